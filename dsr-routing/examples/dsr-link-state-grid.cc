@@ -0,0 +1,143 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+// DSR routes learned in-band by the link-state protocol.
+//
+// Builds a side x side grid of point-to-point links whose routers learn
+// their routes from hellos and LSA flooding instead of from
+// DSRRouteManager.  At --failAt, the link between the first two routers
+// goes down; the program reports when the routers last recomputed their
+// routes and how much control traffic the protocol sent:
+//
+//   ./waf --run "dsr-link-state-grid --side=6 --spfHold=0.5"
+
+#include <iostream>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/ipv4-dsr-routing-helper.h"
+#include "ns3/ipv4-dsr-routing.h"
+#include "ns3/dsr-router-interface.h"
+#include "ns3/dsr-link-state-protocol.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("DsrLinkStateGrid");
+
+namespace {
+
+/// Print when the routers last recomputed their routes and what they sent
+void
+Report (NodeContainer nodes, std::string when)
+{
+  Time last;
+  uint64_t packets = 0;
+  uint64_t bytes = 0;
+  uint32_t runs = 0;
+  for (uint32_t n = 0; n < nodes.GetN (); n++)
+    {
+      Ptr<Ipv4DSRRouting> routing = nodes.Get (n)->GetObject<DSRRouter> ()->GetRoutingProtocol ();
+      Ptr<DSRLinkStateProtocol> protocol = routing->GetLinkStateProtocol ();
+      last = std::max (last, protocol->GetLastSpfTime ());
+      packets += protocol->GetControlPackets ();
+      bytes += protocol->GetControlBytes ();
+      runs += protocol->GetSpfRuns ();
+    }
+  std::cout << when << ": last route computation at " << last.GetSeconds () << " s, "
+            << runs << " computations, " << packets << " control packets, "
+            << bytes << " control bytes" << std::endl;
+}
+
+} // anonymous namespace
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t side = 5;
+  double failAt = 20;
+  double stopAt = 40;
+  double spfHold = 1;
+  double lsaMinInterval = 1;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("side", "Number of routers along each side of the grid", side);
+  cmd.AddValue ("failAt", "Time the first link fails, in seconds", failAt);
+  cmd.AddValue ("stopAt", "Simulation end, in seconds", stopAt);
+  cmd.AddValue ("spfHold", "Minimum time between two route computations, in seconds", spfHold);
+  cmd.AddValue ("lsaMinInterval", "Minimum time between two originations of a router-LSA, in seconds", lsaMinInterval);
+  cmd.Parse (argc, argv);
+
+  Config::SetDefault ("ns3::dsr-routing::Ipv4DSRRouting::InBandProtocol", BooleanValue (true));
+  Config::SetDefault ("ns3::dsr-routing::DSRLinkStateProtocol::SpfHoldTime", TimeValue (Seconds (spfHold)));
+  Config::SetDefault ("ns3::dsr-routing::DSRLinkStateProtocol::LsaMinInterval", TimeValue (Seconds (lsaMinInterval)));
+
+  // ------------------ build topology ---------------------------
+  NodeContainer nodes;
+  nodes.Create (side * side);
+
+  Ipv4DSRRoutingHelper dsr;
+  Ipv4ListRoutingHelper list;
+  list.Add (dsr, 10);
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (list);
+  internet.Install (nodes);
+
+  PointToPointHelper p2p;
+  p2p.SetDeviceAttribute ("DataRate", StringValue ("10Mbps"));
+  p2p.SetChannelAttribute ("Delay", StringValue ("2ms"));
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.255.255.252");
+  NetDeviceContainer first;
+  for (uint32_t row = 0; row < side; row++)
+    {
+      for (uint32_t col = 0; col < side; col++)
+        {
+          uint32_t n = row * side + col;
+          if (col + 1 < side)
+            {
+              NetDeviceContainer devices = p2p.Install (nodes.Get (n), nodes.Get (n + 1));
+              address.Assign (devices);
+              address.NewNetwork ();
+              if (n == 0)
+                {
+                  first = devices;
+                }
+            }
+          if (row + 1 < side)
+            {
+              address.Assign (p2p.Install (nodes.Get (n), nodes.Get (n + side)));
+              address.NewNetwork ();
+            }
+        }
+    }
+
+  // ------------------ fail the first link ----------------------
+  Simulator::Schedule (Seconds (failAt), &Report, nodes, "before the failure");
+  for (uint32_t d = 0; d < first.GetN (); d++)
+    {
+      Ptr<Ipv4> ipv4 = first.Get (d)->GetNode ()->GetObject<Ipv4> ();
+      int32_t interface = ipv4->GetInterfaceForDevice (first.Get (d));
+      Simulator::Schedule (Seconds (failAt), &Ipv4::SetDown, ipv4, interface);
+    }
+
+  Simulator::Stop (Seconds (stopAt));
+  Simulator::Run ();
+  Report (nodes, "at the end");
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,123 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+// DSR route computation in a distributed simulation.
+//
+// Builds a side x side grid of point-to-point links and splits its rows
+// into one band per MPI rank.  Each rank discovers the LSAs of its own
+// routers, the ranks exchange them, and each rank computes the routes of
+// its own routers only.  Compare the wall-clock time of one rank with that
+// of several:
+//
+//   mpirun -np 1 ./waf --run "dsr-mpi-grid --side=40"
+//   mpirun -np 4 ./waf --run "dsr-mpi-grid --side=40"
+//
+// No packets are sent; the simulator is never run.
+
+#include <iostream>
+#include <chrono>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/mpi-interface.h"
+#include "ns3/ipv4-dsr-routing-helper.h"
+#include "ns3/dsr-route-manager.h"
+#include "ns3/dsr-route-manager-impl.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("DsrMpiGrid");
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t side = 20;
+  bool stats = false;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("side", "Number of routers along each side of the grid", side);
+  cmd.AddValue ("stats", "Print the route computation statistics of each rank", stats);
+  cmd.Parse (argc, argv);
+
+  GlobalValue::Bind ("SimulatorImplementationType",
+                     StringValue ("ns3::DistributedSimulatorImpl"));
+  MpiInterface::Enable (&argc, &argv);
+  uint32_t systemId = MpiInterface::GetSystemId ();
+  uint32_t systemCount = MpiInterface::GetSize ();
+
+  // ------------------ build topology ---------------------------
+  // Every rank creates every node; row r belongs to rank r * ranks / side.
+  NodeContainer nodes;
+  for (uint32_t row = 0; row < side; row++)
+    {
+      nodes.Create (side, row * systemCount / side);
+    }
+
+  Ipv4DSRRoutingHelper dsr;
+  Ipv4ListRoutingHelper list;
+  list.Add (dsr, 10);
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (list);
+  internet.Install (nodes);
+
+  PointToPointHelper p2p;
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.255.255.252");
+  for (uint32_t row = 0; row < side; row++)
+    {
+      for (uint32_t col = 0; col < side; col++)
+        {
+          uint32_t n = row * side + col;
+          if (col + 1 < side)
+            {
+              address.Assign (p2p.Install (nodes.Get (n), nodes.Get (n + 1)));
+              address.NewNetwork ();
+            }
+          if (row + 1 < side)
+            {
+              address.Assign (p2p.Install (nodes.Get (n), nodes.Get (n + side)));
+              address.NewNetwork ();
+            }
+        }
+    }
+
+  // ------------------ time the route computation ---------------
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  Ipv4DSRRoutingHelper::PopulateRoutingTables ();
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () - start;
+
+  uint32_t localRouters = 0;
+  for (uint32_t n = 0; n < nodes.GetN (); n++)
+    {
+      if (nodes.Get (n)->GetSystemId () == systemId)
+        {
+          localRouters++;
+        }
+    }
+  std::cout << "rank " << systemId << " of " << systemCount << ": "
+            << localRouters << " of " << nodes.GetN () << " routers, "
+            << elapsed.count () << " s" << std::endl;
+  if (stats)
+    {
+      DSRRouteManager::PrintStats (std::cout);
+    }
+
+  Simulator::Destroy ();
+  MpiInterface::Disable ();
+  return 0;
+}
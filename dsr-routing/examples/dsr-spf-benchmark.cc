@@ -0,0 +1,129 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+// Benchmark of the DSR route computation.
+//
+// Builds a random sparse point-to-point topology (a random spanning tree
+// plus extra random links) with random integer link metrics, then times
+// InitializeRoutes () once with each SPF candidate queue:
+//
+//   ./waf --run "dsr-spf-benchmark --nodes=1000 --extraLinks=1000 --maxMetric=100"
+//
+// No packets are sent; the simulator is never run.
+
+#include <iostream>
+#include <chrono>
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/ipv4-dsr-routing-helper.h"
+#include "ns3/dsr-route-manager.h"
+#include "ns3/dsr-route-manager-impl.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("DsrSpfBenchmark");
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nNodes = 200;
+  uint32_t nExtraLinks = 200;
+  uint32_t maxMetric = 100;
+  uint32_t threads = 1;
+  bool stats = false;
+  std::string backend = "Auto";
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("nodes", "Number of routers", nNodes);
+  cmd.AddValue ("extraLinks", "Number of random links added to the spanning tree", nExtraLinks);
+  cmd.AddValue ("maxMetric", "Link metrics are drawn uniformly from [1, maxMetric]", maxMetric);
+  cmd.AddValue ("threads", "Number of route computation threads", threads);
+  cmd.AddValue ("stats", "Print the route computation statistics of each run", stats);
+  cmd.AddValue ("backend", "SPF backend: Auto, Dijkstra or FloydWarshall", backend);
+  cmd.Parse (argc, argv);
+
+  GlobalValue::Bind ("DsrRouteComputationThreads", UintegerValue (threads));
+  GlobalValue::Bind ("DsrSpfBackend", StringValue (backend));
+
+  // ------------------ build topology ---------------------------
+  NodeContainer nodes;
+  nodes.Create (nNodes);
+
+  Ipv4DSRRoutingHelper dsr;
+  Ipv4ListRoutingHelper list;
+  list.Add (dsr, 10);
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (list);
+  internet.Install (nodes);
+
+  PointToPointHelper p2p;
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.255.255.252");
+  Ptr<UniformRandomVariable> pick = CreateObject<UniformRandomVariable> ();
+  Ptr<UniformRandomVariable> metric = CreateObject<UniformRandomVariable> ();
+  for (uint32_t i = 0; i < nNodes - 1 + nExtraLinks; i++)
+    {
+      uint32_t a, b;
+      if (i < nNodes - 1)
+        {
+          // spanning tree: attach node i+1 to an earlier node
+          a = pick->GetInteger (0, i);
+          b = i + 1;
+        }
+      else
+        {
+          a = pick->GetInteger (0, nNodes - 1);
+          b = pick->GetInteger (0, nNodes - 1);
+          if (a == b)
+            {
+              continue;
+            }
+        }
+      NetDeviceContainer devices = p2p.Install (nodes.Get (a), nodes.Get (b));
+      Ipv4InterfaceContainer interfaces = address.Assign (devices);
+      address.NewNetwork ();
+      uint16_t m = metric->GetInteger (1, maxMetric);
+      for (uint32_t j = 0; j < 2; j++)
+        {
+          std::pair<Ptr<Ipv4>, uint32_t> itf = interfaces.Get (j);
+          itf.first->SetMetric (itf.second, m);
+        }
+    }
+
+  // ------------------ time the route computation ---------------
+  const char* queues[] = {"BinaryHeap", "DialBuckets"};
+  for (uint32_t q = 0; q < 2; q++)
+    {
+      GlobalValue::Bind ("DsrSpfQueue", StringValue (queues[q]));
+      DSRRouteManager::DeleteDSRRoutes ();
+      DSRRouteManager::BuildDSRRoutingDatabase ();
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+      DSRRouteManager::InitializeRoutes ();
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now () - start;
+      std::cout << queues[q] << ": " << nNodes << " nodes, "
+                << elapsed.count () << " s" << std::endl;
+      if (stats)
+        {
+          DSRRouteManager::PrintStats (std::cout);
+        }
+    }
+
+  Simulator::Destroy ();
+  return 0;
+}
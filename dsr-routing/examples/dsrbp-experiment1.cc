@@ -51,6 +51,7 @@
 #include "ns3/applications-module.h"
 #include "ns3/flow-monitor-helper.h"
 #include "ns3/ipv4-dsr-routing-helper.h"
+#include "ns3/dsr-route-controller.h"
 #include "ns3/netanim-module.h"
 #include "ns3/traffic-control-module.h"
 
@@ -68,7 +69,9 @@ main (int argc, char *argv[])
   // DefaultValue::Bind ()s at run-time, via command-line arguments
   CommandLine cmd (__FILE__);
   bool enableFlowMonitor = false;
+  bool enableController = false;
   cmd.AddValue ("EnableMonitor", "Enable Flow Monitor", enableFlowMonitor);
+  cmd.AddValue ("EnableController", "Update the routes from the queue backlogs with DSRRouteController", enableController);
   cmd.Parse (argc, argv);
 
   // ------------------ build topology ---------------------------
@@ -195,6 +198,13 @@ main (int argc, char *argv[])
   // ---------------- Create routingTable ---------------------
   Ipv4DSRRoutingHelper::PopulateRoutingTables ();
 
+  Ptr<DSRRouteController> controller;
+  if (enableController)
+    {
+      controller = CreateObject<DSRRouteController> ();
+      controller->Start ();
+    }
+
   // -------------- Output Routing table & trace files ----------------
   Ipv4DSRRoutingHelper g;
   Ptr<OutputStreamWrapper> routingStream = Create<OutputStreamWrapper>
@@ -205,6 +215,10 @@ main (int argc, char *argv[])
   Simulator::Stop (Seconds (StopTime));
   Simulator::Run ();
 
+  if (controller)
+    {
+      controller->Print (std::cout);
+    }
   Simulator::Destroy ();
   return 0;
 }
@@ -17,16 +17,80 @@
  *
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
+#include <fstream>
+#include <iterator>
+#include <cstring>
+#include <vector>
 #include "ipv4-dsr-routing-helper.h"
 #include "ns3/dsr-router-interface.h"
+#include "ns3/dsr-route-manager.h"
 #include "ns3/ipv4-dsr-routing.h"
 #include "ns3/ipv4-list-routing.h"
+#include "ns3/node-list.h"
+#include "ns3/ipv4.h"
+#include "ns3/inet-socket-address.h"
 #include "ns3/log.h"
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("DSRRoutingHelper");
 
+namespace {
+
+/// Routing table image file identifier
+const char g_dsrImageMagic[8] = {'D', 'S', 'R', 'R', 'T', 'I', 'M', 'G'};
+/// Routing table image format version
+const uint32_t DSR_IMAGE_VERSION = 3;
+/// Byte order mark of the routing table image
+const uint32_t DSR_IMAGE_BYTE_ORDER = 0x01020304;
+
+/// Header of a routing table image
+struct DsrImageHeader
+{
+  char m_magic[8];          //!< g_dsrImageMagic
+  uint32_t m_version;       //!< DSR_IMAGE_VERSION
+  uint32_t m_byteOrder;     //!< DSR_IMAGE_BYTE_ORDER, as written by the host
+  uint64_t m_topologyHash;  //!< DSRRouteManager::GetTopologyHash () of the tables
+  uint32_t m_nNodes;        //!< number of node records
+  uint32_t m_nRoutes;       //!< number of route records
+};
+
+/// Node record of a routing table image
+struct DsrImageNode
+{
+  uint32_t m_nodeId;                                        //!< node ID
+  uint32_t m_nRoutes[Ipv4DSRRouting::N_ROUTE_TABLES];       //!< routes in each table
+};
+
+/// Route record of a routing table image
+struct DsrImageRoute
+{
+  uint32_t m_dest;          //!< destination address or network
+  uint32_t m_mask;          //!< destination network mask
+  uint32_t m_gateway;       //!< next hop, 0.0.0.0 if none
+  uint32_t m_interface;     //!< output interface
+  uint32_t m_distance;      //!< distance between root and destination
+  uint32_t m_roundTrip;     //!< distance to the next hop and back, 0 if unknown
+};
+
+/**
+ * \brief Get the DSR routing protocol of a node
+ * \param node the node
+ * \returns the routing protocol, 0 if the node has no DSRRouter
+ */
+Ptr<Ipv4DSRRouting>
+DsrGetRouting (Ptr<Node> node)
+{
+  Ptr<DSRRouter> router = node->GetObject<DSRRouter> ();
+  if (router == 0)
+    {
+      return 0;
+    }
+  return router->GetRoutingProtocol ();
+}
+
+} // anonymous namespace
+
 Ipv4DSRRoutingHelper::Ipv4DSRRoutingHelper ()
 {
 }
@@ -66,10 +130,209 @@ Ipv4DSRRoutingHelper::PopulateRoutingTables (void)
 void 
 Ipv4DSRRoutingHelper::RecomputeRoutingTables (void)
 {
+  DSRRouteManager::RecomputeRoutes ();
+}
+void 
+Ipv4DSRRoutingHelper::UpdateRoutingTables (void)
+{
+  DSRRouteManager::UpdateRoutes ();
+}
+
+bool
+Ipv4DSRRoutingHelper::SaveRoutingTables (std::string path)
+{
+  NS_LOG_FUNCTION (path);
+  std::vector<DsrImageNode> nodes;
+  std::vector<DsrImageRoute> records;
+  std::vector<Ipv4DSRRoutingTableEntry> routes;
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); i++)
+    {
+      Ptr<Ipv4DSRRouting> routing = DsrGetRouting (*i);
+      if (routing == 0)
+        {
+          continue;
+        }
+      DsrImageNode node;
+      node.m_nodeId = (*i)->GetId ();
+      for (uint32_t t = 0; t < Ipv4DSRRouting::N_ROUTE_TABLES; t++)
+        {
+          routes.clear ();
+          routing->GetRoutes (Ipv4DSRRouting::RouteTable (t), routes);
+          node.m_nRoutes[t] = routes.size ();
+          for (std::vector<Ipv4DSRRoutingTableEntry>::const_iterator r = routes.begin (); r != routes.end (); r++)
+            {
+              DsrImageRoute record;
+              record.m_dest = r->GetDest ().Get ();
+              record.m_mask = r->GetDestNetworkMask ().Get ();
+              record.m_gateway = r->GetGateway ().Get ();
+              record.m_interface = r->GetInterface ();
+              record.m_distance = r->GetDistance ();
+              record.m_roundTrip = r->GetRoundTrip ();
+              records.push_back (record);
+            }
+        }
+      nodes.push_back (node);
+    }
+
+  DsrImageHeader header;
+  std::memset (&header, 0, sizeof (header));
+  std::memcpy (header.m_magic, g_dsrImageMagic, sizeof (header.m_magic));
+  header.m_version = DSR_IMAGE_VERSION;
+  header.m_byteOrder = DSR_IMAGE_BYTE_ORDER;
+  header.m_topologyHash = DSRRouteManager::GetTopologyHash ();
+  header.m_nNodes = nodes.size ();
+  header.m_nRoutes = records.size ();
+
+  std::ofstream out (path.c_str (), std::ios::binary | std::ios::trunc);
+  if (!out)
+    {
+      NS_LOG_WARN ("Cannot open " << path);
+      return false;
+    }
+  out.write (reinterpret_cast<const char*> (&header), sizeof (header));
+  if (!nodes.empty ())
+    {
+      out.write (reinterpret_cast<const char*> (&nodes[0]), nodes.size () * sizeof (DsrImageNode));
+    }
+  if (!records.empty ())
+    {
+      out.write (reinterpret_cast<const char*> (&records[0]), records.size () * sizeof (DsrImageRoute));
+    }
+  NS_LOG_LOGIC ("Saved " << records.size () << " routes of " << nodes.size () << " nodes to " << path);
+  return out.good ();
+}
+
+bool
+Ipv4DSRRoutingHelper::LoadRoutingTables (std::string path)
+{
+  NS_LOG_FUNCTION (path);
   DSRRouteManager::DeleteDSRRoutes ();
   DSRRouteManager::BuildDSRRoutingDatabase ();
-  DSRRouteManager::InitializeRoutes ();
+
+  std::ifstream in (path.c_str (), std::ios::binary);
+  if (!in)
+    {
+      NS_LOG_WARN ("Cannot open " << path);
+      return false;
+    }
+  std::vector<char> image ((std::istreambuf_iterator<char> (in)), std::istreambuf_iterator<char> ());
+  DsrImageHeader header;
+  if (image.size () < sizeof (header))
+    {
+      NS_LOG_WARN (path << " is not a routing table image");
+      return false;
+    }
+  std::memcpy (&header, &image[0], sizeof (header));
+  if (std::memcmp (header.m_magic, g_dsrImageMagic, sizeof (header.m_magic)) != 0
+      || header.m_version != DSR_IMAGE_VERSION || header.m_byteOrder != DSR_IMAGE_BYTE_ORDER
+      || image.size () != sizeof (header) + uint64_t (header.m_nNodes) * sizeof (DsrImageNode)
+                          + uint64_t (header.m_nRoutes) * sizeof (DsrImageRoute))
+    {
+      NS_LOG_WARN (path << " is not a version " << DSR_IMAGE_VERSION << " routing table image of this host");
+      return false;
+    }
+  if (header.m_topologyHash != DSRRouteManager::GetTopologyHash ())
+    {
+      NS_LOG_WARN (path << " holds the routing tables of another topology");
+      return false;
+    }
+
+//
+// Check every node record before touching any table.
+//
+  const char* nodeRecords = &image[sizeof (header)];
+  const char* routeRecords = nodeRecords + header.m_nNodes * sizeof (DsrImageNode);
+  std::vector<Ptr<Ipv4DSRRouting> > tables (header.m_nNodes);
+  uint64_t nRoutes = 0;
+  for (uint32_t n = 0; n < header.m_nNodes; n++)
+    {
+      DsrImageNode node;
+      std::memcpy (&node, nodeRecords + n * sizeof (DsrImageNode), sizeof (node));
+      if (node.m_nodeId < NodeList::GetNNodes ())
+        {
+          tables[n] = DsrGetRouting (NodeList::GetNode (node.m_nodeId));
+        }
+      if (tables[n] == 0)
+        {
+          NS_LOG_WARN (path << " holds routes of node " << node.m_nodeId << ", which has no DSR router");
+          return false;
+        }
+      for (uint32_t t = 0; t < Ipv4DSRRouting::N_ROUTE_TABLES; t++)
+        {
+          nRoutes += node.m_nRoutes[t];
+        }
+    }
+  if (nRoutes != header.m_nRoutes)
+    {
+      NS_LOG_WARN (path << " is truncated");
+      return false;
+    }
+
+  std::vector<Ipv4DSRRoutingTableEntry> routes;
+  for (uint32_t n = 0; n < header.m_nNodes; n++)
+    {
+      DsrImageNode node;
+      std::memcpy (&node, nodeRecords + n * sizeof (DsrImageNode), sizeof (node));
+      for (uint32_t t = 0; t < Ipv4DSRRouting::N_ROUTE_TABLES; t++)
+        {
+          routes.clear ();
+          routes.reserve (node.m_nRoutes[t]);
+          for (uint32_t r = 0; r < node.m_nRoutes[t]; r++, routeRecords += sizeof (DsrImageRoute))
+            {
+              DsrImageRoute record;
+              std::memcpy (&record, routeRecords, sizeof (record));
+              if (record.m_mask == Ipv4Mask::GetOnes ().Get ())
+                {
+                  routes.push_back (Ipv4DSRRoutingTableEntry::CreateHostRouteTo (Ipv4Address (record.m_dest),
+                                                                                 Ipv4Address (record.m_gateway),
+                                                                                 record.m_interface,
+                                                                                 record.m_distance,
+                                                                                 record.m_roundTrip));
+                }
+              else
+                {
+                  routes.push_back (Ipv4DSRRoutingTableEntry::CreateNetworkRouteTo (Ipv4Address (record.m_dest),
+                                                                                    Ipv4Mask (record.m_mask),
+                                                                                    Ipv4Address (record.m_gateway),
+                                                                                    record.m_interface,
+                                                                                    record.m_distance));
+                }
+            }
+          tables[n]->AddRoutes (Ipv4DSRRouting::RouteTable (t), routes);
+        }
+    }
+  NS_LOG_LOGIC ("Loaded " << header.m_nRoutes << " routes of " << header.m_nNodes << " nodes from " << path);
+  return true;
 }
 
+void
+Ipv4DSRRoutingHelper::PrewarmRoutes (ApplicationContainer sinks)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  for (ApplicationContainer::Iterator i = sinks.Begin (); i != sinks.End (); i++)
+    {
+      AddressValue local;
+      (*i)->GetAttribute ("Local", local);
+      if (InetSocketAddress::IsMatchingType (local.Get ()))
+        {
+          Ipv4Address address = InetSocketAddress::ConvertFrom (local.Get ()).GetIpv4 ();
+          if (address != Ipv4Address::GetAny ())
+            {
+              DSRRouteManager::ComputeRoutesTo (address);
+              continue;
+            }
+        }
+      // a sink bound to any address receives on every address of its node,
+      // all of which lead to the same router
+      Ptr<Ipv4> ipv4 = (*i)->GetNode ()->GetObject<Ipv4> ();
+      for (uint32_t j = 0; ipv4 != 0 && j < ipv4->GetNInterfaces (); j++)
+        {
+          for (uint32_t k = 0; k < ipv4->GetNAddresses (j); k++)
+            {
+              DSRRouteManager::ComputeRoutesTo (ipv4->GetAddress (j, k).GetLocal ());
+            }
+        }
+    }
+}
 
 } // namespace ns3
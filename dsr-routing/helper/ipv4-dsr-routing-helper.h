@@ -20,7 +20,9 @@
 #ifndef IPV4_DSR_ROUTING_HELPER_H
 #define IPV4_DSR_ROUTING_HELPER_H
 
+#include <string>
 #include "ns3/node-container.h"
+#include "ns3/application-container.h"
 #include "ns3/ipv4-routing-helper.h"
 
 namespace ns3 {
@@ -72,9 +74,13 @@ public:
    */
   static void PopulateRoutingTables (void);
   /**
-   * \brief Remove all routes that were previously installed in a prior call
-   * to either PopulateRoutingTables() or RecomputeRoutingTables(), and 
-   * add a new set of routes.
+   * \brief Replace all routes that were previously installed in a prior call
+   * to either PopulateRoutingTables() or RecomputeRoutingTables() with a new
+   * set of routes.
+   *
+   * The new routes are computed aside and compared with the installed
+   * ones, and only the routes that differ are added, removed or updated
+   * (see DSRRouteComputationStats for the churn of each node).
    * 
    * This method does not change the set of nodes
    * over which GlobalRouting is being used, but it will dynamically update
@@ -84,6 +90,62 @@ public:
    *
    */
   static void RecomputeRoutingTables (void);
+  /**
+   * \brief Bring the routing tables up to date after link metrics or
+   * states changed.
+   *
+   * Same result as RecomputeRoutingTables(), but only the routes that the
+   * change affects are recomputed and only the tables that differ are
+   * rewritten.  Interface up/down and address events already do this when
+   * the routing protocol responds to interface events; link metric changes
+   * are not notified, so call this after changing them.
+   */
+  static void UpdateRoutingTables (void);
+
+  /**
+   * \brief Write the routing tables of every node to a file.
+   *
+   * The image is a versioned binary file of fixed-size records: a header
+   * holding the topology hash, one index record per node with the number
+   * of routes in each of its tables, then every route.  It is written in
+   * the byte order of the host and can be mapped into memory as is.
+   *
+   * Call it after PopulateRoutingTables() or RecomputeRoutingTables(),
+   * whose routing database provides the topology hash.
+   *
+   * \param path the file name
+   * \returns true if the image was written
+   */
+  static bool SaveRoutingTables (std::string path);
+
+  /**
+   * \brief Install the routing tables of every node from a file written
+   * by SaveRoutingTables().
+   *
+   * Builds the routing database and checks that its topology hash matches
+   * the image before replacing the routes of every node; no SPF computation
+   * runs.  On failure the routing database is built but no route is
+   * installed, and RecomputeRoutingTables() computes them.  A later
+   * UpdateRoutingTables() recomputes every route.
+   *
+   * \param path the file name
+   * \returns true if the routes were installed
+   */
+  static bool LoadRoutingTables (std::string path);
+
+  /**
+   * \brief Compute the routes to the addresses some sinks are bound to.
+   *
+   * With the DsrLazyRouting global value, routes to a router are computed
+   * by the first packet that needs them.  Call this after
+   * PopulateRoutingTables() to compute the routes to the nodes of the
+   * sinks up front instead; a sink bound to any address gets the routes to
+   * its node.  Does nothing without DsrLazyRouting.
+   *
+   * \param sinks applications with a Local attribute, such as the
+   * DsrPacketSink applications installed by DsrSinkHelper
+   */
+  static void PrewarmRoutes (ApplicationContainer sinks);
 private:
   /**
    * \brief Assignment operator declared private and not implemented to disallow
@@ -0,0 +1,828 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <algorithm>
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/packet.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/uinteger.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/ipv4-packet-info-tag.h"
+#include "ns3/udp-socket-factory.h"
+#include "dsr-link-state-protocol.h"
+#include "dsr-route-manager-impl.h"
+#include "dsr-router-interface.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("DSRLinkStateProtocol");
+
+NS_OBJECT_ENSURE_REGISTERED (DSRLinkStateHeader);
+NS_OBJECT_ENSURE_REGISTERED (DSRLinkStateProtocol);
+
+// ---------------------------------------------------------------------------
+//
+// DSRLinkStateHeader Implementation
+//
+// ---------------------------------------------------------------------------
+
+DSRLinkStateHeader::DSRLinkStateHeader ()
+  : m_type (HELLO),
+    m_nodeId (0),
+    m_sequence (0)
+{
+}
+
+TypeId
+DSRLinkStateHeader::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::dsr-routing::DSRLinkStateHeader")
+    .SetParent<Header> ()
+    .SetGroupName ("Dsr-routing")
+    .AddConstructor<DSRLinkStateHeader> ()
+  ;
+  return tid;
+}
+
+TypeId
+DSRLinkStateHeader::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+void
+DSRLinkStateHeader::Print (std::ostream &os) const
+{
+  os << (m_type == HELLO ? "hello" : "link-state") << " router " << m_routerId
+     << " node " << m_nodeId << " seq " << m_sequence << " records " << m_records.size ();
+}
+
+uint32_t
+DSRLinkStateHeader::GetSerializedSize (void) const
+{
+  // type, reserved, record count, router ID, node ID, sequence number
+  return 16 + 16 * m_records.size ();
+}
+
+void
+DSRLinkStateHeader::Serialize (Buffer::Iterator start) const
+{
+  Buffer::Iterator i = start;
+  i.WriteU8 (m_type);
+  i.WriteU8 (0);
+  i.WriteHtonU16 (m_records.size ());
+  i.WriteHtonU32 (m_routerId.Get ());
+  i.WriteHtonU32 (m_nodeId);
+  i.WriteHtonU32 (m_sequence);
+  for (std::vector<Record>::const_iterator r = m_records.begin (); r != m_records.end (); r++)
+    {
+      i.WriteU8 (r->m_linkType);
+      i.WriteU8 (0);
+      i.WriteHtonU16 (0);
+      i.WriteHtonU32 (r->m_linkId.Get ());
+      i.WriteHtonU32 (r->m_linkData.Get ());
+      i.WriteHtonU32 (r->m_metric);
+    }
+}
+
+uint32_t
+DSRLinkStateHeader::Deserialize (Buffer::Iterator start)
+{
+  Buffer::Iterator i = start;
+  m_type = i.ReadU8 ();
+  i.ReadU8 ();
+  uint16_t nRecords = i.ReadNtohU16 ();
+  m_routerId = Ipv4Address (i.ReadNtohU32 ());
+  m_nodeId = i.ReadNtohU32 ();
+  m_sequence = i.ReadNtohU32 ();
+  m_records.resize (nRecords);
+  for (uint16_t j = 0; j < nRecords; j++)
+    {
+      m_records[j].m_linkType = i.ReadU8 ();
+      i.ReadU8 ();
+      i.ReadNtohU16 ();
+      m_records[j].m_linkId = Ipv4Address (i.ReadNtohU32 ());
+      m_records[j].m_linkData = Ipv4Address (i.ReadNtohU32 ());
+      m_records[j].m_metric = i.ReadNtohU32 ();
+    }
+  return GetSerializedSize ();
+}
+
+void
+DSRLinkStateHeader::SetType (MessageType type)
+{
+  m_type = type;
+}
+
+DSRLinkStateHeader::MessageType
+DSRLinkStateHeader::GetType (void) const
+{
+  return MessageType (m_type);
+}
+
+void
+DSRLinkStateHeader::SetRouterId (Ipv4Address routerId)
+{
+  m_routerId = routerId;
+}
+
+Ipv4Address
+DSRLinkStateHeader::GetRouterId (void) const
+{
+  return m_routerId;
+}
+
+void
+DSRLinkStateHeader::SetNodeId (uint32_t nodeId)
+{
+  m_nodeId = nodeId;
+}
+
+uint32_t
+DSRLinkStateHeader::GetNodeId (void) const
+{
+  return m_nodeId;
+}
+
+void
+DSRLinkStateHeader::SetSequence (uint32_t sequence)
+{
+  m_sequence = sequence;
+}
+
+uint32_t
+DSRLinkStateHeader::GetSequence (void) const
+{
+  return m_sequence;
+}
+
+void
+DSRLinkStateHeader::AddRecord (const Record& record)
+{
+  m_records.push_back (record);
+}
+
+const std::vector<DSRLinkStateHeader::Record>&
+DSRLinkStateHeader::GetRecords (void) const
+{
+  return m_records;
+}
+
+// ---------------------------------------------------------------------------
+//
+// DSRLinkStateProtocol Implementation
+//
+// ---------------------------------------------------------------------------
+
+TypeId
+DSRLinkStateProtocol::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::dsr-routing::DSRLinkStateProtocol")
+    .SetParent<Object> ()
+    .SetGroupName ("Dsr-routing")
+    .AddConstructor<DSRLinkStateProtocol> ()
+    .AddAttribute ("Port",
+                   "UDP port of the hello and link state packets",
+                   UintegerValue (7208),
+                   MakeUintegerAccessor (&DSRLinkStateProtocol::m_port),
+                   MakeUintegerChecker<uint16_t> ())
+    .AddAttribute ("HelloInterval",
+                   "Time between two hellos on an interface",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&DSRLinkStateProtocol::m_helloInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("RouterDeadInterval",
+                   "Time without a hello after which a neighbour is lost",
+                   TimeValue (Seconds (4)),
+                   MakeTimeAccessor (&DSRLinkStateProtocol::m_deadInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("LsaMinInterval",
+                   "Minimum time between two originations of the router-LSA",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&DSRLinkStateProtocol::m_lsaMinInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("LsaRefreshInterval",
+                   "Time between two refreshes of an unchanged router-LSA",
+                   TimeValue (Seconds (30)),
+                   MakeTimeAccessor (&DSRLinkStateProtocol::m_lsaRefreshInterval),
+                   MakeTimeChecker ())
+    .AddAttribute ("LsaMaxAge",
+                   "Time after which an LSA that was not refreshed is purged",
+                   TimeValue (Seconds (120)),
+                   MakeTimeAccessor (&DSRLinkStateProtocol::m_lsaMaxAge),
+                   MakeTimeChecker ())
+    .AddAttribute ("SpfHoldTime",
+                   "Minimum time between two route computations, doubled for each "
+                   "change that comes within it",
+                   TimeValue (Seconds (1)),
+                   MakeTimeAccessor (&DSRLinkStateProtocol::m_spfHoldTime),
+                   MakeTimeChecker ())
+    .AddAttribute ("SpfMaxHoldTime",
+                   "Largest minimum time between two route computations",
+                   TimeValue (Seconds (10)),
+                   MakeTimeAccessor (&DSRLinkStateProtocol::m_spfMaxHoldTime),
+                   MakeTimeChecker ())
+    .AddTraceSource ("Tx",
+                     "A hello or link state packet is sent",
+                     MakeTraceSourceAccessor (&DSRLinkStateProtocol::m_txTrace),
+                     "ns3::Packet::TracedCallback")
+    .AddTraceSource ("Spf",
+                     "The routes were recomputed from the given number of LSAs",
+                     MakeTraceSourceAccessor (&DSRLinkStateProtocol::m_spfTrace),
+                     "ns3::DSRLinkStateProtocol::SpfTracedCallback")
+  ;
+  return tid;
+}
+
+DSRLinkStateProtocol::DSRLinkStateProtocol ()
+  : m_port (7208),
+    m_helloInterval (Seconds (1)),
+    m_deadInterval (Seconds (4)),
+    m_lsaMinInterval (Seconds (1)),
+    m_lsaRefreshInterval (Seconds (30)),
+    m_lsaMaxAge (Seconds (120)),
+    m_spfHoldTime (Seconds (1)),
+    m_spfMaxHoldTime (Seconds (10)),
+    m_sequence (0),
+    m_routeManager (0),
+    m_started (false),
+    m_controlPackets (0),
+    m_controlBytes (0),
+    m_spfRuns (0)
+{
+  NS_LOG_FUNCTION (this);
+  m_rand = CreateObject<UniformRandomVariable> ();
+}
+
+DSRLinkStateProtocol::~DSRLinkStateProtocol ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+DSRLinkStateProtocol::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (std::map<NeighborKey, Neighbor>::iterator i = m_neighbors.begin (); i != m_neighbors.end (); i++)
+    {
+      i->second.m_deadEvent.Cancel ();
+    }
+  m_neighbors.clear ();
+  for (std::map<uint32_t, EventId>::iterator i = m_helloEvents.begin (); i != m_helloEvents.end (); i++)
+    {
+      i->second.Cancel ();
+    }
+  m_helloEvents.clear ();
+  for (std::map<uint32_t, Ptr<Socket> >::iterator i = m_sendSockets.begin (); i != m_sendSockets.end (); i++)
+    {
+      i->second->Close ();
+    }
+  m_sendSockets.clear ();
+  if (m_recvSocket)
+    {
+      m_recvSocket->Close ();
+      m_recvSocket = 0;
+    }
+  m_originateEvent.Cancel ();
+  m_refreshEvent.Cancel ();
+  m_spfEvent.Cancel ();
+  for (std::map<uint32_t, StoredLsa>::iterator i = m_lsdb.begin (); i != m_lsdb.end (); i++)
+    {
+      i->second.m_ageEvent.Cancel ();
+    }
+  m_lsdb.clear ();
+  if (m_routeManager)
+    {
+      delete m_routeManager;
+      m_routeManager = 0;
+    }
+  m_ipv4 = 0;
+  m_node = 0;
+  Object::DoDispose ();
+}
+
+void
+DSRLinkStateProtocol::SetIpv4 (Ptr<Ipv4> ipv4)
+{
+  NS_LOG_FUNCTION (this << ipv4);
+  m_ipv4 = ipv4;
+  m_node = ipv4->GetObject<Node> ();
+}
+
+int64_t
+DSRLinkStateProtocol::AssignStreams (int64_t stream)
+{
+  NS_LOG_FUNCTION (this << stream);
+  m_rand->SetStream (stream);
+  return 1;
+}
+
+uint64_t
+DSRLinkStateProtocol::GetControlPackets (void) const
+{
+  return m_controlPackets;
+}
+
+uint64_t
+DSRLinkStateProtocol::GetControlBytes (void) const
+{
+  return m_controlBytes;
+}
+
+uint32_t
+DSRLinkStateProtocol::GetSpfRuns (void) const
+{
+  return m_spfRuns;
+}
+
+Time
+DSRLinkStateProtocol::GetLastSpfTime (void) const
+{
+  return m_lastSpf;
+}
+
+void
+DSRLinkStateProtocol::Start (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT_MSG (m_node, "DSRLinkStateProtocol::Start (): SetIpv4 () not called");
+  Ptr<DSRRouter> router = m_node->GetObject<DSRRouter> ();
+  NS_ASSERT_MSG (router, "DSRLinkStateProtocol::Start (): node has no DSRRouter");
+  m_routerId = router->GetRouterId ();
+  m_routeManager = new DSRRouteManagerImpl ();
+  m_spfHold = m_spfHoldTime;
+  m_started = true;
+
+  m_recvSocket = Socket::CreateSocket (m_node, UdpSocketFactory::GetTypeId ());
+  m_recvSocket->Bind (InetSocketAddress (Ipv4Address::GetAny (), m_port));
+  m_recvSocket->SetRecvCallback (MakeCallback (&DSRLinkStateProtocol::Receive, this));
+  m_recvSocket->SetRecvPktInfo (true);
+
+  for (uint32_t i = 1; i < m_ipv4->GetNInterfaces (); i++)
+    {
+      if (IsProtocolInterface (i))
+        {
+          OpenSocket (i);
+        }
+    }
+  // the first router-LSA only has the stub networks; the adjacencies
+  // follow with the hellos
+  Originate ();
+}
+
+bool
+DSRLinkStateProtocol::IsProtocolInterface (uint32_t interface) const
+{
+  return interface > 0 && m_ipv4->IsUp (interface) && m_ipv4->GetNAddresses (interface) > 0;
+}
+
+void
+DSRLinkStateProtocol::OpenSocket (uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << interface);
+  if (m_sendSockets.find (interface) != m_sendSockets.end ())
+    {
+      return;
+    }
+  Ptr<Socket> socket = Socket::CreateSocket (m_node, UdpSocketFactory::GetTypeId ());
+  socket->Bind ();
+  socket->BindToNetDevice (m_ipv4->GetNetDevice (interface));
+  socket->SetAllowBroadcast (true);
+  socket->SetIpTtl (1);
+  m_sendSockets[interface] = socket;
+  // jitter the first hello so that the routers do not all send at once
+  m_helloEvents[interface] =
+    Simulator::Schedule (Seconds (m_rand->GetValue (0, 0.1 * m_helloInterval.GetSeconds ())),
+                         &DSRLinkStateProtocol::SendHello, this, interface);
+}
+
+bool
+DSRLinkStateProtocol::CloseSocket (uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << interface);
+  std::map<uint32_t, Ptr<Socket> >::iterator socket = m_sendSockets.find (interface);
+  if (socket != m_sendSockets.end ())
+    {
+      socket->second->Close ();
+      m_sendSockets.erase (socket);
+    }
+  m_helloEvents[interface].Cancel ();
+  m_helloEvents.erase (interface);
+  bool twoWay = false;
+  std::map<NeighborKey, Neighbor>::iterator neighbor = m_neighbors.lower_bound (NeighborKey (interface, 0));
+  while (neighbor != m_neighbors.end () && neighbor->first.first == interface)
+    {
+      twoWay = twoWay || neighbor->second.m_twoWay;
+      neighbor->second.m_deadEvent.Cancel ();
+      m_neighbors.erase (neighbor++);
+    }
+  return twoWay;
+}
+
+bool
+DSRLinkStateProtocol::HasAdjacency (uint32_t interface) const
+{
+  std::map<NeighborKey, Neighbor>::const_iterator neighbor = m_neighbors.lower_bound (NeighborKey (interface, 0));
+  for (; neighbor != m_neighbors.end () && neighbor->first.first == interface; neighbor++)
+    {
+      if (neighbor->second.m_twoWay)
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+DSRLinkStateProtocol::NotifyInterfaceUp (uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << interface);
+  if (!m_started || !IsProtocolInterface (interface))
+    {
+      return;
+    }
+  OpenSocket (interface);
+  // the stub network of the interface is back
+  ScheduleOriginate ();
+}
+
+void
+DSRLinkStateProtocol::NotifyInterfaceDown (uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << interface);
+  if (!m_started)
+    {
+      return;
+    }
+  CloseSocket (interface);
+  ScheduleOriginate ();
+}
+
+void
+DSRLinkStateProtocol::NotifyAddressChange (uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << interface);
+  if (!m_started)
+    {
+      return;
+    }
+  CloseSocket (interface);
+  if (IsProtocolInterface (interface))
+    {
+      OpenSocket (interface);
+    }
+  ScheduleOriginate ();
+}
+
+void
+DSRLinkStateProtocol::SendTo (uint32_t interface, const DSRLinkStateHeader& header)
+{
+  NS_LOG_FUNCTION (this << interface << header);
+  std::map<uint32_t, Ptr<Socket> >::iterator socket = m_sendSockets.find (interface);
+  if (socket == m_sendSockets.end ())
+    {
+      return;
+    }
+  Ptr<Packet> packet = Create<Packet> ();
+  packet->AddHeader (header);
+  m_controlPackets++;
+  m_controlBytes += packet->GetSize ();
+  m_txTrace (packet);
+  socket->second->SendTo (packet, 0, InetSocketAddress (Ipv4Address::GetBroadcast (), m_port));
+}
+
+void
+DSRLinkStateProtocol::SendHello (uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << interface);
+  DSRLinkStateHeader header;
+  header.SetType (DSRLinkStateHeader::HELLO);
+  header.SetRouterId (m_routerId);
+  header.SetNodeId (m_node->GetId ());
+  std::map<NeighborKey, Neighbor>::const_iterator neighbor = m_neighbors.lower_bound (NeighborKey (interface, 0));
+  for (; neighbor != m_neighbors.end () && neighbor->first.first == interface; neighbor++)
+    {
+      DSRLinkStateHeader::Record record;
+      record.m_linkType = DSRRoutingLinkRecord::PointToPoint;
+      record.m_linkId = Ipv4Address (neighbor->first.second);
+      record.m_linkData = m_ipv4->GetAddress (interface, 0).GetLocal ();
+      record.m_metric = 0;
+      header.AddRecord (record);
+    }
+  SendTo (interface, header);
+  m_helloEvents[interface] =
+    Simulator::Schedule (m_helloInterval, &DSRLinkStateProtocol::SendHello, this, interface);
+}
+
+void
+DSRLinkStateProtocol::Receive (Ptr<Socket> socket)
+{
+  NS_LOG_FUNCTION (this << socket);
+  Address from;
+  Ptr<Packet> packet = socket->RecvFrom (from);
+  Ipv4PacketInfoTag info;
+  if (!packet->RemovePacketTag (info))
+    {
+      NS_LOG_WARN ("No incoming interface on a control packet, dropping");
+      return;
+    }
+  int32_t interface = m_ipv4->GetInterfaceForDevice (m_node->GetDevice (info.GetRecvIf ()));
+  if (interface < 0 || m_sendSockets.find (interface) == m_sendSockets.end ())
+    {
+      return;
+    }
+  DSRLinkStateHeader header;
+  packet->RemoveHeader (header);
+  if (header.GetRouterId () == m_routerId)
+    {
+      return;
+    }
+  NS_LOG_LOGIC ("Received " << header << " on interface " << interface);
+  if (header.GetType () == DSRLinkStateHeader::HELLO)
+    {
+      HandleHello (interface, header);
+    }
+  else if (header.GetType () == DSRLinkStateHeader::LINK_STATE)
+    {
+      HandleLinkState (interface, header);
+    }
+}
+
+void
+DSRLinkStateProtocol::HandleHello (uint32_t interface, const DSRLinkStateHeader& header)
+{
+  NS_LOG_FUNCTION (this << interface);
+  bool twoWay = false;
+  const std::vector<DSRLinkStateHeader::Record>& records = header.GetRecords ();
+  for (uint32_t j = 0; j < records.size (); j++)
+    {
+      twoWay = twoWay || records[j].m_linkId == m_routerId;
+    }
+
+  NeighborKey key (interface, header.GetRouterId ().Get ());
+  std::map<NeighborKey, Neighbor>::iterator i = m_neighbors.find (key);
+  bool changed = false;
+  if (i == m_neighbors.end ())
+    {
+      i = m_neighbors.insert (std::make_pair (key, Neighbor ())).first;
+      i->second.m_twoWay = false;
+      // answer at once so that the neighbour sees us without waiting for
+      // the next hello
+      m_helloEvents[interface].Cancel ();
+      SendHello (interface);
+    }
+  i->second.m_deadEvent.Cancel ();
+  i->second.m_deadEvent =
+    Simulator::Schedule (m_deadInterval, &DSRLinkStateProtocol::NeighborDead, this,
+                         interface, header.GetRouterId ());
+  if (twoWay != i->second.m_twoWay)
+    {
+      i->second.m_twoWay = twoWay;
+      changed = true;
+      if (twoWay)
+        {
+          // database exchange, simplified: a new adjacency gets every LSA
+          NS_LOG_LOGIC ("Adjacency with " << header.GetRouterId () << " on interface " << interface);
+          for (std::map<uint32_t, StoredLsa>::const_iterator l = m_lsdb.begin (); l != m_lsdb.end (); l++)
+            {
+              DSRLinkStateHeader lsa;
+              lsa.SetType (DSRLinkStateHeader::LINK_STATE);
+              lsa.SetRouterId (Ipv4Address (l->first));
+              lsa.SetNodeId (l->second.m_nodeId);
+              lsa.SetSequence (l->second.m_sequence);
+              for (uint32_t j = 0; j < l->second.m_records.size (); j++)
+                {
+                  lsa.AddRecord (l->second.m_records[j]);
+                }
+              SendTo (interface, lsa);
+            }
+        }
+    }
+  if (changed)
+    {
+      ScheduleOriginate ();
+    }
+}
+
+void
+DSRLinkStateProtocol::NeighborDead (uint32_t interface, Ipv4Address routerId)
+{
+  NS_LOG_FUNCTION (this << interface << routerId);
+  std::map<NeighborKey, Neighbor>::iterator i = m_neighbors.find (NeighborKey (interface, routerId.Get ()));
+  if (i == m_neighbors.end ())
+    {
+      return;
+    }
+  NS_LOG_LOGIC ("Lost neighbour " << routerId << " on interface " << interface);
+  bool twoWay = i->second.m_twoWay;
+  m_neighbors.erase (i);
+  if (twoWay)
+    {
+      ScheduleOriginate ();
+    }
+}
+
+void
+DSRLinkStateProtocol::HandleLinkState (uint32_t interface, const DSRLinkStateHeader& header)
+{
+  NS_LOG_FUNCTION (this << interface);
+  if (!HasAdjacency (interface))
+    {
+      return;
+    }
+  uint32_t routerId = header.GetRouterId ().Get ();
+  std::map<uint32_t, StoredLsa>::iterator i = m_lsdb.find (routerId);
+  if (i != m_lsdb.end () && header.GetSequence () <= i->second.m_sequence)
+    {
+      return;
+    }
+  StoredLsa& lsa = m_lsdb[routerId];
+  lsa.m_nodeId = header.GetNodeId ();
+  lsa.m_sequence = header.GetSequence ();
+  lsa.m_records = header.GetRecords ();
+  lsa.m_ageEvent.Cancel ();
+  lsa.m_ageEvent = Simulator::Schedule (m_lsaMaxAge, &DSRLinkStateProtocol::LsaExpired, this, header.GetRouterId ());
+  Flood (header.GetRouterId (), interface);
+  ScheduleSpf ();
+}
+
+void
+DSRLinkStateProtocol::LsaExpired (Ipv4Address routerId)
+{
+  NS_LOG_FUNCTION (this << routerId);
+  NS_LOG_LOGIC ("Purging the router-LSA of " << routerId);
+  m_lsdb.erase (routerId.Get ());
+  ScheduleSpf ();
+}
+
+void
+DSRLinkStateProtocol::Flood (Ipv4Address routerId, uint32_t except)
+{
+  NS_LOG_FUNCTION (this << routerId << except);
+  const StoredLsa& stored = m_lsdb[routerId.Get ()];
+  DSRLinkStateHeader header;
+  header.SetType (DSRLinkStateHeader::LINK_STATE);
+  header.SetRouterId (routerId);
+  header.SetNodeId (stored.m_nodeId);
+  header.SetSequence (stored.m_sequence);
+  for (uint32_t j = 0; j < stored.m_records.size (); j++)
+    {
+      header.AddRecord (stored.m_records[j]);
+    }
+  for (std::map<uint32_t, Ptr<Socket> >::const_iterator i = m_sendSockets.begin (); i != m_sendSockets.end (); i++)
+    {
+      if (i->first != except && HasAdjacency (i->first))
+        {
+          SendTo (i->first, header);
+        }
+    }
+}
+
+void
+DSRLinkStateProtocol::ScheduleOriginate (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_originateEvent.IsRunning ())
+    {
+      return;
+    }
+  Time earliest = m_lastOriginate + m_lsaMinInterval;
+  Time delay = earliest > Simulator::Now () ? earliest - Simulator::Now () : Seconds (0);
+  m_originateEvent = Simulator::Schedule (delay, &DSRLinkStateProtocol::Originate, this);
+}
+
+void
+DSRLinkStateProtocol::Originate (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_originateEvent.Cancel ();
+  m_refreshEvent.Cancel ();
+  Ptr<DSRRouter> router = m_node->GetObject<DSRRouter> ();
+  StoredLsa& lsa = m_lsdb[m_routerId.Get ()];
+  lsa.m_nodeId = m_node->GetId ();
+  lsa.m_sequence = ++m_sequence;
+  lsa.m_records.clear ();
+  for (uint32_t i = 1; i < m_ipv4->GetNInterfaces (); i++)
+    {
+      if (!IsProtocolInterface (i))
+        {
+          continue;
+        }
+      Ipv4InterfaceAddress address = m_ipv4->GetAddress (i, 0);
+      uint32_t metric = router->GetLinkMetric (m_ipv4->GetNetDevice (i), m_ipv4, i);
+      DSRLinkStateHeader::Record record;
+      std::map<NeighborKey, Neighbor>::const_iterator neighbor = m_neighbors.lower_bound (NeighborKey (i, 0));
+      for (; neighbor != m_neighbors.end () && neighbor->first.first == i; neighbor++)
+        {
+          if (!neighbor->second.m_twoWay)
+            {
+              continue;
+            }
+          record.m_linkType = DSRRoutingLinkRecord::PointToPoint;
+          record.m_linkId = Ipv4Address (neighbor->first.second);
+          record.m_linkData = address.GetLocal ();
+          record.m_metric = metric;
+          lsa.m_records.push_back (record);
+        }
+      record.m_linkType = DSRRoutingLinkRecord::StubNetwork;
+      record.m_linkId = address.GetLocal ().CombineMask (address.GetMask ());
+      record.m_linkData = Ipv4Address (address.GetMask ().Get ());
+      record.m_metric = metric;
+      lsa.m_records.push_back (record);
+    }
+  NS_LOG_LOGIC ("Originating router-LSA " << m_sequence << " with " << lsa.m_records.size () << " records");
+  m_lastOriginate = Simulator::Now ();
+  Flood (m_routerId, 0);
+  m_refreshEvent = Simulator::Schedule (m_lsaRefreshInterval, &DSRLinkStateProtocol::Originate, this);
+  ScheduleSpf ();
+}
+
+void
+DSRLinkStateProtocol::ScheduleSpf (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_spfEvent.IsRunning ())
+    {
+      return;
+    }
+  Time delay = Seconds (0);
+  if (m_spfRuns > 0 && m_lastSpf + m_spfHold > Simulator::Now ())
+    {
+      // the topology is still changing: wait for the hold to end, and hold
+      // longer after the next computation
+      delay = m_lastSpf + m_spfHold - Simulator::Now ();
+      m_spfHold = std::min (m_spfHold + m_spfHold, std::max (m_spfMaxHoldTime, m_spfHoldTime));
+    }
+  else
+    {
+      m_spfHold = m_spfHoldTime;
+    }
+  m_spfEvent = Simulator::Schedule (delay, &DSRLinkStateProtocol::RunSpf, this);
+}
+
+void
+DSRLinkStateProtocol::RunSpf (void)
+{
+  NS_LOG_FUNCTION (this);
+//
+// Turn the database into the router-LSAs DSRRouteManagerImpl computes on.
+// A point-to-point link is only used once both ends advertise it, as in
+// the two-way check of RFC 2328 16.1 (2b); until then the database may
+// hold one side of a link that just came up or went down.
+//
+  DSRRouteManagerLSDB* lsdb = new DSRRouteManagerLSDB ();
+  for (std::map<uint32_t, StoredLsa>::const_iterator i = m_lsdb.begin (); i != m_lsdb.end (); i++)
+    {
+      DSRRoutingLSA* lsa = new DSRRoutingLSA ();
+      lsa->SetLSType (DSRRoutingLSA::RouterLSA);
+      lsa->SetLinkStateId (Ipv4Address (i->first));
+      lsa->SetAdvertisingRouter (Ipv4Address (i->first));
+      lsa->SetNode (NodeList::GetNode (i->second.m_nodeId));
+      for (uint32_t j = 0; j < i->second.m_records.size (); j++)
+        {
+          const DSRLinkStateHeader::Record& record = i->second.m_records[j];
+          if (record.m_linkType == DSRRoutingLinkRecord::PointToPoint)
+            {
+              std::map<uint32_t, StoredLsa>::const_iterator peer = m_lsdb.find (record.m_linkId.Get ());
+              bool twoWay = false;
+              for (uint32_t k = 0; peer != m_lsdb.end () && k < peer->second.m_records.size (); k++)
+                {
+                  twoWay = twoWay ||
+                    (peer->second.m_records[k].m_linkType == DSRRoutingLinkRecord::PointToPoint &&
+                     peer->second.m_records[k].m_linkId.Get () == i->first);
+                }
+              if (!twoWay)
+                {
+                  continue;
+                }
+            }
+          lsa->AddLinkRecord (new DSRRoutingLinkRecord (DSRRoutingLinkRecord::LinkType (record.m_linkType),
+                                                        record.m_linkId, record.m_linkData,
+                                                        record.m_metric));
+        }
+      lsdb->Insert (lsa->GetLinkStateId (), lsa);
+    }
+  m_routeManager->ComputeNodeRoutes (lsdb, m_node->GetId ());
+  m_lastSpf = Simulator::Now ();
+  m_spfRuns++;
+  NS_LOG_LOGIC ("Recomputed the routes of router " << m_routerId << " from " << m_lsdb.size () << " LSAs");
+  m_spfTrace (m_lsdb.size ());
+}
+
+} // namespace ns3
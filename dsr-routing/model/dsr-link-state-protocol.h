@@ -0,0 +1,424 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef DSR_LINK_STATE_PROTOCOL_H
+#define DSR_LINK_STATE_PROTOCOL_H
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+#include "ns3/object.h"
+#include "ns3/header.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4.h"
+#include "ns3/socket.h"
+#include "ns3/traced-callback.h"
+#include "ns3/random-variable-stream.h"
+
+namespace ns3 {
+
+class Node;
+class Packet;
+class DSRRouteManagerImpl;
+
+/**
+ * \ingroup dsr-routing
+ *
+ * \brief Header of the packets of the in-band link-state protocol
+ *
+ * A hello lists, as point-to-point records, the routers the sender has
+ * heard on the interface it is sent on.  A link state update carries one
+ * router-LSA: a point-to-point record per adjacent router and a stub record
+ * per interface, as DSRRouter::DiscoverLSAs () describes a router.
+ */
+class DSRLinkStateHeader : public Header
+{
+public:
+  /// Packet types
+  enum MessageType
+  {
+    HELLO = 1,        //!< neighbour discovery
+    LINK_STATE = 2,   //!< router-LSA
+  };
+
+  /// One link record of a hello or a router-LSA
+  struct Record
+  {
+    uint8_t m_linkType;     //!< DSRRoutingLinkRecord::LinkType
+    Ipv4Address m_linkId;   //!< neighbour router ID, or stub network
+    Ipv4Address m_linkData; //!< local interface address, or stub mask
+    uint32_t m_metric;      //!< cost of the link
+  };
+
+  DSRLinkStateHeader ();
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual void Print (std::ostream &os) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (Buffer::Iterator start) const;
+  virtual uint32_t Deserialize (Buffer::Iterator start);
+
+  /**
+   * \brief Set the packet type
+   * \param type the packet type
+   */
+  void SetType (MessageType type);
+  /**
+   * \brief Get the packet type
+   * \return the packet type
+   */
+  MessageType GetType (void) const;
+  /**
+   * \brief Set the router ID of the originator
+   * \param routerId the router ID
+   */
+  void SetRouterId (Ipv4Address routerId);
+  /**
+   * \brief Get the router ID of the originator
+   * \return the router ID
+   */
+  Ipv4Address GetRouterId (void) const;
+  /**
+   * \brief Set the node ID of the originator
+   * \param nodeId the node ID
+   */
+  void SetNodeId (uint32_t nodeId);
+  /**
+   * \brief Get the node ID of the originator
+   * \return the node ID
+   */
+  uint32_t GetNodeId (void) const;
+  /**
+   * \brief Set the sequence number of a router-LSA
+   * \param sequence the sequence number
+   */
+  void SetSequence (uint32_t sequence);
+  /**
+   * \brief Get the sequence number of a router-LSA
+   * \return the sequence number
+   */
+  uint32_t GetSequence (void) const;
+  /**
+   * \brief Append a link record
+   * \param record the record
+   */
+  void AddRecord (const Record& record);
+  /**
+   * \brief Get the link records
+   * \return the records, in packet order
+   */
+  const std::vector<Record>& GetRecords (void) const;
+
+private:
+  uint8_t m_type;                //!< packet type
+  Ipv4Address m_routerId;        //!< router ID of the originator
+  uint32_t m_nodeId;             //!< node ID of the originator
+  uint32_t m_sequence;           //!< LSA sequence number
+  std::vector<Record> m_records; //!< link records
+};
+
+/**
+ * \ingroup dsr-routing
+ *
+ * \brief In-band link-state protocol of a DSR router
+ *
+ * Instead of reading every LSA from the nodes at once, as DSRRouteManager
+ * does, each router learns the topology from packets sent over the
+ * simulated links, in the spirit of OSPFv2 \RFC{2328}:
+ *
+ * - hellos are broadcast on every interface and list every router heard
+ *   on it; a neighbour is adjacent once it lists this router in its own
+ *   hellos, and is lost after RouterDeadInterval without one;
+ * - each router originates a router-LSA with a sequence number whenever
+ *   its adjacencies change, no more often than LsaMinInterval, and
+ *   refreshes it every LsaRefreshInterval;
+ * - a newer LSA is stored and flooded on every interface with an adjacency
+ *   but the one it came from; a new adjacency gets the whole database;
+ * - an LSA that is not refreshed within LsaMaxAge is purged, so that the
+ *   LSAs of routers that are gone for good stop being used;
+ * - routes are recomputed by the SPF code of DSRRouteManagerImpl
+ *   restricted to this node, over the links both ends advertise.  A change
+ *   within the hold time of the previous computation waits for the hold to
+ *   end and doubles it, up to SpfMaxHoldTime; the hold is back to
+ *   SpfHoldTime once a change comes after it.
+ *
+ * Neighbours are told apart by interface and router ID, so every router
+ * of a broadcast network is adjacent to every other one and advertised as
+ * a point-to-point link, as in the point-to-multipoint networks of
+ * \RFC{2328}; there is no designated router election and no network-LSA.
+ * There is no LSA acknowledgement either, lost updates being repaired by
+ * the periodic refresh, and a purged LSA is not flooded: each router ages
+ * its own copy.
+ */
+class DSRLinkStateProtocol : public Object
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  DSRLinkStateProtocol ();
+  virtual ~DSRLinkStateProtocol ();
+
+  /**
+   * TracedCallback signature for route computations.
+   *
+   * \param [in] nLsas the number of router-LSAs the routes were computed from
+   */
+  typedef void (* SpfTracedCallback)(uint32_t nLsas);
+
+  /**
+   * \brief Set the IPv4 stack the protocol runs on
+   * \param ipv4 the IPv4 stack of the router
+   */
+  void SetIpv4 (Ptr<Ipv4> ipv4);
+
+  /**
+   * \brief Open the sockets and start sending hellos
+   */
+  void Start (void);
+
+  /**
+   * \brief Handle an interface that came up
+   * \param interface the interface index
+   */
+  void NotifyInterfaceUp (uint32_t interface);
+
+  /**
+   * \brief Handle an interface that went down
+   * \param interface the interface index
+   */
+  void NotifyInterfaceDown (uint32_t interface);
+
+  /**
+   * \brief Handle an address change
+   * \param interface the interface index
+   */
+  void NotifyAddressChange (uint32_t interface);
+
+  /**
+   * \brief Get the number of control packets sent
+   * \return the number of hello and link state packets
+   */
+  uint64_t GetControlPackets (void) const;
+
+  /**
+   * \brief Get the number of control bytes sent
+   * \return the size of the hello and link state packets, without the
+   * UDP and IP headers
+   */
+  uint64_t GetControlBytes (void) const;
+
+  /**
+   * \brief Get the number of route computations
+   * \return the number of times the routing table was recomputed
+   */
+  uint32_t GetSpfRuns (void) const;
+
+  /**
+   * \brief Get the time of the last route computation
+   * \return the simulation time the routing table was last rewritten
+   */
+  Time GetLastSpfTime (void) const;
+
+  /**
+   * Assign a fixed random variable stream number to the random variables
+   * used by this model.  Return the number of streams (possibly zero) that
+   * have been assigned.
+   *
+   * \param stream first stream index to use
+   * \return the number of stream indices assigned by this model
+   */
+  int64_t AssignStreams (int64_t stream);
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /// A neighbour heard on an interface
+  struct Neighbor
+  {
+    bool m_twoWay;          //!< whether the neighbour hears us
+    EventId m_deadEvent;    //!< expiry of the neighbour
+  };
+
+  /// Interface and router ID of a neighbour
+  typedef std::pair<uint32_t, uint32_t> NeighborKey;
+
+  /// A router-LSA of the database
+  struct StoredLsa
+  {
+    uint32_t m_nodeId;   //!< node of the originator
+    uint32_t m_sequence; //!< sequence number
+    std::vector<DSRLinkStateHeader::Record> m_records; //!< link records
+    EventId m_ageEvent;  //!< purge of the LSA, unless refreshed
+  };
+
+  /**
+   * \brief Whether an interface takes part in the protocol
+   * \param interface the interface index
+   * \return true if the interface is up, is not the loopback and has an
+   * address
+   */
+  bool IsProtocolInterface (uint32_t interface) const;
+
+  /**
+   * \brief Open the sending socket of an interface
+   * \param interface the interface index
+   */
+  void OpenSocket (uint32_t interface);
+
+  /**
+   * \brief Close the sending socket of an interface and forget its neighbours
+   * \param interface the interface index
+   * \return true if an adjacency was lost
+   */
+  bool CloseSocket (uint32_t interface);
+
+  /**
+   * \brief Whether a neighbour on an interface hears this router
+   * \param interface the interface index
+   * \return true if the interface has an adjacency
+   */
+  bool HasAdjacency (uint32_t interface) const;
+
+  /**
+   * \brief Send a packet on an interface
+   * \param interface the interface index
+   * \param header the packet header
+   */
+  void SendTo (uint32_t interface, const DSRLinkStateHeader& header);
+
+  /**
+   * \brief Send a hello on an interface and schedule the next one
+   * \param interface the interface index
+   */
+  void SendHello (uint32_t interface);
+
+  /**
+   * \brief Receive a control packet
+   * \param socket the receiving socket
+   */
+  void Receive (Ptr<Socket> socket);
+
+  /**
+   * \brief Handle a hello
+   * \param interface the receiving interface
+   * \param header the packet header
+   */
+  void HandleHello (uint32_t interface, const DSRLinkStateHeader& header);
+
+  /**
+   * \brief Handle a router-LSA
+   * \param interface the receiving interface
+   * \param header the packet header
+   */
+  void HandleLinkState (uint32_t interface, const DSRLinkStateHeader& header);
+
+  /**
+   * \brief Forget a neighbour whose hellos stopped
+   * \param interface the interface of the neighbour
+   * \param routerId the router ID of the neighbour
+   */
+  void NeighborDead (uint32_t interface, Ipv4Address routerId);
+
+  /**
+   * \brief Purge a router-LSA that was not refreshed within LsaMaxAge
+   * \param routerId the originator of the LSA
+   */
+  void LsaExpired (Ipv4Address routerId);
+
+  /**
+   * \brief Send a stored router-LSA on every interface with an adjacency
+   * but one
+   * \param routerId the originator of the LSA
+   * \param except the interface not to send on, or 0
+   */
+  void Flood (Ipv4Address routerId, uint32_t except);
+
+  /**
+   * \brief Originate the router-LSA of this router now, or as soon as
+   * LsaMinInterval allows
+   */
+  void ScheduleOriginate (void);
+
+  /**
+   * \brief Originate the router-LSA of this router
+   */
+  void Originate (void);
+
+  /**
+   * \brief Recompute the routes now, or once the current hold time is over
+   */
+  void ScheduleSpf (void);
+
+  /**
+   * \brief Recompute the routes from the database
+   */
+  void RunSpf (void);
+
+  Ptr<Ipv4> m_ipv4;              //!< IPv4 stack of the router
+  Ptr<Node> m_node;              //!< the router
+  Ipv4Address m_routerId;        //!< router ID of the router
+  uint16_t m_port;               //!< UDP port of the protocol
+  Time m_helloInterval;          //!< time between hellos
+  Time m_deadInterval;           //!< time without hello before a neighbour is lost
+  Time m_lsaMinInterval;         //!< minimum time between two originations
+  Time m_lsaRefreshInterval;     //!< time between refreshes of the router-LSA
+  Time m_lsaMaxAge;              //!< time after which an LSA not refreshed is purged
+  Time m_spfHoldTime;            //!< initial minimum time between two route computations
+  Time m_spfMaxHoldTime;         //!< longest minimum time between two route computations
+  Ptr<UniformRandomVariable> m_rand; //!< jitter of the hellos
+
+  Ptr<Socket> m_recvSocket;      //!< socket receiving every control packet
+  std::map<uint32_t, Ptr<Socket> > m_sendSockets; //!< sending socket of each interface
+  std::map<uint32_t, EventId> m_helloEvents;      //!< next hello of each interface
+  std::map<NeighborKey, Neighbor> m_neighbors;    //!< neighbours by interface and router ID
+  std::map<uint32_t, StoredLsa> m_lsdb;           //!< router-LSAs by router ID
+
+  uint32_t m_sequence;           //!< sequence number of the last origination
+  Time m_lastOriginate;          //!< time of the last origination
+  EventId m_originateEvent;      //!< pending origination
+  EventId m_refreshEvent;        //!< next refresh
+  Time m_lastSpf;                //!< time of the last route computation
+  Time m_spfHold;                //!< current minimum time between two route computations
+  EventId m_spfEvent;            //!< pending route computation
+  DSRRouteManagerImpl* m_routeManager; //!< SPF code, restricted to this node
+  bool m_started;                //!< whether Start () was called
+
+  uint64_t m_controlPackets;     //!< control packets sent
+  uint64_t m_controlBytes;       //!< control bytes sent
+  uint32_t m_spfRuns;            //!< route computations
+
+  /// Trace of the control packets sent
+  TracedCallback<Ptr<const Packet> > m_txTrace;
+  /// Trace of the route computations, with the number of LSAs used
+  TracedCallback<uint32_t> m_spfTrace;
+};
+
+} // namespace ns3
+
+#endif /* DSR_LINK_STATE_PROTOCOL_H */
@@ -0,0 +1,327 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include "ns3/global-value.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/ipv4.h"
+#include "ns3/traffic-control-layer.h"
+#include "dsr-route-controller.h"
+#include "dsr-route-manager.h"
+#include "dsr-router-interface.h"
+#include "dsr-virtual-queue-disc.h"
+#include "ipv4-dsr-routing.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("DSRRouteController");
+
+NS_OBJECT_ENSURE_REGISTERED (DSRRouteController);
+
+namespace {
+
+/// Lanes of DsrVirtualQueueDisc that carry delay-guaranteed packets
+const uint32_t DSR_GUARANTEED_LANES = 2;
+
+/// Route choices of a router towards one destination
+struct DsrRouteChoice
+{
+  uint32_t m_best;       //!< shortest current distance
+  uint64_t m_localCost;  //!< least initial distance plus local queueing delay
+  uint32_t m_local;      //!< current distance of the route of least local cost
+};
+
+} // anonymous namespace
+
+TypeId
+DSRRouteController::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::dsr-routing::DSRRouteController")
+    .SetParent<Object> ()
+    .SetGroupName ("Dsr-routing")
+    .AddConstructor<DSRRouteController> ()
+    .AddAttribute ("Interval",
+                   "Time between two readings of the queues",
+                   TimeValue (MilliSeconds (100)),
+                   MakeTimeAccessor (&DSRRouteController::m_interval),
+                   MakeTimeChecker ())
+    .AddAttribute ("Threshold",
+                   "Smallest change of the queueing delay of an interface that updates the routes",
+                   TimeValue (MicroSeconds (500)),
+                   MakeTimeAccessor (&DSRRouteController::m_threshold),
+                   MakeTimeChecker ())
+    .AddTraceSource ("Update",
+                     "The routes were updated after the given number of queueing delays changed",
+                     MakeTraceSourceAccessor (&DSRRouteController::m_updateTrace),
+                     "ns3::DSRRouteController::UpdateTracedCallback")
+  ;
+  return tid;
+}
+
+DSRRouteController::DSRRouteController ()
+  : m_interval (MilliSeconds (100)),
+    m_threshold (MicroSeconds (500)),
+    m_polls (0),
+    m_updates (0),
+    m_changedLinks (0),
+    m_decisions (0),
+    m_improvedDecisions (0),
+    m_gain (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+DSRRouteController::~DSRRouteController ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+DSRRouteController::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_pollEvent.Cancel ();
+  m_distances.clear ();
+  Object::DoDispose ();
+}
+
+void
+DSRRouteController::Start (void)
+{
+  NS_LOG_FUNCTION (this);
+  //
+  // A poll only changes link costs.  Without the SPF results of the last
+  // computation, each update would recompute every route of the network, so
+  // compute them once more with the results kept.
+  //
+  BooleanValue incremental;
+  GlobalValue::GetValueByName ("DsrIncrementalRouting", incremental);
+  if (!incremental.Get ())
+    {
+      NS_LOG_INFO ("Enabling DsrIncrementalRouting and recomputing the routes");
+      GlobalValue::Bind ("DsrIncrementalRouting", BooleanValue (true));
+      DSRRouteManager::RecomputeRoutes ();
+    }
+  m_distances.assign (NodeList::GetNNodes (), Distances_t ());
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); i++)
+    {
+      Ptr<DSRRouter> router = (*i)->GetObject<DSRRouter> ();
+      if (router == 0)
+        {
+          continue;
+        }
+      std::vector<Ipv4DSRRoutingTableEntry> routes;
+      router->GetRoutingProtocol ()->GetRoutes (Ipv4DSRRouting::HOST_ROUTES, routes);
+      router->GetRoutingProtocol ()->GetRoutes (Ipv4DSRRouting::NODE_ROUTES, routes);
+      Distances_t& distances = m_distances[(*i)->GetId ()];
+      for (uint32_t r = 0; r < routes.size (); r++)
+        {
+          std::pair<uint32_t, uint32_t> key (routes[r].GetDest ().Get (), routes[r].GetInterface ());
+          Distances_t::iterator d = distances.find (key);
+          if (d == distances.end () || d->second > routes[r].GetDistance ())
+            {
+              distances[key] = routes[r].GetDistance ();
+            }
+        }
+    }
+  m_pollEvent.Cancel ();
+  m_pollEvent = Simulator::Schedule (m_interval, &DSRRouteController::Poll, this);
+}
+
+void
+DSRRouteController::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_pollEvent.Cancel ();
+}
+
+uint32_t
+DSRRouteController::GetQueueingDelay (Ptr<DsrVirtualQueueDisc> queue) const
+{
+  uint64_t backlog = 0;
+  double delay = 0;
+  for (uint32_t lane = 0; lane < DSR_GUARANTEED_LANES; lane++)
+    {
+      uint32_t packets = queue->GetLaneBacklog (lane);
+      backlog += packets;
+      delay += packets * queue->GetLaneSojournTime (lane).GetMicroSeconds ();
+    }
+  return backlog == 0 ? 0 : static_cast<uint32_t> (delay / backlog);
+}
+
+void
+DSRRouteController::Poll (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_polls++;
+  uint64_t threshold = m_threshold.GetMicroSeconds ();
+  uint32_t changed = 0;
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); i++)
+    {
+      Ptr<DSRRouter> router = (*i)->GetObject<DSRRouter> ();
+      Ptr<TrafficControlLayer> tc = (*i)->GetObject<TrafficControlLayer> ();
+      Ptr<Ipv4> ipv4 = (*i)->GetObject<Ipv4> ();
+      if (router == 0 || tc == 0 || ipv4 == 0)
+        {
+          continue;
+        }
+      for (uint32_t interface = 0; interface < ipv4->GetNInterfaces (); interface++)
+        {
+          Ptr<DsrVirtualQueueDisc> queue =
+            DynamicCast<DsrVirtualQueueDisc> (tc->GetRootQueueDiscOnDevice (ipv4->GetNetDevice (interface)));
+          if (queue == 0)
+            {
+              continue;
+            }
+          uint32_t delay = GetQueueingDelay (queue);
+          uint32_t advertised = router->GetQueueingDelay (interface);
+          uint32_t change = delay > advertised ? delay - advertised : advertised - delay;
+          if (change > 0 && change >= threshold)
+            {
+              NS_LOG_LOGIC ("Node " << (*i)->GetId () << " interface " << interface
+                            << ": queueing delay " << advertised << " -> " << delay << " us");
+              router->SetQueueingDelay (interface, delay);
+              changed++;
+            }
+        }
+    }
+  if (changed > 0)
+    {
+      NS_LOG_INFO ("Updating the routes after " << changed << " queueing delay changes");
+      m_updates++;
+      m_changedLinks += changed;
+      DSRRouteManager::UpdateRoutes ();
+      m_updateTrace (changed);
+    }
+  CompareDecisions ();
+  m_pollEvent = Simulator::Schedule (m_interval, &DSRRouteController::Poll, this);
+}
+
+void
+DSRRouteController::CompareDecisions (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); i++)
+    {
+      Ptr<DSRRouter> router = (*i)->GetObject<DSRRouter> ();
+      if (router == 0 || (*i)->GetId () >= m_distances.size ())
+        {
+          continue;
+        }
+      const Distances_t& distances = m_distances[(*i)->GetId ()];
+      std::vector<Ipv4DSRRoutingTableEntry> routes;
+      router->GetRoutingProtocol ()->GetRoutes (Ipv4DSRRouting::HOST_ROUTES, routes);
+      router->GetRoutingProtocol ()->GetRoutes (Ipv4DSRRouting::NODE_ROUTES, routes);
+      std::map<uint32_t, DsrRouteChoice> choices;
+      for (uint32_t r = 0; r < routes.size (); r++)
+        {
+          uint32_t dest = routes[r].GetDest ().Get ();
+          uint32_t interface = routes[r].GetInterface ();
+          Distances_t::const_iterator d = distances.find (std::make_pair (dest, interface));
+          if (d == distances.end ())
+            {
+              continue;
+            }
+          uint64_t localCost = static_cast<uint64_t> (d->second) + router->GetQueueingDelay (interface);
+          uint32_t distance = routes[r].GetDistance ();
+          std::map<uint32_t, DsrRouteChoice>::iterator c = choices.find (dest);
+          if (c == choices.end ())
+            {
+              DsrRouteChoice choice;
+              choice.m_best = distance;
+              choice.m_localCost = localCost;
+              choice.m_local = distance;
+              choices[dest] = choice;
+              continue;
+            }
+          c->second.m_best = std::min (c->second.m_best, distance);
+          if (localCost < c->second.m_localCost)
+            {
+              c->second.m_localCost = localCost;
+              c->second.m_local = distance;
+            }
+        }
+      for (std::map<uint32_t, DsrRouteChoice>::const_iterator c = choices.begin (); c != choices.end (); c++)
+        {
+          m_decisions++;
+          if (c->second.m_local > c->second.m_best)
+            {
+              m_improvedDecisions++;
+              m_gain += c->second.m_local - c->second.m_best;
+            }
+        }
+    }
+}
+
+uint32_t
+DSRRouteController::GetPolls (void) const
+{
+  return m_polls;
+}
+
+uint32_t
+DSRRouteController::GetUpdates (void) const
+{
+  return m_updates;
+}
+
+uint64_t
+DSRRouteController::GetChangedLinks (void) const
+{
+  return m_changedLinks;
+}
+
+uint64_t
+DSRRouteController::GetDecisions (void) const
+{
+  return m_decisions;
+}
+
+uint64_t
+DSRRouteController::GetImprovedDecisions (void) const
+{
+  return m_improvedDecisions;
+}
+
+Time
+DSRRouteController::GetMeanGain (void) const
+{
+  if (m_decisions == 0)
+    {
+      return Time (0);
+    }
+  return MicroSeconds (static_cast<double> (m_gain) / m_decisions);
+}
+
+void
+DSRRouteController::Print (std::ostream& os) const
+{
+  os << "polls " << m_polls << ", route updates " << m_updates
+     << ", queueing delay changes " << m_changedLinks << std::endl;
+  os << "route choices compared " << m_decisions << ", improved by the global view "
+     << m_improvedDecisions;
+  if (m_decisions > 0)
+    {
+      os << " (" << 100.0 * m_improvedDecisions / m_decisions << "%)";
+    }
+  os << ", mean gain " << GetMeanGain ().GetMicroSeconds () << " us" << std::endl;
+}
+
+} // namespace ns3
@@ -0,0 +1,182 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef DSR_ROUTE_CONTROLLER_H
+#define DSR_ROUTE_CONTROLLER_H
+
+#include <map>
+#include <vector>
+#include <ostream>
+#include <stdint.h>
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/traced-callback.h"
+
+namespace ns3 {
+
+class DsrVirtualQueueDisc;
+
+/**
+ * \ingroup dsr-routing
+ *
+ * \brief Centralized, congestion-aware computation of the DSR routes
+ *
+ * An idealized baseline for the local forwarding decisions of
+ * Ipv4DSRRouting: every Interval, the controller reads the lanes of every
+ * DsrVirtualQueueDisc installed on a router interface, and estimates the
+ * queueing delay of the interface as the mean sojourn time of the
+ * delay-guaranteed lanes, weighted by their backlog.  The estimates that
+ * moved by at least Threshold are handed to DSRRouter::SetQueueingDelay ()
+ * and DSRRouteManager::UpdateRoutes () is called once, so the distances of
+ * the delay-guaranteed routes become propagation plus queueing delay.
+ * Start () sets DsrIncrementalRouting, so that each update only repeats the
+ * SPF runs the changed links can affect and only rewrites the tables whose
+ * routes changed; with DsrKShortestPaths above 1, every update still
+ * recomputes all the routes.
+ *
+ * To measure what the global view buys, the controller keeps the distances
+ * the routes had when it started.  After each poll, for every router and
+ * destination, it compares the route a router would pick from those
+ * distances plus the queueing delays of its own interfaces, which is all a
+ * local decision sees, with the route of least current distance.  The mean
+ * difference of their current distances is the gain of the global view.
+ *
+ * The controller is meant for routes computed by DSRRouteManager, with
+ * DsrLinkMetric set to ChannelDelay so that metrics are in microseconds.
+ */
+class DSRRouteController : public Object
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  DSRRouteController ();
+  virtual ~DSRRouteController ();
+
+  /**
+   * TracedCallback signature for route updates.
+   *
+   * \param [in] nLinks the number of interfaces whose queueing delay changed
+   */
+  typedef void (* UpdateTracedCallback)(uint32_t nLinks);
+
+  /**
+   * \brief Record the current distances and start polling the queues
+   *
+   * The routes must have been computed, and no queueing delay set yet.  If
+   * DsrIncrementalRouting is not set, it is bound to true and the routes
+   * are recomputed once, to keep the SPF results the updates start from.
+   */
+  void Start (void);
+
+  /**
+   * \brief Stop polling the queues
+   */
+  void Stop (void);
+
+  /**
+   * \brief Get the number of polls
+   * \return the number of times the queues were read
+   */
+  uint32_t GetPolls (void) const;
+
+  /**
+   * \brief Get the number of route updates
+   * \return the number of polls that changed a queueing delay
+   */
+  uint32_t GetUpdates (void) const;
+
+  /**
+   * \brief Get the number of queueing delay changes
+   * \return the number of interface delays changed, over all updates
+   */
+  uint64_t GetChangedLinks (void) const;
+
+  /**
+   * \brief Get the number of route choices compared
+   * \return the number of (router, destination) pairs compared, over all polls
+   */
+  uint64_t GetDecisions (void) const;
+
+  /**
+   * \brief Get the number of route choices the global view improves
+   * \return the number of compared pairs whose local choice is longer
+   * than the shortest current route
+   */
+  uint64_t GetImprovedDecisions (void) const;
+
+  /**
+   * \brief Get the gain of the global view
+   * \return the mean, over the compared pairs, of the current distance of
+   * the local choice minus the shortest current distance
+   */
+  Time GetMeanGain (void) const;
+
+  /**
+   * \brief Print the counters and the gain of the global view
+   * \param os the output stream
+   */
+  void Print (std::ostream& os) const;
+
+protected:
+  virtual void DoDispose (void);
+
+private:
+  /// Distance of each route of a router, by (destination, interface)
+  typedef std::map<std::pair<uint32_t, uint32_t>, uint32_t> Distances_t;
+
+  /**
+   * \brief Estimate the queueing delay of an interface from its queue disc
+   * \param queue the queue disc of the interface
+   * \return the backlog-weighted sojourn time of the delay-guaranteed
+   * lanes, in microseconds
+   */
+  uint32_t GetQueueingDelay (Ptr<DsrVirtualQueueDisc> queue) const;
+
+  /**
+   * \brief Read the queues, update the routes if needed, and reschedule
+   */
+  void Poll (void);
+
+  /**
+   * \brief Compare the local and global route choices of every router
+   */
+  void CompareDecisions (void);
+
+  Time m_interval;                       //!< time between two polls
+  Time m_threshold;                      //!< smallest delay change pushed to the routes
+  EventId m_pollEvent;                   //!< next poll
+  std::vector<Distances_t> m_distances;  //!< distances at Start (), by node ID
+
+  uint32_t m_polls;                      //!< polls
+  uint32_t m_updates;                    //!< polls that changed a delay
+  uint64_t m_changedLinks;               //!< delays changed
+  uint64_t m_decisions;                  //!< route choices compared
+  uint64_t m_improvedDecisions;          //!< route choices the global view improves
+  uint64_t m_gain;                       //!< sum of the gains, in microseconds
+
+  /// Trace of the route updates, with the number of delays changed
+  TracedCallback<uint32_t> m_updateTrace;
+};
+
+} // namespace ns3
+
+#endif /* DSR_ROUTE_CONTROLLER_H */
@@ -27,6 +27,14 @@
 #include <queue>
 #include <algorithm>
 #include <iostream>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <set>
+#include <chrono>
+#ifdef NS3_MPI
+#include <mpi.h>
+#endif
 #include "ns3/assert.h"
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
@@ -34,385 +42,24 @@
 #include "ns3/ipv4.h"
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/ipv4-list-routing.h"
+#include "ns3/global-value.h"
+#include "ns3/uinteger.h"
+#include "ns3/enum.h"
+#include "ns3/boolean.h"
+#include "ns3/nstime.h"
+#include "ns3/hash.h"
+#include "ns3/simulator.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
 #include "dsr-router-interface.h"
 #include "dsr-route-manager-impl.h"
-#include "dsr-candidate-queue.h"
 #include "ipv4-dsr-routing.h"
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("DSRRouteManagerImpl");
 
-/**
- * \brief Stream insertion operator.
- *
- * \param os the reference to the output stream
- * \param exit the exit node
- * \returns the reference to the output stream
- */
-std::ostream& 
-operator<< (std::ostream& os, const DSRVertex::NodeExit_t& exit)
-{
-  os << "(" << exit.first << " ," << exit.second << ")";
-  return os;
-}
-
-std::ostream& 
-operator<< (std::ostream& os, const DSRVertex::ListOfDSRVertex_t& vs)
-{
-  typedef DSRVertex::ListOfDSRVertex_t::const_iterator CIter_t;
-  os << "{";
-  for (CIter_t iter = vs.begin (); iter != vs.end ();)
-    {
-      os << (*iter)->m_vertexId;
-      if (++iter != vs.end ()) 
-        {
-          os << ", ";
-        }
-      else 
-        { 
-          break;
-        }
-    }
-  os << "}";
-  return os;
-}
-
-// ---------------------------------------------------------------------------
-//
-// DSRVertex Implementation
-//
-// ---------------------------------------------------------------------------
-
-DSRVertex::DSRVertex () : 
-  m_vertexType (VertexUnknown), 
-  m_vertexId ("255.255.255.255"), 
-  m_lsa (0),
-  m_distanceFromRoot (DISTINFINITY), 
-  m_rootOif (DISTINFINITY),
-  m_nextHop ("0.0.0.0"),
-  m_parents (),
-  m_children (),
-  m_vertexProcessed (false)
-{
-  NS_LOG_FUNCTION (this);
-}
-
-DSRVertex::DSRVertex (DSRRoutingLSA* lsa) : 
-  m_vertexId (lsa->GetLinkStateId ()),
-  m_lsa (lsa),
-  m_distanceFromRoot (DISTINFINITY), 
-  m_rootOif (DISTINFINITY),
-  m_nextHop ("0.0.0.0"),
-  m_parents (),
-  m_children (),
-  m_vertexProcessed (false)
-{
-  NS_LOG_FUNCTION (this << lsa);
-
-  if (lsa->GetLSType () == DSRRoutingLSA::RouterLSA) 
-    {
-      NS_LOG_LOGIC ("Setting m_vertexType to VertexRouter");
-      m_vertexType = DSRVertex::VertexRouter;
-    }
-  else if (lsa->GetLSType () == DSRRoutingLSA::NetworkLSA) 
-    { 
-      NS_LOG_LOGIC ("Setting m_vertexType to VertexNetwork");
-      m_vertexType = DSRVertex::VertexNetwork;
-    }
-}
-
-DSRVertex::~DSRVertex ()
-{
-  NS_LOG_FUNCTION (this);
-
-  NS_LOG_LOGIC ("Children vertices - " << m_children);
-  NS_LOG_LOGIC ("Parent verteices - " << m_parents);
-
-  // find this node from all its parents and remove the entry of this node
-  // from all its parents
-  for (ListOfDSRVertex_t::iterator piter = m_parents.begin (); 
-       piter != m_parents.end ();
-       piter++)
-    {
-      // remove the current vertex from its parent's children list. Check
-      // if the size of the list is reduced, or the child<->parent relation
-      // is not bidirectional
-      uint32_t orgCount = (*piter)->m_children.size ();
-      (*piter)->m_children.remove (this);
-      uint32_t newCount = (*piter)->m_children.size ();
-      if (orgCount > newCount)
-        {
-          NS_ASSERT_MSG (orgCount > newCount, "Unable to find the current vertex from its parents --- impossible!");
-        }
-    }
-
-  // delete children
-  while (m_children.size () > 0)
-    {
-      // pop out children one by one. Some children may disappear 
-      // when deleting some other children in the list. As a result,
-      // it is necessary to use pop to walk through all children, instead
-      // of using iterator.
-      //
-      // Note that m_children.pop_front () is not necessary as this
-      // p is removed from the children list when p is deleted
-      DSRVertex* p = m_children.front ();
-      // 'p' == 0, this child is already deleted by its other parent
-      if (p == 0) continue;
-      NS_LOG_LOGIC ("Parent vertex-" << m_vertexId << " deleting its child vertex-" << p->GetVertexId ());
-      delete p;
-      p = 0;
-    }
-  m_children.clear ();
-  // delete parents
-  m_parents.clear ();
-  // delete root exit direction
-  m_ecmpRootExits.clear ();
-
-  NS_LOG_LOGIC ("Vertex-" << m_vertexId << " completed deleted");
-}
-
-void
-DSRVertex::SetVertexType (DSRVertex::VertexType type)
-{
-  NS_LOG_FUNCTION (this << type);
-  m_vertexType = type;
-}
-
-DSRVertex::VertexType
-DSRVertex::GetVertexType (void) const
-{
-  NS_LOG_FUNCTION (this);
-  return m_vertexType;
-}
-
-void
-DSRVertex::SetVertexId (Ipv4Address id)
-{
-  NS_LOG_FUNCTION (this << id);
-  m_vertexId = id;
-}
-
-Ipv4Address
-DSRVertex::GetVertexId (void) const
-{
-  NS_LOG_FUNCTION (this);
-  return m_vertexId;
-}
-
-void
-DSRVertex::SetLSA (DSRRoutingLSA* lsa)
-{
-  NS_LOG_FUNCTION (this << lsa);
-  m_lsa = lsa;
-}
-
-DSRRoutingLSA*
-DSRVertex::GetLSA (void) const
-{
-  NS_LOG_FUNCTION (this);
-  return m_lsa;
-}
-
-void
-DSRVertex::SetDistanceFromRoot (uint32_t distance)
-{
-  NS_LOG_FUNCTION (this << distance);
-  m_distanceFromRoot = distance;
-}
-
-uint32_t
-DSRVertex::GetDistanceFromRoot (void) const
-{
-  NS_LOG_FUNCTION (this);
-  return m_distanceFromRoot;
-}
-
-void
-DSRVertex::SetParent (DSRVertex* parent)
-{
-  NS_LOG_FUNCTION (this << parent);
-
-  // always maintain only one parent when using setter/getter methods
-  m_parents.clear ();
-  m_parents.push_back (parent);
-}
-
-DSRVertex*
-DSRVertex::GetParent (uint32_t i) const
-{
-  NS_LOG_FUNCTION (this << i);
-
-  // If the index i is out-of-range, return 0 and do nothing
-  if (m_parents.size () <= i)
-    {
-      NS_LOG_LOGIC ("Index to DSRVertex's parent is out-of-range.");
-      return 0;
-    }
-  ListOfDSRVertex_t::const_iterator iter = m_parents.begin ();
-  while (i-- > 0) 
-    {
-      iter++;
-    }
-  return *iter;
-}
-
-void 
-DSRVertex::MergeParent (const DSRVertex* v)
-{
-  NS_LOG_FUNCTION (this << v);
-
-  NS_LOG_LOGIC ("Before merge, list of parents = " << m_parents);
-  // combine the two lists first, and then remove any duplicated after
-  m_parents.insert (m_parents.end (), 
-                    v->m_parents.begin (), v->m_parents.end ());
-  // remove duplication
-  m_parents.sort ();
-  m_parents.unique ();
-  NS_LOG_LOGIC ("After merge, list of parents = " << m_parents);
-}
-
-void 
-DSRVertex::SetRootExitDirection (Ipv4Address nextHop, int32_t id)
-{
-  NS_LOG_FUNCTION (this << nextHop << id);
-
-  // always maintain only one root's exit
-  m_ecmpRootExits.clear ();
-  m_ecmpRootExits.push_back (NodeExit_t (nextHop, id));
-  // update the following in order to be backward compatitable with
-  // GetNextHop and GetOutgoingInterface methods
-  m_nextHop = nextHop;
-  m_rootOif = id;
-}
-
-void 
-DSRVertex::SetRootExitDirection (DSRVertex::NodeExit_t exit)
-{
-  NS_LOG_FUNCTION (this << exit);
-  SetRootExitDirection (exit.first, exit.second);
-}
-
-DSRVertex::NodeExit_t
-DSRVertex::GetRootExitDirection (uint32_t i) const
-{
-  NS_LOG_FUNCTION (this << i);
-  typedef ListOfNodeExit_t::const_iterator CIter_t;
-
-  NS_ASSERT_MSG (i < m_ecmpRootExits.size (), "Index out-of-range when accessing DSRVertex::m_ecmpRootExits!");
-  CIter_t iter = m_ecmpRootExits.begin ();
-  while (i-- > 0) { iter++; }
-
-  return *iter;
-}
-
-DSRVertex::NodeExit_t 
-DSRVertex::GetRootExitDirection () const
-{
-  NS_LOG_FUNCTION (this);
-
-  NS_ASSERT_MSG (m_ecmpRootExits.size () <= 1, "Assumed there is at most one exit from the root to this vertex");
-  return GetRootExitDirection (0);
-}
-
-void 
-DSRVertex::MergeRootExitDirections (const DSRVertex* vertex)
-{
-  NS_LOG_FUNCTION (this << vertex);
-
-  // obtain the external list of exit directions
-  //
-  // Append the external list into 'this' and remove duplication afterward
-  const ListOfNodeExit_t& extList = vertex->m_ecmpRootExits;
-  m_ecmpRootExits.insert (m_ecmpRootExits.end (), 
-                          extList.begin (), extList.end ());
-  m_ecmpRootExits.sort ();
-  m_ecmpRootExits.unique ();
-}
-
-void 
-DSRVertex::InheritAllRootExitDirections (const DSRVertex* vertex)
-{
-  NS_LOG_FUNCTION (this << vertex);
-
-  // discard all exit direction currently associated with this vertex,
-  // and copy all the exit directions from the given vertex
-  if (m_ecmpRootExits.size () > 0)
-    {
-      NS_LOG_WARN ("x root exit directions in this vertex are going to be discarded");
-    }
-  m_ecmpRootExits.clear ();
-  m_ecmpRootExits.insert (m_ecmpRootExits.end (), 
-                          vertex->m_ecmpRootExits.begin (), vertex->m_ecmpRootExits.end ());
-}
-
-uint32_t 
-DSRVertex::GetNRootExitDirections () const
-{
-  NS_LOG_FUNCTION (this);
-  return m_ecmpRootExits.size ();
-}
-
-uint32_t 
-DSRVertex::GetNChildren (void) const
-{
-  NS_LOG_FUNCTION (this);
-  return m_children.size ();
-}
-
-DSRVertex*
-DSRVertex::GetChild (uint32_t n) const
-{
-  NS_LOG_FUNCTION (this << n);
-  uint32_t j = 0;
-
-  for ( ListOfDSRVertex_t::const_iterator i = m_children.begin ();
-        i != m_children.end ();
-        i++, j++)
-    {
-      if (j == n)
-        {
-          return *i;
-        }
-    }
-  NS_ASSERT_MSG (false, "Index <n> out of range.");
-  return 0;
-}
-
-uint32_t
-DSRVertex::AddChild (DSRVertex* child)
-{
-  NS_LOG_FUNCTION (this << child);
-  m_children.push_back (child);
-  return m_children.size ();
-}
-
-void 
-DSRVertex::SetVertexProcessed (bool value)
-{
-  NS_LOG_FUNCTION (this << value);
-  m_vertexProcessed = value;
-}
-
-bool 
-DSRVertex::IsVertexProcessed (void) const
-{
-  NS_LOG_FUNCTION (this);
-  return m_vertexProcessed;
-}
-
-void
-DSRVertex::ClearVertexProcessed (void)
-{
-  NS_LOG_FUNCTION (this);
-  for (uint32_t i = 0; i < this->GetNChildren (); i++)
-    {
-      this->GetChild (i)->ClearVertexProcessed ();
-    }
-  this->SetVertexProcessed (false);
-}
-
 // ---------------------------------------------------------------------------
 //
 // DSRRouteManagerLSDB Implementation
@@ -433,32 +80,20 @@ DSRRouteManagerLSDB::~DSRRouteManagerLSDB ()
   LSDBMap_t::iterator i;
   for (i= m_database.begin (); i!= m_database.end (); i++)
     {
-      NS_LOG_LOGIC ("free LSA");
+      NS_LOG_LOGIC ("release LSA");
       DSRRoutingLSA* temp = i->second;
-      delete temp;
+      temp->Unref ();
     }
   for (uint32_t j = 0; j < m_extdatabase.size (); j++)
     {
-      NS_LOG_LOGIC ("free ASexternalLSA");
+      NS_LOG_LOGIC ("release ASexternalLSA");
       DSRRoutingLSA* temp = m_extdatabase.at (j);
-      delete temp;
+      temp->Unref ();
     }
   NS_LOG_LOGIC ("clear map");
   m_database.clear ();
 }
 
-void
-DSRRouteManagerLSDB::Initialize ()
-{
-  NS_LOG_FUNCTION (this);
-  LSDBMap_t::iterator i;
-  for (i= m_database.begin (); i!= m_database.end (); i++)
-    {
-      DSRRoutingLSA* temp = i->second;
-      temp->SetStatus (DSRRoutingLSA::LSA_SPF_NOT_EXPLORED);
-    }
-}
-
 void
 DSRRouteManagerLSDB::Insert (Ipv4Address addr, DSRRoutingLSA* lsa)
 {
@@ -469,10 +104,27 @@ DSRRouteManagerLSDB::Insert (Ipv4Address addr, DSRRoutingLSA* lsa)
     } 
   else
     {
-      m_database.insert (LSDBPair_t (addr, lsa));
+      if (m_database.insert (LSDBPair_t (addr, lsa)).second)
+        {
+          m_index[addr] = m_lsas.size ();
+          m_lsas.push_back (lsa);
+        }
+      else
+        {
+          NS_LOG_LOGIC ("Duplicate LSA for " << addr << ", dropped");
+          lsa->Unref ();
+        }
     }
 }
 
+void
+DSRRouteManagerLSDB::Insert (Ipv4Address addr, Ptr<DSRRoutingLSA> lsa)
+{
+  NS_LOG_FUNCTION (this << addr << lsa);
+  lsa->Ref ();
+  Insert (addr, PeekPointer (lsa));
+}
+
 DSRRoutingLSA*
 DSRRouteManagerLSDB::GetExtLSA (uint32_t index) const
 {
@@ -494,17 +146,40 @@ DSRRouteManagerLSDB::GetLSA (Ipv4Address addr) const
 //
 // Look up an LSA by its address.
 //
-  LSDBMap_t::const_iterator i;
-  for (i= m_database.begin (); i!= m_database.end (); i++)
+  LSDBMap_t::const_iterator i = m_database.find (addr);
+  if (i != m_database.end ())
     {
-      if (i->first == addr)
-        {
-          return i->second;
-        }
+      return i->second;
     }
   return 0;
 }
 
+uint32_t
+DSRRouteManagerLSDB::GetNumLSAs () const
+{
+  NS_LOG_FUNCTION (this);
+  return m_lsas.size ();
+}
+
+uint32_t
+DSRRouteManagerLSDB::GetLSAIndex (Ipv4Address addr) const
+{
+  NS_LOG_FUNCTION (this << addr);
+  std::map<Ipv4Address, uint32_t>::const_iterator i = m_index.find (addr);
+  if (i != m_index.end ())
+    {
+      return i->second;
+    }
+  return m_lsas.size ();
+}
+
+DSRRoutingLSA*
+DSRRouteManagerLSDB::GetLSAByIndex (uint32_t index) const
+{
+  NS_LOG_FUNCTION (this << index);
+  return m_lsas.at (index);
+}
+
 DSRRoutingLSA*
 DSRRouteManagerLSDB::GetLSAByLinkData (Ipv4Address addr) const
 {
@@ -519,7 +194,7 @@ DSRRouteManagerLSDB::GetLSAByLinkData (Ipv4Address addr) const
 // Iterate among temp's Link Records
       for (uint32_t j = 0; j < temp->GetNLinkRecords (); j++)
         {
-          DSRRoutingLinkRecord *lr = temp->GetLinkRecord (j);
+          const DSRRoutingLinkRecord *lr = temp->GetLinkRecord (j);
           if ( lr->GetLinkType () == DSRRoutingLinkRecord::TransitNetwork &&
                lr->GetLinkData () == addr)
             {
@@ -532,366 +207,3239 @@ DSRRouteManagerLSDB::GetLSAByLinkData (Ipv4Address addr) const
 
 // ---------------------------------------------------------------------------
 //
-// DSRRouteManagerNSDB Implementation
+// DSRGraphSnapshot Implementation
 //
 // ---------------------------------------------------------------------------
 
-DSRRouteManagerNSDB::DSRRouteManagerNSDB ()
-  :
-    m_neighborstatedatabase ()
+DSRGraphSnapshot::DSRGraphSnapshot ()
+  : m_maxWeight (0)
 {
   NS_LOG_FUNCTION (this);
 }
 
-DSRRouteManagerNSDB::~DSRRouteManagerNSDB ()
+void
+DSRGraphSnapshot::Clear (void)
 {
   NS_LOG_FUNCTION (this);
-  NSDBMap_t::iterator i;
-  for (i= m_neighborstatedatabase.begin (); i!= m_neighborstatedatabase.end (); i++)
-    {
-      NS_LOG_LOGIC ("free NetDevice");
-      NetDevice* temp = i->second;
-      delete temp;
-    }
-  NS_LOG_LOGIC ("clear map");
-  m_neighborstatedatabase.clear ();
+  m_maxWeight = 0;
+  m_vertexId.clear ();
+  m_vertexType.clear ();
+  m_networkMask.clear ();
+  m_nodeId.clear ();
+  m_rowStart.clear ();
+  m_target.clear ();
+  m_weight.clear ();
+  m_linkData.clear ();
+  m_linkType.clear ();
+  m_reverse.clear ();
+  m_outIf.clear ();
+  m_stubStart.clear ();
+  m_stubNetwork.clear ();
+  m_stubMask.clear ();
+  m_hostStart.clear ();
+  m_hostAddr.clear ();
+  m_extAdvertiser.clear ();
+  m_extNetwork.clear ();
+  m_extMask.clear ();
+  m_vertexArea.clear ();
+  m_areaId.clear ();
+  m_rangeStart.clear ();
+  m_rangeNetwork.clear ();
+  m_rangeMask.clear ();
+  m_inStart.clear ();
+  m_inEdge.clear ();
+  m_inSource.clear ();
 }
 
-void
-DSRRouteManagerNSDB::Insert (Ipv4Address addr, NetDevice* netDev)
+uint32_t
+DSRGraphSnapshot::GetNVertices (void) const
 {
-  NS_LOG_FUNCTION (this << addr << netDev);
-  m_neighborstatedatabase.insert (NSDBPair_t (addr, netDev));
+  return m_vertexId.size ();
 }
 
-void
-DSRRouteManagerNSDB::Initialize ()
+uint32_t
+DSRGraphSnapshot::GetNEdges (void) const
 {
-  NS_LOG_FUNCTION (this);
+  return m_target.size ();
 }
 
-NetDevice*
-DSRRouteManagerNSDB::GetNetDevice (Ipv4Address addr) const
+uint32_t
+DSRGraphSnapshot::GetMaxWeight (void) const
 {
-  NS_LOG_FUNCTION (this << addr);
-//
-// Look up the NetDevice by its address.
-//
-  NSDBMap_t::const_iterator i;
-  for (i= m_neighborstatedatabase.begin (); i!= m_neighborstatedatabase.end (); i++)
-    {
-      if (i->first == addr)
-        {
-          return i->second;
-        }
-    }
-  return 0;
+  return m_maxWeight;
 }
 
 uint32_t
-DSRRouteManagerNSDB::GetNumNetDevices () const
+DSRGraphSnapshot::GetNRanges (void) const
 {
-  NS_LOG_FUNCTION (this);
-  return m_neighborstatedatabase.size ();
+  return m_rangeNetwork.size ();
 }
 
-// ---------------------------------------------------------------------------
-//
-// DSRRouteManagerImpl Implementation
-//
-// ---------------------------------------------------------------------------
-
-DSRRouteManagerImpl::DSRRouteManagerImpl () 
-  :
-    m_spfroot (0)
+int32_t
+DSRGraphSnapshot::GetAreaRange (uint32_t network, uint32_t mask, uint32_t area) const
 {
-  NS_LOG_FUNCTION (this);
-  m_lsdb = new DSRRouteManagerLSDB ();
+  for (uint32_t r = m_rangeStart[area]; r < m_rangeStart[area + 1]; r++)
+    {
+      if ((network & m_rangeMask[r]) == m_rangeNetwork[r] && (mask & m_rangeMask[r]) == m_rangeMask[r])
+        {
+          return r;
+        }
+    }
+  return -1;
 }
 
-DSRRouteManagerImpl::~DSRRouteManagerImpl ()
+int32_t
+DSRGraphSnapshot::GetSummaryRange (uint32_t network, uint32_t mask, uint32_t area, uint32_t routerArea) const
 {
-  NS_LOG_FUNCTION (this);
-  if (m_lsdb)
+  if (area == routerArea)
     {
-      delete m_lsdb;
+      return -1;
     }
+  return GetAreaRange (network, mask, area);
 }
 
-void
-DSRRouteManagerImpl::DebugUseLsdb (DSRRouteManagerLSDB* lsdb)
+bool
+DSRGraphSnapshot::HasSummarizedAddress (uint32_t v, uint32_t routerArea) const
 {
-  NS_LOG_FUNCTION (this << lsdb);
-  if (m_lsdb)
+  for (uint32_t e = m_rowStart[v]; e < m_rowStart[v + 1]; e++)
     {
-      delete m_lsdb;
+      if (m_linkType[e] == DSRRoutingLinkRecord::PointToPoint
+          && GetSummaryRange (m_linkData[e], 0xffffffff, m_vertexArea[v], routerArea) >= 0)
+        {
+          return true;
+        }
     }
-  m_lsdb = lsdb;
+  return false;
 }
 
-void
-DSRRouteManagerImpl::DeleteDSRRoutes ()
+namespace {
+
+/**
+ * \brief Feed the size and the elements of a vector to a hasher
+ * \param hasher the hasher
+ * \param v the vector
+ */
+template <typename T>
+void
+DsrHashVector (Hasher& hasher, const std::vector<T>& v)
+{
+  uint64_t size = v.size ();
+  hasher.GetHash64 (reinterpret_cast<const char*> (&size), sizeof (size));
+  if (size)
+    {
+      hasher.GetHash64 (reinterpret_cast<const char*> (&v[0]), size * sizeof (T));
+    }
+}
+
+} // anonymous namespace
+
+void
+DSRGraphSnapshot::BuildInEdges (void)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t nVertices = GetNVertices ();
+  m_inStart.assign (nVertices + 1, 0);
+  for (uint32_t e = 0; e < GetNEdges (); e++)
+    {
+      if (m_target[e] >= 0)
+        {
+          m_inStart[m_target[e] + 1]++;
+        }
+    }
+  for (uint32_t v = 0; v < nVertices; v++)
+    {
+      m_inStart[v + 1] += m_inStart[v];
+    }
+  m_inEdge.resize (m_inStart[nVertices]);
+  m_inSource.resize (m_inStart[nVertices]);
+  std::vector<uint32_t> next (m_inStart.begin (), m_inStart.end () - 1);
+  for (uint32_t v = 0; v < nVertices; v++)
+    {
+      for (uint32_t e = m_rowStart[v]; e < m_rowStart[v + 1]; e++)
+        {
+          if (m_target[e] >= 0)
+            {
+              uint32_t k = next[m_target[e]]++;
+              m_inEdge[k] = e;
+              m_inSource[k] = v;
+            }
+        }
+    }
+}
+
+uint64_t
+DSRGraphSnapshot::GetHash (void) const
+{
+  NS_LOG_FUNCTION (this);
+  Hasher hasher;
+  DsrHashVector (hasher, m_vertexId);
+  DsrHashVector (hasher, m_vertexType);
+  DsrHashVector (hasher, m_networkMask);
+  DsrHashVector (hasher, m_nodeId);
+  DsrHashVector (hasher, m_rowStart);
+  DsrHashVector (hasher, m_target);
+  DsrHashVector (hasher, m_weight);
+  DsrHashVector (hasher, m_linkData);
+  DsrHashVector (hasher, m_linkType);
+  DsrHashVector (hasher, m_reverse);
+  DsrHashVector (hasher, m_outIf);
+  DsrHashVector (hasher, m_stubStart);
+  DsrHashVector (hasher, m_stubNetwork);
+  DsrHashVector (hasher, m_stubMask);
+  DsrHashVector (hasher, m_hostStart);
+  DsrHashVector (hasher, m_hostAddr);
+  DsrHashVector (hasher, m_extAdvertiser);
+  DsrHashVector (hasher, m_extNetwork);
+  DsrHashVector (hasher, m_extMask);
+  DsrHashVector (hasher, m_vertexArea);
+  DsrHashVector (hasher, m_areaId);
+  DsrHashVector (hasher, m_rangeStart);
+  DsrHashVector (hasher, m_rangeNetwork);
+  DsrHashVector (hasher, m_rangeMask);
+  uint32_t maxWeight = m_maxWeight;
+  return hasher.GetHash64 (reinterpret_cast<const char*> (&maxWeight), sizeof (maxWeight));
+}
+
+void
+DSRGraphSnapshot::Build (const DSRRouteManagerLSDB& lsdb, const AreaRanges_t& ranges)
+{
+  NS_LOG_FUNCTION (this << &lsdb << ranges.size ());
+  Clear ();
+  uint32_t nVertices = lsdb.GetNumLSAs ();
+  bool haveNodes = NodeList::GetNNodes () > 0;
+  std::vector<Ptr<Ipv4> > ipv4s (nVertices);
+//
+// First pass over the LSAs: the vertices themselves, and the addresses of
+// their nodes.
+//
+  m_vertexId.reserve (nVertices);
+  m_vertexType.reserve (nVertices);
+  m_networkMask.reserve (nVertices);
+  m_nodeId.reserve (nVertices);
+  m_hostStart.reserve (nVertices + 1);
+  for (uint32_t i = 0; i < nVertices; i++)
+    {
+      DSRRoutingLSA* lsa = lsdb.GetLSAByIndex (i);
+      m_vertexId.push_back (lsa->GetLinkStateId ().Get ());
+      if (lsa->GetLSType () == DSRRoutingLSA::RouterLSA)
+        {
+          m_vertexType.push_back (DSRGraphSnapshot::VertexRouter);
+          m_networkMask.push_back (0);
+        }
+      else if (lsa->GetLSType () == DSRRoutingLSA::NetworkLSA)
+        {
+          m_vertexType.push_back (DSRGraphSnapshot::VertexNetwork);
+          m_networkMask.push_back (lsa->GetNetworkLSANetworkMask ().Get ());
+        }
+      else
+        {
+          NS_ASSERT_MSG (0, "DSRGraphSnapshot::Build (): illegal LSA type");
+        }
+
+      m_hostStart.push_back (m_hostAddr.size ());
+      Ptr<Node> node;
+      if (haveNodes)
+        {
+          node = lsa->GetNode ();
+        }
+      if (node == 0)
+        {
+          m_nodeId.push_back (0);
+          m_vertexArea.push_back (0);
+          continue;
+        }
+      m_nodeId.push_back (node->GetId ());
+      Ptr<DSRRouter> router = node->GetObject<DSRRouter> ();
+      m_vertexArea.push_back (router ? router->GetAreaId () : 0);
+      ipv4s[i] = node->GetObject<Ipv4> ();
+      NS_ASSERT_MSG (ipv4s[i], 
+                     "DSRGraphSnapshot::Build (): "
+                     "GetObject for <Ipv4> interface failed");
+      // the neighbour host routes go to the primary address of every
+      // interface but the loopback
+      for (uint32_t j = 1; j < ipv4s[i]->GetNInterfaces (); j++)
+        {
+          if (ipv4s[i]->GetNAddresses (j) > 0)
+            {
+              m_hostAddr.push_back (ipv4s[i]->GetAddress (j, 0).GetLocal ().Get ());
+            }
+        }
+    }
+  m_hostStart.push_back (m_hostAddr.size ());
+//
+// Number the areas in increasing ID order, and keep the ranges of those
+// that have vertices.  m_vertexArea holds area IDs until then.
+//
+  std::map<uint32_t, uint32_t> areaIndex;
+  for (uint32_t i = 0; i < nVertices; i++)
+    {
+      areaIndex.insert (std::make_pair (m_vertexArea[i], 0));
+    }
+  m_rangeStart.reserve (areaIndex.size () + 1);
+  for (std::map<uint32_t, uint32_t>::iterator a = areaIndex.begin (); a != areaIndex.end (); a++)
+    {
+      a->second = m_areaId.size ();
+      m_areaId.push_back (a->first);
+      m_rangeStart.push_back (m_rangeNetwork.size ());
+      AreaRanges_t::const_iterator r = ranges.find (a->first);
+      for (uint32_t k = 0; r != ranges.end () && k < r->second.size (); k++)
+        {
+          m_rangeNetwork.push_back (r->second[k].first & r->second[k].second);
+          m_rangeMask.push_back (r->second[k].second);
+        }
+    }
+  m_rangeStart.push_back (m_rangeNetwork.size ());
+  for (uint32_t i = 0; i < nVertices; i++)
+    {
+      m_vertexArea[i] = areaIndex[m_vertexArea[i]];
+    }
+//
+// A network-LSA lists its attached routers by interface address; the router
+// is the first LSA, in link state ID order, with a transit record of that
+// address (DSRRouteManagerLSDB::GetLSAByLinkData).
+//
+  std::vector<uint32_t> byId (nVertices);
+  for (uint32_t i = 0; i < nVertices; i++)
+    {
+      byId[i] = i;
+    }
+  std::sort (byId.begin (), byId.end (), 
+             [this] (uint32_t a, uint32_t b) { return m_vertexId[a] < m_vertexId[b]; });
+  std::map<uint32_t, int32_t> transitOwner;
+  for (uint32_t k = 0; k < nVertices; k++)
+    {
+      DSRRoutingLSA* lsa = lsdb.GetLSAByIndex (byId[k]);
+      for (uint32_t j = 0; j < lsa->GetNLinkRecords (); j++)
+        {
+          const DSRRoutingLinkRecord *l = lsa->GetLinkRecord (j);
+          if (l->GetLinkType () == DSRRoutingLinkRecord::TransitNetwork)
+            {
+              transitOwner.insert (std::make_pair (l->GetLinkData ().Get (), byId[k]));
+            }
+        }
+    }
+//
+// Second pass: the edges and stub networks of every vertex, in link record
+// order.
+//
+  std::vector<uint32_t> linkId;
+  m_rowStart.reserve (nVertices + 1);
+  m_stubStart.reserve (nVertices + 1);
+  for (uint32_t i = 0; i < nVertices; i++)
+    {
+      DSRRoutingLSA* lsa = lsdb.GetLSAByIndex (i);
+      m_rowStart.push_back (m_target.size ());
+      m_stubStart.push_back (m_stubNetwork.size ());
+      if (m_vertexType[i] == DSRGraphSnapshot::VertexRouter)
+        {
+          for (uint32_t j = 0; j < lsa->GetNLinkRecords (); j++)
+            {
+              const DSRRoutingLinkRecord *l = lsa->GetLinkRecord (j);
+              if (l->GetLinkType () == DSRRoutingLinkRecord::StubNetwork)
+                {
+                  uint32_t mask = l->GetLinkData ().Get ();
+                  m_stubNetwork.push_back (l->GetLinkId ().Get () & mask);
+                  m_stubMask.push_back (mask);
+                  continue;
+                }
+              NS_ASSERT_MSG (l->GetLinkType () == DSRRoutingLinkRecord::PointToPoint ||
+                             l->GetLinkType () == DSRRoutingLinkRecord::TransitNetwork,
+                             "illegal Link Type");
+              uint32_t w = lsdb.GetLSAIndex (l->GetLinkId ());
+              int32_t target = w < nVertices ? w : -1;
+              int32_t outIf = -1;
+              if (ipv4s[i] && l->GetLinkType () == DSRRoutingLinkRecord::PointToPoint)
+                {
+                  outIf = ipv4s[i]->GetInterfaceForPrefix (l->GetLinkData (), Ipv4Mask::GetOnes ());
+                }
+              else if (ipv4s[i] && target >= 0)
+                {
+                  outIf = ipv4s[i]->GetInterfaceForPrefix (Ipv4Address (m_vertexId[w]),
+                                                           Ipv4Mask (m_networkMask[w]));
+                }
+              m_target.push_back (target);
+              m_weight.push_back (l->GetMetric ());
+              m_linkData.push_back (l->GetLinkData ().Get ());
+              m_linkType.push_back (l->GetLinkType ());
+              m_outIf.push_back (outIf);
+              linkId.push_back (l->GetLinkId ().Get ());
+            }
+        }
+      else
+        {
+          for (uint32_t j = 0; j < lsa->GetNAttachedRouters (); j++)
+            {
+              Ipv4Address router = lsa->GetAttachedRouter (j);
+              std::map<uint32_t, int32_t>::const_iterator owner = transitOwner.find (router.Get ());
+              if (owner == transitOwner.end ())
+                {
+                  continue;
+                }
+              m_target.push_back (owner->second);
+              m_weight.push_back (0);
+              m_linkData.push_back (router.Get ());
+              m_linkType.push_back (DSRRoutingLinkRecord::Unknown);
+              m_outIf.push_back (-1);
+              linkId.push_back (router.Get ());
+            }
+        }
+    }
+  m_rowStart.push_back (m_target.size ());
+  m_stubStart.push_back (m_stubNetwork.size ());
+//
+// The reverse of an edge is the first record of the target router pointing
+// back at the owner (quagga ospf_get_next_link).  Its link data is the next
+// hop address towards the owner.
+//
+  m_reverse.assign (m_target.size (), -1);
+  for (uint32_t v = 0; v < nVertices; v++)
+    {
+      for (uint32_t e = m_rowStart[v]; e < m_rowStart[v + 1]; e++)
+        {
+          int32_t w = m_target[e];
+          if (w < 0 || m_vertexType[w] != DSRGraphSnapshot::VertexRouter)
+            {
+              continue;
+            }
+          for (uint32_t f = m_rowStart[w]; f < m_rowStart[w + 1]; f++)
+            {
+              if (linkId[f] == m_vertexId[v])
+                {
+                  m_reverse[e] = f;
+                  break;
+                }
+            }
+        }
+    }
+
+  for (uint32_t i = 0; i < lsdb.GetNumExtLSAs (); i++)
+    {
+      DSRRoutingLSA *extlsa = lsdb.GetExtLSA (i);
+      uint32_t adv = lsdb.GetLSAIndex (extlsa->GetAdvertisingRouter ());
+      uint32_t mask = extlsa->GetNetworkLSANetworkMask ().Get ();
+      m_extAdvertiser.push_back (adv < nVertices ? adv : -1);
+      m_extNetwork.push_back (extlsa->GetLinkStateId ().Get () & mask);
+      m_extMask.push_back (mask);
+    }
+  if (!m_weight.empty ())
+    {
+      m_maxWeight = *std::max_element (m_weight.begin (), m_weight.end ());
+    }
+  NS_LOG_LOGIC ("Snapshot of " << nVertices << " vertices, " << GetNEdges () << 
+                " edges, " << m_stubNetwork.size () << " stub networks and " << 
+                m_areaId.size () << " areas");
+}
+
+// ---------------------------------------------------------------------------
+//
+// DSRSPFArena Implementation
+//
+// ---------------------------------------------------------------------------
+
+namespace {
+/// Size of the chunks an SPF arena obtains from the heap
+const uint32_t DSR_SPF_ARENA_CHUNK_SIZE = 64 * 1024;
+/// Alignment of every arena allocation
+const uint32_t DSR_SPF_ARENA_ALIGNMENT = 8;
+} // anonymous namespace
+
+DSRSPFArena::DSRSPFArena ()
+  : m_chunks (),
+    m_current (0),
+    m_offset (0),
+    m_chunkAllocations (0),
+    m_bytesAllocated (0),
+    m_spills (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+DSRSPFArena::~DSRSPFArena ()
+{
+  NS_LOG_FUNCTION (this);
+  for (std::vector<Chunk>::iterator i = m_chunks.begin (); i != m_chunks.end (); i++)
+    {
+      delete [] i->m_data;
+    }
+  m_chunks.clear ();
+}
+
+void*
+DSRSPFArena::AllocateBytes (uint32_t size)
+{
+  size = (size + DSR_SPF_ARENA_ALIGNMENT - 1) & ~(DSR_SPF_ARENA_ALIGNMENT - 1);
+  m_bytesAllocated += size;
+//
+// Move on to the next chunk that is large enough, growing the arena if none
+// of the chunks kept from previous runs fits.
+//
+  while (m_current < m_chunks.size ()
+         && m_offset + size > m_chunks[m_current].m_size)
+    {
+      m_current++;
+      m_offset = 0;
+    }
+  if (m_current == m_chunks.size ())
+    {
+      Chunk chunk;
+      chunk.m_size = std::max (size, DSR_SPF_ARENA_CHUNK_SIZE);
+      chunk.m_data = new char[chunk.m_size];
+      m_chunks.push_back (chunk);
+      m_chunkAllocations++;
+      m_offset = 0;
+    }
+  void* p = m_chunks[m_current].m_data + m_offset;
+  m_offset += size;
+  return p;
+}
+
+void
+DSRSPFArena::Reset (void)
+{
+  m_current = 0;
+  m_offset = 0;
+}
+
+uint64_t
+DSRSPFArena::GetChunkAllocations (void) const
+{
+  return m_chunkAllocations;
+}
+
+uint64_t
+DSRSPFArena::GetBytesAllocated (void) const
+{
+  return m_bytesAllocated;
+}
+
+uint64_t
+DSRSPFArena::GetSpills (void) const
+{
+  return m_spills;
+}
+
+void
+DSRSPFArena::NotifySpill (void)
+{
+  m_spills++;
+}
+
+// ---------------------------------------------------------------------------
+//
+// DSRRouteComputationStats Implementation
+//
+// ---------------------------------------------------------------------------
+
+DSRRouteComputationStats::DSRRouteComputationStats ()
+  : m_lsas (0),
+    m_discoveryTime (0),
+    m_lsdbTime (0),
+    m_spfTime (0),
+    m_installTime (0),
+    m_spfRuns (0),
+    m_spfReused (0),
+    m_arenaChunks (0),
+    m_arenaBytes (0),
+    m_inlineSpills (0),
+    m_kspRuns (0),
+    m_kspRoutes (0),
+    m_bestEffortRuns (0),
+    m_queueOperations (0),
+    m_verticesReached (0),
+    m_routesInstalled (0),
+    m_coalescedEvents (0),
+    m_routesAdded (0),
+    m_routesRemoved (0),
+    m_routesUpdated (0),
+    m_lazyRuns (0),
+    m_matrixVertices (0)
+{
+}
+
+void
+DSRRouteComputationStats::Print (std::ostream& os) const
+{
+  uint32_t maxRoutes = 0;
+  for (uint32_t n = 0; n < m_routesPerNode.size (); n++)
+    {
+      maxRoutes = std::max (maxRoutes, m_routesPerNode[n]);
+    }
+  os << "DSR route computation:" << std::endl;
+  os << "  LSA discovery     " << m_discoveryTime << " s, " << m_lsas << " LSAs" << std::endl;
+  os << "  LSDB insert       " << m_lsdbTime << " s" << std::endl;
+  os << "  route computation " << m_spfTime << " s, " << m_spfRuns << " SPF runs, " <<
+    m_spfReused << " reused, " << m_bestEffortRuns << " best-effort, " << m_kspRuns << " K-shortest paths" << std::endl;
+  os << "  route install     " << m_installTime << " s, " << m_routesInstalled << " routes, at most " <<
+    maxRoutes << " per node" << std::endl;
+  os << "  queue operations  " << m_queueOperations << ", vertices reached " << m_verticesReached << std::endl;
+  os << "  arena             " << m_arenaChunks << " chunks, " << m_arenaBytes << " bytes, " <<
+    m_inlineSpills << " inline spills" << std::endl;
+  if (!m_churnPerNode.empty ())
+    {
+      uint32_t changedTables = 0;
+      uint32_t maxChurn = 0;
+      for (uint32_t n = 0; n < m_churnPerNode.size (); n++)
+        {
+          changedTables += m_churnPerNode[n] > 0;
+          maxChurn = std::max (maxChurn, m_churnPerNode[n]);
+        }
+      os << "  route churn       " << m_routesAdded << " added, " << m_routesRemoved << " removed, " <<
+        m_routesUpdated << " updated, in " << changedTables << " tables, at most " << maxChurn <<
+        " per node" << std::endl;
+    }
+  if (m_coalescedEvents > 0)
+    {
+      os << "  scheduled update  " << m_coalescedEvents << " interface events" << std::endl;
+    }
+  if (m_lazyRuns > 0)
+    {
+      os << "  lazy routing      " << m_lazyRuns << " destinations computed on demand" << std::endl;
+    }
+  if (m_matrixVertices > 0)
+    {
+      os << "  distance matrix   " << m_matrixVertices << " vertices" << std::endl;
+    }
+}
+
+// ---------------------------------------------------------------------------
+//
+// DSRSPFWorkspace Implementation
+//
+// ---------------------------------------------------------------------------
+
+namespace {
+/// Largest number of buckets a Dial queue may use before falling back to the heap
+const uint32_t DSR_SPF_MAX_BUCKETS = 1 << 16;
+} // anonymous namespace
+
+DSRSPFWorkspace::DSRSPFWorkspace ()
+  : m_rootIndex (0),
+    m_routes (0),
+    m_queueOperations (0),
+    m_verticesReached (0),
+    m_epoch (0),
+    m_queueType (BinaryHeap),
+    m_cursor (0),
+    m_queued (0),
+    m_sequence (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+DSRSPFWorkspace::SetQueueType (QueueType type, uint32_t maxWeight)
+{
+  NS_LOG_FUNCTION (this << type << maxWeight);
+  m_queueType = type;
+  m_buckets.clear ();
+  m_queued = 0;
+  if (type == DialBuckets)
+    {
+      if (maxWeight >= DSR_SPF_MAX_BUCKETS)
+        {
+          NS_LOG_WARN ("Metric " << maxWeight << " too large for a bucket queue, using a binary heap");
+          m_queueType = BinaryHeap;
+          return;
+        }
+      m_buckets.resize (maxWeight + 1);
+      ClearBuckets ();
+    }
+}
+
+DSRSPFWorkspace::QueueType
+DSRSPFWorkspace::GetQueueType (void) const
+{
+  return m_queueType;
+}
+
+void
+DSRSPFWorkspace::Reset (uint32_t nVertices, std::vector<DSRRouteRecord>* routes)
+{
+  NS_LOG_FUNCTION (this << nVertices << routes);
+//
+// Nothing is reset per vertex.  Bumping the epoch turns every vertex back to
+// LSA_SPF_NOT_EXPLORED at once, and the rest of the per-vertex state is
+// reinitialized by SetStatus () when the run first reaches the vertex.  The
+// arrays only ever grow, with new entries stamped with the never current
+// epoch 0.
+//
+  if (m_epochOf.size () < nVertices)
+    {
+      m_epochOf.resize (nVertices, 0);
+      m_status.resize (nVertices);
+      m_distance.resize (nVertices);
+      m_processed.resize (nVertices);
+      m_sequenceOf.resize (nVertices);
+      m_exits.resize (nVertices);
+      m_parents.resize (nVertices);
+      m_children.resize (nVertices);
+    }
+  if (++m_epoch == 0)
+    {
+      std::fill (m_epochOf.begin (), m_epochOf.end (), 0);
+      m_epoch = 1;
+    }
+  m_mergeExits.Clear ();
+  m_arena.Reset ();
+  m_heap.clear ();
+  if (m_queued > 0)
+    {
+      ClearBuckets ();
+    }
+  m_stack.clear ();
+  m_sequence = 0;
+  m_rootIndex = 0;
+  m_routes = routes;
+}
+
+void
+DSRSPFWorkspace::ResetRanges (uint32_t nRanges)
+{
+  if (m_rangeDistance.size () != nRanges)
+    {
+      m_rangeDistance.assign (nRanges, DISTINFINITY);
+      m_rangesReached.clear ();
+      return;
+    }
+  for (uint32_t r = 0; r < m_rangesReached.size (); r++)
+    {
+      m_rangeDistance[m_rangesReached[r]] = DISTINFINITY;
+    }
+  m_rangesReached.clear ();
+}
+
+bool
+DSRSPFWorkspace::ReachRange (uint32_t range, uint32_t distance)
+{
+  if (m_rangeDistance[range] == DISTINFINITY)
+    {
+      m_rangeDistance[range] = distance;
+      m_rangesReached.push_back (range);
+      return true;
+    }
+  m_rangeDistance[range] = std::max (m_rangeDistance[range], distance);
+  return false;
+}
+
+DSRRoutingLSA::SPFStatus
+DSRSPFWorkspace::GetStatus (uint32_t index) const
+{
+  if (m_epochOf[index] != m_epoch)
+    {
+      return DSRRoutingLSA::LSA_SPF_NOT_EXPLORED;
+    }
+  return static_cast<DSRRoutingLSA::SPFStatus> (m_status[index]);
+}
+
+void
+DSRSPFWorkspace::SetStatus (uint32_t index, DSRRoutingLSA::SPFStatus status)
+{
+  if (m_epochOf[index] != m_epoch)
+    {
+      // first time this run reaches the vertex; the lists may still point
+      // into arena storage of an earlier run
+      m_epochOf[index] = m_epoch;
+      m_verticesReached++;
+      m_distance[index] = DISTINFINITY;
+      m_processed[index] = 0;
+      m_exits[index].Clear ();
+      m_parents[index].Clear ();
+      m_children[index].Clear ();
+    }
+  m_status[index] = status;
+}
+
+bool
+DSRSPFWorkspace::Candidate::operator< (const Candidate& o) const
+{
+  if (m_distance != o.m_distance)
+    {
+      return m_distance > o.m_distance;
+    }
+  if (m_rank != o.m_rank)
+    {
+      return m_rank > o.m_rank;
+    }
+  return m_sequence > o.m_sequence;
+}
+
+void
+DSRSPFWorkspace::PushCandidate (uint32_t index, uint32_t distance, bool isNetwork)
+{
+  Candidate c;
+  c.m_distance = distance;
+  c.m_rank = isNetwork ? 0 : 1;
+  c.m_sequence = m_sequence++;
+  c.m_index = index;
+  m_sequenceOf[index] = c.m_sequence;
+  m_queueOperations++;
+  if (m_queueType == BinaryHeap)
+    {
+      m_heap.push_back (c);
+      std::push_heap (m_heap.begin (), m_heap.end ());
+      return;
+    }
+//
+// Dijkstra never queues a vertex closer than the one being expanded, and
+// never further than that plus the largest metric; so the bucket of a
+// distance taken modulo the number of buckets only ever holds that one
+// distance.  The cursor starts at the first entry queued into an empty queue
+// and may move back to a closer neighbour of the same vertex.
+//
+  if (m_queued == 0 || distance < m_cursor)
+    {
+      m_cursor = distance;
+    }
+  NS_ASSERT (distance >= m_cursor && distance - m_cursor < m_buckets.size ());
+  m_buckets[distance % m_buckets.size ()].m_entries[c.m_rank].push_back (c);
+  m_queued++;
+}
+
+bool
+DSRSPFWorkspace::PopBucket (Candidate& c)
+{
+  while (m_queued > 0)
+    {
+      Bucket& b = m_buckets[m_cursor % m_buckets.size ()];
+//
+// Within a bucket, network vertices pop before routers and each kind pops
+// in queueing order, the order of the heap.  Vertices queued at the cursor
+// distance while the bucket is popped join the back of their FIFO.
+//
+      for (uint32_t rank = 0; rank < 2; rank++)
+        {
+          if (b.m_head[rank] < b.m_entries[rank].size ())
+            {
+              c = b.m_entries[rank][b.m_head[rank]++];
+              m_queued--;
+              return true;
+            }
+        }
+      for (uint32_t rank = 0; rank < 2; rank++)
+        {
+          b.m_entries[rank].clear ();
+          b.m_head[rank] = 0;
+        }
+      m_cursor++;
+    }
+  return false;
+}
+
+void
+DSRSPFWorkspace::ClearBuckets (void)
+{
+  for (std::vector<Bucket>::iterator b = m_buckets.begin (); b != m_buckets.end (); b++)
+    {
+      for (uint32_t rank = 0; rank < 2; rank++)
+        {
+          b->m_entries[rank].clear ();
+          b->m_head[rank] = 0;
+        }
+    }
+  m_queued = 0;
+}
+
+bool
+DSRSPFWorkspace::PopCandidate (uint32_t& index)
+{
+  for (;;)
+    {
+      Candidate c;
+      if (m_queueType == DialBuckets)
+        {
+          if (!PopBucket (c))
+            {
+              break;
+            }
+        }
+      else
+        {
+          if (m_heap.empty ())
+            {
+              break;
+            }
+          std::pop_heap (m_heap.begin (), m_heap.end ());
+          c = m_heap.back ();
+          m_heap.pop_back ();
+        }
+      m_queueOperations++;
+      // an entry is superseded once its vertex is requeued with a smaller
+      // distance
+      if (GetStatus (c.m_index) == DSRRoutingLSA::LSA_SPF_CANDIDATE
+          && m_sequenceOf[c.m_index] == c.m_sequence)
+        {
+          index = c.m_index;
+          return true;
+        }
+    }
+  return false;
+}
+
+// ---------------------------------------------------------------------------
+//
+// DSRKspWorkspace Implementation
+//
+// ---------------------------------------------------------------------------
+
+DSRKspWorkspace::DSRKspWorkspace ()
+  : m_routes (0),
+    m_removal (0),
+    m_search (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+DSRKspWorkspace::Reset (uint32_t nVertices, uint32_t nEdges)
+{
+  NS_LOG_FUNCTION (this << nVertices << nEdges);
+  m_distance.assign (nVertices, DISTINFINITY);
+  m_predEdge.assign (nVertices, -1);
+  m_done.assign (nVertices, 0);
+  m_vertexRemoved.assign (nVertices, 0);
+  m_reached.assign (nVertices, 0);
+  m_edgeRemoved.assign (nEdges, 0);
+  m_heap.clear ();
+  m_removal = 1;
+  m_search = 1;
+}
+
+void
+DSRKspWorkspace::ClearRemoved (void)
+{
+  if (++m_removal == 0)
+    {
+      std::fill (m_vertexRemoved.begin (), m_vertexRemoved.end (), 0);
+      std::fill (m_edgeRemoved.begin (), m_edgeRemoved.end (), 0);
+      m_removal = 1;
+    }
+}
+
+void
+DSRKspWorkspace::RemoveVertex (uint32_t v)
+{
+  m_vertexRemoved[v] = m_removal;
+}
+
+void
+DSRKspWorkspace::RemoveEdge (uint32_t e)
+{
+  m_edgeRemoved[e] = m_removal;
+}
+
+bool
+DSRKspWorkspace::IsVertexRemoved (uint32_t v) const
+{
+  return m_vertexRemoved[v] == m_removal;
+}
+
+bool
+DSRKspWorkspace::IsEdgeRemoved (uint32_t e) const
+{
+  return m_edgeRemoved[e] == m_removal;
+}
+
+void
+DSRKspWorkspace::NewSearch (void)
+{
+  m_heap.clear ();
+  if (++m_search == 0)
+    {
+      std::fill (m_reached.begin (), m_reached.end (), 0);
+      m_search = 1;
+    }
+}
+
+bool
+DSRKspWorkspace::IsReached (uint32_t v) const
+{
+  return m_reached[v] == m_search;
+}
+
+void
+DSRKspWorkspace::Reach (uint32_t v, uint32_t distance, int32_t edge)
+{
+  if (m_reached[v] != m_search)
+    {
+      m_reached[v] = m_search;
+      m_done[v] = 0;
+    }
+  m_distance[v] = distance;
+  m_predEdge[v] = edge;
+  m_heap.push_back (std::make_pair (distance, v));
+  std::push_heap (m_heap.begin (), m_heap.end (), std::greater<std::pair<uint32_t, uint32_t> > ());
+}
+
+// ---------------------------------------------------------------------------
+//
+// DSRDistanceMatrix Implementation
+//
+// ---------------------------------------------------------------------------
+
+const uint32_t DSRDistanceMatrix::TILE;
+const uint32_t DSRDistanceMatrix::INFINITY_CELL;
+
+namespace {
+/// Fewest vertices for which DsrSpfBackend Auto considers the distance matrix
+const uint32_t DSR_MATRIX_MIN_VERTICES = 2 * DSRDistanceMatrix::TILE;
+/// Most vertices for which DsrSpfBackend Auto considers the distance matrix
+const uint32_t DSR_MATRIX_MAX_VERTICES = 32 * DSRDistanceMatrix::TILE;
+/// Cells the Floyd-Warshall kernel relaxes in the time Dijkstra scans an edge
+const uint32_t DSR_MATRIX_CELLS_PER_EDGE = 8;
+} // anonymous namespace
+
+DSRDistanceMatrix::DSRDistanceMatrix ()
+  : m_nVertices (0),
+    m_stride (0)
+{
+  NS_LOG_FUNCTION (this);
+}
+
+bool
+DSRDistanceMatrix::Fits (const DSRGraphSnapshot& g)
+{
+  return static_cast<uint64_t> (g.GetMaxWeight ()) * g.GetNVertices () < INFINITY_CELL;
+}
+
+void
+DSRDistanceMatrix::Initialize (const DSRGraphSnapshot& g)
+{
+  NS_LOG_FUNCTION (this << g.GetNVertices ());
+  NS_ASSERT (Fits (g));
+  m_nVertices = g.GetNVertices ();
+  m_stride = (m_nVertices + TILE - 1) / TILE * TILE;
+  m_cells.assign (static_cast<size_t> (m_stride) * m_stride, INFINITY_CELL);
+  for (uint32_t v = 0; v < m_nVertices; v++)
+    {
+      uint32_t* row = &m_cells[static_cast<size_t> (v) * m_stride];
+      row[v] = 0;
+      for (uint32_t e = g.m_rowStart[v]; e < g.m_rowStart[v + 1]; e++)
+        {
+          int32_t w = g.m_target[e];
+          if (w >= 0)
+            {
+              row[w] = std::min (row[w], g.m_weight[e]);
+            }
+        }
+    }
+}
+
+void
+DSRDistanceMatrix::Clear (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_nVertices = 0;
+  m_stride = 0;
+  std::vector<uint32_t> ().swap (m_cells);
+}
+
+uint32_t
+DSRDistanceMatrix::GetNTiles (void) const
+{
+  return m_stride / TILE;
+}
+
+void
+DSRDistanceMatrix::RelaxTile (uint32_t i, uint32_t j, uint32_t k)
+{
+  uint32_t* c = &m_cells[static_cast<size_t> (i) * TILE * m_stride + j * TILE];
+  const uint32_t* a = &m_cells[static_cast<size_t> (i) * TILE * m_stride + k * TILE];
+  const uint32_t* b = &m_cells[static_cast<size_t> (k) * TILE * m_stride + j * TILE];
+//
+// Vertex kk of tile k is the intermediate vertex of the outer loop, so the
+// row and column of kk are not changed while it is: tile k has zeros on
+// its diagonal.  The inner loop over a contiguous row is a vectorisable
+// min-plus update; a cell never exceeds INFINITY_CELL, so the sums cannot
+// overflow.
+//
+  for (uint32_t kk = 0; kk < TILE; kk++)
+    {
+      const uint32_t* bRow = b + static_cast<size_t> (kk) * m_stride;
+      for (uint32_t ii = 0; ii < TILE; ii++)
+        {
+          uint32_t aik = a[static_cast<size_t> (ii) * m_stride + kk];
+          if (aik == INFINITY_CELL)
+            {
+              continue;
+            }
+          uint32_t* cRow = c + static_cast<size_t> (ii) * m_stride;
+          for (uint32_t jj = 0; jj < TILE; jj++)
+            {
+              cRow[jj] = std::min (cRow[jj], aik + bRow[jj]);
+            }
+        }
+    }
+}
+
+uint32_t
+DSRDistanceMatrix::Get (uint32_t from, uint32_t to) const
+{
+  NS_ASSERT (from < m_nVertices && to < m_nVertices);
+  uint32_t distance = m_cells[static_cast<size_t> (from) * m_stride + to];
+  return distance == INFINITY_CELL ? DISTINFINITY : distance;
+}
+
+// ---------------------------------------------------------------------------
+//
+// DSRWorkerPool Implementation
+//
+// ---------------------------------------------------------------------------
+
+DSRWorkerPool::DSRWorkerPool (uint32_t nThreads)
+  : m_nThreads (std::max<uint32_t> (nThreads, 1)),
+    m_job (0),
+    m_next (0),
+    m_end (0),
+    m_round (0),
+    m_busy (0),
+    m_stop (false)
+{
+  NS_LOG_FUNCTION (this << nThreads);
+  for (uint32_t t = 1; t < m_nThreads; ++t)
+    {
+      m_threads.push_back (std::thread (&DSRWorkerPool::Work, this, t));
+    }
+}
+
+DSRWorkerPool::~DSRWorkerPool ()
+{
+  NS_LOG_FUNCTION (this);
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_stop = true;
+  }
+  m_start.notify_all ();
+  for (uint32_t t = 0; t < m_threads.size (); ++t)
+    {
+      m_threads[t].join ();
+    }
+}
+
+uint32_t
+DSRWorkerPool::GetNThreads (void) const
+{
+  return m_nThreads;
+}
+
+void
+DSRWorkerPool::Run (uint32_t begin, uint32_t end, const Job_t& job)
+{
+  NS_LOG_FUNCTION (this << begin << end);
+  if (m_threads.empty () || end - begin <= 1)
+    {
+      for (uint32_t k = begin; k < end; ++k)
+        {
+          job (k, 0);
+        }
+      return;
+    }
+  {
+    std::lock_guard<std::mutex> lock (m_mutex);
+    m_job = &job;
+    m_next = begin;
+    m_end = end;
+    m_busy = m_threads.size ();
+    m_round++;
+  }
+  m_start.notify_all ();
+  Drain (0);
+  std::unique_lock<std::mutex> lock (m_mutex);
+  m_finish.wait (lock, [this] () { return m_busy == 0; });
+  m_job = 0;
+}
+
+void
+DSRWorkerPool::Drain (uint32_t worker)
+{
+  for (uint32_t k = m_next++; k < m_end; k = m_next++)
+    {
+      (*m_job) (k, worker);
+    }
+}
+
+void
+DSRWorkerPool::Work (uint32_t worker)
+{
+  uint64_t round = 0;
+  std::unique_lock<std::mutex> lock (m_mutex);
+  while (true)
+    {
+      m_start.wait (lock, [this, round] () { return m_stop || m_round != round; });
+      if (m_stop)
+        {
+          return;
+        }
+      round = m_round;
+      lock.unlock ();
+      Drain (worker);
+      lock.lock ();
+      if (--m_busy == 0)
+        {
+          m_finish.notify_one ();
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+//
+// DSRRouteManagerImpl Implementation
+//
+// ---------------------------------------------------------------------------
+
+static GlobalValue g_dsrRouteComputationThreads ("DsrRouteComputationThreads",
+                                                 "Number of threads used to discover the LSAs and "
+                                                 "compute DSR routes (0 selects one thread per "
+                                                 "hardware thread)",
+                                                 UintegerValue (1),
+                                                 MakeUintegerChecker<uint32_t> ());
+
+static GlobalValue g_dsrKShortestPaths ("DsrKShortestPaths",
+                                        "Number of loopless paths computed per destination; "
+                                        "values above 1 add ranked alternative routes",
+                                        UintegerValue (1),
+                                        MakeUintegerChecker<uint32_t> (1));
+
+static GlobalValue g_dsrKShortestMaxDistance ("DsrKShortestMaxDistance",
+                                              "Alternative paths longer than this are pruned, "
+                                              "typically the largest delay budget (0 for no limit)",
+                                              UintegerValue (0),
+                                              MakeUintegerChecker<uint32_t> ());
+
+static GlobalValue g_dsrKShortestMaxRoutes ("DsrKShortestMaxRoutes",
+                                            "Largest number of alternative routes added to a node",
+                                            UintegerValue (4096),
+                                            MakeUintegerChecker<uint32_t> ());
+
+static GlobalValue g_dsrSpfQueue ("DsrSpfQueue",
+                                  "Priority structure holding the SPF candidate list; "
+                                  "DialBuckets falls back to BinaryHeap when a link metric "
+                                  "reaches 65536, e.g. a ChannelDelay metric above about 65 ms",
+                                  EnumValue (DSRSPFWorkspace::BinaryHeap),
+                                  MakeEnumChecker (DSRSPFWorkspace::BinaryHeap, "BinaryHeap",
+                                                   DSRSPFWorkspace::DialBuckets, "DialBuckets"));
+
+static GlobalValue g_dsrSpfBackend ("DsrSpfBackend",
+                                    "Shortest path trees behind the SPF jobs: one Dijkstra search per "
+                                    "job, or trees read off an all-pairs distance matrix; Auto picks "
+                                    "the matrix for small dense graphs",
+                                    EnumValue (DSRDistanceMatrix::AutoBackend),
+                                    MakeEnumChecker (DSRDistanceMatrix::AutoBackend, "Auto",
+                                                     DSRDistanceMatrix::DijkstraBackend, "Dijkstra",
+                                                     DSRDistanceMatrix::MatrixBackend, "FloydWarshall"));
+
+static GlobalValue g_dsrIncrementalRouting ("DsrIncrementalRouting",
+                                            "Keep the SPF results so that interface events only rerun "
+                                            "the computations they affect; costs one distance per "
+                                            "router pair and a copy of every computed route of memory",
+                                            BooleanValue (false),
+                                            MakeBooleanChecker ());
+
+static GlobalValue g_dsrBestEffortRoutes ("DsrBestEffortRoutes",
+                                          "Compute a hop-count best-effort table next to the "
+                                          "delay-guaranteed routes; packets without a BudgetTag "
+                                          "then take the minimum hop route.  Each local router "
+                                          "gets one breadth-first search on top of its SPF runs",
+                                          BooleanValue (false),
+                                          MakeBooleanChecker ());
+
+static GlobalValue g_dsrLazyRouting ("DsrLazyRouting",
+                                     "Compute the delay-guaranteed routes to a router the first "
+                                     "time a packet needs them, with one reverse SPF run, instead "
+                                     "of all of them up front; the first packet to a stub, transit "
+                                     "or external network has them all computed",
+                                     BooleanValue (false),
+                                     MakeBooleanChecker ());
+
+static GlobalValue g_dsrSpfDelay ("DsrSpfDelay",
+                                  "Time from an interface event to the route update it "
+                                  "triggers; the events in between share the update",
+                                  TimeValue (Seconds (0)),
+                                  MakeTimeChecker ());
+
+static GlobalValue g_dsrSpfHoldTime ("DsrSpfHoldTime",
+                                     "Initial minimum time between two route updates "
+                                     "triggered by interface events",
+                                     TimeValue (MilliSeconds (50)),
+                                     MakeTimeChecker ());
+
+static GlobalValue g_dsrSpfMaxHoldTime ("DsrSpfMaxHoldTime",
+                                        "Largest minimum time between two route updates, "
+                                        "reached by doubling DsrSpfHoldTime under sustained churn",
+                                        TimeValue (Seconds (5)),
+                                        MakeTimeChecker ());
+
+namespace {
+
+/**
+ * \brief Wall-clock time elapsed since a point
+ * \param start the point
+ * \returns the elapsed time, in seconds
+ */
+double
+DsrSecondsSince (std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+}
+
+/**
+ * \brief Whether the nodes are partitioned among several MPI ranks
+ * \returns true in a distributed simulation of more than one rank
+ */
+bool
+DsrIsPartitioned (void)
+{
+#ifdef NS3_MPI
+  return MpiInterface::IsEnabled () && MpiInterface::GetSize () > 1;
+#else
+  return false;
+#endif
+}
+
+/**
+ * \brief Append an LSA to a buffer of 32-bit words
+ * \param lsa the LSA
+ * \param buffer the buffer
+ */
+void
+DsrSerializeLSA (const DSRRoutingLSA& lsa, std::vector<uint32_t>& buffer)
+{
+  buffer.push_back (lsa.GetLSType ());
+  buffer.push_back (lsa.GetLinkStateId ().Get ());
+  buffer.push_back (lsa.GetAdvertisingRouter ().Get ());
+  buffer.push_back (lsa.GetNetworkLSANetworkMask ().Get ());
+  buffer.push_back (lsa.GetNode () ? lsa.GetNode ()->GetId () : 0xffffffff);
+  buffer.push_back (lsa.GetNLinkRecords ());
+  for (uint32_t i = 0; i < lsa.GetNLinkRecords (); i++)
+    {
+      const DSRRoutingLinkRecord *l = lsa.GetLinkRecord (i);
+      buffer.push_back (l->GetLinkType ());
+      buffer.push_back (l->GetLinkId ().Get ());
+      buffer.push_back (l->GetLinkData ().Get ());
+      buffer.push_back (l->GetMetric ());
+    }
+  buffer.push_back (lsa.GetNAttachedRouters ());
+  for (uint32_t i = 0; i < lsa.GetNAttachedRouters (); i++)
+    {
+      buffer.push_back (lsa.GetAttachedRouter (i).Get ());
+    }
+}
+
+/**
+ * \brief Read an LSA written by DsrSerializeLSA
+ * \param buffer the buffer
+ * \param pos the offset of the LSA in the buffer, moved past it
+ * \returns a new LSA
+ */
+DSRRoutingLSA*
+DsrDeserializeLSA (const std::vector<uint32_t>& buffer, uint32_t& pos)
+{
+  DSRRoutingLSA* lsa = new DSRRoutingLSA ();
+  lsa->SetLSType (DSRRoutingLSA::LSType (buffer[pos++]));
+  lsa->SetLinkStateId (Ipv4Address (buffer[pos++]));
+  lsa->SetAdvertisingRouter (Ipv4Address (buffer[pos++]));
+  lsa->SetNetworkLSANetworkMask (Ipv4Mask (buffer[pos++]));
+  uint32_t nodeId = buffer[pos++];
+  if (nodeId != 0xffffffff)
+    {
+      lsa->SetNode (NodeList::GetNode (nodeId));
+    }
+  uint32_t nLinks = buffer[pos++];
+  for (uint32_t i = 0; i < nLinks; i++, pos += 4)
+    {
+      lsa->AddLinkRecord (new DSRRoutingLinkRecord (DSRRoutingLinkRecord::LinkType (buffer[pos]),
+                                                    Ipv4Address (buffer[pos + 1]),
+                                                    Ipv4Address (buffer[pos + 2]),
+                                                    buffer[pos + 3]));
+    }
+  uint32_t nAttached = buffer[pos++];
+  for (uint32_t i = 0; i < nAttached; i++)
+    {
+      lsa->AddAttachedRouter (Ipv4Address (buffer[pos++]));
+    }
+  return lsa;
+}
+
+} // anonymous namespace
+
+DSRRouteManagerImpl::DSRRouteManagerImpl () 
+  : m_jobsValid (false),
+    m_singleNode (false),
+    m_routedNode (0),
+    m_lazyReady (false),
+    m_lazyFallback (false),
+    m_scheduledUpdates (0),
+    m_pendingEvents (0)
+{
+  NS_LOG_FUNCTION (this);
+  m_lsdb = new DSRRouteManagerLSDB ();
+}
+
+DSRRouteManagerImpl::~DSRRouteManagerImpl ()
+{
+  NS_LOG_FUNCTION (this);
+  m_updateEvent.Cancel ();
+  if (m_lsdb)
+    {
+      delete m_lsdb;
+    }
+}
+
+void
+DSRRouteManagerImpl::DebugUseLsdb (DSRRouteManagerLSDB* lsdb)
+{
+  NS_LOG_FUNCTION (this << lsdb);
+  if (m_lsdb)
+    {
+      delete m_lsdb;
+    }
+  m_lsdb = lsdb;
+  m_graph.Build (*m_lsdb, m_areaRanges);
+  InstallNodeAddresses ();
+}
+
+void
+DSRRouteManagerImpl::ComputeNodeRoutes (DSRRouteManagerLSDB* lsdb, uint32_t nodeId)
+{
+  NS_LOG_FUNCTION (this << lsdb << nodeId);
+  m_stats = DSRRouteComputationStats ();
+  m_singleNode = true;
+  m_routedNode = nodeId;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  if (m_lsdb)
+    {
+      delete m_lsdb;
+    }
+  m_lsdb = lsdb;
+  m_graph.Build (*m_lsdb, m_areaRanges);
+  InstallNodeAddresses ();
+  m_stats.m_lsas = m_graph.GetNVertices ();
+  m_stats.m_lsdbTime = DsrSecondsSince (start);
+
+  Ptr<DSRRouter> router = NodeList::GetNode (nodeId)->GetObject<DSRRouter> ();
+  NS_ASSERT_MSG (router, "DSRRouteManagerImpl::ComputeNodeRoutes (): node has no DSRRouter");
+  InitializeRoutes ();
+  // every run starts from a new LSDB, so there is nothing to update later
+  std::vector<SPFJob> ().swap (m_jobs);
+  std::vector<std::vector<uint32_t> > ().swap (m_rootDistances);
+  std::vector<RouterJob> ().swap (m_bestEffortJobs);
+  m_jobsValid = false;
+}
+
+bool
+DSRRouteManagerImpl::IsRoutedNode (Ptr<Node> node) const
+{
+  if (m_singleNode)
+    {
+      return node->GetId () == m_routedNode;
+    }
+  return node->GetSystemId () == Simulator::GetSystemId ();
+}
+
+void
+DSRRouteManagerImpl::DeleteDSRRoutes ()
+{
+  NS_LOG_FUNCTION (this);
+  NodeList::Iterator listEnd = NodeList::End ();
+  for (NodeList::Iterator i = NodeList::Begin (); i != listEnd; i++)
+    {
+      Ptr<Node> node = *i;
+      Ptr<DSRRouter> router = node->GetObject<DSRRouter> ();
+      if (router == 0)
+        {
+          continue;
+        }
+      DeleteRoutes (router->GetRoutingProtocol ());
+    }
+  m_lazyRouters.clear ();
+  ClearRoutingDatabase ();
+}
+
+void
+DSRRouteManagerImpl::ClearRoutingDatabase ()
+{
+  NS_LOG_FUNCTION (this);
+  std::vector<SPFJob> ().swap (m_jobs);
+  std::vector<std::vector<uint32_t> > ().swap (m_rootDistances);
+  std::vector<RouterJob> ().swap (m_bestEffortJobs);
+  m_jobsValid = false;
+  m_lazyReady = false;
+  m_lazyFallback = false;
+  if (m_lsdb)
+    {
+      NS_LOG_LOGIC ("Deleting LSDB, creating new one");
+      delete m_lsdb;
+      m_lsdb = new DSRRouteManagerLSDB ();
+    }
+  m_graph.Clear ();
+}
+
+void
+DSRRouteManagerImpl::InstallNodeAddresses ()
+{
+  NS_LOG_FUNCTION (this);
+  const DSRGraphSnapshot& g = m_graph;
+  Ptr<DSRNodeAddressMap> addresses = Create<DSRNodeAddressMap> ();
+  for (uint32_t v = 0; v < g.GetNVertices (); v++)
+    {
+      if (g.m_vertexType[v] != DSRGraphSnapshot::VertexRouter)
+        {
+          continue;
+        }
+      for (uint32_t e = g.m_rowStart[v]; e < g.m_rowStart[v + 1]; e++)
+        {
+          if (g.m_linkType[e] == DSRRoutingLinkRecord::PointToPoint)
+            {
+              addresses->Add (Ipv4Address (g.m_linkData[e]), Ipv4Address (g.m_vertexId[v]));
+            }
+        }
+    }
+  addresses->Sort ();
+  NS_LOG_LOGIC (addresses->GetN () << " router addresses");
+  m_nodeAddresses = addresses;
+  bool lazy = IsLazy ();
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); i++)
+    {
+      Ptr<DSRRouter> router = (*i)->GetObject<DSRRouter> ();
+      if (router != 0 && IsRoutedNode (*i))
+        {
+          router->GetRoutingProtocol ()->SetNodeAddresses (addresses);
+          router->GetRoutingProtocol ()->SetLazyRouting (lazy);
+        }
+    }
+}
+
+void
+DSRRouteManagerImpl::AddAreaRange (uint32_t area, Ipv4Address network, Ipv4Mask mask)
+{
+  NS_LOG_FUNCTION (this << area << network << mask);
+  m_areaRanges[area].push_back (std::make_pair (network.Get () & mask.Get (), mask.Get ()));
+}
+
+void
+DSRRouteManagerImpl::RecomputeRoutes ()
+{
+  NS_LOG_FUNCTION (this);
+  ClearRoutingDatabase ();
+  BuildDSRRoutingDatabase ();
+  InitializeRoutes ();
+}
+
+void
+DSRRouteManagerImpl::DeleteRoutes (Ptr<Ipv4DSRRouting> gr) const
+{
+  NS_LOG_FUNCTION (this << gr);
+  uint32_t j = 0;
+  uint32_t nRoutes = gr->GetNRoutes ();
+  NS_LOG_LOGIC ("Deleting " << gr->GetNRoutes ()<< " routes");
+  // Each time we delete route 0, the route index shifts downward
+  // We can delete all routes if we delete the route numbered 0
+  // nRoutes times
+  for (j = 0; j < nRoutes; j++)
+    {
+      NS_LOG_LOGIC ("Deleting global route " << j);
+      gr->RemoveRoute (0);
+    }
+  NS_LOG_LOGIC ("Deleted " << j << " global routes");
+}
+
+//
+// In order to build the routing database, we need to walk the list of nodes
+// in the system and look for those that support the DSRRouter interface.
+// These routers will export a number of Link State Advertisements (LSAs)
+// that describe the links and networks that are "adjacent" (i.e., that are
+// on the other side of a point-to-point link).  We take these LSAs and put
+// add them to the Link State DataBase (LSDB) from which the routes will 
+// ultimately be computed.
+//
+void
+DSRRouteManagerImpl::BuildDSRRoutingDatabase () 
+{
+  NS_LOG_FUNCTION (this);
+  m_stats = DSRRouteComputationStats ();
+  bool partitioned = DsrIsPartitioned ();
+  uint32_t systemId = Simulator::GetSystemId ();
+  std::vector<std::vector<DSRRoutingLSA*> > byNode;
+  if (partitioned)
+    {
+      byNode.resize (NodeList::GetNNodes ());
+    }
+//
+// Walk the list of nodes looking for the DSRRouter Interface.  Nodes with
+// global router interfaces are, not too surprisingly, our routers.
+//
+  std::vector<Ptr<DSRRouter> > routers;
+  std::vector<uint32_t> nodeIds;
+  NodeList::Iterator listEnd = NodeList::End ();
+  for (NodeList::Iterator i = NodeList::Begin (); i != listEnd; i++)
+    {
+      Ptr<Node> node = *i;
+      Ptr<DSRRouter> rtr = node->GetObject<DSRRouter> ();
+//
+// Ignore nodes that aren't participating in routing.
+//
+      if (!rtr)
+        {
+          continue;
+        }
+//
+// In a distributed simulation the rank that owns a node advertises it.
+//
+      if (partitioned && node->GetSystemId () != systemId)
+        {
+          continue;
+        }
+      routers.push_back (rtr);
+      nodeIds.push_back (node->GetId ());
+    }
+//
+// You must call DiscoverLSAs () before trying to use any routing info or to
+// update LSAs.  DiscoverLSAs () drives the process of discovering routes in
+// the DSRRouter.  Afterward, you may use GetNumLSAs (), which is a very
+// computationally inexpensive call.  If you call GetNumLSAs () before calling 
+// DiscoverLSAs () will get zero as the number since no routes have been 
+// found.
+//
+// The nodes are read once into the device index; the routers then only read
+// the index and their own node, so they discover their LSAs concurrently.
+//
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  DSRDeviceIndex devices;
+  devices.Build ();
+  std::vector<uint32_t> numLSAs (routers.size ());
+  DSRWorkerPool workers (GetComputationThreads ());
+  workers.Run (0, routers.size (),
+               [&routers, &devices, &numLSAs] (uint32_t k, uint32_t)
+                 {
+                   numLSAs[k] = routers[k]->DiscoverLSAs (devices);
+                 });
+  devices.Clear ();
+  m_stats.m_discoveryTime += DsrSecondsSince (start);
+
+//
+// Collect the LSAs in node order, whatever order the routers finished in, so
+// that the vertices are numbered the same way on every run.
+//
+  for (uint32_t k = 0; k < routers.size (); ++k)
+    {
+      m_stats.m_lsas += numLSAs[k];
+      NS_LOG_LOGIC ("Found " << numLSAs[k] << " LSAs");
+
+      for (uint32_t j = 0; j < numLSAs[k]; ++j)
+        {
+//
+// This is the call to actually fetch a Link State Advertisement from the 
+// router.  The database shares it with the router rather than copying it.
+//
+          Ptr<DSRRoutingLSA> lsa = routers[k]->GetLSA (j);
+          NS_LOG_LOGIC (*lsa);
+          if (partitioned)
+            {
+              lsa->Ref ();
+              byNode[nodeIds[k]].push_back (PeekPointer (lsa));
+              continue;
+            }
+//
+// Write the newly discovered link state advertisement to the database.
+//
+          start = std::chrono::steady_clock::now ();
+          m_lsdb->Insert (lsa->GetLinkStateId (), lsa); 
+          m_stats.m_lsdbTime += DsrSecondsSince (start);
+        }
+    }
+  if (partitioned)
+    {
+      ExchangeLSAs (byNode);
+//
+// Insert in node order, like the walk above, so that every rank numbers the
+// vertices as a single process would and computes the same routes.
+//
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+      for (uint32_t n = 0; n < byNode.size (); n++)
+        {
+          for (uint32_t j = 0; j < byNode[n].size (); j++)
+            {
+              m_lsdb->Insert (byNode[n][j]->GetLinkStateId (), byNode[n][j]);
+            }
+        }
+      m_stats.m_lsdbTime += DsrSecondsSince (start);
+    }
+//
+// Flatten the database for the SPF runs.
+//
+  start = std::chrono::steady_clock::now ();
+  m_graph.Build (*m_lsdb, m_areaRanges);
+  InstallNodeAddresses ();
+  m_stats.m_lsdbTime += DsrSecondsSince (start);
+  NS_LOG_INFO ("Discovered " << m_stats.m_lsas << " LSAs in " << m_stats.m_discoveryTime << 
+               " s, built the LSDB in " << m_stats.m_lsdbTime << " s");
+}
+
+uint32_t
+DSRRouteManagerImpl::PackLSAs (const std::vector<std::vector<DSRRoutingLSA*> >& byNode,
+                               std::vector<uint32_t>& buffer)
+{
+  uint32_t packed = 0;
+  for (uint32_t n = 0; n < byNode.size (); n++)
+    {
+      if (byNode[n].empty ())
+        {
+          continue;
+        }
+      buffer.push_back (n);
+      buffer.push_back (byNode[n].size ());
+      for (uint32_t j = 0; j < byNode[n].size (); j++)
+        {
+          DsrSerializeLSA (*byNode[n][j], buffer);
+        }
+      packed += byNode[n].size ();
+    }
+  return packed;
+}
+
+uint32_t
+DSRRouteManagerImpl::UnpackLSAs (const std::vector<uint32_t>& buffer, uint32_t begin, uint32_t end,
+                                 std::vector<std::vector<DSRRoutingLSA*> >& byNode)
+{
+  uint32_t unpacked = 0;
+  for (uint32_t pos = begin; pos < end; )
+    {
+      uint32_t n = buffer[pos++];
+      uint32_t nLSAs = buffer[pos++];
+      NS_ASSERT_MSG (n < byNode.size () && byNode[n].empty (), "LSAs of node " << n << " received twice");
+      for (uint32_t j = 0; j < nLSAs; j++)
+        {
+          byNode[n].push_back (DsrDeserializeLSA (buffer, pos));
+        }
+      unpacked += nLSAs;
+    }
+  return unpacked;
+}
+
+void
+DSRRouteManagerImpl::ExchangeLSAs (std::vector<std::vector<DSRRoutingLSA*> >& byNode)
+{
+  NS_LOG_FUNCTION (this);
+#ifdef NS3_MPI
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  std::vector<uint32_t> sendBuffer;
+  uint32_t sent = PackLSAs (byNode, sendBuffer);
+//
+// One all-gather of the buffer sizes, then one of the buffers themselves.
+//
+  MPI_Comm communicator = MpiInterface::GetCommunicator ();
+  uint32_t nRanks = MpiInterface::GetSize ();
+  int sendCount = sendBuffer.size ();
+  std::vector<int> counts (nRanks);
+  std::vector<int> offsets (nRanks);
+  MPI_Allgather (&sendCount, 1, MPI_INT, &counts[0], 1, MPI_INT, communicator);
+  int total = 0;
+  for (uint32_t r = 0; r < nRanks; r++)
+    {
+      offsets[r] = total;
+      total += counts[r];
+    }
+  sendBuffer.push_back (0);
+  std::vector<uint32_t> receiveBuffer (total + 1);
+  MPI_Allgatherv (&sendBuffer[0], sendCount, MPI_UINT32_T,
+                  &receiveBuffer[0], &counts[0], &offsets[0], MPI_UINT32_T, communicator);
+
+  uint32_t rank = MpiInterface::GetSystemId ();
+  uint32_t received = 0;
+  for (uint32_t r = 0; r < nRanks; r++)
+    {
+      if (r != rank)
+        {
+          received += UnpackLSAs (receiveBuffer, offsets[r], offsets[r] + counts[r], byNode);
+        }
+    }
+  m_stats.m_lsas += received;
+  m_stats.m_discoveryTime += DsrSecondsSince (start);
+  NS_LOG_LOGIC ("Sent " << sent << " LSAs, received " << received << " from " << nRanks - 1 << " ranks");
+#endif /* NS3_MPI */
+}
+
+//
+// For each node that is a global router (which is determined by the presence
+// of an aggregated DSRRouter interface), run the Dijkstra SPF calculation
+// on the database rooted at that router, and populate the node forwarding
+// tables.
+//
+// This function parallels RFC2328, Section 16.1.1, and quagga ospfd
+//
+// This calculation yields the set of intra-area routes associated
+// with an area (called hereafter Area A).  A router calculates the
+// shortest-path tree using itself as the root.  The formation
+// of the shortest path tree is done here in two stages.  In the
+// first stage, only links between routers and transit networks are
+// considered.  Using the Dijkstra algorithm, a tree is formed from
+// this subset of the link state database.  In the second stage,
+// leaves are added to the tree by considering the links to stub
+// networks.
+//
+// The area's link state database is represented as a directed graph.
+// The graph's vertices are routers, transit networks and stub networks.
+//
+// The first stage of the procedure (i.e., the Dijkstra algorithm)
+// can now be summarized as follows. At each iteration of the
+// algorithm, there is a list of candidate vertices.  Paths from
+// the root to these vertices have been found, but not necessarily
+// the shortest ones.  However, the paths to the candidate vertex
+// that is closest to the root are guaranteed to be shortest; this
+// vertex is added to the shortest-path tree, removed from the
+// candidate list, and its adjacent vertices are examined for
+// possible addition to/modification of the candidate list.  The
+// algorithm then iterates again.  It terminates when the candidate
+// list becomes empty. 
+//
+void
+DSRRouteManagerImpl::InitializeRoutes ()
+{
+  NS_LOG_FUNCTION (this);
+//
+// The SPF runs only read the snapshot built with the LSDB, so they can be
+// spread over worker threads.  Everything that touches the nodes happens
+// here, on this thread.
+//
+  if (IsLazy ())
+    {
+      InitializeLazyRoutes ();
+      return;
+    }
+  NS_LOG_INFO ("About to start SPF calculation");
+  const DSRGraphSnapshot& g = m_graph;
+  std::vector<Ptr<Ipv4DSRRouting> > tables;
+  std::vector<SPFJob> jobs;
+  std::vector<RouterJob> routerJobs;
+  CollectSPFJobs (jobs, routerJobs, tables);
+
+  UintegerValue kValue, maxDistanceValue, maxRoutesValue;
+  g_dsrKShortestPaths.GetValue (kValue);
+  g_dsrKShortestMaxDistance.GetValue (maxDistanceValue);
+  g_dsrKShortestMaxRoutes.GetValue (maxRoutesValue);
+  uint32_t k = kValue.Get ();
+  uint32_t maxDistance = maxDistanceValue.Get () ? maxDistanceValue.Get () : DISTINFINITY;
+  uint32_t maxRoutes = maxRoutesValue.Get ();
+//
+// For UpdateRoutes (), keep the routes of every job and the distances of one
+// job per SPF root.  The ranked alternative routes are not maintained
+// incrementally.
+//
+  BooleanValue incremental;
+  g_dsrIncrementalRouting.GetValue (incremental);
+  bool keep = incremental.Get () && k <= 1;
+  std::vector<std::vector<uint32_t> > rootDistances;
+  if (keep)
+    {
+      rootDistances.resize (g.GetNVertices ());
+      for (uint32_t j = 0; j < jobs.size (); j++)
+        {
+          if (rootDistances[jobs[j].m_rootIndex].empty ())
+            {
+              rootDistances[jobs[j].m_rootIndex].resize (g.GetNVertices ());
+              jobs[j].m_distances = &rootDistances[jobs[j].m_rootIndex];
+            }
+        }
+    }
+//
+// The best-effort table of each local router is searched on the same
+// snapshot, by the same workers and with the same workspaces, right after
+// the SPF jobs.
+//
+  BooleanValue bestEffort;
+  g_dsrBestEffortRoutes.GetValue (bestEffort);
+  std::vector<RouterJob> bestEffortJobs;
+  if (bestEffort.Get ())
+    {
+      bestEffortJobs = routerJobs;
+    }
+//
+// Run the queued computations in batches: each batch is computed in parallel
+// and its recorded routes are then staged by node, in queue order, before the
+// next one starts.  A table is replaced as a whole, so nothing is installed
+// until every batch is done: the staged records of all the routes are held
+// until then, while the copies kept by the jobs are released as they are
+// staged unless the jobs are kept for UpdateRoutes ().
+//
+  uint32_t nThreads = GetComputationThreads ();
+  uint32_t batchSize = std::max<uint32_t> (64, 16 * nThreads);
+  DSRWorkerPool workers (nThreads);
+  std::vector<DSRSPFWorkspace> workspaces (nThreads);
+  InitializeWorkspaces (workspaces);
+  uint32_t nJobs = jobs.size ();
+  uint32_t nTotal = nJobs + bestEffortJobs.size ();
+  NS_LOG_INFO ("Running " << nJobs << " SPF and " << bestEffortJobs.size () << 
+               " best-effort computations on " << nThreads << " threads");
+  double spfTime = 0;
+  double installTime = 0;
+//
+// On a small dense graph most vertices are the root of many jobs.  The
+// shortest path tree of each root is then read off one distance matrix, in
+// parallel over the roots, and the jobs replay the tree of their root.
+//
+  std::vector<DSRSPFTree> trees;
+  std::vector<uint32_t> treeOf;
+  uint32_t matrixVertices = 0;
+  if (UseDistanceMatrix (nJobs))
+    {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+      DSRDistanceMatrix matrix;
+      ComputeDistanceMatrix (matrix, workers);
+      std::vector<uint32_t> roots;
+      treeOf.assign (g.GetNVertices (), 0);
+      std::vector<uint8_t> isRoot (g.GetNVertices (), 0);
+      for (uint32_t j = 0; j < nJobs; j++)
+        {
+          uint32_t root = jobs[j].m_rootIndex;
+          if (!isRoot[root])
+            {
+              isRoot[root] = 1;
+              treeOf[root] = roots.size ();
+              roots.push_back (root);
+            }
+        }
+      trees.resize (roots.size ());
+      workers.Run (0, roots.size (),
+                   [this, &workspaces, &matrix, &roots, &trees] (uint32_t r, uint32_t t)
+                     {
+                       MatrixTree (workspaces[t], matrix, roots[r], trees[r]);
+                     });
+      matrixVertices = g.GetNVertices ();
+      spfTime += DsrSecondsSince (start);
+      NS_LOG_INFO ("Derived " << roots.size () << " SPF trees from a distance matrix of " <<
+                   matrixVertices << " vertices");
+    }
+  StagedRoutes_t staged (tables.size ());
+  for (uint32_t begin = 0; begin < nTotal; begin += batchSize)
+    {
+      uint32_t end = std::min<uint32_t> (begin + batchSize, nTotal);
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+      workers.Run (begin, end,
+                   [this, &jobs, &bestEffortJobs, &workspaces, &trees, &treeOf, nJobs] (uint32_t j, uint32_t t)
+                     {
+                       if (j < nJobs)
+                         {
+                           if (trees.empty ())
+                             {
+                               SPFCalculate (workspaces[t], jobs[j]);
+                             }
+                           else
+                             {
+                               MatrixCalculate (workspaces[t], trees[treeOf[jobs[j].m_rootIndex]], jobs[j]);
+                             }
+                           SaveDistances (workspaces[t], jobs[j]);
+                         }
+                       else
+                         {
+                           BestEffortCalculate (workspaces[t], bestEffortJobs[j - nJobs]);
+                         }
+                     });
+      spfTime += DsrSecondsSince (start);
+      start = std::chrono::steady_clock::now ();
+      for (uint32_t j = begin; j < end; j++)
+        {
+          std::vector<DSRRouteRecord>& routes = j < nJobs ? jobs[j].m_routes : bestEffortJobs[j - nJobs].m_routes;
+          StageRoutes (routes, tables, staged);
+          if (!keep)
+            {
+              std::vector<DSRRouteRecord> ().swap (routes);
+            }
+        }
+      installTime += DsrSecondsSince (start);
+    }
+//
+// With DsrKShortestPaths above 1, ranked alternative routes are appended to
+// the tables of the local routers once all the shortest path routes are in,
+// batched the same way.
+//
+  uint64_t kspRoutes = 0;
+  if (k > 1)
+    {
+      std::vector<DSRKspWorkspace> kspWorkspaces (nThreads);
+      for (uint32_t t = 0; t < nThreads; t++)
+        {
+          kspWorkspaces[t].Reset (g.GetNVertices (), g.GetNEdges ());
+        }
+      NS_LOG_INFO ("Computing " << k << " shortest paths for " << routerJobs.size () << " routers");
+      for (uint32_t begin = 0; begin < routerJobs.size (); begin += batchSize)
+        {
+          uint32_t end = std::min<uint32_t> (begin + batchSize, routerJobs.size ());
+          std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+          workers.Run (begin, end,
+                       [this, &routerJobs, &kspWorkspaces, k, maxDistance, maxRoutes] (uint32_t j, uint32_t t)
+                         {
+                           KspCalculate (kspWorkspaces[t], routerJobs[j], k, maxDistance, maxRoutes);
+                         });
+          spfTime += DsrSecondsSince (start);
+          start = std::chrono::steady_clock::now ();
+          for (uint32_t j = begin; j < end; j++)
+            {
+              kspRoutes += routerJobs[j].m_routes.size ();
+              StageRoutes (routerJobs[j].m_routes, tables, staged);
+              std::vector<DSRRouteRecord> ().swap (routerJobs[j].m_routes);
+            }
+          installTime += DsrSecondsSince (start);
+        }
+    }
+
+  m_jobs.swap (jobs);
+  m_rootDistances.swap (rootDistances);
+  m_bestEffortJobs.swap (bestEffortJobs);
+  m_jobsValid = keep;
+  if (!keep)
+    {
+      std::vector<SPFJob> ().swap (m_jobs);
+      std::vector<std::vector<uint32_t> > ().swap (m_rootDistances);
+      std::vector<RouterJob> ().swap (m_bestEffortJobs);
+    }
+
+  ResetComputationStats ();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  ApplyStagedRoutes (tables, staged);
+  installTime += DsrSecondsSince (start);
+  m_stats.m_spfTime = spfTime;
+  m_stats.m_installTime = installTime;
+  if (k > 1)
+    {
+      m_stats.m_kspRuns = routerJobs.size ();
+      m_stats.m_kspRoutes = kspRoutes;
+    }
+  m_stats.m_spfRuns = nJobs;
+  m_stats.m_bestEffortRuns = nTotal - nJobs;
+  m_stats.m_matrixVertices = matrixVertices;
+  CountWorkspaces (workspaces);
+  CountRoutes (tables);
+  NS_LOG_INFO ("Finished DSR-SPF calculation: " << m_stats.m_spfRuns << " SPF runs, " <<
+               m_stats.m_arenaChunks << " arena chunks, " << m_stats.m_arenaBytes << 
+               " arena bytes, " << m_stats.m_inlineSpills << " inline spills");
+}
+
+void
+DSRRouteManagerImpl::CollectSPFJobs (std::vector<SPFJob>& jobs, std::vector<RouterJob>& routerJobs,
+                                     std::vector<Ptr<Ipv4DSRRouting> >& tables) const
+{
+  NS_LOG_FUNCTION (this);
+  const DSRGraphSnapshot& g = m_graph;
+  tables.assign (NodeList::GetNNodes (), Ptr<Ipv4DSRRouting> ());
+//
+// Walk the list of nodes in the system and queue one SPF computation per
+// transit link of every local router.  The queue order is the order in
+// which the serial algorithm visited them, and routes are installed in that
+// order whatever the number of threads.
+//
+  NodeList::Iterator listEnd = NodeList::End ();
+  for (NodeList::Iterator i = NodeList::Begin (); i != listEnd; i++)
+    {
+      Ptr<Node> node = *i;
+      //
+      // Look for the DSRRouter interface that indicates that the node is
+      // participating in routing.
+      //
+      Ptr<DSRRouter> rtr = 
+        node->GetObject<DSRRouter> ();
+      if (rtr == 0)
+        {
+          continue;
+        }
+      //
+      // In a distributed simulation only the nodes assigned to our systemId
+      // get routes, and after ComputeNodeRoutes () only one node.  The SPF
+      // run of a link is rooted at the far end and also installs the
+      // network routes of that end, so the links of other nodes towards our
+      // nodes are queued too.
+      //
+      bool local = IsRoutedNode (node);
+      if (local)
+        {
+          tables[node->GetId ()] = rtr->GetRoutingProtocol ();
+        }
+
+      //
+      // if the node has a DSR router interface, then run the DSR routing
+      // algorithms.  Loop over the transit edges of its router vertex; links
+      // to stub networks are not part of the rows.
+      //
+      uint32_t v = m_lsdb->GetLSAIndex (rtr->GetRouterId ());
+      if (v >= g.GetNVertices ())
+        {
+          // a router the in-band protocol has not heard of yet
+          NS_ASSERT (m_singleNode && !local);
+          continue;
+        }
+      if (local)
+        {
+          RouterJob routerJob;
+          routerJob.m_sourceIndex = v;
+          routerJob.m_nodeId = node->GetId ();
+          routerJobs.push_back (routerJob);
+        }
+      for (uint32_t e = g.m_rowStart[v]; e < g.m_rowStart[v + 1]; e++)
+        {
+          int32_t w = g.m_target[e];
+          NS_ASSERT (w >= 0);
+          if (!local && !IsRoutedNode (NodeList::GetNode (g.m_nodeId[w])))
+            {
+              continue;
+            }
+          SPFJob job;
+          job.m_rootIndex = w;
+          job.m_sourceIndex = v;
+          job.m_initNodeId = node->GetId ();
+          job.m_area = g.m_vertexArea[v];
+          job.m_distances = 0;
+          if (g.m_linkType[e] == DSRRoutingLinkRecord::PointToPoint)
+            {
+              NS_LOG_LOGIC ("Found a P2P record from " << 
+                            Ipv4Address (g.m_vertexId[v]) << " to " << Ipv4Address (g.m_vertexId[w]));
+              //
+              // linkRemote is the record of the same link seen from <w>; its
+              // link data is the next hop towards <w>.
+              //
+              int32_t linkRemote = g.m_reverse[e];
+              NS_ASSERT (linkRemote >= 0);
+              int32_t Iface = g.m_outIf[e];
+
+              job.m_distance = g.m_weight[linkRemote];
+              job.m_nextHop = g.m_linkData[linkRemote];
+              job.m_interface = Iface;
+              //
+              // The neighbour itself is one hop away: add a host route to
+              // each of its interface addresses through this link.  The
+              // next hop is the destination, so it never routes back.
+              //
+              for (uint32_t k = g.m_hostStart[w]; k < g.m_hostStart[w + 1]; k++)
+                {
+                  DSRRouteRecord route;
+                  route.m_type = DSRRouteRecord::HostRoute;
+                  route.m_nodeId = node->GetId ();
+                  route.m_dest = g.m_hostAddr[k];
+                  route.m_mask = 0;
+                  route.m_nextHop = job.m_nextHop;
+                  route.m_interface = Iface;
+                  route.m_distance = g.m_weight[e];
+                  route.m_roundTrip = DISTINFINITY;
+                  job.m_routes.push_back (route);
+                }
+            }
+          else
+            {
+              NS_LOG_LOGIC ("Found a Transit record from " << 
+                            Ipv4Address (g.m_vertexId[v]) << " to " << Ipv4Address (g.m_vertexId[w]));
+              job.m_distance = g.m_weight[e];
+              job.m_nextHop = g.m_linkData[e];
+              job.m_interface = g.m_outIf[e];
+            }
+          job.m_nHostRoutes = job.m_routes.size ();
+          jobs.push_back (job);
+        }
+    }
+}
+
+bool
+DSRRouteManagerImpl::IsLazy (void) const
+{
+  BooleanValue lazy;
+  g_dsrLazyRouting.GetValue (lazy);
+  UintegerValue kValue;
+  g_dsrKShortestPaths.GetValue (kValue);
+  return lazy.Get () && !m_lazyFallback && !m_singleNode && kValue.Get () <= 1 && m_areaRanges.empty ();
+}
+
+bool
+DSRRouteManagerImpl::IsNetworkDestination (Ipv4Address address) const
+{
+  NS_LOG_FUNCTION (this << address);
+  const DSRGraphSnapshot& g = m_graph;
+  uint32_t a = address.Get ();
+  for (uint32_t s = 0; s < g.m_stubNetwork.size (); s++)
+    {
+      if ((a & g.m_stubMask[s]) == g.m_stubNetwork[s])
+        {
+          return true;
+        }
+    }
+  for (uint32_t v = 0; v < g.GetNVertices (); v++)
+    {
+      if (g.m_vertexType[v] == DSRGraphSnapshot::VertexNetwork
+          && (a & g.m_networkMask[v]) == (g.m_vertexId[v] & g.m_networkMask[v]))
+        {
+          return true;
+        }
+    }
+  for (uint32_t i = 0; i < g.m_extNetwork.size (); i++)
+    {
+      if ((a & g.m_extMask[i]) == g.m_extNetwork[i])
+        {
+          return true;
+        }
+    }
+  return false;
+}
+
+void
+DSRRouteManagerImpl::CollectLazyJobs (std::vector<Ptr<Ipv4DSRRouting> >& tables,
+                                      std::vector<RouterJob>& routerJobs,
+                                      std::vector<DSRRouteRecord>& routes)
+{
+  NS_LOG_FUNCTION (this);
+  const DSRGraphSnapshot& g = m_graph;
+  std::vector<SPFJob> jobs;
+  CollectSPFJobs (jobs, routerJobs, tables);
+  m_graph.BuildInEdges ();
+  EnumValue queueType;
+  g_dsrSpfQueue.GetValue (queueType);
+  m_lazyWorkspace.SetQueueType (static_cast<DSRSPFWorkspace::QueueType> (queueType.Get ()),
+                                g.GetMaxWeight ());
+//
+// The SPF run of a job rooted at a stub router ends with the stub test, so
+// its routes are known without a run.  The other jobs only contribute their
+// host routes to the neighbour until a destination is asked for.
+//
+  m_jobs.clear ();
+  for (uint32_t j = 0; j < jobs.size (); j++)
+    {
+      m_lazyWorkspace.Reset (g.GetNVertices (), &jobs[j].m_routes);
+      m_lazyWorkspace.m_rootIndex = jobs[j].m_rootIndex;
+      bool stub = CheckForStubNode (m_lazyWorkspace);
+      routes.insert (routes.end (), jobs[j].m_routes.begin (), jobs[j].m_routes.end ());
+      if (!stub)
+        {
+          std::vector<DSRRouteRecord> ().swap (jobs[j].m_routes);
+          m_jobs.push_back (jobs[j]);
+        }
+    }
+  m_lazyReady = true;
+  NS_LOG_LOGIC (m_jobs.size () << " of " << jobs.size () << " SPF jobs kept for the lazy routes");
+}
+
+void
+DSRRouteManagerImpl::InitializeLazyRoutes ()
+{
+  NS_LOG_FUNCTION (this);
+  const DSRGraphSnapshot& g = m_graph;
+  std::vector<Ptr<Ipv4DSRRouting> > tables;
+  std::vector<RouterJob> routerJobs;
+  std::vector<DSRRouteRecord> routes;
+  CollectLazyJobs (tables, routerJobs, routes);
+//
+// The routers computed on demand so far get their routes again, from the
+// new snapshot; those that left it are forgotten.
+//
+  std::vector<uint32_t> dests;
+  for (std::set<uint32_t>::iterator i = m_lazyRouters.begin (); i != m_lazyRouters.end (); )
+    {
+      uint32_t v = m_lsdb->GetLSAIndex (Ipv4Address (*i));
+      if (v < g.GetNVertices () && g.m_vertexType[v] == DSRGraphSnapshot::VertexRouter)
+        {
+          dests.push_back (v);
+          i++;
+        }
+      else
+        {
+          m_lazyRouters.erase (i++);
+        }
+    }
+  BooleanValue bestEffort;
+  g_dsrBestEffortRoutes.GetValue (bestEffort);
+  std::vector<RouterJob> bestEffortJobs;
+  if (bestEffort.Get ())
+    {
+      bestEffortJobs = routerJobs;
+    }
+  uint32_t nThreads = GetComputationThreads ();
+  DSRWorkerPool workers (nThreads);
+  std::vector<DSRSPFWorkspace> workspaces (nThreads);
+  InitializeWorkspaces (workspaces);
+  uint32_t nDests = dests.size ();
+  std::vector<std::vector<DSRRouteRecord> > destRoutes (nDests);
+  NS_LOG_INFO ("Running " << nDests << " reverse SPF and " << bestEffortJobs.size () <<
+               " best-effort computations on " << nThreads << " threads");
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  workers.Run (0, nDests + bestEffortJobs.size (),
+               [this, &dests, &destRoutes, &bestEffortJobs, &workspaces, nDests] (uint32_t j, uint32_t t)
+                 {
+                   if (j < nDests)
+                     {
+                       LazyCalculate (workspaces[t], dests[j], destRoutes[j]);
+                     }
+                   else
+                     {
+                       BestEffortCalculate (workspaces[t], bestEffortJobs[j - nDests]);
+                     }
+                 });
+  double spfTime = DsrSecondsSince (start);
+
+  start = std::chrono::steady_clock::now ();
+  StagedRoutes_t staged (tables.size ());
+  StageRoutes (routes, tables, staged);
+  for (uint32_t j = 0; j < nDests; j++)
+    {
+      StageRoutes (destRoutes[j], tables, staged);
+    }
+  for (uint32_t j = 0; j < bestEffortJobs.size (); j++)
+    {
+      StageRoutes (bestEffortJobs[j].m_routes, tables, staged);
+    }
+  std::vector<std::vector<uint32_t> > ().swap (m_rootDistances);
+  std::vector<RouterJob> ().swap (m_bestEffortJobs);
+  m_jobsValid = false;
+
+  ResetComputationStats ();
+  ApplyStagedRoutes (tables, staged);
+  m_stats.m_spfTime = spfTime;
+  m_stats.m_installTime = DsrSecondsSince (start);
+  m_stats.m_spfRuns = nDests;
+  m_stats.m_bestEffortRuns = bestEffortJobs.size ();
+  CountWorkspaces (workspaces);
+  CountRoutes (tables);
+  NS_LOG_INFO ("Finished lazy DSR-SPF calculation: " << m_jobs.size () << " SPF jobs deferred, " <<
+               nDests << " routers computed");
+}
+
+bool
+DSRRouteManagerImpl::ComputeRoutesTo (Ipv4Address address)
+{
+  NS_LOG_FUNCTION (this << address);
+  Ipv4Address routerId;
+  if (!IsLazy () || m_nodeAddresses == 0)
+    {
+      return false;
+    }
+  if (!m_nodeAddresses->Lookup (address, routerId))
+    {
+//
+// The deferred jobs dropped their routes to the stub, transit and external
+// networks.  Rather than one more kind of reverse run, compute every route
+// the eager way, once.
+//
+      if (!IsNetworkDestination (address))
+        {
+          return false;
+        }
+      NS_LOG_INFO ("Network destination " << address << ": computing every route up front");
+      m_lazyFallback = true;
+      InitializeRoutes ();
+      InstallNodeAddresses ();
+      return true;
+    }
+  if (!m_lazyReady)
+    {
+//
+// The tables were loaded from an image rather than computed: the routers
+// it holds node routes to were computed before it was saved.
+//
+      std::vector<Ptr<Ipv4DSRRouting> > tables;
+      std::vector<RouterJob> routerJobs;
+      std::vector<DSRRouteRecord> routes;
+      CollectLazyJobs (tables, routerJobs, routes);
+      std::vector<Ipv4DSRRoutingTableEntry> entries;
+      for (uint32_t n = 0; n < tables.size (); n++)
+        {
+          if (tables[n] != 0)
+            {
+              tables[n]->GetRoutes (Ipv4DSRRouting::NODE_ROUTES, entries);
+            }
+        }
+      for (uint32_t r = 0; r < entries.size (); r++)
+        {
+          m_lazyRouters.insert (entries[r].GetDest ().Get ());
+        }
+    }
+  if (!m_lazyRouters.insert (routerId.Get ()).second)
+    {
+      return false;
+    }
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  std::vector<DSRRouteRecord> routes;
+  LazyCalculate (m_lazyWorkspace, m_lsdb->GetLSAIndex (routerId), routes);
+  m_stats.m_spfTime += DsrSecondsSince (start);
+  start = std::chrono::steady_clock::now ();
+  for (std::vector<DSRRouteRecord>::const_iterator i = routes.begin (); i != routes.end (); i++)
+    {
+      Ptr<Node> node = NodeList::GetNode (i->m_nodeId);
+      Ptr<DSRRouter> router = node->GetObject<DSRRouter> ();
+      if (router != 0 && IsRoutedNode (node))
+        {
+          router->GetRoutingProtocol ()->AddNodeRouteTo (Ipv4Address (i->m_dest), Ipv4Address (i->m_nextHop),
+                                                         i->m_interface, i->m_distance);
+        }
+    }
+  m_stats.m_installTime += DsrSecondsSince (start);
+  m_stats.m_lazyRuns++;
+  NS_LOG_LOGIC ("Computed " << routes.size () << " routes to router " << routerId);
+  return true;
+}
+
+void
+DSRRouteManagerImpl::InitializeWorkspaces (std::vector<DSRSPFWorkspace>& workspaces) const
+{
+  NS_LOG_FUNCTION (this << workspaces.size ());
+  EnumValue queueType;
+  g_dsrSpfQueue.GetValue (queueType);
+  for (uint32_t t = 0; t < workspaces.size (); t++)
+    {
+      workspaces[t].SetQueueType (static_cast<DSRSPFWorkspace::QueueType> (queueType.Get ()),
+                                  m_graph.GetMaxWeight ());
+    }
+}
+
+void
+DSRRouteManagerImpl::CountWorkspaces (const std::vector<DSRSPFWorkspace>& workspaces)
+{
+  NS_LOG_FUNCTION (this << workspaces.size ());
+  for (uint32_t t = 0; t < workspaces.size (); t++)
+    {
+      const DSRSPFArena& arena = workspaces[t].m_arena;
+      m_stats.m_arenaChunks += arena.GetChunkAllocations ();
+      m_stats.m_arenaBytes += arena.GetBytesAllocated ();
+      m_stats.m_inlineSpills += arena.GetSpills ();
+      m_stats.m_queueOperations += workspaces[t].m_queueOperations;
+      m_stats.m_verticesReached += workspaces[t].m_verticesReached;
+    }
+}
+
+void
+DSRRouteManagerImpl::CountRoutes (const std::vector<Ptr<Ipv4DSRRouting> >& tables)
+{
+  NS_LOG_FUNCTION (this << tables.size ());
+  m_stats.m_routesPerNode.assign (tables.size (), 0);
+  m_stats.m_routesInstalled = 0;
+  for (uint32_t n = 0; n < tables.size (); n++)
+    {
+      if (tables[n] != 0)
+        {
+          m_stats.m_routesPerNode[n] = tables[n]->GetNRoutes ();
+          m_stats.m_routesInstalled += m_stats.m_routesPerNode[n];
+        }
+    }
+}
+
+void
+DSRRouteManagerImpl::ResetComputationStats (void)
 {
   NS_LOG_FUNCTION (this);
-  NodeList::Iterator listEnd = NodeList::End ();
-  for (NodeList::Iterator i = NodeList::Begin (); i != listEnd; i++)
+  DSRRouteComputationStats stats;
+  stats.m_lsas = m_stats.m_lsas;
+  stats.m_discoveryTime = m_stats.m_discoveryTime;
+  stats.m_lsdbTime = m_stats.m_lsdbTime;
+  m_stats = stats;
+}
+
+void
+DSRRouteManagerImpl::SaveDistances (const DSRSPFWorkspace& ws, const SPFJob& job) const
+{
+  if (job.m_distances == 0)
+    {
+      return;
+    }
+  const DSRGraphSnapshot& g = m_graph;
+  std::vector<uint32_t>& distances = *job.m_distances;
+  for (uint32_t v = 0; v < distances.size (); v++)
+    {
+      distances[v] = ws.GetStatus (v) == DSRRoutingLSA::LSA_SPF_NOT_EXPLORED ?
+        DISTINFINITY : ws.m_distance[v] - job.m_distance;
+    }
+//
+// A stub root stops at its only transit link, but its default route still
+// depends on the record of the peer pointing back; count the peer as
+// reached so that a change to it reruns the job.
+//
+  uint32_t root = job.m_rootIndex;
+  for (uint32_t e = g.m_rowStart[root]; e < g.m_rowStart[root + 1]; e++)
+    {
+      int32_t w = g.m_target[e];
+      if (w >= 0 && distances[w] == DISTINFINITY)
+        {
+          distances[w] = g.m_weight[e];
+        }
+    }
+}
+
+void
+DSRRouteManagerImpl::SetRoundTrips (const DSRSPFWorkspace& ws, SPFJob& job) const
+{
+//
+// The host and node routes of the initial node all leave through the link
+// of the job; the other routes belong to nodes of the tree.  A root that
+// does not reach the initial node never routes back through it.
+//
+  uint32_t roundTrip = ws.GetStatus (job.m_sourceIndex) == DSRRoutingLSA::LSA_SPF_IN_SPFTREE ?
+    ws.m_distance[job.m_sourceIndex] : DISTINFINITY;
+  for (uint32_t r = job.m_nHostRoutes; r < job.m_routes.size (); r++)
+    {
+      DSRRouteRecord& route = job.m_routes[r];
+      if (route.m_nodeId == job.m_initNodeId
+          && (route.m_type == DSRRouteRecord::HostRoute || route.m_type == DSRRouteRecord::NodeRoute))
+        {
+          route.m_roundTrip = roundTrip;
+        }
+    }
+}
+
+namespace {
+
+/**
+ * \brief How a vertex changed between two snapshots
+ */
+struct DsrVertexChange
+{
+  uint32_t m_vertex;      //!< the vertex
+  bool m_structural;      //!< any change other than edge metrics or a link gone from the graph
+  bool m_pruned;          //!< a point-to-point link or stub gone from the whole graph
+  /// target and old metric of the edges lengthened or removed
+  std::vector<std::pair<uint32_t, uint32_t> > m_lost;
+  /// target and new metric of the edges whose metric changed
+  std::vector<std::pair<uint32_t, uint32_t> > m_gained;
+};
+
+/**
+ * \brief Effect of the changed vertices on the SPF runs from one root
+ */
+enum DsrRootChange
+{
+  DSR_ROOT_KEPT,   //!< the routes are unchanged
+  DSR_ROOT_PRUNED, //!< the routes to addresses gone from the graph disappear
+  DSR_ROOT_RERUN   //!< the SPF runs must be repeated
+};
+
+/// Compare edge ea of a with edge eb of b, metric excluded
+bool
+DsrSameEdge (const DSRGraphSnapshot& a, uint32_t ea, const DSRGraphSnapshot& b, uint32_t eb)
+{
+  if (a.m_target[ea] != b.m_target[eb] || a.m_linkData[ea] != b.m_linkData[eb]
+      || a.m_linkType[ea] != b.m_linkType[eb] || a.m_outIf[ea] != b.m_outIf[eb])
+    {
+      return false;
+    }
+  int32_t ra = a.m_reverse[ea];
+  int32_t rb = b.m_reverse[eb];
+  if (ra < 0 || rb < 0)
+    {
+      return ra == rb;
+    }
+  return a.m_linkData[ra] == b.m_linkData[rb] && a.m_linkType[ra] == b.m_linkType[rb];
+}
+
+/// Compare the stubs, edges and mask of vertex v in two snapshots
+bool
+DsrCompareVertex (const DSRGraphSnapshot& a, const DSRGraphSnapshot& b, uint32_t v,
+                  const std::set<uint32_t>& goneHosts,
+                  const std::set<std::pair<uint32_t, uint32_t> >& goneStubs,
+                  DsrVertexChange& change)
+{
+  change.m_vertex = v;
+  change.m_structural = a.m_networkMask[v] != b.m_networkMask[v];
+  change.m_pruned = false;
+  bool isRouter = a.m_vertexType[v] == DSRGraphSnapshot::VertexRouter;
+  bool changed = change.m_structural;
+//
+// The remaining edges must keep their order; a point-to-point edge may only
+// disappear together with its address.
+//
+  uint32_t j = b.m_rowStart[v];
+  for (uint32_t i = a.m_rowStart[v]; i < a.m_rowStart[v + 1]; i++)
+    {
+      if (j < b.m_rowStart[v + 1] && DsrSameEdge (a, i, b, j))
+        {
+          if (a.m_weight[i] != b.m_weight[j] && a.m_target[i] >= 0)
+            {
+              changed = true;
+              change.m_lost.push_back (std::make_pair (a.m_target[i], a.m_weight[i]));
+              change.m_gained.push_back (std::make_pair (b.m_target[j], b.m_weight[j]));
+            }
+          j++;
+          continue;
+        }
+      changed = true;
+      if (isRouter && a.m_linkType[i] == DSRRoutingLinkRecord::PointToPoint
+          && goneHosts.count (a.m_linkData[i]))
+        {
+          change.m_pruned = true;
+          if (a.m_target[i] >= 0)
+            {
+              change.m_lost.push_back (std::make_pair (a.m_target[i], a.m_weight[i]));
+            }
+        }
+      else
+        {
+          change.m_structural = true;
+        }
+    }
+  if (j < b.m_rowStart[v + 1])
+    {
+      changed = change.m_structural = true;
+    }
+  j = b.m_stubStart[v];
+  for (uint32_t i = a.m_stubStart[v]; i < a.m_stubStart[v + 1]; i++)
+    {
+      if (j < b.m_stubStart[v + 1] && a.m_stubNetwork[i] == b.m_stubNetwork[j]
+          && a.m_stubMask[i] == b.m_stubMask[j])
+        {
+          j++;
+          continue;
+        }
+      changed = true;
+      if (goneStubs.count (std::make_pair (a.m_stubNetwork[i], a.m_stubMask[i])))
+        {
+          change.m_pruned = true;
+        }
+      else
+        {
+          change.m_structural = true;
+        }
+    }
+  if (j < b.m_stubStart[v + 1])
+    {
+      changed = change.m_structural = true;
+    }
+  if (changed && !isRouter)
+    {
+      change.m_structural = true;
+    }
+  return changed;
+}
+
+/**
+ * \brief Decide whether the changes alter the SPF runs from a root
+ *
+ * Only the vertices the runs reached matter.  A metric change or a removed
+ * edge leaves the shortest path tree alone unless the old edge was on a
+ * shortest path (its head is exactly as far as the tail plus the old metric)
+ * or the new edge is at least as short as the current path to its head.
+ */
+DsrRootChange
+DsrClassifyRoot (uint32_t root, const std::vector<uint32_t>& distances,
+                 const std::vector<DsrVertexChange>& changes)
+{
+  if (distances.empty ())
+    {
+      return DSR_ROOT_RERUN;
+    }
+  DsrRootChange result = DSR_ROOT_KEPT;
+  for (uint32_t c = 0; c < changes.size (); c++)
+    {
+      const DsrVertexChange& change = changes[c];
+      uint64_t du = distances[change.m_vertex];
+      if (du == DISTINFINITY)
+        {
+          continue;
+        }
+      if (change.m_vertex == root || change.m_structural)
+        {
+          return DSR_ROOT_RERUN;
+        }
+      for (uint32_t k = 0; k < change.m_lost.size (); k++)
+        {
+          uint32_t dx = distances[change.m_lost[k].first];
+          if (dx != DISTINFINITY && du + change.m_lost[k].second == dx)
+            {
+              return DSR_ROOT_RERUN;
+            }
+        }
+      for (uint32_t k = 0; k < change.m_gained.size (); k++)
+        {
+          if (du + change.m_gained[k].second <= distances[change.m_gained[k].first])
+            {
+              return DSR_ROOT_RERUN;
+            }
+        }
+      if (change.m_pruned)
+        {
+          result = DSR_ROOT_PRUNED;
+        }
+    }
+  return result;
+}
+
+/// Test whether a route leads to an address gone from the graph
+bool
+DsrIsGone (const DSRRouteRecord& route, const std::set<uint32_t>& goneHosts,
+           const std::set<std::pair<uint32_t, uint32_t> >& goneStubs)
+{
+  if (route.m_type == DSRRouteRecord::HostRoute || route.m_type == DSRRouteRecord::BestEffortHostRoute)
+    {
+      return goneHosts.count (route.m_dest) != 0;
+    }
+  return (route.m_type == DSRRouteRecord::NetworkRoute || route.m_type == DSRRouteRecord::BestEffortNetworkRoute)
+         && goneStubs.count (std::make_pair (route.m_dest, route.m_mask)) != 0;
+}
+
+/// Compare two recorded routes
+bool
+DsrSameRoute (const DSRRouteRecord& a, const DSRRouteRecord& b)
+{
+  return a.m_type == b.m_type && a.m_nodeId == b.m_nodeId && a.m_dest == b.m_dest
+         && a.m_mask == b.m_mask && a.m_nextHop == b.m_nextHop
+         && a.m_interface == b.m_interface && a.m_distance == b.m_distance
+         && a.m_roundTrip == b.m_roundTrip;
+}
+
+/// Flag the nodes that receive some of the routes
+void
+DsrMarkNodes (const std::vector<DSRRouteRecord>& routes, std::vector<uint8_t>& nodes)
+{
+  for (uint32_t r = 0; r < routes.size (); r++)
+    {
+      nodes[routes[r].m_nodeId] = 1;
+    }
+}
+
+} // anonymous namespace
+
+//
+// A link event only moves the part of each shortest path tree that the
+// changed LSAs touch.  The distances of the previous runs tell which SPF
+// roots can see a change, in the spirit of Ramalingam and Reps' dynamic
+// SPF; the other runs and their routes are kept as they are.
+//
+void
+DSRRouteManagerImpl::UpdateRoutes ()
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_jobsValid)
+    {
+      RecomputeRoutes ();
+      return;
+    }
+  DSRGraphSnapshot previous;
+  std::swap (previous, m_graph);
+  delete m_lsdb;
+  m_lsdb = new DSRRouteManagerLSDB ();
+  BuildDSRRoutingDatabase ();
+  if (!ApplyGraphChange (previous))
+    {
+      NS_LOG_LOGIC ("Recomputing every route");
+      InitializeRoutes ();
+    }
+}
+
+void
+DSRRouteManagerImpl::ScheduleUpdateRoutes ()
+{
+  NS_LOG_FUNCTION (this);
+  m_pendingEvents++;
+  if (m_updateEvent.IsRunning ())
+    {
+      NS_LOG_LOGIC ("Update already scheduled, " << m_pendingEvents << " events pending");
+      return;
+    }
+  TimeValue delayValue, holdValue, maxHoldValue;
+  g_dsrSpfDelay.GetValue (delayValue);
+  g_dsrSpfHoldTime.GetValue (holdValue);
+  g_dsrSpfMaxHoldTime.GetValue (maxHoldValue);
+  Time now = Simulator::Now ();
+  Time delay = delayValue.Get ();
+  if (m_scheduledUpdates > 0 && now < m_lastUpdate + m_holdTime)
+    {
+//
+// Sustained churn: wait for the hold time to expire, and back off further
+// for the next update.
+//
+      delay = std::max (delay, m_lastUpdate + m_holdTime - now);
+      m_holdTime = std::min (m_holdTime + m_holdTime, maxHoldValue.Get ());
+    }
+  else
+    {
+      m_holdTime = holdValue.Get ();
+    }
+  NS_LOG_LOGIC ("Updating the routes in " << delay.GetSeconds () << " s, then holding for " <<
+                m_holdTime.GetSeconds () << " s");
+  m_updateEvent = Simulator::Schedule (delay, &DSRRouteManagerImpl::RunScheduledUpdate, this);
+}
+
+void
+DSRRouteManagerImpl::RunScheduledUpdate ()
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t events = m_pendingEvents;
+  m_pendingEvents = 0;
+  m_lastUpdate = Simulator::Now ();
+  m_scheduledUpdates++;
+  UpdateRoutes ();
+  m_stats.m_coalescedEvents = events;
+  NS_LOG_INFO ("Scheduled update " << m_scheduledUpdates << " served " << events << " interface events");
+}
+
+bool
+DSRRouteManagerImpl::ApplyGraphChange (const DSRGraphSnapshot& previous)
+{
+  NS_LOG_FUNCTION (this);
+  const DSRGraphSnapshot& g = m_graph;
+  BooleanValue incremental;
+  g_dsrIncrementalRouting.GetValue (incremental);
+  UintegerValue kValue;
+  g_dsrKShortestPaths.GetValue (kValue);
+  if (!m_jobsValid || !incremental.Get () || kValue.Get () > 1)
+    {
+      return false;
+    }
+//
+// The distances are indexed by vertex, so the LSAs must be the same ones.
+//
+  if (g.m_vertexId != previous.m_vertexId || g.m_vertexType != previous.m_vertexType
+      || g.m_nodeId != previous.m_nodeId || g.m_extAdvertiser != previous.m_extAdvertiser
+      || g.m_extNetwork != previous.m_extNetwork || g.m_extMask != previous.m_extMask)
+    {
+      NS_LOG_LOGIC ("The set of LSAs changed");
+      return false;
+    }
+  if (g.m_vertexArea != previous.m_vertexArea || g.m_rangeStart != previous.m_rangeStart
+      || g.m_rangeNetwork != previous.m_rangeNetwork || g.m_rangeMask != previous.m_rangeMask)
+    {
+      NS_LOG_LOGIC ("The areas changed");
+      return false;
+    }
+//
+// Addresses of links that are gone from the whole graph.  The routes the SPF
+// runs computed to them can be removed from the tables in place.
+//
+  std::set<uint32_t> goneHosts;
+  std::set<std::pair<uint32_t, uint32_t> > goneStubs;
+  for (uint32_t e = 0; e < previous.GetNEdges (); e++)
+    {
+      if (previous.m_linkType[e] == DSRRoutingLinkRecord::PointToPoint)
+        {
+          goneHosts.insert (previous.m_linkData[e]);
+        }
+    }
+  for (uint32_t s = 0; s < previous.m_stubNetwork.size (); s++)
+    {
+      goneStubs.insert (std::make_pair (previous.m_stubNetwork[s], previous.m_stubMask[s]));
+    }
+  for (uint32_t e = 0; e < g.GetNEdges (); e++)
+    {
+      if (g.m_linkType[e] == DSRRoutingLinkRecord::PointToPoint)
+        {
+          goneHosts.erase (g.m_linkData[e]);
+        }
+    }
+  for (uint32_t s = 0; s < g.m_stubNetwork.size (); s++)
+    {
+      goneStubs.erase (std::make_pair (g.m_stubNetwork[s], g.m_stubMask[s]));
+    }
+  for (uint32_t v = 0; v < g.GetNVertices (); v++)
+    {
+      if (g.m_vertexType[v] == DSRGraphSnapshot::VertexNetwork)
+        {
+          goneStubs.erase (std::make_pair (g.m_vertexId[v] & g.m_networkMask[v], g.m_networkMask[v]));
+        }
+    }
+//
+// Removing the route to a gone address in place would leave the distance of
+// a summary that covered it stale.
+//
+  if (g.GetNRanges () > 0 && (!goneHosts.empty () || !goneStubs.empty ()))
+    {
+      NS_LOG_LOGIC ("Addresses are gone from a topology with area ranges");
+      return false;
+    }
+
+  std::vector<DsrVertexChange> changes;
+  for (uint32_t v = 0; v < g.GetNVertices (); v++)
+    {
+      DsrVertexChange change;
+      if (DsrCompareVertex (previous, g, v, goneHosts, goneStubs, change))
+        {
+          changes.push_back (change);
+        }
+    }
+  NS_LOG_LOGIC (changes.size () << " vertices changed");
+
+  std::vector<Ptr<Ipv4DSRRouting> > tables;
+  std::vector<SPFJob> jobs;
+  std::vector<RouterJob> routerJobs;
+  CollectSPFJobs (jobs, routerJobs, tables);
+//
+// Pair each job with the previous job of the same link, and decide for each
+// SPF root whether its runs must be repeated.  A node whose routes change
+// in any other way than losing the gone addresses has its table rewritten.
+//
+  typedef std::pair<std::pair<uint32_t, uint32_t>, std::pair<uint32_t, uint32_t> > JobKey_t;
+  std::multimap<JobKey_t, uint32_t> previousJobs;
+  for (uint32_t o = 0; o < m_jobs.size (); o++)
+    {
+      const SPFJob& job = m_jobs[o];
+      previousJobs.insert (std::make_pair (JobKey_t (std::make_pair (job.m_initNodeId, job.m_rootIndex),
+                                                     std::make_pair (job.m_nextHop, job.m_interface)), o));
+    }
+  std::vector<uint8_t> rootChange (g.GetNVertices (), DSR_ROOT_KEPT);
+  std::vector<uint8_t> classified (g.GetNVertices (), 0);
+  std::vector<uint8_t> rewrite (tables.size (), 0);
+  std::vector<uint8_t> prune (tables.size (), 0);
+  std::vector<int32_t> matched (jobs.size (), -1);
+  std::vector<uint32_t> rerun;
+  m_rootDistances.resize (g.GetNVertices ());
+  uint32_t lastMatched = 0;
+  for (uint32_t j = 0; j < jobs.size (); j++)
+    {
+      SPFJob& job = jobs[j];
+      uint32_t root = job.m_rootIndex;
+      // the host routes to a neighbour keep the addresses of its interfaces
+      // that are down, so in-place removal would take too many
+      for (uint32_t r = 0; r < job.m_nHostRoutes; r++)
+        {
+          if (goneHosts.count (job.m_routes[r].m_dest))
+            {
+              rewrite[job.m_initNodeId] = 1;
+            }
+        }
+      if (!classified[root])
+        {
+          classified[root] = 1;
+          rootChange[root] = DsrClassifyRoot (root, m_rootDistances[root], changes);
+          if (rootChange[root] == DSR_ROOT_RERUN)
+            {
+              m_rootDistances[root].resize (g.GetNVertices ());
+              job.m_distances = &m_rootDistances[root];
+            }
+        }
+      std::multimap<JobKey_t, uint32_t>::iterator it =
+        previousJobs.lower_bound (JobKey_t (std::make_pair (job.m_initNodeId, root),
+                                     std::make_pair (job.m_nextHop, job.m_interface)));
+      if (it == previousJobs.end () || it->first != JobKey_t (std::make_pair (job.m_initNodeId, root),
+                                                              std::make_pair (job.m_nextHop, job.m_interface)))
+        {
+          rerun.push_back (j);
+          continue;
+        }
+      uint32_t o = it->second;
+      previousJobs.erase (it);
+      matched[j] = o;
+      SPFJob& old = m_jobs[o];
+      // a job that now comes before one it used to follow changes the order
+      // of the routes in the tables the two share
+      if (o < lastMatched)
+        {
+          DsrMarkNodes (old.m_routes, rewrite);
+        }
+      lastMatched = std::max (lastMatched, o);
+      bool sameStart = old.m_distance == job.m_distance && old.m_nHostRoutes == job.m_nHostRoutes;
+      for (uint32_t r = 0; sameStart && r < job.m_nHostRoutes; r++)
+        {
+          sameStart = DsrSameRoute (old.m_routes[r], job.m_routes[r]);
+        }
+      if (rootChange[root] == DSR_ROOT_RERUN || !sameStart)
+        {
+          rerun.push_back (j);
+          continue;
+        }
+      job.m_routes.swap (old.m_routes);
+      if (rootChange[root] == DSR_ROOT_PRUNED)
+        {
+          std::vector<DSRRouteRecord> kept (job.m_routes.begin (), job.m_routes.begin () + job.m_nHostRoutes);
+          for (uint32_t r = job.m_nHostRoutes; r < job.m_routes.size (); r++)
+            {
+              if (DsrIsGone (job.m_routes[r], goneHosts, goneStubs))
+                {
+                  prune[job.m_routes[r].m_nodeId] = 1;
+                }
+              else
+                {
+                  kept.push_back (job.m_routes[r]);
+                }
+            }
+          job.m_routes.swap (kept);
+        }
+    }
+  for (std::multimap<JobKey_t, uint32_t>::iterator it = previousJobs.begin (); it != previousJobs.end (); it++)
+    {
+      DsrMarkNodes (m_jobs[it->second].m_routes, rewrite);
+    }
+  for (uint32_t v = 0; v < g.GetNVertices (); v++)
     {
-      Ptr<Node> node = *i;
-      Ptr<DSRRouter> router = node->GetObject<DSRRouter> ();
-      if (router == 0)
+      if (!classified[v])
+        {
+          std::vector<uint32_t> ().swap (m_rootDistances[v]);
+        }
+    }
+//
+// Repeat the affected runs, all at once since the routes are kept anyway.
+// The best-effort searches are cheap next to the SPF runs and are all
+// repeated, in the same dispatch.
+//
+  BooleanValue bestEffort;
+  g_dsrBestEffortRoutes.GetValue (bestEffort);
+  std::vector<RouterJob> bestEffortJobs;
+  if (bestEffort.Get ())
+    {
+      bestEffortJobs = routerJobs;
+    }
+  uint32_t nThreads = GetComputationThreads ();
+  DSRWorkerPool workers (nThreads);
+  std::vector<DSRSPFWorkspace> workspaces (nThreads);
+  InitializeWorkspaces (workspaces);
+  uint32_t nRerun = rerun.size ();
+  NS_LOG_INFO ("Rerunning " << nRerun << " of " << jobs.size () << " SPF computations");
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+  workers.Run (0, nRerun + bestEffortJobs.size (),
+               [this, &jobs, &rerun, &bestEffortJobs, &workspaces, nRerun] (uint32_t k, uint32_t t)
+                 {
+                   if (k < nRerun)
+                     {
+                       SPFCalculate (workspaces[t], jobs[rerun[k]]);
+                       SaveDistances (workspaces[t], jobs[rerun[k]]);
+                     }
+                   else
+                     {
+                       BestEffortCalculate (workspaces[t], bestEffortJobs[k - nRerun]);
+                     }
+                 });
+  double spfTime = DsrSecondsSince (start);
+  for (uint32_t k = 0; k < rerun.size (); k++)
+    {
+      const SPFJob& job = jobs[rerun[k]];
+      bool same = false;
+      if (matched[rerun[k]] >= 0)
+        {
+          const std::vector<DSRRouteRecord>& routes = m_jobs[matched[rerun[k]]].m_routes;
+          same = routes.size () == job.m_routes.size ();
+          for (uint32_t r = 0; same && r < routes.size (); r++)
+            {
+              same = DsrSameRoute (routes[r], job.m_routes[r]);
+            }
+          if (!same)
+            {
+              DsrMarkNodes (routes, rewrite);
+            }
+        }
+      if (!same)
+        {
+          DsrMarkNodes (job.m_routes, rewrite);
+        }
+    }
+//
+// A best-effort table that only lost the gone addresses is pruned in place
+// like the others; any other difference rewrites it.
+//
+  bool sameRouters = bestEffortJobs.size () == m_bestEffortJobs.size ();
+  for (uint32_t b = 0; sameRouters && b < bestEffortJobs.size (); b++)
+    {
+      sameRouters = bestEffortJobs[b].m_nodeId == m_bestEffortJobs[b].m_nodeId;
+    }
+  for (uint32_t b = 0; b < m_bestEffortJobs.size (); b++)
+    {
+      const RouterJob& old = m_bestEffortJobs[b];
+      if (!sameRouters)
         {
+          rewrite[old.m_nodeId] = 1;
           continue;
         }
-      Ptr<Ipv4DSRRouting> gr = router->GetRoutingProtocol ();
-      uint32_t j = 0;
-      uint32_t nRoutes = gr->GetNRoutes ();
-      NS_LOG_LOGIC ("Deleting " << gr->GetNRoutes ()<< " routes from node " << node->GetId ());
-      // Each time we delete route 0, the route index shifts downward
-      // We can delete all routes if we delete the route numbered 0
-      // nRoutes times
-      for (j = 0; j < nRoutes; j++)
+      const std::vector<DSRRouteRecord>& routes = bestEffortJobs[b].m_routes;
+      uint32_t n = 0;
+      bool same = true;
+      for (uint32_t r = 0; same && r < old.m_routes.size (); r++)
+        {
+          if (DsrIsGone (old.m_routes[r], goneHosts, goneStubs))
+            {
+              prune[old.m_nodeId] = 1;
+              continue;
+            }
+          same = n < routes.size () && DsrSameRoute (old.m_routes[r], routes[n]);
+          n++;
+        }
+      if (!same || n != routes.size ())
         {
-          NS_LOG_LOGIC ("Deleting global route " << j << " from node " << node->GetId ());
-          gr->RemoveRoute (0);
+          rewrite[old.m_nodeId] = 1;
         }
-      NS_LOG_LOGIC ("Deleted " << j << " global routes from node "<< node->GetId ());
     }
-  if (m_lsdb)
+  for (uint32_t b = 0; !sameRouters && b < bestEffortJobs.size (); b++)
     {
-      NS_LOG_LOGIC ("Deleting LSDB, creating new one");
-      delete m_lsdb;
-      m_lsdb = new DSRRouteManagerLSDB ();
+      rewrite[bestEffortJobs[b].m_nodeId] = 1;
     }
-}
-
 //
-// In order to build the routing database, we need to walk the list of nodes
-// in the system and look for those that support the DSRRouter interface.
-// These routers will export a number of Link State Advertisements (LSAs)
-// that describe the links and networks that are "adjacent" (i.e., that are
-// on the other side of a point-to-point link).  We take these LSAs and put
-// add them to the Link State DataBase (LSDB) from which the routes will 
-// ultimately be computed.
+// Apply the new routes of the tables that changed, in installation order,
+// and remove the routes to the gone addresses from the tables that only
+// lost those.
 //
-void
-DSRRouteManagerImpl::BuildDSRRoutingDatabase () 
+  ResetComputationStats ();
+  start = std::chrono::steady_clock::now ();
+  uint32_t nRewritten = 0;
+  for (uint32_t n = 0; n < tables.size (); n++)
+    {
+      if (rewrite[n] && tables[n] != 0)
+        {
+          nRewritten++;
+        }
+    }
+  if (nRewritten > 0)
+    {
+      StagedRoutes_t staged (tables.size ());
+      for (uint32_t j = 0; j < jobs.size (); j++)
+        {
+          StageRoutes (jobs[j].m_routes, tables, staged, &rewrite);
+        }
+      for (uint32_t b = 0; b < bestEffortJobs.size (); b++)
+        {
+          StageRoutes (bestEffortJobs[b].m_routes, tables, staged, &rewrite);
+        }
+      ApplyStagedRoutes (tables, staged, &rewrite);
+    }
+  m_stats.m_churnPerNode.resize (tables.size (), 0);
+  for (uint32_t n = 0; n < tables.size (); n++)
+    {
+      if (prune[n] && !rewrite[n] && tables[n] != 0)
+        {
+          uint32_t removed = 0;
+          for (std::set<uint32_t>::const_iterator h = goneHosts.begin (); h != goneHosts.end (); h++)
+            {
+              removed += tables[n]->RemoveHostRoutesTo (Ipv4Address (*h));
+            }
+          for (std::set<std::pair<uint32_t, uint32_t> >::const_iterator s = goneStubs.begin ();
+               s != goneStubs.end (); s++)
+            {
+              removed += tables[n]->RemoveNetworkRoutesTo (Ipv4Address (s->first), Ipv4Mask (s->second));
+            }
+          m_stats.m_routesRemoved += removed;
+          m_stats.m_churnPerNode[n] += removed;
+        }
+    }
+  double installTime = DsrSecondsSince (start);
+  m_jobs.swap (jobs);
+  m_bestEffortJobs.swap (bestEffortJobs);
+
+  m_stats.m_spfTime = spfTime;
+  m_stats.m_installTime = installTime;
+  m_stats.m_spfRuns = rerun.size ();
+  m_stats.m_spfReused = m_jobs.size () - rerun.size ();
+  m_stats.m_bestEffortRuns = m_bestEffortJobs.size ();
+  CountWorkspaces (workspaces);
+  CountRoutes (tables);
+  NS_LOG_INFO ("Finished incremental DSR-SPF update: " << m_stats.m_spfRuns << " SPF runs, " <<
+               m_stats.m_spfReused << " kept, " << nRewritten << " tables rewritten");
+  return true;
+}
+
+const DSRRouteComputationStats&
+DSRRouteManagerImpl::GetRouteComputationStats (void) const
+{
+  return m_stats;
+}
+
+uint64_t
+DSRRouteManagerImpl::GetTopologyHash (void) const
 {
   NS_LOG_FUNCTION (this);
-//
-// Walk the list of nodes looking for the DSRRouter Interface.  Nodes with
-// global router interfaces are, not too surprisingly, our routers.
-//
-  NodeList::Iterator listEnd = NodeList::End ();
-  for (NodeList::Iterator i = NodeList::Begin (); i != listEnd; i++)
+  UintegerValue kValue;
+  g_dsrKShortestPaths.GetValue (kValue);
+  UintegerValue maxDistance;
+  g_dsrKShortestMaxDistance.GetValue (maxDistance);
+  UintegerValue maxRoutes;
+  g_dsrKShortestMaxRoutes.GetValue (maxRoutes);
+  BooleanValue bestEffort;
+  g_dsrBestEffortRoutes.GetValue (bestEffort);
+  uint64_t settings[] = {m_graph.GetHash (), kValue.Get (), maxDistance.Get (), maxRoutes.Get (), bestEffort.Get (),
+                         IsLazy ()};
+  return Hasher ().GetHash64 (reinterpret_cast<const char*> (settings), sizeof (settings));
+}
+
+uint32_t
+DSRRouteManagerImpl::GetComputationThreads (void) const
+{
+  NS_LOG_FUNCTION (this);
+  UintegerValue value;
+  g_dsrRouteComputationThreads.GetValue (value);
+  uint32_t nThreads = value.Get ();
+  if (nThreads == 0)
     {
-      Ptr<Node> node = *i;
-      Ptr<DSRRouter> rtr = node->GetObject<DSRRouter> ();
-//
-// Ignore nodes that aren't participating in routing.
-//
-      if (!rtr)
+      nThreads = std::thread::hardware_concurrency ();
+    }
+  return std::max<uint32_t> (nThreads, 1);
+}
+
+void
+DSRRouteManagerImpl::StageRoutes (const std::vector<DSRRouteRecord>& routes,
+                                  const std::vector<Ptr<Ipv4DSRRouting> >& tables,
+                                  StagedRoutes_t& staged,
+                                  const std::vector<uint8_t>* nodes) const
+{
+  NS_LOG_FUNCTION (this << routes.size ());
+  for (std::vector<DSRRouteRecord>::const_iterator i = routes.begin (); i != routes.end (); i++)
+    {
+      if (nodes && !(*nodes)[i->m_nodeId])
         {
           continue;
         }
-//
-// You must call DiscoverLSAs () before trying to use any routing info or to
-// update LSAs.  DiscoverLSAs () drives the process of discovering routes in
-// the DSRRouter.  Afterward, you may use GetNumLSAs (), which is a very
-// computationally inexpensive call.  If you call GetNumLSAs () before calling 
-// DiscoverLSAs () will get zero as the number since no routes have been 
-// found.
-//
-      Ptr<Ipv4DSRRouting> grouting = rtr->GetRoutingProtocol ();
-      uint32_t numLSAs = rtr->DiscoverLSAs ();
-      NS_LOG_LOGIC ("Found " << numLSAs << " LSAs");
-
-      for (uint32_t j = 0; j < numLSAs; ++j)
+      if (tables[i->m_nodeId] == 0)
         {
-          DSRRoutingLSA* lsa = new DSRRoutingLSA ();
-//
-// This is the call to actually fetch a Link State Advertisement from the 
-// router.
-//
-          rtr->GetLSA (j, *lsa);
-          NS_LOG_LOGIC (*lsa);
-//
-// Write the newly discovered link state advertisement to the database.
-//
-          m_lsdb->Insert (lsa->GetLinkStateId (), lsa); 
+          NS_LOG_LOGIC ("No DSRRouter interface on node " << i->m_nodeId);
+          continue;
         }
+      staged[i->m_nodeId].push_back (*i);
     }
 }
 
-//
-// For each node that is a global router (which is determined by the presence
-// of an aggregated DSRRouter interface), run the Dijkstra SPF calculation
-// on the database rooted at that router, and populate the node forwarding
-// tables.
-//
-// This function parallels RFC2328, Section 16.1.1, and quagga ospfd
-//
-// This calculation yields the set of intra-area routes associated
-// with an area (called hereafter Area A).  A router calculates the
-// shortest-path tree using itself as the root.  The formation
-// of the shortest path tree is done here in two stages.  In the
-// first stage, only links between routers and transit networks are
-// considered.  Using the Dijkstra algorithm, a tree is formed from
-// this subset of the link state database.  In the second stage,
-// leaves are added to the tree by considering the links to stub
-// networks.
-//
-// The area's link state database is represented as a directed graph.
-// The graph's vertices are routers, transit networks and stub networks.
-//
-// The first stage of the procedure (i.e., the Dijkstra algorithm)
-// can now be summarized as follows. At each iteration of the
-// algorithm, there is a list of candidate vertices.  Paths from
-// the root to these vertices have been found, but not necessarily
-// the shortest ones.  However, the paths to the candidate vertex
-// that is closest to the root are guaranteed to be shortest; this
-// vertex is added to the shortest-path tree, removed from the
-// candidate list, and its adjacent vertices are examined for
-// possible addition to/modification of the candidate list.  The
-// algorithm then iterates again.  It terminates when the candidate
-// list becomes empty. 
-//
 void
-DSRRouteManagerImpl::InitializeRoutes ()
+DSRRouteManagerImpl::ApplyStagedRoutes (const std::vector<Ptr<Ipv4DSRRouting> >& tables,
+                                        StagedRoutes_t& staged,
+                                        const std::vector<uint8_t>* nodes)
 {
-  NS_LOG_FUNCTION (this);
-//
-// Walk the list of nodes in the system.
-//
-  NS_LOG_INFO ("About to start SPF calculation");
-  NodeList::Iterator listEnd = NodeList::End ();
-  for (NodeList::Iterator i = NodeList::Begin (); i != listEnd; i++)
+  NS_LOG_FUNCTION (this << tables.size ());
+  m_stats.m_churnPerNode.resize (tables.size (), 0);
+  std::vector<Ipv4DSRRoutingTableEntry> routes[Ipv4DSRRouting::N_ROUTE_TABLES];
+  for (uint32_t n = 0; n < tables.size (); n++)
     {
-      Ptr<Node> node = *i;
-      //
-      // Look for the DSRRouter interface that indicates that the node is
-      // participating in routing.
-      //
-      Ptr<DSRRouter> rtr = 
-        node->GetObject<DSRRouter> ();
-
-      uint32_t systemId = Simulator::GetSystemId ();
-      // Ignore nodes that are not assigned to our systemId (distributed sim)
-      if (node->GetSystemId () != systemId) 
+      Ptr<Ipv4DSRRouting> gr = tables[n];
+      if (gr == 0 || (nodes && !(*nodes)[n]))
         {
           continue;
         }
-
-      //
-      // if the node has a DSR router interface, then run the DSR routing
-      // algorithms.
-      //
-        DSRVertex *v;
-        DSRRoutingLSA* w_lsa = 0;
-        DSRRoutingLinkRecord *l = 0;
-        uint32_t numRecordsInVertex = 0;
-        v = new DSRVertex (m_lsdb->GetLSA(rtr->GetRouterId ()));
-        //
-        // V points to a Router-LSA or Network-LSA
-        // Loop over the links in router LSA or attached routers in Network LSA
-        //
-        if (v->GetVertexType () == DSRVertex::VertexRouter)
-          {
-            numRecordsInVertex = v->GetLSA ()->GetNLinkRecords (); 
-          }
-        if (v->GetVertexType () == DSRVertex::VertexNetwork)
-          {
-            numRecordsInVertex = v->GetLSA ()->GetNAttachedRouters (); 
-          }
-        for (uint32_t i = 0; i < numRecordsInVertex; i++)
-          {
-            // std::cout << "i = " << i << std::endl;
-            if (v->GetVertexType () == DSRVertex::VertexRouter) 
-              {
-                NS_LOG_LOGIC ("Examining link " << i << " of " << 
-                      v->GetVertexId () << "'s " <<
-                      v->GetLSA ()->GetNLinkRecords () << " link records");
-              //
-              // (a) If this is a link to a stub network, examine the next link in V's LSA.
-              // Links to stub networks will be considered in the second stage of the
-              // shortest path calculation.
-              //
-                l = v->GetLSA ()->GetLinkRecord (i);
-                NS_ASSERT (l != 0);
-              if (l->GetLinkType () == DSRRoutingLinkRecord::StubNetwork)
-                {
-                  NS_LOG_LOGIC ("Found a Stub record to " << l->GetLinkId ());
-                  continue;
-                }
-              //
-              // (b) Otherwise, W is a transit vertex (router or transit network).  Look up
-              // the vertex W's LSA (router-LSA or network-LSA) in Area A's link state
-              // database. 
-              //
-              if (l->GetLinkType () == DSRRoutingLinkRecord::PointToPoint)
-                {
-                  //
-                  // Lookup the link state advertisement of the new link -- we call it <w> in
-                  // the link state database.
-                  //
-                  w_lsa = m_lsdb->GetLSA (l->GetLinkId ());
-                  NS_ASSERT (w_lsa);
-                  NS_LOG_LOGIC ("Found a P2P record from " << 
-                                v->GetVertexId () << " to " << w_lsa->GetLinkStateId ());
-                  Ptr<DSRRouter> router = node->GetObject<DSRRouter> ();
-                  if (router == 0)
-                    {
-                      continue;
-                    }
-                  Ptr<Ipv4DSRRouting> gr = router->GetRoutingProtocol ();
-                  NS_ASSERT (gr);
-                  DSRRoutingLinkRecord *linkRemote =0;
-                  DSRVertex* w = new DSRVertex (w_lsa);
-                  linkRemote = SPFGetNextLink (w, v, linkRemote);
-                  Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
-                  int32_t Iface = ipv4->GetInterfaceForAddress (l->GetLinkData ());
-                  // std::cout << "The interface = " << Iface << std::endl;
-                  // gr->AddHostRouteTo (linkRemote->GetLinkData (), linkRemote->GetLinkData (), Iface, l->GetMetric ());
-
-                  // todo
-                  for (NodeList::Iterator j = NodeList::Begin (); j != listEnd; j++)
-                    {
-                      Ptr<Node> nextNode = *j;
-                      Ptr<Ipv4> nextIpv4 = nextNode->GetObject<Ipv4> ();
-                      for (uint32_t iter =0; iter < nextIpv4->GetNInterfaces (); iter ++)
-                        {
-                          Ipv4InterfaceAddress ifc = nextIpv4->GetAddress (iter,0);
-                          Ipv4Address addr = ifc.GetLocal ();
-                          if (addr == linkRemote->GetLinkData ())
-                            {
-                              std::cout << "true" << std::endl;
-                              for (uint32_t nIfc = 1; nIfc < nextIpv4->GetNInterfaces (); nIfc ++)
-                                {
-                                  gr->AddHostRouteTo (nextIpv4->GetAddress (nIfc,0).GetLocal (), linkRemote->GetLinkData (), Iface, l->GetMetric ());
-                                }
-                            }
-                        }
-                    }   
-
-
-                  SPFCalculate (w_lsa->GetLinkStateId (), rtr->GetRouterId (), linkRemote, Iface);
-                }
-                else if (l->GetLinkType () == 
-                          DSRRoutingLinkRecord::TransitNetwork)
-                  {
-                    w_lsa = m_lsdb->GetLSA (l->GetLinkId ());
-                    NS_ASSERT (w_lsa);
-                    NS_LOG_LOGIC ("Found a Transit record from " << 
-                                  v->GetVertexId () << " to " << w_lsa->GetLinkStateId ());
-                    SPFCalculate (w_lsa->GetLinkStateId (), rtr->GetRouterId (), l, i+1);
-                  }
-                else 
-                  {
-                    NS_ASSERT_MSG (0, "illegal Link Type");
-                  }
-                }
-          }
+//
+// Build the routes exactly as the Add*RouteTo () methods of the routing
+// protocol would, so that the table ends up as if it had been emptied and
+// refilled.
+//
+      const std::vector<DSRRouteRecord>& records = staged[n];
+      for (std::vector<DSRRouteRecord>::const_iterator i = records.begin (); i != records.end (); i++)
+        {
+          Ipv4Address dest (i->m_dest);
+          Ipv4Address nextHop (i->m_nextHop);
+          switch (i->m_type)
+            {
+            case DSRRouteRecord::HostRoute:
+              routes[Ipv4DSRRouting::HOST_ROUTES].push_back (
+                Ipv4DSRRoutingTableEntry::CreateHostRouteTo (dest, nextHop, i->m_interface, i->m_distance,
+                                                             i->m_roundTrip));
+              break;
+            case DSRRouteRecord::NodeRoute:
+              routes[Ipv4DSRRouting::NODE_ROUTES].push_back (
+                Ipv4DSRRoutingTableEntry::CreateHostRouteTo (dest, nextHop, i->m_interface, i->m_distance,
+                                                             i->m_roundTrip));
+              break;
+            case DSRRouteRecord::NetworkRoute:
+              routes[Ipv4DSRRouting::NETWORK_ROUTES].push_back (
+                Ipv4DSRRoutingTableEntry::CreateNetworkRouteTo (dest, Ipv4Mask (i->m_mask), nextHop, i->m_interface));
+              break;
+            case DSRRouteRecord::ASExternalRoute:
+              routes[Ipv4DSRRouting::AS_EXTERNAL_ROUTES].push_back (
+                Ipv4DSRRoutingTableEntry::CreateNetworkRouteTo (dest, Ipv4Mask (i->m_mask), nextHop, i->m_interface));
+              break;
+            case DSRRouteRecord::BestEffortHostRoute:
+              routes[Ipv4DSRRouting::BEST_EFFORT_HOST_ROUTES].push_back (
+                Ipv4DSRRoutingTableEntry::CreateHostRouteTo (dest, nextHop, i->m_interface, i->m_distance));
+              break;
+            case DSRRouteRecord::BestEffortNetworkRoute:
+              routes[Ipv4DSRRouting::BEST_EFFORT_NETWORK_ROUTES].push_back (
+                Ipv4DSRRoutingTableEntry::CreateNetworkRouteTo (dest, Ipv4Mask (i->m_mask), nextHop, i->m_interface));
+              break;
+            case DSRRouteRecord::SummaryRoute:
+              routes[Ipv4DSRRouting::NETWORK_ROUTES].push_back (
+                Ipv4DSRRoutingTableEntry::CreateNetworkRouteTo (dest, Ipv4Mask (i->m_mask), nextHop,
+                                                                i->m_interface, i->m_distance));
+              break;
+            }
+        }
+      std::vector<DSRRouteRecord> ().swap (staged[n]);
+      uint32_t churn = 0;
+      for (uint32_t t = 0; t < Ipv4DSRRouting::N_ROUTE_TABLES; t++)
+        {
+          Ipv4DSRRouting::RouteChurn c = gr->ApplyRoutes (static_cast<Ipv4DSRRouting::RouteTable> (t), routes[t]);
+          m_stats.m_routesAdded += c.m_added;
+          m_stats.m_routesRemoved += c.m_removed;
+          m_stats.m_routesUpdated += c.m_updated;
+          churn += c.m_added + c.m_removed + c.m_updated;
+          routes[t].clear ();
+        }
+      m_stats.m_churnPerNode[n] += churn;
     }
-  NS_LOG_INFO ("Finished DSR-SPF calculation");
 }
 
 //
@@ -899,268 +3447,162 @@ DSRRouteManagerImpl::InitializeRoutes ()
 // 16.1 (2) for further details.
 //
 // We're passed a parameter <v> that is a vertex which is already in the SPF
-// tree.  A vertex represents a router node.  We also get a reference to the
-// SPF candidate queue, which is a priority queue containing the shortest paths
-// to the networks we know about.
+// tree.  A vertex represents a router node or a transit network.  The SPF
+// candidate queue of the workspace is a priority queue containing the
+// shortest paths to the networks we know about.
 //
-// We examine the links in v's LSA and update the list of candidates with any
+// We examine the edges of <v> and update the list of candidates with any
 // vertices not already on the list.  If a lower-cost path is found to a
 // vertex already on the candidate list, store the new (lower) cost.
 //
 void
-DSRRouteManagerImpl::SPFNext (DSRVertex* v, DsrCandidateQueue& candidate)
+DSRRouteManagerImpl::SPFNext (DSRSPFWorkspace& ws, uint32_t v) const
 {
-  NS_LOG_FUNCTION (this << v << &candidate);
-
-  DSRVertex* w = 0;
-  DSRRoutingLSA* w_lsa = 0;
-  DSRRoutingLinkRecord *l = 0;
-  uint32_t distance = 0;
-  uint32_t numRecordsInVertex = 0;
-//
-// V points to a Router-LSA or Network-LSA
-// Loop over the links in router LSA or attached routers in Network LSA
-//
-  if (v->GetVertexType () == DSRVertex::VertexRouter)
-    {
-      numRecordsInVertex = v->GetLSA ()->GetNLinkRecords (); 
-    }
-  if (v->GetVertexType () == DSRVertex::VertexNetwork)
-    {
-      numRecordsInVertex = v->GetLSA ()->GetNAttachedRouters (); 
-    }
+  NS_LOG_FUNCTION (this << v);
 
-  for (uint32_t i = 0; i < numRecordsInVertex; i++)
-    {
-// Get w_lsa:  In case of V is Router-LSA
-      if (v->GetVertexType () == DSRVertex::VertexRouter) 
-        {
-          NS_LOG_LOGIC ("Examining link " << i << " of " << 
-                        v->GetVertexId () << "'s " <<
-                        v->GetLSA ()->GetNLinkRecords () << " link records");
+  const DSRGraphSnapshot& g = m_graph;
+  bool vIsRouter = g.m_vertexType[v] == DSRGraphSnapshot::VertexRouter;
 //
-// (a) If this is a link to a stub network, examine the next link in V's LSA.
-// Links to stub networks will be considered in the second stage of the
+// The edges of <v> are the point-to-point and transit network records of a
+// router-LSA, or the attached routers of a network-LSA.  Links to stub
+// networks are not edges; they are considered in the second stage of the
 // shortest path calculation.
 //
-          l = v->GetLSA ()->GetLinkRecord (i);
-          NS_ASSERT (l != 0);
-          if (l->GetLinkType () == DSRRoutingLinkRecord::StubNetwork)
-            {
-              NS_LOG_LOGIC ("Found a Stub record to " << l->GetLinkId ());
-              continue;
-            }
-//
-// (b) Otherwise, W is a transit vertex (router or transit network).  Look up
-// the vertex W's LSA (router-LSA or network-LSA) in Area A's link state
-// database. 
-//
-          if (l->GetLinkType () == DSRRoutingLinkRecord::PointToPoint)
-            {
+  for (uint32_t e = g.m_rowStart[v]; e < g.m_rowStart[v + 1]; e++)
+    {
 //
-// Lookup the link state advertisement of the new link -- we call it <w> in
-// the link state database.
+// (b) W is a transit vertex (router or transit network), the far end of the
+// edge.
 //
-              w_lsa = m_lsdb->GetLSA (l->GetLinkId ());
-              NS_ASSERT (w_lsa);
-              NS_LOG_LOGIC ("Found a P2P record from " << 
-                            v->GetVertexId () << " to " << w_lsa->GetLinkStateId ());
-            }
-          else if (l->GetLinkType () == 
-                   DSRRoutingLinkRecord::TransitNetwork)
-            {
-              w_lsa = m_lsdb->GetLSA (l->GetLinkId ());
-              NS_ASSERT (w_lsa);
-              NS_LOG_LOGIC ("Found a Transit record from " << 
-                            v->GetVertexId () << " to " << w_lsa->GetLinkStateId ());
-            }
-          else 
-            {
-              NS_ASSERT_MSG (0, "illegal Link Type");
-            }
-        }
-// Get w_lsa:  In case of V is Network-LSA
-      if (v->GetVertexType () == DSRVertex::VertexNetwork) 
+      int32_t w = g.m_target[e];
+      if (w < 0)
         {
-          w_lsa = m_lsdb->GetLSAByLinkData 
-              (v->GetLSA ()->GetAttachedRouter (i));
-          if (!w_lsa)
-            {
-              continue;
-            }
-          NS_LOG_LOGIC ("Found a Network LSA from " << 
-                        v->GetVertexId () << " to " << w_lsa->GetLinkStateId ());
+          NS_ASSERT_MSG (!vIsRouter, "link record to an LSA missing from the LSDB");
+          continue;
         }
-
-// Note:  w_lsa at this point may be either RouterLSA or NetworkLSA
 //
 // (c) If vertex W is already on the shortest-path tree, examine the next
-// link in the LSA.
-//
-// If the link is to a router that is already in the shortest path first tree
-// then we have it covered -- ignore it.
+// edge.
 //
-      if (w_lsa->GetStatus () == DSRRoutingLSA::LSA_SPF_IN_SPFTREE) 
+      if (ws.GetStatus (w) == DSRRoutingLSA::LSA_SPF_IN_SPFTREE) 
         {
-          NS_LOG_LOGIC ("Skipping ->  LSA "<< 
-                        w_lsa->GetLinkStateId () << " already in SPF tree");
+          NS_LOG_LOGIC ("Skipping -> " << Ipv4Address (g.m_vertexId[w]) << " already in SPF tree");
           continue;
         }
 //
 // (d) Calculate the link state cost D of the resulting path from the root to 
 // vertex W.  D is equal to the sum of the link state cost of the (already 
 // calculated) shortest path to vertex V and the advertised cost of the link
-// between vertices V and W.
+// between vertices V and W.  Edges out of a network vertex cost nothing.
 //
-      if (v->GetLSA ()->GetLSType () == DSRRoutingLSA::RouterLSA)
-        {
-          NS_ASSERT (l != 0);
-          distance = v->GetDistanceFromRoot () + l->GetMetric ();
-        }
-      else
-        {
-          distance = v->GetDistanceFromRoot ();
-        }
+      uint32_t distance = ws.m_distance[v] + g.m_weight[e];
+      bool wIsNetwork = g.m_vertexType[w] == DSRGraphSnapshot::VertexNetwork;
 
-      NS_LOG_LOGIC ("Considering w_lsa " << w_lsa->GetLinkStateId ());
+      NS_LOG_LOGIC ("Considering " << Ipv4Address (g.m_vertexId[w]));
 
 // Is there already vertex w in candidate list?
-      if (w_lsa->GetStatus () == DSRRoutingLSA::LSA_SPF_NOT_EXPLORED)
+      if (ws.GetStatus (w) == DSRRoutingLSA::LSA_SPF_NOT_EXPLORED)
         {
+// The first status change of a vertex in this run also wipes whatever a
+// previous run left in its per-vertex state, so it comes first.
+          ws.SetStatus (w, DSRRoutingLSA::LSA_SPF_CANDIDATE);
 // Calculate nexthop to w
 // We need to figure out how to actually get to the new router represented
 // by <w>.  This will (among other things) find the next hop address to send
 // packets destined for this network to, and also find the outbound interface
 // used to forward the packets.
-
-// prepare vertex w
-          w = new DSRVertex (w_lsa);
-          if (SPFNexthopCalculation (v, w, l, distance))
-            {
-              w_lsa->SetStatus (DSRRoutingLSA::LSA_SPF_CANDIDATE);
+          SPFNexthopCalculation (ws, v, w, e, ws.m_exits[w]);
+          ws.m_distance[w] = distance;
+          ws.m_parents[w].Assign (v);
 //
 // Push this new vertex onto the priority queue (ordered by distance from the
 // root node).
 //
-              candidate.Push (w);
-              NS_LOG_LOGIC ("Pushing " << 
-                            w->GetVertexId () << ", parent vertexId: " <<
-                            v->GetVertexId () << ", distance: " <<
-                            w->GetDistanceFromRoot ());
-            }
-          else
-            NS_ASSERT_MSG (0, "SPFNexthopCalculation never " 
-                           << "return false, but it does now!");
+          ws.PushCandidate (w, distance, wIsNetwork);
+          NS_LOG_LOGIC ("Pushing " << 
+                        Ipv4Address (g.m_vertexId[w]) << ", parent vertexId: " <<
+                        Ipv4Address (g.m_vertexId[v]) << ", distance: " << distance);
         }
-      else if (w_lsa->GetStatus () == DSRRoutingLSA::LSA_SPF_CANDIDATE)
+      else if (ws.GetStatus (w) == DSRRoutingLSA::LSA_SPF_CANDIDATE)
         {
 //
-// We have already considered the link represented by <w>.  What wse have to
-// do now is to decide if this new router represents a route with a shorter
-// distance metric.
+// We have already considered the vertex <w>.  What we have to do now is to
+// decide if this new path represents a route with a shorter distance metric.
 //
-// So, locate the vertex in the candidate queue and take a look at the 
-// distance.
-
 /* (quagga-0.98.6) W is already on the candidate list; call it cw.
 * Compare the previously calculated cost (cw->distance)
 * with the cost we just determined (w->distance) to see
 * if we've found a shorter path.
 */
-          DSRVertex* cw;
-          cw = candidate.Find (w_lsa->GetLinkStateId ());
-          if (cw->GetDistanceFromRoot () < distance)
+          if (ws.m_distance[w] < distance)
             {
 //
 // This is not a shorter path, so don't do anything.
 //
               continue;
             }
-          else if (cw->GetDistanceFromRoot () == distance)
+          else if (ws.m_distance[w] == distance)
             {
 //
 // This path is one with an equal cost.
 //
               NS_LOG_LOGIC ("Equal cost multiple paths found.");
-
-// At this point, there are two instances 'w' and 'cw' of the
-// same vertex, the vertex that is currently being considered
-// for adding into the shortest path tree. 'w' is the instance
-// as seen from the root via vertex 'v', and 'cw' is the instance 
-// as seen from the root via some other vertices other than 'v'.
-// These two instances are being merged in the following code.
-// In particular, the parent nodes, the next hops, and the root's
-// output interfaces of the two instances are being merged.
-// 
-// Note that this is functionally equivalent to calling
-// ospf_nexthop_merge (cw->nexthop, w->nexthop) in quagga-0.98.6
-// (ospf_spf.c::859), although the detail implementation
-// is very different from quagga (blame ns3::DSRRouteManagerImpl)
-
-// prepare vertex w
-              w = new DSRVertex (w_lsa);
-              SPFNexthopCalculation (v, w, l, distance);
-              cw->MergeRootExitDirections (w);
-              cw->MergeParent (w);
-// DSRVertexAddParent (w) is necessary as the destructor of 
-// DSRVertex checks if the vertex and its parent is linked
-// bidirectionally
-              DSRVertexAddParent (w);
-              delete w;
+//
+// Merge the next hops and parents of the path through <v> into those
+// already known for <w>: functionally ospf_nexthop_merge (cw->nexthop,
+// w->nexthop) in quagga-0.98.6 (ospf_spf.c::859).
+//
+              SPFNexthopCalculation (ws, v, w, e, ws.m_mergeExits);
+              DSRSPFWorkspace::ExitList_t& exits = ws.m_exits[w];
+              for (uint32_t k = 0; k < ws.m_mergeExits.Size (); k++)
+                {
+                  exits.PushBack (ws.m_mergeExits[k], ws.m_arena);
+                }
+              std::sort (exits.Begin (), exits.End ());
+              exits.Truncate (std::unique (exits.Begin (), exits.End ()) - exits.Begin ());
+              DSRSPFWorkspace::VertexList_t& parents = ws.m_parents[w];
+              if (std::find (parents.Begin (), parents.End (), v) == parents.End ())
+                {
+                  parents.PushBack (v, ws.m_arena);
+                }
             }
           else // cw->GetDistanceFromRoot () > w->GetDistanceFromRoot ()
             {
 // 
 // this path represents a new, lower-cost path to <w> (the vertex we found in
-// the current link record of the link state advertisement of the current root
-// (vertex <v>)
-//
-// N.B. the nexthop_calculation is conditional, if it finds a valid nexthop
-// it will call spf_add_parents, which will flush the old parents
-//
-              if (SPFNexthopCalculation (v, cw, l, distance))
-                {
-//
-// If we've changed the cost to get to the vertex represented by <w>, we 
-// must reorder the priority queue keyed to that cost.
+// the current edge of the current vertex <v>).  The next hops and the
+// parent are replaced, and <w> is requeued at its new distance.
 //
-                  candidate.Reorder ();
-                }
+              SPFNexthopCalculation (ws, v, w, e, ws.m_exits[w]);
+              ws.m_distance[w] = distance;
+              ws.m_parents[w].Assign (v);
+              ws.PushCandidate (w, distance, wIsNetwork);
             } // new lower cost path found
         } // end W is already on the candidate list
-    } // end loop over the links in V's LSA
+    } // end loop over the edges of V
 }
 
 //
 // This method is derived from quagga ospf_nexthop_calculation() 16.1.1.
 //
 // Calculate nexthop from root through V (parent) to vertex W (destination)
-// with given distance from root->W.
-//
-// As appropriate, set w's parent, distance, and nexthop information
+// over edge e, and store the root exits of W in <exits>.
 //
 // For now, this is greatly simplified from the quagga code
 //
-int
+void
 DSRRouteManagerImpl::SPFNexthopCalculation (
-  DSRVertex* v, 
-  DSRVertex* w,
-  DSRRoutingLinkRecord* l,
-  uint32_t distance)
+  DSRSPFWorkspace& ws,
+  uint32_t v, 
+  uint32_t w,
+  uint32_t e,
+  DSRSPFWorkspace::ExitList_t& exits) const
 {
-  NS_LOG_FUNCTION (this << v << w << l << distance);
-//
-// If w is a NetworkVertex, l should be null
-/*
-  if (w->GetVertexType () == DSRVertex::VertexNetwork && l)
-    {
-        NS_ASSERT_MSG (0, "Error:  SPFNexthopCalculation parameter problem");
-    }
-*/
-
+  NS_LOG_FUNCTION (this << v << w << e);
+  const DSRGraphSnapshot& g = m_graph;
 //
-// The vertex m_spfroot is a distinguished vertex representing the node at
-// the root of the calculations.  That is, it is the node for which we are
+// The vertex ws.m_rootIndex is a distinguished vertex representing the node
+// at the root of the calculations.  That is, it is the node for which we are
 // calculating the routes.
 //
 // There are two distinct cases for calculating the next hop information.
@@ -1178,117 +3620,74 @@ DSRRouteManagerImpl::SPFNexthopCalculation (
 // We call the propagation of next hop information down vertices of a path
 // "inheriting" the next hop information.
 //
-// The point-to-point link information is only useful in this calculation when
-// we are examining the root node. 
-//
-  if (v == m_spfroot)
-    {
-//
-// In this case <v> is the root node, which means it is the starting point
-// for the packets forwarded by that node.  This also means that the next hop
-// address of packets headed for some arbitrary off-network destination must
-// be the destination at the other end of one of the links off of the root
-// node if this root node is a router.  We then need to see if this node <w>
-// is a router.
-//
-      if (w->GetVertexType () == DSRVertex::VertexRouter) 
-        {
-//
-// In the case of point-to-point links, the link data field (m_linkData) of a
-// Global Router Link Record contains the local IP address.  If we look at the
-// link record describing the link from the perspecive of <w> (the remote
-// node from the viewpoint of <v>) back to the root node, we can discover the
-// IP address of the router to which <v> is adjacent.  This is a distinguished
-// address -- the next hop address to get from <v> to <w> and all networks 
-// accessed through that path.
-//
-// SPFGetNextLink () is a little odd.  used in this way it is just going to
-// return the link record describing the link from <w> to <v>.  Think of it as
-// SPFGetLink.
-//
-          NS_ASSERT (l);
-          DSRRoutingLinkRecord *linkRemote = 0;
-          linkRemote = SPFGetNextLink (w, v, linkRemote);
-// 
-// At this point, <l> is the Global Router Link Record describing the point-
-// to point link from <v> to <w> from the perspective of <v>; and <linkRemote>
-// is the Global Router Link Record describing that same link from the 
-// perspective of <w> (back to <v>).  Now we can just copy the next hop 
-// address from the m_linkData member variable.
-// 
-// The next hop member variable we put in <w> has the sense "in order to get
-// from the root node to the host represented by vertex <w>, you have to send
-// the packet to the next hop address specified in w->m_nextHop.
-//
-          Ipv4Address nextHop = linkRemote->GetLinkData ();
-// 
-// Now find the outgoing interface corresponding to the point to point link
-// from the perspective of <v> -- remember that <l> is the link "from"
-// <v> "to" <w>.
+// The point-to-point link information is only useful in this calculation when
+// we are examining the root node. 
 //
-          uint32_t outIf = FindOutgoingInterfaceId (l->GetLinkData ());
-
-          w->SetRootExitDirection (nextHop, outIf);
-          w->SetDistanceFromRoot (distance);
-          w->SetParent (v);
+  if (v == ws.m_rootIndex)
+    {
+      if (g.m_vertexType[w] == DSRGraphSnapshot::VertexRouter) 
+        {
+//
+// In the case of point-to-point links, the link data of a record contains
+// the local IP address.  The reverse of edge <e> is the record describing
+// the link from the perspective of <w> back to the root node; its link data
+// is the address of the router to which the root is adjacent -- the next hop
+// address to get from the root to <w> and all networks accessed through that
+// path.  The outgoing interface is the one the root's own record leaves
+// through.
+//
+          int32_t linkRemote = g.m_reverse[e];
+          NS_ASSERT (linkRemote >= 0);
+          exits.Assign (DSRGraphSnapshot::Exit_t (g.m_linkData[linkRemote], g.m_outIf[e]));
           NS_LOG_LOGIC ("Next hop from " << 
-                        v->GetVertexId () << " to " << w->GetVertexId () <<
-                        " goes through next hop " << nextHop <<
-                        " via outgoing interface " << outIf <<
-                        " with distance " << distance);
+                        Ipv4Address (g.m_vertexId[v]) << " to " << Ipv4Address (g.m_vertexId[w]) <<
+                        " goes through next hop " << Ipv4Address (g.m_linkData[linkRemote]) <<
+                        " via outgoing interface " << g.m_outIf[e]);
         }  // end W is a router vertes
       else 
         {
-          NS_ASSERT (w->GetVertexType () == DSRVertex::VertexNetwork);
-// W is a directly connected network; no next hop is required
-          DSRRoutingLSA* w_lsa = w->GetLSA ();
-          NS_ASSERT (w_lsa->GetLSType () == DSRRoutingLSA::NetworkLSA);
-// Find outgoing interface ID for this network
-          uint32_t outIf = FindOutgoingInterfaceId (w_lsa->GetLinkStateId (), 
-                                                    w_lsa->GetNetworkLSANetworkMask () );
-// Set the next hop to 0.0.0.0 meaning "not exist"
-          Ipv4Address nextHop = Ipv4Address::GetZero ();
-          w->SetRootExitDirection (nextHop, outIf);
-          w->SetDistanceFromRoot (distance);
-          w->SetParent (v);
+          NS_ASSERT (g.m_vertexType[w] == DSRGraphSnapshot::VertexNetwork);
+// W is a directly connected network; no next hop is required.  Set the next
+// hop to 0.0.0.0 meaning "not exist"
+          exits.Assign (DSRGraphSnapshot::Exit_t (0, g.m_outIf[e]));
           NS_LOG_LOGIC ("Next hop from " << 
-                        v->GetVertexId () << " to network " << w->GetVertexId () <<
-                        " via outgoing interface " << outIf <<
-                        " with distance " << distance);
-          return 1;
+                        Ipv4Address (g.m_vertexId[v]) << " to network " << Ipv4Address (g.m_vertexId[w]) <<
+                        " via outgoing interface " << g.m_outIf[e]);
         }
     } // end v is the root
-  else if (v->GetVertexType () == DSRVertex::VertexNetwork) 
+  else if (g.m_vertexType[v] == DSRGraphSnapshot::VertexNetwork) 
     {
 // See if any of v's parents are the root
-      if (v->GetParent () == m_spfroot)
+      const DSRSPFWorkspace::VertexList_t& parents = ws.m_parents[v];
+      if (std::find (parents.Begin (), parents.End (), ws.m_rootIndex) != parents.End ())
         {
 // 16.1.1 para 5. ...the parent vertex is a network that
 // directly connects the calculating router to the destination
 // router.  The list of next hops is then determined by
 // examining the destination's router-LSA...
-          NS_ASSERT (w->GetVertexType () == DSRVertex::VertexRouter);
-          DSRRoutingLinkRecord *linkRemote = 0;
-          while ((linkRemote = SPFGetNextLink (w, v, linkRemote)))
-            {
+          NS_ASSERT (g.m_vertexType[w] == DSRGraphSnapshot::VertexRouter);
 /* ...For each link in the router-LSA that points back to the
  * parent network, the link's Link Data field provides the IP
  * address of a next hop router.  The outgoing interface to
  * use can then be derived from the next hop IP address (or 
  * it can be inherited from the parent network).
  */
-              Ipv4Address nextHop = linkRemote->GetLinkData ();
-              uint32_t outIf = v->GetRootExitDirection ().second;
-              w->SetRootExitDirection (nextHop, outIf);
+          exits.Clear ();
+          int32_t linkRemote = g.m_reverse[e];
+          if (linkRemote >= 0)
+            {
+              NS_ASSERT (ws.m_exits[v].Size () == 1);
+              exits.Assign (DSRGraphSnapshot::Exit_t (g.m_linkData[linkRemote], ws.m_exits[v][0].second));
               NS_LOG_LOGIC ("Next hop from " <<
-                            v->GetVertexId () << " to " << w->GetVertexId () <<
-                            " goes through next hop " << nextHop <<
-                            " via outgoing interface " << outIf);
+                            Ipv4Address (g.m_vertexId[v]) << " to " << Ipv4Address (g.m_vertexId[w]) <<
+                            " goes through next hop " << Ipv4Address (g.m_linkData[linkRemote]) <<
+                            " via outgoing interface " << ws.m_exits[v][0].second);
             }
         }
       else 
         {
-          w->SetRootExitDirection (v->GetRootExitDirection ());
+          NS_ASSERT (ws.m_exits[v].Size () == 1);
+          exits.Assign (ws.m_exits[v][0]);
         }
     }
   else 
@@ -1300,108 +3699,8 @@ DSRRouteManagerImpl::SPFNexthopCalculation (
 // still send packets to the next hop address of the router adjacent to the
 // root on the path toward <w>.
 //
-// Above, when we were considering the root node, we calculated the next hop
-// address and outgoing interface required to get off of the root network.
-// At this point, we are further away from the root network along one of the
-// (shortest) paths.  So the next hop and outoing interface remain the same
-// (are inherited).
-//
-      w->InheritAllRootExitDirections (v);
-    }
-//
-// In all cases, we need valid values for the distance metric and a parent.
-//
-  w->SetDistanceFromRoot (distance);
-  w->SetParent (v);
-
-  return 1;
-}
-
-//
-// This method is derived from quagga ospf_get_next_link ()
-//
-// First search the Global Router Link Records of vertex <v> for one
-// representing a point-to point link to vertex <w>.
-//
-// What is done depends on prev_link.  Contrary to appearances, prev_link just
-// acts as a flag here.  If prev_link is NULL, we return the first Global
-// Router Link Record we find that describes a point-to-point link from <v> 
-// to <w>.  If prev_link is not NULL, we return a Global Router Link Record
-// representing a possible *second* link from <v> to <w>.
-//
-DSRRoutingLinkRecord*
-DSRRouteManagerImpl::SPFGetNextLink (
-  DSRVertex* v,
-  DSRVertex* w,
-  DSRRoutingLinkRecord* prev_link) 
-{
-  NS_LOG_FUNCTION (this << v << w << prev_link);
-
-  bool skip = true;
-  bool found_prev_link = false;
-  DSRRoutingLinkRecord* l;
-//
-// If prev_link is 0, we are really looking for the first link, not the next 
-// link.
-//
-  if (prev_link == 0)
-    {
-      skip = false;
-      found_prev_link = true;
-    }
-//
-// Iterate through the Global Router Link Records advertised by the vertex
-// <v> looking for records representing the point-to-point links off of this
-// vertex.
-//
-  for (uint32_t i = 0; i < v->GetLSA ()->GetNLinkRecords (); ++i)
-    {
-      l = v->GetLSA ()->GetLinkRecord (i);
-//
-// The link ID of a link record representing a point-to-point link is set to
-// the router ID of the neighboring router -- the router to which the link
-// connects from the perspective of <v> in this case.  The vertex ID is also
-// set to the router ID (using the link state advertisement of a router node).
-// We're just checking to see if the link <l> is actually the link from <v> to
-// <w>.
-//
-      if (l->GetLinkId () == w->GetVertexId ()) 
-        {
-          if (!found_prev_link)
-            {
-              NS_LOG_LOGIC ("Skipping links before prev_link found");
-              found_prev_link = true;
-              continue;
-            }
-
-          NS_LOG_LOGIC ("Found matching link l:  linkId = " <<
-                        l->GetLinkId () << " linkData = " << l->GetLinkData ());
-//
-// If skip is false, don't (not too surprisingly) skip the link found -- it's 
-// the one we're interested in.  That's either because we didn't pass in a 
-// previous link, and we're interested in the first one, or because we've 
-// skipped a previous link and moved forward to the next (which is then the
-// one we want).
-//
-          if (skip == false)
-            {
-              NS_LOG_LOGIC ("Returning the found link");
-              return l;
-            }
-          else
-            {
-//
-// Skip is true and we've found a link from <v> to <w>.  We want the next one.
-// Setting skip to false gets us the next point-to-point global router link
-// record in the LSA from <v>.
-//
-              NS_LOG_LOGIC ("Skipping the found link");
-              skip = false;
-              continue;
-            }
-        }
+      exits.Assign (ws.m_exits[v], ws.m_arena);
     }
-  return 0;
 }
 
 //
@@ -1414,6 +3713,24 @@ DSRRouteManagerImpl::DebugSPFCalculate (Ipv4Address root)
   // SPFCalculate (root, 1, 1);
 }
 
+void
+DSRRouteManagerImpl::DebugKShortestPaths (Ipv4Address source, Ipv4Address target, uint32_t k,
+                                          std::vector<DSRPath>& paths) const
+{
+  NS_LOG_FUNCTION (this << source << target << k);
+  const DSRGraphSnapshot& g = m_graph;
+  paths.clear ();
+  std::vector<uint32_t>::const_iterator s = std::find (g.m_vertexId.begin (), g.m_vertexId.end (), source.Get ());
+  std::vector<uint32_t>::const_iterator t = std::find (g.m_vertexId.begin (), g.m_vertexId.end (), target.Get ());
+  if (s == g.m_vertexId.end () || t == g.m_vertexId.end ())
+    {
+      return;
+    }
+  DSRKspWorkspace ws;
+  ws.Reset (g.GetNVertices (), g.GetNEdges ());
+  KShortestPaths (ws, s - g.m_vertexId.begin (), t - g.m_vertexId.begin (), k, DISTINFINITY, paths);
+}
+
 //
 // Used to test if a node is a stub, from an OSPF sense.
 // If there is only one link of type 1 or 2, then a default route
@@ -1421,25 +3738,20 @@ DSRRouteManagerImpl::DebugSPFCalculate (Ipv4Address root)
 // to be run
 //
 bool
-DSRRouteManagerImpl::CheckForStubNode (Ipv4Address root)
+DSRRouteManagerImpl::CheckForStubNode (DSRSPFWorkspace& ws) const
 {
+  const DSRGraphSnapshot& g = m_graph;
+  uint32_t root = ws.m_rootIndex;
   NS_LOG_FUNCTION (this << root);
-  DSRRoutingLSA *rlsa = m_lsdb->GetLSA (root);
-  Ipv4Address myRouterId = rlsa->GetLinkStateId ();
   int transits = 0;
-  DSRRoutingLinkRecord *transitLink = 0;
-  for (uint32_t i = 0; i < rlsa->GetNLinkRecords (); i++)
+  uint32_t transitLink = 0;
+  for (uint32_t e = g.m_rowStart[root]; e < g.m_rowStart[root + 1]; e++)
     {
-      DSRRoutingLinkRecord *l = rlsa->GetLinkRecord (i);
-      if (l->GetLinkType () == DSRRoutingLinkRecord::TransitNetwork)
-        {
-          transits++;
-          transitLink = l;
-        }
-      else if (l->GetLinkType () == DSRRoutingLinkRecord::PointToPoint)
+      if (g.m_linkType[e] == DSRRoutingLinkRecord::TransitNetwork ||
+          g.m_linkType[e] == DSRRoutingLinkRecord::PointToPoint)
         {
           transits++;
-          transitLink = l;
+          transitLink = e;
         }
     }
   if (transits == 0)
@@ -1447,12 +3759,12 @@ DSRRouteManagerImpl::CheckForStubNode (Ipv4Address root)
       // This router is not connected to any router.  Probably, global
       // routing should not be called for this node, but we can just raise
       // a warning here and return true.
-      NS_LOG_WARN ("all nodes should have at least one transit link:" << root );
+      NS_LOG_WARN ("all nodes should have at least one transit link:" << Ipv4Address (g.m_vertexId[root]));
       return true;
     }
   if (transits == 1)
     {
-      if (transitLink->GetLinkType () == DSRRoutingLinkRecord::TransitNetwork)
+      if (g.m_linkType[transitLink] == DSRRoutingLinkRecord::TransitNetwork)
         {
           // Install default route to next hop router
           // What is the next hop?  We need to check all neighbors on the link.
@@ -1463,38 +3775,28 @@ DSRRouteManagerImpl::CheckForStubNode (Ipv4Address root)
           NS_LOG_LOGIC ("TBD: Would have inserted default for transit");
           return false;
         }
-      else if (transitLink->GetLinkType () == DSRRoutingLinkRecord::PointToPoint)
+      else if (g.m_linkType[transitLink] == DSRRoutingLinkRecord::PointToPoint)
         {
           // Install default route to next hop
-          // The link record LinkID is the router ID of the peer.
-          // The Link Data is the local IP interface address
-          DSRRoutingLSA *w_lsa = m_lsdb->GetLSA (transitLink->GetLinkId ());
-          uint32_t nLinkRecords = w_lsa->GetNLinkRecords ();
-          for (uint32_t j = 0; j < nLinkRecords; ++j)
+          // The reverse edge is the link record of the peer pointing back
+          // at us; its Link Data is the next hop address.
+          int32_t lr = g.m_reverse[transitLink];
+          if (lr >= 0 && g.m_linkType[lr] == DSRRoutingLinkRecord::PointToPoint)
             {
-              //
-              // We are only concerned about point-to-point links
-              //
-              DSRRoutingLinkRecord *lr = w_lsa->GetLinkRecord (j);
-              if (lr->GetLinkType () != DSRRoutingLinkRecord::PointToPoint)
-                {
-                  continue;
-                }
-              // Find the link record that corresponds to our routerId
-              if (lr->GetLinkId () == myRouterId)
-                {
-                  // Next hop is stored in the LinkID field of lr
-                  Ptr<DSRRouter> router = rlsa->GetNode ()->GetObject<DSRRouter> ();
-                  NS_ASSERT (router);
-                  Ptr<Ipv4DSRRouting> gr = router->GetRoutingProtocol ();
-                  NS_ASSERT (gr);
-                  gr->AddNetworkRouteTo (Ipv4Address ("0.0.0.0"), Ipv4Mask ("0.0.0.0"), lr->GetLinkData (), 
-                                         FindOutgoingInterfaceId (transitLink->GetLinkData ()));
-                  NS_LOG_LOGIC ("Inserting default route for node " << myRouterId << " to next hop " << 
-                                lr->GetLinkData () << " via interface " << 
-                                FindOutgoingInterfaceId (transitLink->GetLinkData ()));
-                  return true;
-                }
+              DSRRouteRecord route;
+              route.m_type = DSRRouteRecord::NetworkRoute;
+              route.m_nodeId = g.m_nodeId[root];
+              route.m_dest = 0;
+              route.m_mask = 0;
+              route.m_nextHop = g.m_linkData[lr];
+              route.m_interface = g.m_outIf[transitLink];
+              route.m_distance = 0;
+              route.m_roundTrip = 0;
+              ws.m_routes->push_back (route);
+              NS_LOG_LOGIC ("Inserting default route for node " << Ipv4Address (g.m_vertexId[root]) << 
+                            " to next hop " << Ipv4Address (route.m_nextHop) << 
+                            " via interface " << route.m_interface);
+              return true;
             }
         }
     }
@@ -1503,43 +3805,30 @@ DSRRouteManagerImpl::CheckForStubNode (Ipv4Address root)
 
 // quagga ospf_spf_calculate
 void
-DSRRouteManagerImpl::SPFCalculate (Ipv4Address root, Ipv4Address initroot, DSRRoutingLinkRecord* l, uint32_t Iface)
+DSRRouteManagerImpl::SPFCalculate (DSRSPFWorkspace& ws, SPFJob& job) const
 {
-  NS_LOG_FUNCTION (this << root);
-  // std::cout << "The interface = " << Iface << std::endl;
-  DSRVertex *v;
-//
-// Initialize the Link State Database.
-//
-  m_lsdb->Initialize ();
+  NS_LOG_FUNCTION (this << job.m_rootIndex);
+  const DSRGraphSnapshot& g = m_graph;
 //
-// The candidate queue is a priority queue of DSRVertex objects, with the top
-// of the queue being the closest vertex in terms of distance from the root
-// of the tree.  Initially, this queue is empty.
+// Initialize the per-run state.  The snapshot itself is shared by all the
+// threads and is only read.  The candidate queue of the workspace is a
+// priority queue of vertices, with the top of the queue being the closest
+// vertex in terms of distance from the root of the tree.  Initially, this
+// queue is empty.
 //
-  DsrCandidateQueue candidate;
-  NS_ASSERT (candidate.Size () == 0);
-//
-// Initialize the shortest-path tree to only contain the router doing the 
-// calculation.  Each router (and corresponding network) is a vertex in the
-// shortest path first (SPF) tree.
-//
-  v = new DSRVertex (m_lsdb->GetLSA (root));
-
-/**
- * @brief add the initroot for dsr
- * \author Pu Yang
- */
-  DSRVertex *v_init;
-  v_init = new DSRVertex (m_lsdb->GetLSA (initroot));
+  ws.Reset (g.GetNVertices (), &job.m_routes);
+  ws.ResetRanges (g.GetNRanges ());
 // 
-// This vertex is the root of the SPF tree and it is distance 0 from the root.
-// We also mark this vertex as being in the SPF tree.
+// Initialize the shortest-path tree to only contain the router doing the 
+// calculation.  This vertex is the root of the SPF tree and it is at the
+// distance of the link back to the initial node.  We also mark this vertex
+// as being in the SPF tree.
 //
-  m_spfroot= v;
-  v->SetDistanceFromRoot (l->GetMetric ());
-  v->GetLSA ()->SetStatus (DSRRoutingLSA::LSA_SPF_IN_SPFTREE);
-  NS_LOG_LOGIC ("Starting SPFCalculate for node " << root);
+  uint32_t v = job.m_rootIndex;
+  ws.m_rootIndex = v;
+  ws.SetStatus (v, DSRRoutingLSA::LSA_SPF_IN_SPFTREE);
+  ws.m_distance[v] = job.m_distance;
+  NS_LOG_LOGIC ("Starting SPFCalculate for node " << Ipv4Address (g.m_vertexId[v]));
 
 //
 // Optimize SPF calculation, for ns-3.
@@ -1548,105 +3837,65 @@ DSRRouteManagerImpl::SPFCalculate (Ipv4Address root, Ipv4Address initroot, DSRRo
 // reached.  Instead, short-circuit this computation and just install
 // a default route in the CheckForStubNode() method.
 //
-  if (NodeList::GetNNodes () > 0 && CheckForStubNode (root))
+  if (CheckForStubNode (ws))
     {
-      NS_LOG_LOGIC ("SPFCalculate truncated for stub node " << root);
-      delete m_spfroot;
+      NS_LOG_LOGIC ("SPFCalculate truncated for stub node " << Ipv4Address (g.m_vertexId[v]));
       return;
     }
 
   for (;;)
     {
 //
-// The operations we need to do are given in the OSPF RFC which we reference
-// as we go along.
-//
 // RFC2328 16.1. (2). 
 //
-// We examine the Global Router Link Records in the Link State 
-// Advertisements of the current vertex.  If there are any point-to-point
-// links to unexplored adjacent vertices we add them to the tree and update
-// the distance and next hop information on how to get there.  We also add
-// the new vertices to the candidate queue (the priority queue ordered by
+// We examine the edges of the current vertex.  If there are any links to
+// unexplored adjacent vertices we add them to the tree and update the
+// distance and next hop information on how to get there.  We also add the
+// new vertices to the candidate queue (the priority queue ordered by
 // shortest path).  If the new vertices represent shorter paths, we use them
 // and update the path cost.
 //
-      SPFNext (v, candidate);
+      SPFNext (ws, v);
 //
 // RFC2328 16.1. (3). 
 //
 // If at this step the candidate list is empty, the shortest-path tree (of
 // transit vertices) has been completely built and this stage of the
-// procedure terminates. 
+// procedure terminates.  Otherwise choose the vertex belonging to the
+// candidate list that is closest to the root, and add it to the
+// shortest-path tree (removing it from the candidate list in the process).
 //
-      if (candidate.Size () == 0)
+      if (!ws.PopCandidate (v))
         {
           break;
         }
+      NS_LOG_LOGIC ("Popped vertex " << Ipv4Address (g.m_vertexId[v]));
+      ws.SetStatus (v, DSRRoutingLSA::LSA_SPF_IN_SPFTREE);
 //
-// Choose the vertex belonging to the candidate list that is closest to the
-// root, and add it to the shortest-path tree (removing it from the candidate
-// list in the process).
-//
-// Recall that in the previous step, we created DSRVertex structures for each
-// of the routers found in the Global Router Link Records and added tehm to 
-// the candidate list.
-//
-      NS_LOG_LOGIC (candidate);
-      v = candidate.Pop ();
-      NS_LOG_LOGIC ("Popped vertex " << v->GetVertexId ());
-//
-// Update the status field of the vertex to indicate that it is in the SPF
-// tree.
-//
-      v->GetLSA ()->SetStatus (DSRRoutingLSA::LSA_SPF_IN_SPFTREE);
+// Link the vertex into the children lists of its parents.
 //
-// The current vertex has a parent pointer.  By calling this rather oddly 
-// named method (blame quagga) we add the current vertex to the list of 
-// children of that parent vertex.  In the next hop calculation called during
-// SPFNext, the parent pointer was set but the vertex has been orphaned up
-// to now.
-//
-      DSRVertexAddParent (v);
-//
-// Note that when there is a choice of vertices closest to the root, network
-// vertices must be chosen before router vertices in order to necessarily
-// find all equal-cost paths. 
+      DSRVertexAddParent (ws, v);
 //
 // RFC2328 16.1. (4). 
 //
-// This is the method that actually adds the routes.  It'll walk the list
-// of nodes in the system, looking for the node corresponding to the router
-// ID of the root of the tree -- that is the router we're building the routes
-// for.  It looks for the Ipv4 interface of that node and remembers it.  So
-// we are only actually adding routes to that one node at the root of the SPF 
-// tree.
-//
-// We're going to pop of a pointer to every vertex in the tree except the 
-// root in order of distance from the root.  For each of the vertices, we call
-// SPFIntraAddRouter ().  Down in SPFIntraAddRouter, we look at all of the 
-// point-to-point Global Router Link Records (the links to nodes adjacent to
-// the node represented by the vertex).  We add a route to the IP address 
-// specified by the m_linkData field of each of those link records.  This will
-// be the *local* IP address associated with the interface attached to the 
-// link.  We use the outbound interface and next hop information present in 
-// the vertex <v> which have possibly been inherited from the root.
-//
-// To summarize, we're going to look at the node represented by <v> and loop
-// through its point-to-point links, adding a *host* route to the local IP
-// address (at the <v> side) for each of those links.
+// This is the method that actually adds the routes.  We get every vertex in
+// the tree except the root in order of distance from the root.  For each
+// router vertex, we call SPFIntraAddRouter ().  Down in SPFIntraAddRouter, we
+// look at all of the point-to-point edges of the vertex and add a *host*
+// route to the local IP address (at the <v> side) of each of them, on the
+// initial node of the job, through the job's link towards the root.
 //
-      if (v->GetVertexType () == DSRVertex::VertexRouter)
+      if (g.m_vertexType[v] == DSRGraphSnapshot::VertexRouter)
         {
-          SPFIntraAddRouter (v, v_init, l->GetLinkData (), Iface);
+          SPFIntraAddRouter (ws, v, job);
         }
-      else if (v->GetVertexType () == DSRVertex::VertexNetwork)
+      else if (g.m_vertexType[v] == DSRGraphSnapshot::VertexNetwork)
         {
-          SPFIntraAddTransit (v);
+          SPFIntraAddTransit (ws, v);
         }
       else
         {
-          NS_ASSERT_MSG (0, "illegal DSRVertex type");
+          NS_ASSERT_MSG (0, "illegal vertex type");
         }
 //
 // RFC2328 16.1. (5). 
@@ -1656,50 +3905,299 @@ DSRRouteManagerImpl::SPFCalculate (Ipv4Address root, Ipv4Address initroot, DSRRo
 
     }  // end for loop
 
+  SPFAddSummaries (ws, job);
 // Second stage of SPF calculation procedure
-  SPFProcessStubs (m_spfroot);
-  for (uint32_t i = 0; i < m_lsdb->GetNumExtLSAs (); i++)
+  SPFProcessStubs (ws);
+  ProcessASExternals (ws);
+// The round trip through the root, for the loop-free alternates
+  SetRoundTrips (ws, job);
+}
+
+bool
+DSRRouteManagerImpl::UseDistanceMatrix (uint32_t nJobs) const
+{
+  NS_LOG_FUNCTION (this << nJobs);
+  const DSRGraphSnapshot& g = m_graph;
+  EnumValue backend;
+  g_dsrSpfBackend.GetValue (backend);
+  if (backend.Get () == DSRDistanceMatrix::DijkstraBackend || nJobs == 0)
+    {
+      return false;
+    }
+  if (!DSRDistanceMatrix::Fits (g))
+    {
+      NS_LOG_LOGIC ("Metric " << g.GetMaxWeight () << " too large for a distance matrix");
+      return false;
+    }
+  if (backend.Get () == DSRDistanceMatrix::MatrixBackend)
+    {
+      return true;
+    }
+//
+// The kernel relaxes every cell of the padded matrix once per vertex, while
+// each Dijkstra search scans about every edge.  Tiny graphs stay with
+// Dijkstra however dense they are: their matrix would be mostly padding.
+//
+  uint32_t nVertices = g.GetNVertices ();
+  if (nVertices < DSR_MATRIX_MIN_VERTICES || nVertices > DSR_MATRIX_MAX_VERTICES)
     {
-      m_spfroot->ClearVertexProcessed ();
-      DSRRoutingLSA *extlsa = m_lsdb->GetExtLSA (i);
-      NS_LOG_LOGIC ("Processing External LSA with id " << extlsa->GetLinkStateId ());
-      ProcessASExternals (m_spfroot, extlsa);
+      return false;
     }
+  uint64_t side = (nVertices + DSRDistanceMatrix::TILE - 1) / DSRDistanceMatrix::TILE * DSRDistanceMatrix::TILE;
+  return static_cast<uint64_t> (nJobs) * g.GetNEdges () * DSR_MATRIX_CELLS_PER_EDGE >= side * side * side;
+}
 
+void
+DSRRouteManagerImpl::ComputeDistanceMatrix (DSRDistanceMatrix& matrix, DSRWorkerPool& workers) const
+{
+  NS_LOG_FUNCTION (this << workers.GetNThreads ());
+  matrix.Initialize (m_graph);
 //
-// We're all done setting the routing information for the node at the root of
-// the SPF tree.  Delete all of the vertices and corresponding resources.  Go
-// possibly do it again for the next router.
+// Round k of the blocked Floyd-Warshall: the tile on the diagonal, then the
+// rest of row and column k, which only read it, then all the other tiles,
+// which only read row and column k.  Each step writes disjoint tiles.
 //
-  delete m_spfroot;
-  m_spfroot = 0;
+  uint32_t nTiles = matrix.GetNTiles ();
+  for (uint32_t k = 0; k < nTiles; k++)
+    {
+      matrix.RelaxTile (k, k, k);
+      workers.Run (0, nTiles,
+                   [&matrix, k] (uint32_t i, uint32_t)
+                     {
+                       if (i != k)
+                         {
+                           matrix.RelaxTile (k, i, k);
+                           matrix.RelaxTile (i, k, k);
+                         }
+                     });
+      workers.Run (0, nTiles,
+                   [&matrix, k, nTiles] (uint32_t i, uint32_t)
+                     {
+                       for (uint32_t j = 0; i != k && j < nTiles; j++)
+                         {
+                           if (j != k)
+                             {
+                               matrix.RelaxTile (i, j, k);
+                             }
+                         }
+                     });
+    }
 }
 
 void
-DSRRouteManagerImpl::ProcessASExternals (DSRVertex* v, DSRRoutingLSA* extlsa)
+DSRRouteManagerImpl::MatrixTree (DSRSPFWorkspace& ws, const DSRDistanceMatrix& matrix, uint32_t root,
+                                 DSRSPFTree& tree) const
 {
-  NS_LOG_FUNCTION (this << v << extlsa);
-  NS_LOG_LOGIC ("Processing external for destination " << 
-                extlsa->GetLinkStateId () <<
-                ", for router "  << v->GetVertexId () <<
-                ", advertised by " << extlsa->GetAdvertisingRouter ());
-  if (v->GetVertexType () == DSRVertex::VertexRouter)
+  NS_LOG_FUNCTION (this << root);
+  const DSRGraphSnapshot& g = m_graph;
+  ws.Reset (g.GetNVertices (), 0);
+  ws.m_rootIndex = root;
+  ws.SetStatus (root, DSRRoutingLSA::LSA_SPF_IN_SPFTREE);
+  ws.m_distance[root] = 0;
+  tree.m_order.clear ();
+  tree.m_distance.clear ();
+  tree.m_parentStart.assign (1, 0);
+  tree.m_parents.clear ();
+  tree.m_exitStart.assign (1, 0);
+  tree.m_exits.clear ();
+//
+// SPFNext () restricted to the edges on a shortest path.  The distance of
+// every vertex is known, so a vertex is queued once, by the first of its
+// parents to be expanded, and later parents only merge their exits.  The
+// vertices then pop in the order, and with the parents and exits, that
+// SPFCalculate () gives them.
+//
+  uint32_t v = root;
+  for (;;)
     {
-      DSRRoutingLSA *rlsa = v->GetLSA ();
-      NS_LOG_LOGIC ("Processing router LSA with id " << rlsa->GetLinkStateId ());
-      if ((rlsa->GetLinkStateId ()) == (extlsa->GetAdvertisingRouter ()))
+      for (uint32_t e = g.m_rowStart[v]; e < g.m_rowStart[v + 1]; e++)
         {
-          NS_LOG_LOGIC ("Found advertising router to destination");
-          SPFAddASExternal (extlsa,v);
+          int32_t w = g.m_target[e];
+          if (w < 0 || ws.GetStatus (w) == DSRRoutingLSA::LSA_SPF_IN_SPFTREE)
+            {
+              continue;
+            }
+          uint32_t distance = ws.m_distance[v] + g.m_weight[e];
+          if (distance != matrix.Get (root, w))
+            {
+              continue;
+            }
+          if (ws.GetStatus (w) == DSRRoutingLSA::LSA_SPF_NOT_EXPLORED)
+            {
+              ws.SetStatus (w, DSRRoutingLSA::LSA_SPF_CANDIDATE);
+              SPFNexthopCalculation (ws, v, w, e, ws.m_exits[w]);
+              ws.m_distance[w] = distance;
+              ws.m_parents[w].Assign (v);
+              ws.PushCandidate (w, distance, g.m_vertexType[w] == DSRGraphSnapshot::VertexNetwork);
+              continue;
+            }
+          SPFNexthopCalculation (ws, v, w, e, ws.m_mergeExits);
+          DSRSPFWorkspace::ExitList_t& exits = ws.m_exits[w];
+          for (uint32_t k = 0; k < ws.m_mergeExits.Size (); k++)
+            {
+              exits.PushBack (ws.m_mergeExits[k], ws.m_arena);
+            }
+          std::sort (exits.Begin (), exits.End ());
+          exits.Truncate (std::unique (exits.Begin (), exits.End ()) - exits.Begin ());
+          DSRSPFWorkspace::VertexList_t& parents = ws.m_parents[w];
+          if (std::find (parents.Begin (), parents.End (), v) == parents.End ())
+            {
+              parents.PushBack (v, ws.m_arena);
+            }
+        }
+      if (!ws.PopCandidate (v))
+        {
+          break;
+        }
+      ws.SetStatus (v, DSRRoutingLSA::LSA_SPF_IN_SPFTREE);
+      tree.m_order.push_back (v);
+      tree.m_distance.push_back (ws.m_distance[v]);
+      tree.m_parents.insert (tree.m_parents.end (), ws.m_parents[v].Begin (), ws.m_parents[v].End ());
+      tree.m_parentStart.push_back (tree.m_parents.size ());
+      tree.m_exits.insert (tree.m_exits.end (), ws.m_exits[v].Begin (), ws.m_exits[v].End ());
+      tree.m_exitStart.push_back (tree.m_exits.size ());
+    }
+}
+
+void
+DSRRouteManagerImpl::MatrixCalculate (DSRSPFWorkspace& ws, const DSRSPFTree& tree, SPFJob& job) const
+{
+  NS_LOG_FUNCTION (this << job.m_rootIndex);
+  const DSRGraphSnapshot& g = m_graph;
+  ws.Reset (g.GetNVertices (), &job.m_routes);
+  ws.ResetRanges (g.GetNRanges ());
+  uint32_t v = job.m_rootIndex;
+  ws.m_rootIndex = v;
+  ws.SetStatus (v, DSRRoutingLSA::LSA_SPF_IN_SPFTREE);
+  ws.m_distance[v] = job.m_distance;
+  if (CheckForStubNode (ws))
+    {
+      NS_LOG_LOGIC ("SPFCalculate truncated for stub node " << Ipv4Address (g.m_vertexId[v]));
+      return;
+    }
+//
+// The vertices join the tree in the recorded order, with their recorded
+// parents and exits, and get their routes as in SPFCalculate ().
+//
+  for (uint32_t i = 0; i < tree.m_order.size (); i++)
+    {
+      v = tree.m_order[i];
+      ws.SetStatus (v, DSRRoutingLSA::LSA_SPF_IN_SPFTREE);
+      ws.m_distance[v] = job.m_distance + tree.m_distance[i];
+      for (uint32_t p = tree.m_parentStart[i]; p < tree.m_parentStart[i + 1]; p++)
+        {
+          ws.m_parents[v].PushBack (tree.m_parents[p], ws.m_arena);
+        }
+      for (uint32_t x = tree.m_exitStart[i]; x < tree.m_exitStart[i + 1]; x++)
+        {
+          ws.m_exits[v].PushBack (tree.m_exits[x], ws.m_arena);
+        }
+      DSRVertexAddParent (ws, v);
+      if (g.m_vertexType[v] == DSRGraphSnapshot::VertexRouter)
+        {
+          SPFIntraAddRouter (ws, v, job);
+        }
+      else
+        {
+          SPFIntraAddTransit (ws, v);
+        }
+    }
+  SPFAddSummaries (ws, job);
+  SPFProcessStubs (ws);
+  ProcessASExternals (ws);
+  SetRoundTrips (ws, job);
+}
+
+void
+DSRRouteManagerImpl::ReverseSPFCalculate (DSRSPFWorkspace& ws, uint32_t dest) const
+{
+  NS_LOG_FUNCTION (this << dest);
+  const DSRGraphSnapshot& g = m_graph;
+  NS_ASSERT (g.m_inStart.size () == g.GetNVertices () + 1);
+  ws.Reset (g.GetNVertices (), 0);
+  ws.m_rootIndex = dest;
+  ws.SetStatus (dest, DSRRoutingLSA::LSA_SPF_IN_SPFTREE);
+  ws.m_distance[dest] = 0;
+//
+// SPFNext () with the edges taken backwards: the vertex at the near end of
+// an edge into <v> is one edge metric further from the destination.
+//
+  uint32_t v = dest;
+  for (;;)
+    {
+      for (uint32_t k = g.m_inStart[v]; k < g.m_inStart[v + 1]; k++)
+        {
+          uint32_t w = g.m_inSource[k];
+          DSRRoutingLSA::SPFStatus status = ws.GetStatus (w);
+          if (status == DSRRoutingLSA::LSA_SPF_IN_SPFTREE)
+            {
+              continue;
+            }
+          uint32_t distance = ws.m_distance[v] + g.m_weight[g.m_inEdge[k]];
+          if (status == DSRRoutingLSA::LSA_SPF_NOT_EXPLORED || distance < ws.m_distance[w])
+            {
+              ws.SetStatus (w, DSRRoutingLSA::LSA_SPF_CANDIDATE);
+              ws.m_distance[w] = distance;
+              ws.PushCandidate (w, distance, g.m_vertexType[w] == DSRGraphSnapshot::VertexNetwork);
+            }
+        }
+      if (!ws.PopCandidate (v))
+        {
+          break;
+        }
+      ws.SetStatus (v, DSRRoutingLSA::LSA_SPF_IN_SPFTREE);
+    }
+}
+
+void
+DSRRouteManagerImpl::LazyCalculate (DSRSPFWorkspace& ws, uint32_t dest, std::vector<DSRRouteRecord>& routes) const
+{
+  NS_LOG_FUNCTION (this << dest);
+  const DSRGraphSnapshot& g = m_graph;
+  ReverseSPFCalculate (ws, dest);
+  for (std::vector<SPFJob>::const_iterator j = m_jobs.begin (); j != m_jobs.end (); j++)
+    {
+//
+// The root of an SPF run gets no route from it: a neighbour is reached
+// through the host routes of the job.
+//
+      if (j->m_rootIndex == dest
+          || ws.GetStatus (j->m_rootIndex) != DSRRoutingLSA::LSA_SPF_IN_SPFTREE)
+        {
+          continue;
         }
+      DSRRouteRecord route;
+      route.m_type = DSRRouteRecord::NodeRoute;
+      route.m_nodeId = j->m_initNodeId;
+      route.m_dest = g.m_vertexId[dest];
+      route.m_mask = 0;
+      route.m_nextHop = j->m_nextHop;
+      route.m_interface = j->m_interface;
+      route.m_distance = j->m_distance + ws.m_distance[j->m_rootIndex];
+      route.m_roundTrip = 0;
+      routes.push_back (route);
     }
-  for (uint32_t i = 0; i < v->GetNChildren (); i++)
+}
+
+//
+// The advertising router of an external LSA can appear at most once in the
+// SPF tree, so instead of walking the tree for each external LSA we only need
+// to check whether the router made it into the tree.
+//
+void
+DSRRouteManagerImpl::ProcessASExternals (DSRSPFWorkspace& ws) const
+{
+  NS_LOG_FUNCTION (this);
+  const DSRGraphSnapshot& g = m_graph;
+  for (uint32_t i = 0; i < g.m_extAdvertiser.size (); i++)
     {
-      if (!v->GetChild (i)->IsVertexProcessed ())
+      int32_t v = g.m_extAdvertiser[i];
+      NS_LOG_LOGIC ("Processing external for destination " << Ipv4Address (g.m_extNetwork[i]));
+      if (v >= 0 && g.m_vertexType[v] == DSRGraphSnapshot::VertexRouter
+          && ws.GetStatus (v) == DSRRoutingLSA::LSA_SPF_IN_SPFTREE)
         {
-          NS_LOG_LOGIC ("Vertex's child " << i << " not yet processed, processing...");
-          ProcessASExternals (v->GetChild (i), extlsa);
-          v->GetChild (i)->SetVertexProcessed (true);
+          NS_LOG_LOGIC ("Found advertising router to destination");
+          SPFAddASExternal (ws, i, v);
         }
     }
 }
@@ -1710,650 +4208,729 @@ DSRRouteManagerImpl::ProcessASExternals (DSRVertex* v, DSRRoutingLSA* extlsa)
 //
 
 void
-DSRRouteManagerImpl::SPFAddASExternal (DSRRoutingLSA *extlsa, DSRVertex *v)
+DSRRouteManagerImpl::SPFAddASExternal (DSRSPFWorkspace& ws, uint32_t ext, uint32_t v) const
 {
-  NS_LOG_FUNCTION (this << extlsa << v);
-
-  NS_ASSERT_MSG (m_spfroot, "DSRRouteManagerImpl::SPFAddASExternal (): Root pointer not set");
+  NS_LOG_FUNCTION (this << ext << v);
+  const DSRGraphSnapshot& g = m_graph;
 // Two cases to consider: We are advertising the external ourselves
 // => No need to add anything
 // OR find best path to the advertising router
-  if (v->GetVertexId () == m_spfroot->GetVertexId ())
+  if (v == ws.m_rootIndex)
     {
       NS_LOG_LOGIC ("External is on local host: " 
-                    << v->GetVertexId () << "; returning");
+                    << Ipv4Address (g.m_vertexId[v]) << "; returning");
       return;
     }
   NS_LOG_LOGIC ("External is on remote host: " 
-                << extlsa->GetAdvertisingRouter () << "; installing");
-
-  Ipv4Address routerId = m_spfroot->GetVertexId ();
-
-  NS_LOG_LOGIC ("Vertex ID = " << routerId);
+                << Ipv4Address (g.m_vertexId[v]) << "; installing");
 //
-// We need to walk the list of nodes looking for the one that has the router
-// ID corresponding to the root vertex.  This is the one we're going to write
-// the routing information to.
+// The routes are written to the node at the root of the SPF tree, through
+// each of the next hops and outgoing interfaces the root uses to reach the
+// advertising router.
 //
-  NodeList::Iterator i = NodeList::Begin (); 
-  NodeList::Iterator listEnd = NodeList::End ();
-  for (; i != listEnd; i++)
+  uint32_t nodeId = g.m_nodeId[ws.m_rootIndex];
+  const DSRSPFWorkspace::ExitList_t& exits = ws.m_exits[v];
+  for (uint32_t i = 0; i < exits.Size (); i++)
     {
-      Ptr<Node> node = *i;
-//
-// The router ID is accessible through the DSRRouter interface, so we need
-// to QI for that interface.  If there's no DSRRouter interface, the node
-// in question cannot be the router we want, so we continue.
-// 
-      Ptr<DSRRouter> rtr = node->GetObject<DSRRouter> ();
-
-      if (rtr == 0)
+      if (exits[i].second >= 0)
         {
-          NS_LOG_LOGIC ("No DSRRouter interface on node " << node->GetId ());
-          continue;
+          DSRRouteRecord route;
+          route.m_type = DSRRouteRecord::ASExternalRoute;
+          route.m_nodeId = nodeId;
+          route.m_dest = g.m_extNetwork[ext];
+          route.m_mask = g.m_extMask[ext];
+          route.m_nextHop = exits[i].first;
+          route.m_interface = exits[i].second;
+          route.m_distance = 0;
+          route.m_roundTrip = 0;
+          ws.m_routes->push_back (route);
+          NS_LOG_LOGIC ("(Route " << i << ") Node " << nodeId <<
+                        " add external network route to " << Ipv4Address (route.m_dest) <<
+                        " using next hop " << Ipv4Address (route.m_nextHop) <<
+                        " via interface " << route.m_interface);
         }
-//
-// If the router ID of the current node is equal to the router ID of the 
-// root of the SPF tree, then this node is the one for which we need to 
-// write the routing tables.
-//
-      NS_LOG_LOGIC ("Considering router " << rtr->GetRouterId ());
-
-      if (rtr->GetRouterId () == routerId)
+      else
         {
-          NS_LOG_LOGIC ("Setting routes for node " << node->GetId ());
-//
-// Routing information is updated using the Ipv4 interface.  We need to QI
-// for that interface.  If the node is acting as an IP version 4 router, it
-// should absolutely have an Ipv4 interface.
-//
-          Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
-          NS_ASSERT_MSG (ipv4, 
-                         "DSRRouteManagerImpl::SPFIntraAddRouter (): "
-                         "QI for <Ipv4> interface failed");
-//
-// Get the Global Router Link State Advertisement from the vertex we're
-// adding the routes to.  The LSA will have a number of attached Global Router
-// Link Records corresponding to links off of that vertex / node.  We're going
-// to be interested in the records corresponding to point-to-point links.
-//
-          NS_ASSERT_MSG (v->GetLSA (), 
-                         "DSRRouteManagerImpl::SPFIntraAddRouter (): "
-                         "Expected valid LSA in DSRVertex* v");
-          Ipv4Mask tempmask = extlsa->GetNetworkLSANetworkMask ();
-          Ipv4Address tempip = extlsa->GetLinkStateId ();
-          tempip = tempip.CombineMask (tempmask);
+          NS_LOG_LOGIC ("(Route " << i << ") Node " << nodeId <<
+                        " NOT able to add network route to " << Ipv4Address (g.m_extNetwork[ext]) <<
+                        " since outgoing interface id is negative");
+        }
+    }
+}
 
+
+// Processing logic from RFC 2328, page 166 and quagga ospf_spf_process_stubs ()
+// stub link records will exist for point-to-point interfaces and for
+// broadcast interfaces for which no neighboring router can be found
 //
-// Here's why we did all of that work.  We're going to add a host route to the
-// host address found in the m_linkData field of the point-to-point link
-// record.  In the case of a point-to-point link, this is the local IP address
-// of the node connected to the link.  Each of these point-to-point links
-// will correspond to a local interface that has an IP address to which
-// the node at the root of the SPF tree can send packets.  The vertex <v> 
-// (corresponding to the node that has these links and interfaces) has 
-// an m_nextHop address precalculated for us that is the address to which the
-// root node should send packets to be forwarded to these IP addresses.
-// Similarly, the vertex <v> has an m_rootOif (outbound interface index) to
-// which the packets should be send for forwarding.
-//
-          Ptr<DSRRouter> router = node->GetObject<DSRRouter> ();
-          if (router == 0)
+// The SPF tree is walked depth first from the root, visiting the children of
+// a vertex in the order they joined the tree, and each vertex once.
+void
+DSRRouteManagerImpl::SPFProcessStubs (DSRSPFWorkspace& ws) const
+{
+  NS_LOG_FUNCTION (this);
+  const DSRGraphSnapshot& g = m_graph;
+  ws.m_stack.clear ();
+  ws.m_stack.push_back (ws.m_rootIndex);
+  while (!ws.m_stack.empty ())
+    {
+      uint32_t v = ws.m_stack.back ();
+      ws.m_stack.pop_back ();
+      if (ws.m_processed[v])
+        {
+          continue;
+        }
+      ws.m_processed[v] = 1;
+      NS_LOG_LOGIC ("Processing stubs for " << Ipv4Address (g.m_vertexId[v]));
+      if (g.m_vertexType[v] == DSRGraphSnapshot::VertexRouter)
+        {
+          for (uint32_t s = g.m_stubStart[v]; s < g.m_stubStart[v + 1]; s++)
             {
-              continue;
+              NS_LOG_LOGIC ("Found a Stub record to " << Ipv4Address (g.m_stubNetwork[s]));
+              SPFIntraAddStub (ws, s, v);
             }
-          Ptr<Ipv4DSRRouting> gr = router->GetRoutingProtocol ();
-          NS_ASSERT (gr);
-          // walk through all next-hop-IPs and out-going-interfaces for reaching
-          // the stub network gateway 'v' from the root node
-          for (uint32_t i = 0; i < v->GetNRootExitDirections (); i++)
-            {
-              DSRVertex::NodeExit_t exit = v->GetRootExitDirection (i);
-              Ipv4Address nextHop = exit.first;
-              int32_t outIf = exit.second;
-              /**
-               * \author Pu Yang
-               * \brief get the distance
-              */
-              // uint32_t distance = v->GetDistanceFromRoot ();
-              // std::cout << "the SPF distance = " << distance;
-
-              if (outIf >= 0)
-                {
-                  gr->AddASExternalRouteTo (tempip, tempmask, nextHop, outIf);
-                  NS_LOG_LOGIC ("(Route " << i << ") Node " << node->GetId () <<
-                                " add external network route to " << tempip <<
-                                " using next hop " << nextHop <<
-                                " via interface " << outIf);
-                }
-              else
-                {
-                  NS_LOG_LOGIC ("(Route " << i << ") Node " << node->GetId () <<
-                                " NOT able to add network route to " << tempip <<
-                                " using next hop " << nextHop <<
-                                " since outgoing interface id is negative");
-                }
+        }
+      const DSRSPFWorkspace::VertexList_t& children = ws.m_children[v];
+      for (uint32_t c = children.Size (); c-- > 0; )
+        {
+          if (!ws.m_processed[children[c]])
+            {
+              ws.m_stack.push_back (children[c]);
             }
-          return;
-        } // if
-    } // for
+        }
+    }
 }
 
+// RFC2328 16.1. second stage. 
+void
+DSRRouteManagerImpl::SPFIntraAddStub (DSRSPFWorkspace& ws, uint32_t stub, uint32_t v) const
+{
+  NS_LOG_FUNCTION (this << stub << v);
+  const DSRGraphSnapshot& g = m_graph;
 
-// Processing logic from RFC 2328, page 166 and quagga ospf_spf_process_stubs ()
-// stub link records will exist for point-to-point interfaces and for
-// broadcast interfaces for which no neighboring router can be found
+  // XXX simplifed logic for the moment.  There are two cases to consider:
+  // 1) the stub network is on this router; do nothing for now
+  //    (already handled above)
+  // 2) the stub network is on a remote router, so I should use the
+  // same next hop that I use to get to vertex v
+  if (v == ws.m_rootIndex)
+    {
+      NS_LOG_LOGIC ("Stub is on local host: " << Ipv4Address (g.m_vertexId[v]) << "; returning");
+      return;
+    }
+  if (g.GetSummaryRange (g.m_stubNetwork[stub], g.m_stubMask[stub], g.m_vertexArea[v],
+                         g.m_vertexArea[ws.m_rootIndex]) >= 0)
+    {
+      NS_LOG_LOGIC ("Stub " << Ipv4Address (g.m_stubNetwork[stub]) << " is in a range of another area");
+      return;
+    }
+  NS_LOG_LOGIC ("Stub is on remote host: " << Ipv4Address (g.m_vertexId[v]) << "; installing");
+//
+// The root of the Shortest Path First tree is the router to which we are 
+// going to write the actual routing table entries.  The vertex <v>
+// (corresponding to the node that has the stub network) has the next hops
+// and outbound interfaces the root uses to reach it; add a network route
+// through each of them.
+//
+  uint32_t nodeId = g.m_nodeId[ws.m_rootIndex];
+  const DSRSPFWorkspace::ExitList_t& exits = ws.m_exits[v];
+  for (uint32_t i = 0; i < exits.Size (); i++)
+    {
+      if (exits[i].second >= 0)
+        {
+          DSRRouteRecord route;
+          route.m_type = DSRRouteRecord::NetworkRoute;
+          route.m_nodeId = nodeId;
+          route.m_dest = g.m_stubNetwork[stub];
+          route.m_mask = g.m_stubMask[stub];
+          route.m_nextHop = exits[i].first;
+          route.m_interface = exits[i].second;
+          route.m_distance = 0;
+          route.m_roundTrip = 0;
+          ws.m_routes->push_back (route);
+          NS_LOG_LOGIC ("(Route " << i << ") Node " << nodeId <<
+                        " add network route to " << Ipv4Address (route.m_dest) <<
+                        " using next hop " << Ipv4Address (route.m_nextHop) <<
+                        " via interface " << route.m_interface);
+        }
+      else
+        {
+          NS_LOG_LOGIC ("(Route " << i << ") Node " << nodeId <<
+                        " NOT able to add network route to " << Ipv4Address (g.m_stubNetwork[stub]) <<
+                        " since outgoing interface id is negative");
+        }
+    }
+}
+
+//
+// This method is derived from quagga ospf_intra_add_router ()
+//
+// This is where we are actually going to add the routes to the routers to
+// the routing tables of the individual nodes.
+//
+// The vertex passed as a parameter has just been added to the SPF tree.
+// For each of its point to point edges, the link data is the local IP
+// address of the link.  This corresponds to a destination IP address,
+// reachable from the initial node of the job through the job's link, with
+// the distance of the vertex.  All of them share one node route to the
+// router, which the DSRNodeAddressMap of the tables resolves them to.
+//
 void
-DSRRouteManagerImpl::SPFProcessStubs (DSRVertex* v)
+DSRRouteManagerImpl::SPFIntraAddRouter (DSRSPFWorkspace& ws, uint32_t v, const SPFJob& job) const
 {
   NS_LOG_FUNCTION (this << v);
-  NS_LOG_LOGIC ("Processing stubs for " << v->GetVertexId ());
-  if (v->GetVertexType () == DSRVertex::VertexRouter)
+  const DSRGraphSnapshot& g = m_graph;
+  NS_LOG_LOGIC (" Node " << job.m_initNodeId <<
+                " found " << g.m_rowStart[v + 1] - g.m_rowStart[v] << 
+                " edges at " << Ipv4Address (g.m_vertexId[v]));
+//
+// An address in a range of another area is left to the summary of the range.
+// We are only concerned about point-to-point links.
+//
+  bool summarized = false;
+  for (uint32_t e = g.m_rowStart[v]; e < g.m_rowStart[v + 1]; e++)
     {
-      DSRRoutingLSA *rlsa = v->GetLSA ();
-      NS_LOG_LOGIC ("Processing router LSA with id " << rlsa->GetLinkStateId ());
-      for (uint32_t i = 0; i < rlsa->GetNLinkRecords (); i++)
+      if (g.m_linkType[e] != DSRRoutingLinkRecord::PointToPoint)
         {
-          NS_LOG_LOGIC ("Examining link " << i << " of " << 
-                        v->GetVertexId () << "'s " <<
-                        v->GetLSA ()->GetNLinkRecords () << " link records");
-          DSRRoutingLinkRecord *l = v->GetLSA ()->GetLinkRecord (i);
-          if (l->GetLinkType () == DSRRoutingLinkRecord::StubNetwork)
-            {
-              NS_LOG_LOGIC ("Found a Stub record to " << l->GetLinkId ());
-              SPFIntraAddStub (l, v);
-              continue;
-            }
+          continue;
         }
+      int32_t range = g.GetSummaryRange (g.m_linkData[e], DISTINFINITY, g.m_vertexArea[v], job.m_area);
+      if (range >= 0)
+        {
+          ws.ReachRange (range, ws.m_distance[v]);
+          summarized = true;
+        }
+    }
+  DSRRouteRecord route;
+  route.m_nodeId = job.m_initNodeId;
+  route.m_mask = 0;
+  route.m_nextHop = job.m_nextHop;
+  route.m_interface = job.m_interface;
+  route.m_distance = ws.m_distance[v];
+  route.m_roundTrip = 0;
+  if (!summarized)
+    {
+      route.m_type = DSRRouteRecord::NodeRoute;
+      route.m_dest = g.m_vertexId[v];
+      ws.m_routes->push_back (route);
+      return;
     }
-  for (uint32_t i = 0; i < v->GetNChildren (); i++)
+//
+// The node route would also cover the summarized addresses, so the other
+// ones get a host route each.
+//
+  route.m_type = DSRRouteRecord::HostRoute;
+  for (uint32_t e = g.m_rowStart[v]; e < g.m_rowStart[v + 1]; e++)
     {
-      if (!v->GetChild (i)->IsVertexProcessed ())
+      if (g.m_linkType[e] == DSRRoutingLinkRecord::PointToPoint
+          && g.GetSummaryRange (g.m_linkData[e], DISTINFINITY, g.m_vertexArea[v], job.m_area) < 0)
         {
-          SPFProcessStubs (v->GetChild (i));
-          v->GetChild (i)->SetVertexProcessed (true);
+          route.m_dest = g.m_linkData[e];
+          ws.m_routes->push_back (route);
         }
     }
 }
 
-// RFC2328 16.1. second stage. 
 void
-DSRRouteManagerImpl::SPFIntraAddStub (DSRRoutingLinkRecord *l, DSRVertex* v)
+DSRRouteManagerImpl::SPFAddSummaries (DSRSPFWorkspace& ws, const SPFJob& job) const
 {
-  NS_LOG_FUNCTION (this << l << v);
-
-  NS_ASSERT_MSG (m_spfroot, 
-                 "DSRRouteManagerImpl::SPFIntraAddStub (): Root pointer not set");
-
-  // XXX simplifed logic for the moment.  There are two cases to consider:
-  // 1) the stub network is on this router; do nothing for now
-  //    (already handled above)
-  // 2) the stub network is on a remote router, so I should use the
-  // same next hop that I use to get to vertex v
-  if (v->GetVertexId () == m_spfroot->GetVertexId ())
+  NS_LOG_FUNCTION (this << ws.m_rangesReached.size ());
+  const DSRGraphSnapshot& g = m_graph;
+  for (uint32_t i = 0; i < ws.m_rangesReached.size (); i++)
     {
-      NS_LOG_LOGIC ("Stub is on local host: " << v->GetVertexId () << "; returning");
-      return;
+      uint32_t r = ws.m_rangesReached[i];
+      DSRRouteRecord route;
+      route.m_type = DSRRouteRecord::SummaryRoute;
+      route.m_nodeId = job.m_initNodeId;
+      route.m_dest = g.m_rangeNetwork[r];
+      route.m_mask = g.m_rangeMask[r];
+      route.m_nextHop = job.m_nextHop;
+      route.m_interface = job.m_interface;
+      route.m_distance = ws.m_rangeDistance[r];
+      route.m_roundTrip = 0;
+      ws.m_routes->push_back (route);
+      NS_LOG_LOGIC ("Node " << job.m_initNodeId << " add summary route to " << Ipv4Address (route.m_dest) <<
+                    "/" << Ipv4Mask (route.m_mask) << " using next hop " << Ipv4Address (route.m_nextHop) <<
+                    " at distance " << route.m_distance);
     }
-  NS_LOG_LOGIC ("Stub is on remote host: " << v->GetVertexId () << "; installing");
+}
+
+void
+DSRRouteManagerImpl::SPFIntraAddTransit (DSRSPFWorkspace& ws, uint32_t v) const
+{
+  NS_LOG_FUNCTION (this << v);
+  const DSRGraphSnapshot& g = m_graph;
 //
 // The root of the Shortest Path First tree is the router to which we are 
-// going to write the actual routing table entries.  The vertex corresponding
-// to this router has a vertex ID which is the router ID of that node.  We're
-// going to use this ID to discover which node it is that we're actually going
-// to update.
+// going to write the actual routing table entries.
 //
-  Ipv4Address routerId = m_spfroot->GetVertexId ();
+  uint32_t nodeId = g.m_nodeId[ws.m_rootIndex];
+  NS_LOG_LOGIC ("setting routes for node " << nodeId);
+  uint32_t mask = g.m_networkMask[v];
+  uint32_t network = g.m_vertexId[v] & mask;
+  if (g.GetSummaryRange (network, mask, g.m_vertexArea[v], g.m_vertexArea[ws.m_rootIndex]) >= 0)
+    {
+      NS_LOG_LOGIC ("Transit network " << Ipv4Address (network) << " is in a range of another area");
+      return;
+    }
+  // walk through all available exit directions due to ECMP,
+  // and add host route for each of the exit direction toward
+  // the vertex 'v'
+  const DSRSPFWorkspace::ExitList_t& exits = ws.m_exits[v];
+  for (uint32_t i = 0; i < exits.Size (); i++)
+    {
+      if (exits[i].second >= 0)
+        {
+          DSRRouteRecord route;
+          route.m_type = DSRRouteRecord::NetworkRoute;
+          route.m_nodeId = nodeId;
+          route.m_dest = network;
+          route.m_mask = mask;
+          route.m_nextHop = exits[i].first;
+          route.m_interface = exits[i].second;
+          route.m_distance = 0;
+          route.m_roundTrip = 0;
+          ws.m_routes->push_back (route);
+          NS_LOG_LOGIC ("(Route " << i << ") Node " << nodeId <<
+                        " add network route to " << Ipv4Address (network) <<
+                        " using next hop " << Ipv4Address (route.m_nextHop) <<
+                        " via interface " << route.m_interface);
+        }
+      else
+        {
+          NS_LOG_LOGIC ("(Route " << i << ") Node " << nodeId <<
+                        " NOT able to add network route to " << Ipv4Address (network) <<
+                        " since outgoing interface id is negative " << exits[i].second);
+        }
+    }
+}
 
-  NS_LOG_LOGIC ("Vertex ID = " << routerId);
+// Derived from quagga ospf_vertex_add_parents ()
 //
-// We need to walk the list of nodes looking for the one that has the router
-// ID corresponding to the root vertex.  This is the one we're going to write
-// the routing information to.
+// This is a somewhat oddly named method (blame quagga).  Although you might
+// expect it to add a parent *to* something, it actually adds a vertex
+// to the list of children *in* each of its parents. 
 //
-  NodeList::Iterator i = NodeList::Begin (); 
-  NodeList::Iterator listEnd = NodeList::End ();
-  for (; i != listEnd; i++)
+void
+DSRRouteManagerImpl::DSRVertexAddParent (DSRSPFWorkspace& ws, uint32_t v) const
+{
+  NS_LOG_FUNCTION (this << v);
+  const DSRSPFWorkspace::VertexList_t& parents = ws.m_parents[v];
+  for (uint32_t i = 0; i < parents.Size (); i++)
     {
-      Ptr<Node> node = *i;
-//
-// The router ID is accessible through the DSRRouter interface, so we need
-// to QI for that interface.  If there's no DSRRouter interface, the node
-// in question cannot be the router we want, so we continue.
-// 
-      Ptr<DSRRouter> rtr = 
-        node->GetObject<DSRRouter> ();
+      ws.m_children[parents[i]].PushBack (v, ws.m_arena);
+    }
+}
 
-      if (rtr == 0)
+//
+// Dijkstra from <source> towards <target> over the vertices and edges that
+// the current spur iteration of Yen's algorithm has not removed.
+//
+bool
+DSRRouteManagerImpl::KspShortestPath (DSRKspWorkspace& ws, uint32_t source, uint32_t target,
+                                      uint32_t maxDistance, DSRPath& path) const
+{
+  NS_LOG_FUNCTION (this << source << target << maxDistance);
+  const DSRGraphSnapshot& g = m_graph;
+  std::greater<std::pair<uint32_t, uint32_t> > later;
+  ws.NewSearch ();
+  ws.Reach (source, 0, -1);
+  while (!ws.m_heap.empty ())
+    {
+      std::pop_heap (ws.m_heap.begin (), ws.m_heap.end (), later);
+      std::pair<uint32_t, uint32_t> top = ws.m_heap.back ();
+      ws.m_heap.pop_back ();
+      uint32_t v = top.second;
+      if (ws.m_done[v] || top.first != ws.m_distance[v])
         {
-          NS_LOG_LOGIC ("No DSRRouter interface on node " << 
-                        node->GetId ());
           continue;
         }
-//
-// If the router ID of the current node is equal to the router ID of the 
-// root of the SPF tree, then this node is the one for which we need to 
-// write the routing tables.
-//
-      NS_LOG_LOGIC ("Considering router " << rtr->GetRouterId ());
-
-      if (rtr->GetRouterId () == routerId)
+      ws.m_done[v] = 1;
+      if (v == target)
         {
-          NS_LOG_LOGIC ("Setting routes for node " << node->GetId ());
-//
-// Routing information is updated using the Ipv4 interface.  We need to QI
-// for that interface.  If the node is acting as an IP version 4 router, it
-// should absolutely have an Ipv4 interface.
-//
-          Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
-          NS_ASSERT_MSG (ipv4, 
-                         "DSRRouteManagerImpl::SPFIntraAddRouter (): "
-                         "QI for <Ipv4> interface failed");
-//
-// Get the Global Router Link State Advertisement from the vertex we're
-// adding the routes to.  The LSA will have a number of attached Global Router
-// Link Records corresponding to links off of that vertex / node.  We're going
-// to be interested in the records corresponding to point-to-point links.
-//
-          NS_ASSERT_MSG (v->GetLSA (), 
-                         "DSRRouteManagerImpl::SPFIntraAddRouter (): "
-                         "Expected valid LSA in DSRVertex* v");
-          Ipv4Mask tempmask (l->GetLinkData ().Get ());
-          Ipv4Address tempip = l->GetLinkId ();
-          tempip = tempip.CombineMask (tempmask);
-//
-// Here's why we did all of that work.  We're going to add a host route to the
-// host address found in the m_linkData field of the point-to-point link
-// record.  In the case of a point-to-point link, this is the local IP address
-// of the node connected to the link.  Each of these point-to-point links
-// will correspond to a local interface that has an IP address to which
-// the node at the root of the SPF tree can send packets.  The vertex <v> 
-// (corresponding to the node that has these links and interfaces) has 
-// an m_nextHop address precalculated for us that is the address to which the
-// root node should send packets to be forwarded to these IP addresses.
-// Similarly, the vertex <v> has an m_rootOif (outbound interface index) to
-// which the packets should be send for forwarding.
-//
-
-          Ptr<DSRRouter> router = node->GetObject<DSRRouter> ();
-          if (router == 0)
+          break;
+        }
+      for (uint32_t e = g.m_rowStart[v]; e < g.m_rowStart[v + 1]; e++)
+        {
+          int32_t w = g.m_target[e];
+          if (w < 0 || ws.IsEdgeRemoved (e) || ws.IsVertexRemoved (w))
             {
               continue;
             }
-          Ptr<Ipv4DSRRouting> gr = router->GetRoutingProtocol ();
-          NS_ASSERT (gr);
-          // walk through all next-hop-IPs and out-going-interfaces for reaching
-          // the stub network gateway 'v' from the root node
-          for (uint32_t i = 0; i < v->GetNRootExitDirections (); i++)
+          uint32_t distance = ws.m_distance[v] + g.m_weight[e];
+          if (distance > maxDistance)
             {
-              DSRVertex::NodeExit_t exit = v->GetRootExitDirection (i);
-              Ipv4Address nextHop = exit.first;
-              int32_t outIf = exit.second;
-              if (outIf >= 0)
-                {
-                  gr->AddNetworkRouteTo (tempip, tempmask, nextHop, outIf);
-                  NS_LOG_LOGIC ("(Route " << i << ") Node " << node->GetId () <<
-                                " add network route to " << tempip <<
-                                " using next hop " << nextHop <<
-                                " via interface " << outIf);
-                }
-              else
-                {
-                  NS_LOG_LOGIC ("(Route " << i << ") Node " << node->GetId () <<
-                                " NOT able to add network route to " << tempip <<
-                                " using next hop " << nextHop <<
-                                " since outgoing interface id is negative");
-                }
+              continue;
             }
-          return;
-        } // if
-    } // for
-}
-
-//
-// Return the interface number corresponding to a given IP address and mask
-// This is a wrapper around GetInterfaceForPrefix(), but we first
-// have to find the right node pointer to pass to that function.
-// If no such interface is found, return -1 (note:  unit test framework
-// for routing assumes -1 to be a legal return value)
-//
-int32_t
-DSRRouteManagerImpl::FindOutgoingInterfaceId (Ipv4Address a, Ipv4Mask amask)
-{
-  NS_LOG_FUNCTION (this << a << amask);
-//
-// We have an IP address <a> and a vertex ID of the root of the SPF tree.
-// The question is what interface index does this address correspond to.
-// The answer is a little complicated since we have to find a pointer to
-// the node corresponding to the vertex ID, find the Ipv4 interface on that
-// node in order to iterate the interfaces and find the one corresponding to
-// the address in question.
-//
-  Ipv4Address routerId = m_spfroot->GetVertexId ();
+          if (!ws.IsReached (w) || (!ws.m_done[w] && distance < ws.m_distance[w]))
+            {
+              ws.Reach (w, distance, e);
+            }
+        }
+    }
+  if (!ws.IsReached (target) || !ws.m_done[target])
+    {
+      return false;
+    }
 //
-// Walk the list of nodes in the system looking for the one corresponding to
-// the node at the root of the SPF tree.  This is the node for which we are
-// building the routing table.
+// Walk the predecessor edges back from the target.  An edge's source is not
+// stored, so it is found from the row it belongs to.
 //
-  NodeList::Iterator i = NodeList::Begin (); 
-  NodeList::Iterator listEnd = NodeList::End ();
-  for (; i != listEnd; i++)
+  path.m_distance = ws.m_distance[target];
+  path.m_edges.clear ();
+  path.m_vertices.clear ();
+  uint32_t v = target;
+  path.m_vertices.push_back (v);
+  while (v != source)
     {
-      Ptr<Node> node = *i;
+      int32_t e = ws.m_predEdge[v];
+      NS_ASSERT (e >= 0);
+      path.m_edges.push_back (e);
+      v = std::upper_bound (g.m_rowStart.begin (), g.m_rowStart.end (), static_cast<uint32_t> (e))
+        - g.m_rowStart.begin () - 1;
+      path.m_vertices.push_back (v);
+    }
+  std::reverse (path.m_edges.begin (), path.m_edges.end ());
+  std::reverse (path.m_vertices.begin (), path.m_vertices.end ());
+  return true;
+}
 
-      Ptr<DSRRouter> rtr = 
-        node->GetObject<DSRRouter> ();
 //
-// If the node doesn't have a DSRRouter interface it can't be the one
-// we're interested in.
+// Yen's algorithm.  Path k is the shortest of the candidate paths built by
+// deviating from path k-1 at each of its vertices (the spur vertex): the
+// root of path k-1 up to the spur vertex is kept, the edges that earlier
+// paths with the same root take out of the spur vertex are removed, and so
+// are the root vertices themselves so that the result stays loopless.
 //
-      if (rtr == 0)
+void
+DSRRouteManagerImpl::KShortestPaths (DSRKspWorkspace& ws, uint32_t source, uint32_t target,
+                                     uint32_t k, uint32_t maxDistance,
+                                     std::vector<DSRPath>& paths) const
+{
+  NS_LOG_FUNCTION (this << source << target << k << maxDistance);
+  const DSRGraphSnapshot& g = m_graph;
+  paths.clear ();
+  ws.ClearRemoved ();
+  DSRPath path;
+  if (!KspShortestPath (ws, source, target, maxDistance, path))
+    {
+      return;
+    }
+  paths.push_back (path);
+  std::vector<DSRPath> candidates;
+  while (paths.size () < k)
+    {
+      const DSRPath& previous = paths.back ();
+      uint32_t rootDistance = 0;
+      for (uint32_t i = 0; i < previous.m_edges.size (); i++)
         {
-          continue;
+          if (rootDistance > maxDistance)
+            {
+              break;
+            }
+          uint32_t spur = previous.m_vertices[i];
+          ws.ClearRemoved ();
+          for (uint32_t p = 0; p < paths.size (); p++)
+            {
+              const DSRPath& known = paths[p];
+              if (known.m_edges.size () > i
+                  && std::equal (previous.m_edges.begin (), previous.m_edges.begin () + i,
+                                 known.m_edges.begin ()))
+                {
+                  ws.RemoveEdge (known.m_edges[i]);
+                }
+            }
+          for (uint32_t j = 0; j < i; j++)
+            {
+              ws.RemoveVertex (previous.m_vertices[j]);
+            }
+          DSRPath spurPath;
+          if (KspShortestPath (ws, spur, target, maxDistance - rootDistance, spurPath))
+            {
+              DSRPath candidate;
+              candidate.m_vertices.assign (previous.m_vertices.begin (), previous.m_vertices.begin () + i);
+              candidate.m_vertices.insert (candidate.m_vertices.end (),
+                                           spurPath.m_vertices.begin (), spurPath.m_vertices.end ());
+              candidate.m_edges.assign (previous.m_edges.begin (), previous.m_edges.begin () + i);
+              candidate.m_edges.insert (candidate.m_edges.end (),
+                                        spurPath.m_edges.begin (), spurPath.m_edges.end ());
+              candidate.m_distance = rootDistance + spurPath.m_distance;
+              bool known = false;
+              for (uint32_t c = 0; c < candidates.size () && !known; c++)
+                {
+                  known = candidates[c].m_edges == candidate.m_edges;
+                }
+              if (!known)
+                {
+                  candidates.push_back (candidate);
+                }
+            }
+          rootDistance += g.m_weight[previous.m_edges[i]];
         }
-
-      if (rtr->GetRouterId () == routerId)
+      if (candidates.empty ())
         {
+          break;
+        }
 //
-// This is the node we're building the routing table for.  We're going to need
-// the Ipv4 interface to look for the ipv4 interface index.  Since this node
-// is participating in routing IP version 4 packets, it certainly must have 
-// an Ipv4 interface.
-//
-          Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
-          NS_ASSERT_MSG (ipv4, 
-                         "DSRRouteManagerImpl::FindOutgoingInterfaceId (): "
-                         "GetObject for <Ipv4> interface failed");
-//
-// Look through the interfaces on this node for one that has the IP address
-// we're looking for.  If we find one, return the corresponding interface
-// index, or -1 if not found.
+// Take the shortest candidate; ties go to the fewest hops, then to the
+// earliest found.
 //
-          int32_t interface = ipv4->GetInterfaceForPrefix (a, amask);
-
-#if 0
-          if (interface < 0)
+      uint32_t best = 0;
+      for (uint32_t c = 1; c < candidates.size (); c++)
+        {
+          if (candidates[c].m_distance < candidates[best].m_distance
+              || (candidates[c].m_distance == candidates[best].m_distance
+                  && candidates[c].m_edges.size () < candidates[best].m_edges.size ()))
             {
-              NS_FATAL_ERROR ("DSRRouteManagerImpl::FindOutgoingInterfaceId(): "
-                              "Expected an interface associated with address a:" << a);
+              best = c;
             }
-#endif 
-          return interface;
         }
+      paths.push_back (candidates[best]);
+      candidates.erase (candidates.begin () + best);
     }
-//
-// Couldn't find it.
-//
-  NS_LOG_LOGIC ("FindOutgoingInterfaceId():Can't find root node " << routerId);
-  return -1;
 }
 
-//
-// This method is derived from quagga ospf_intra_add_router ()
-//
-// This is where we are actually going to add the host routes to the routing
-// tables of the individual nodes.
-//
-// The vertex passed as a parameter has just been added to the SPF tree.
-// This vertex must have a valid m_root_oid, corresponding to the outgoing
-// interface on the root router of the tree that is the first hop on the path
-// to the vertex.  The vertex must also have a next hop address, corresponding
-// to the next hop on the path to the vertex.  The vertex has an m_lsa field
-// that has some number of link records.  For each point to point link record,
-// the m_linkData is the local IP address of the link.  This corresponds to
-// a destination IP address, reachable from the root, to which we add a host
-// route.
-//
 void
-DSRRouteManagerImpl::SPFIntraAddRouter (DSRVertex* v, DSRVertex* v_init, Ipv4Address nextHop, uint32_t Iface)
+DSRRouteManagerImpl::KspCalculate (DSRKspWorkspace& ws, RouterJob& job, uint32_t k,
+                                   uint32_t maxDistance, uint32_t maxRoutes) const
 {
-  NS_LOG_FUNCTION (this << v);
-
-  NS_ASSERT_MSG (m_spfroot, 
-                 "DSRRouteManagerImpl::SPFIntraAddRouter (): Root pointer not set");
-//
-// The root of the Shortest Path First tree is the router to which we are 
-// going to write the actual routing table entries.  The vertex corresponding
-// to this router has a vertex ID which is the router ID of that node.  We're
-// going to use this ID to discover which node it is that we're actually going
-// to update.
-//
-  Ipv4Address routerId = m_spfroot->GetVertexId ();
-
-/**
- * @brief the router Ipv4 Address to write the routing table
- * \author Pu Yang
- */
-  Ipv4Address routerId_init = v_init->GetVertexId ();
-  NS_LOG_LOGIC ("Vertex ID = " << routerId);
-
-//
-// We need to walk the list of nodes looking for the one that has the router
-// ID corresponding to the root vertex.  This is the one we're going to write
-// the routing information to.
-//
-
-  NodeList::Iterator listEnd = NodeList::End ();
-  NodeList::Iterator i = NodeList::Begin (); 
-  
-  for (; i != listEnd; i++)
+  NS_LOG_FUNCTION (this << job.m_sourceIndex << k << maxDistance << maxRoutes);
+  const DSRGraphSnapshot& g = m_graph;
+  ws.m_routes = &job.m_routes;
+  uint32_t source = job.m_sourceIndex;
+  uint32_t area = g.m_vertexArea[source];
+  std::vector<DSRPath> paths;
+  std::vector<uint32_t> firstEdges;
+  for (uint32_t d = 0; d < g.GetNVertices (); d++)
     {
-      Ptr<Node> node = *i;
-//
-// The router ID is accessible through the GlobalRouter interface, so we need
-// to GetObject for that interface.  If there's no GlobalRouter interface, 
-// the node in question cannot be the router we want, so we continue.
-// 
-      Ptr<DSRRouter> rtr = 
-        node->GetObject<DSRRouter> ();
-
-      if (rtr == 0)
+      if (d == source || g.m_vertexType[d] != DSRGraphSnapshot::VertexRouter)
         {
-          NS_LOG_LOGIC ("No GlobalRouter interface on node " << 
-                        node->GetId ());
           continue;
         }
-        // std::cout << "The neighbour node " << node->GetId () << std::endl;
-//
-// If the router ID of the current node is equal to the router ID of the 
-// root of the SPF tree, then this node is the one for which we need to 
-// write the routing tables.
-//
-      NS_LOG_LOGIC ("Considering router " << rtr->GetRouterId ());
-
-      if (rtr->GetRouterId () == routerId_init)
+      KShortestPaths (ws, source, d, k, maxDistance, paths);
+      firstEdges.clear ();
+      for (uint32_t p = 0; p < paths.size (); p++)
         {
-          NS_LOG_LOGIC ("Setting routes for node " << node->GetId ());
-//
-// Routing information is updated using the Ipv4 interface.  We need to 
-// GetObject for that interface.  If the node is acting as an IP version 4 
-// router, it should absolutely have an Ipv4 interface.
-//
-          Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
-          NS_ASSERT_MSG (ipv4, 
-                         "DSRRouteManagerImpl::SPFIntraAddRouter (): "
-                         "GetObject for <Ipv4> interface failed");
+          const DSRPath& path = paths[p];
+          uint32_t e = path.m_edges[0];
 //
-// Get the Global Router Link State Advertisement from the vertex we're
-// adding the routes to.  The LSA will have a number of attached Global Router
-// Link Records corresponding to links off of that vertex / node.  We're going
-// to be interested in the records corresponding to point-to-point links.
+// The shortest path out of each neighbour is already in the table, from the
+// SPF job rooted at that neighbour; only the next ones are new.
 //
-          DSRRoutingLSA *lsa = v->GetLSA ();
-          NS_ASSERT_MSG (lsa, 
-                         "DSRRouteManagerImpl::SPFIntraAddRouter (): "
-                         "Expected valid LSA in DSRVertex* v");
-
-          uint32_t nLinkRecords = lsa->GetNLinkRecords ();
-//
-// Iterate through the link records on the vertex to which we're going to add
-// routes.  To make sure we're being clear, we're going to add routing table
-// entries to the tables on the node corresping to the root of the SPF tree.
-// These entries will have routes to the IP addresses we find from looking at
-// the local side of the point-to-point links found on the node described by
-// the vertex <v>.
-//
-          NS_LOG_LOGIC (" Node " << node->GetId () <<
-                        " found " << nLinkRecords << " link records in LSA " << lsa << "with LinkStateId "<< lsa->GetLinkStateId ());
-          for (uint32_t j = 0; j < nLinkRecords; ++j)
+          if (std::find (firstEdges.begin (), firstEdges.end (), e) == firstEdges.end ())
             {
+              firstEdges.push_back (e);
+              continue;
+            }
 //
-// We are only concerned about point-to-point links
+// Leaving through a point-to-point link, the next hop is the far end of the
+// link; through a transit network, it is the interface of the second router
+// on that network.  As for the SPF routes, the first hop is counted with the
+// metric the neighbour advertises back towards the source.
 //
-              DSRRoutingLinkRecord *lr = lsa->GetLinkRecord (j);
-              if (lr->GetLinkType () != DSRRoutingLinkRecord::PointToPoint)
+          uint32_t nextHop;
+          uint32_t distance = path.m_distance;
+          if (g.m_linkType[e] == DSRRoutingLinkRecord::PointToPoint)
+            {
+              int32_t linkRemote = g.m_reverse[e];
+              if (linkRemote < 0)
                 {
                   continue;
                 }
-              Ptr<DSRRouter> router = node->GetObject<DSRRouter> ();
-              if (router == 0)
+              nextHop = g.m_linkData[linkRemote];
+              distance = distance - g.m_weight[e] + g.m_weight[linkRemote];
+            }
+          else
+            {
+              NS_ASSERT (path.m_edges.size () > 1);
+              int32_t linkRemote = g.m_reverse[path.m_edges[1]];
+              if (linkRemote < 0)
                 {
                   continue;
                 }
-              Ptr<Ipv4DSRRouting> gr = router->GetRoutingProtocol ();
-              NS_ASSERT (gr);
-              uint32_t distance = v->GetDistanceFromRoot ();
-              gr->AddHostRouteTo (lr->GetLinkData (), nextHop, Iface, distance);
+              nextHop = g.m_linkData[linkRemote];
+            }
+          if (g.m_outIf[e] < 0)
+            {
+              continue;
+            }
+          DSRRouteRecord route;
+          route.m_nodeId = job.m_nodeId;
+          route.m_mask = 0;
+          route.m_nextHop = nextHop;
+          route.m_interface = g.m_outIf[e];
+          route.m_distance = distance;
+          route.m_roundTrip = 0;
+          if (!g.HasSummarizedAddress (d, area))
+            {
+              if (job.m_routes.size () >= maxRoutes)
+                {
+                  NS_LOG_LOGIC ("Node " << job.m_nodeId << " reached the cap of " <<
+                                maxRoutes << " alternative routes");
+                  return;
+                }
+              route.m_type = DSRRouteRecord::NodeRoute;
+              route.m_dest = g.m_vertexId[d];
+              ws.m_routes->push_back (route);
+              continue;
+            }
+          route.m_type = DSRRouteRecord::HostRoute;
+          for (uint32_t r = g.m_rowStart[d]; r < g.m_rowStart[d + 1]; r++)
+            {
+              if (g.m_linkType[r] != DSRRoutingLinkRecord::PointToPoint
+                  || g.GetSummaryRange (g.m_linkData[r], DISTINFINITY, g.m_vertexArea[d], area) >= 0)
+                {
+                  continue;
+                }
+              if (job.m_routes.size () >= maxRoutes)
+                {
+                  NS_LOG_LOGIC ("Node " << job.m_nodeId << " reached the cap of " <<
+                                maxRoutes << " alternative routes");
+                  return;
+                }
+              route.m_dest = g.m_linkData[r];
+              ws.m_routes->push_back (route);
             }
-//
-// Done adding the routes for the selected node.
-//
-          return;
         }
     }
 }
-void
-DSRRouteManagerImpl::SPFIntraAddTransit (DSRVertex* v)
-{
-  NS_LOG_FUNCTION (this << v);
-
-  NS_ASSERT_MSG (m_spfroot, 
-                 "DSRRouteManagerImpl::SPFIntraAddTransit (): Root pointer not set");
-//
-// The root of the Shortest Path First tree is the router to which we are 
-// going to write the actual routing table entries.  The vertex corresponding
-// to this router has a vertex ID which is the router ID of that node.  We're
-// going to use this ID to discover which node it is that we're actually going
-// to update.
-//
-  Ipv4Address routerId = m_spfroot->GetVertexId ();
 
-  NS_LOG_LOGIC ("Vertex ID = " << routerId);
 //
-// We need to walk the list of nodes looking for the one that has the router
-// ID corresponding to the root vertex.  This is the one we're going to write
-// the routing information to.
+// The best-effort class gets the minimum hop path, not the minimum delay
+// one.  Every transit edge counts as one hop, so the search is a plain
+// breadth-first traversal of the snapshot; a broadcast network is expanded
+// as soon as it is reached so that crossing it costs a single hop.  The
+// FIFO lives in the stack of the workspace.
 //
-  NodeList::Iterator i = NodeList::Begin (); 
-  NodeList::Iterator listEnd = NodeList::End ();
-  for (; i != listEnd; i++)
+void
+DSRRouteManagerImpl::BestEffortCalculate (DSRSPFWorkspace& ws, RouterJob& job) const
+{
+  NS_LOG_FUNCTION (this << job.m_sourceIndex);
+  const DSRGraphSnapshot& g = m_graph;
+  ws.Reset (g.GetNVertices (), &job.m_routes);
+  ws.ResetRanges (g.GetNRanges ());
+  uint32_t root = job.m_sourceIndex;
+  ws.m_rootIndex = root;
+  ws.SetStatus (root, DSRRoutingLSA::LSA_SPF_IN_SPFTREE);
+  ws.m_distance[root] = 0;
+  ws.m_stack.clear ();
+  ws.m_stack.push_back (root);
+  for (uint32_t head = 0; head < ws.m_stack.size (); head++)
     {
-      Ptr<Node> node = *i;
-//
-// The router ID is accessible through the DSRRouter interface, so we need
-// to GetObject for that interface.  If there's no DSRRouter interface, 
-// the node in question cannot be the router we want, so we continue.
-// 
-      Ptr<DSRRouter> rtr = 
-        node->GetObject<DSRRouter> ();
-
-      if (rtr == 0)
+      uint32_t v = ws.m_stack[head];
+      uint32_t hops = ws.m_distance[v] + 1;
+      for (uint32_t e = g.m_rowStart[v]; e < g.m_rowStart[v + 1]; e++)
         {
-          NS_LOG_LOGIC ("No DSRRouter interface on node " << 
-                        node->GetId ());
-          continue;
-        }
-//
-// If the router ID of the current node is equal to the router ID of the 
-// root of the SPF tree, then this node is the one for which we need to 
-// write the routing tables.
-//
-      NS_LOG_LOGIC ("Considering router " << rtr->GetRouterId ());
-
-      if (rtr->GetRouterId () == routerId)
-        {
-          NS_LOG_LOGIC ("setting routes for node " << node->GetId ());
-//
-// Routing information is updated using the Ipv4 interface.  We need to 
-// GetObject for that interface.  If the node is acting as an IP version 4 
-// router, it should absolutely have an Ipv4 interface.
-//
-          Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
-          NS_ASSERT_MSG (ipv4, 
-                         "DSRRouteManagerImpl::SPFIntraAddTransit (): "
-                         "GetObject for <Ipv4> interface failed");
-//
-// Get the Global Router Link State Advertisement from the vertex we're
-// adding the routes to.  The LSA will have a number of attached Global Router
-// Link Records corresponding to links off of that vertex / node.  We're going
-// to be interested in the records corresponding to point-to-point links.
-//
-          DSRRoutingLSA *lsa = v->GetLSA ();
-          NS_ASSERT_MSG (lsa, 
-                         "DSRRouteManagerImpl::SPFIntraAddTransit (): "
-                         "Expected valid LSA in DSRVertex* v");
-          Ipv4Mask tempmask = lsa->GetNetworkLSANetworkMask ();
-          Ipv4Address tempip = lsa->GetLinkStateId ();
-          tempip = tempip.CombineMask (tempmask);
-          Ptr<DSRRouter> router = node->GetObject<DSRRouter> ();
-          if (router == 0)
+          int32_t w = g.m_target[e];
+          if (w < 0 || ws.GetStatus (w) != DSRRoutingLSA::LSA_SPF_NOT_EXPLORED)
             {
               continue;
             }
-          Ptr<Ipv4DSRRouting> gr = router->GetRoutingProtocol ();
-          NS_ASSERT (gr);
-          // walk through all available exit directions due to ECMP,
-          // and add host route for each of the exit direction toward
-          // the vertex 'v'
-          for (uint32_t i = 0; i < v->GetNRootExitDirections (); i++)
+          if (g.m_vertexType[w] == DSRGraphSnapshot::VertexRouter)
             {
-              DSRVertex::NodeExit_t exit = v->GetRootExitDirection (i);
-              Ipv4Address nextHop = exit.first;
-              int32_t outIf = exit.second;
-
-              if (outIf >= 0)
+              // the next hop out of the root is the neighbour's end of the link
+              if (v == root && g.m_reverse[e] < 0)
                 {
-                  gr->AddNetworkRouteTo (tempip, tempmask, nextHop, outIf);
-                  NS_LOG_LOGIC ("(Route " << i << ") Node " << node->GetId () <<
-                                " add network route to " << tempip <<
-                                " using next hop " << nextHop <<
-                                " via interface " << outIf);
+                  continue;
                 }
-              else
+              DSRGraphSnapshot::Exit_t exit = v == root ? 
+                DSRGraphSnapshot::Exit_t (g.m_linkData[g.m_reverse[e]], g.m_outIf[e]) : ws.m_exits[v][0];
+              BestEffortAddVertex (ws, job, w, exit, hops);
+              continue;
+            }
+          DSRGraphSnapshot::Exit_t exit = v == root ? 
+            DSRGraphSnapshot::Exit_t (0, g.m_outIf[e]) : ws.m_exits[v][0];
+          BestEffortAddVertex (ws, job, w, exit, hops);
+          for (uint32_t f = g.m_rowStart[w]; f < g.m_rowStart[w + 1]; f++)
+            {
+              int32_t x = g.m_target[f];
+              if (x < 0 || ws.GetStatus (x) != DSRRoutingLSA::LSA_SPF_NOT_EXPLORED
+                  || (v == root && g.m_reverse[f] < 0))
                 {
-                  NS_LOG_LOGIC ("(Route " << i << ") Node " << node->GetId () <<
-                                " NOT able to add network route to " << tempip <<
-                                " using next hop " << nextHop <<
-                                " since outgoing interface id is negative " << outIf);
+                  continue;
                 }
+              // from a network the root is on, the next hop is the router's
+              // address on that network
+              DSRGraphSnapshot::Exit_t routerExit = v == root ? 
+                DSRGraphSnapshot::Exit_t (g.m_linkData[g.m_reverse[f]], g.m_outIf[e]) : exit;
+              BestEffortAddVertex (ws, job, x, routerExit, hops);
             }
         }
-    } 
+    }
 }
 
-// Derived from quagga ospf_vertex_add_parents ()
-//
-// This is a somewhat oddly named method (blame quagga).  Although you might
-// expect it to add a parent *to* something, it actually adds a vertex
-// to the list of children *in* each of its parents. 
-//
-// Given a pointer to a vertex, it links back to the vertex's parent that it
-// already has set and adds itself to that vertex's list of children.
-//
 void
-DSRRouteManagerImpl::DSRVertexAddParent (DSRVertex* v)
+DSRRouteManagerImpl::BestEffortAddVertex (DSRSPFWorkspace& ws, const RouterJob& job, uint32_t v,
+                                          const DSRGraphSnapshot::Exit_t& exit, uint32_t hops) const
 {
-  NS_LOG_FUNCTION (this << v);
-
-  for (uint32_t i=0;;)
+  NS_LOG_FUNCTION (this << v << hops);
+  const DSRGraphSnapshot& g = m_graph;
+  ws.SetStatus (v, DSRRoutingLSA::LSA_SPF_IN_SPFTREE);
+  ws.m_distance[v] = hops;
+  ws.m_exits[v].Assign (exit);
+  DSRRouteRecord route;
+  route.m_nodeId = job.m_nodeId;
+  route.m_nextHop = exit.first;
+  route.m_interface = exit.second;
+  route.m_distance = hops;
+  route.m_roundTrip = 0;
+//
+// A destination in a range of another area is replaced by a route to the
+// range, added when the search first reaches it, which is with the fewest
+// hops.
+//
+  uint32_t area = g.m_vertexArea[v];
+  uint32_t rootArea = g.m_vertexArea[job.m_sourceIndex];
+  auto summarize = [&g, &ws, &route, area, rootArea] (uint32_t network, uint32_t mask)
+    {
+      int32_t range = g.GetSummaryRange (network, mask, area, rootArea);
+      if (range < 0)
+        {
+          return false;
+        }
+      if (ws.ReachRange (range, route.m_distance))
+        {
+          DSRRouteRecord summary = route;
+          summary.m_type = DSRRouteRecord::BestEffortNetworkRoute;
+          summary.m_dest = g.m_rangeNetwork[range];
+          summary.m_mask = g.m_rangeMask[range];
+          ws.m_routes->push_back (summary);
+        }
+      return true;
+    };
+  if (g.m_vertexType[v] == DSRGraphSnapshot::VertexNetwork)
+    {
+      route.m_type = DSRRouteRecord::BestEffortNetworkRoute;
+      route.m_dest = g.m_vertexId[v] & g.m_networkMask[v];
+      route.m_mask = g.m_networkMask[v];
+      if (!summarize (route.m_dest, route.m_mask))
+        {
+          ws.m_routes->push_back (route);
+        }
+      return;
+    }
+  ws.m_stack.push_back (v);
+  route.m_type = DSRRouteRecord::BestEffortHostRoute;
+  route.m_mask = 0;
+  for (uint32_t e = g.m_rowStart[v]; e < g.m_rowStart[v + 1]; e++)
     {
-      DSRVertex* parent;
-      // check if all parents of vertex v
-      if ((parent = v->GetParent (i++)) == 0) break;
-      parent->AddChild (v);
+      if (g.m_linkType[e] == DSRRoutingLinkRecord::PointToPoint
+          && !summarize (g.m_linkData[e], DISTINFINITY))
+        {
+          route.m_dest = g.m_linkData[e];
+          ws.m_routes->push_back (route);
+        }
+    }
+  route.m_type = DSRRouteRecord::BestEffortNetworkRoute;
+  for (uint32_t s = g.m_stubStart[v]; s < g.m_stubStart[v + 1]; s++)
+    {
+      if (!summarize (g.m_stubNetwork[s], g.m_stubMask[s]))
+        {
+          route.m_dest = g.m_stubNetwork[s];
+          route.m_mask = g.m_stubMask[s];
+          ws.m_routes->push_back (route);
+        }
     }
 }
 
 } // namespace ns3
-
-
@@ -23,773 +23,1193 @@
 #define DSR_ROUTE_MANAGER_IMPL_H
 
 #include <stdint.h>
-#include <list>
-#include <queue>
 #include <map>
+#include <set>
 #include <vector>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include "ns3/object.h"
 #include "ns3/ptr.h"
 #include "ns3/ipv4-address.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
 #include "dsr-router-interface.h"
 
 namespace ns3 {
 
 const uint32_t DISTINFINITY = 0xffffffff; //!< "infinite" distance between nodes
 
-class DsrCandidateQueue;
 class Ipv4DSRRouting;
+class DSRNodeAddressMap;
 
 /**
- * \ingroup globalrouting
- *
- * @brief Vertex used in shortest path first (SPF) computations. See \RFC{2328},
- * Section 16.
- *
- * Each router in the simulation is associated with an DSRVertex object.  When
- * calculating routes, each of these routers is, in turn, chosen as the "root"
- * of the calculation and routes to all of the other routers are eventually
- * saved in the routing tables of each of the chosen nodes.  Each of these 
- * routers in the calculation has an associated DSRVertex.
+ * @brief The Link State DataBase (LSDB) of the DSR Route Manager.
  *
- * The "Root" vertex is the DSRVertex representing the router that is having
- * its routing tables set.  The DSRVertex objects representing other routers
- * or networks in the simulation are arranged in the SPF tree.  It is this 
- * tree that represents the Shortest Paths to the other networks.
+ * Each node in the simulation participating in global routing has a
+ * DSRRouter interface.  The primary job of this interface is to export
+ * Global Router Link State Advertisements (LSAs).  These advertisements in
+ * turn contain a number of Global Router Link Records that describe the 
+ * point to point links from the underlying node to other nodes (that will 
+ * also export their own LSAs.
  *
- * Each DSRVertex has a pointer to the Global Router Link State Advertisement
- * (LSA) that its underlying router has exported.  Within these LSAs are
- * Global Router Link Records that describe the point to point links from the
- * underlying router to other nodes (represented by other DSRVertex objects)
- * in the simulation topology.  The combination of the arrangement of the 
- * DSRVertex objects in the SPF tree, along with the details of the link
- * records that connect them provide the information required to construct the
- * required routes.
+ * This class implements a searchable database of LSAs gathered from every
+ * router in the simulation.
  */
-class DSRVertex
+class DSRRouteManagerLSDB
 {
 public:
 /**
- * @brief Enumeration of the possible types of DSRVertex objects.
+ * @brief Construct an empty Global Router Manager Link State Database.
  *
- * Currently we use VertexRouter to identify objects that represent a router 
- * in the simulation topology, and VertexNetwork to identify objects that 
- * represent a network.
+ * The database map composing the Link State Database is initialized in
+ * this constructor.
  */
-  enum VertexType {
-    VertexUnknown = 0,  /**< Uninitialized Link Record */
-    VertexRouter,       /**< Vertex representing a router in the topology */
-    VertexNetwork       /**< Vertex representing a network in the topology */
-  };
+  DSRRouteManagerLSDB ();
 
 /**
- * @brief Construct an empty ("uninitialized") DSRVertex (Shortest Path First 
- * Vertex).
- *
- * The Vertex Type is set to VertexUnknown, the Vertex ID is set to 
- * 255.255.255.255, and the distance from root is set to infinity 
- * (UINT32_MAX).  The referenced Link State Advertisement (LSA) is set to 
- * null as is the parent DSRVertex.  The outgoing interface index is set to
- * infinity, the next hop address is set to 0.0.0.0 and the list of children
- * of the DSRVertex is initialized to empty.
+ * @brief Destroy an empty Global Router Manager Link State Database.
  *
- * @see VertexType
+ * The database map is walked and all of the Link State Advertisements stored
+ * in the database are released; then the database map itself is clear ()ed to
+ * release any remaining resources.
  */
-  DSRVertex();
+  ~DSRRouteManagerLSDB ();
 
 /**
- * @brief Construct an initialized DSRVertex (Shortest Path First Vertex).
- *
- * The Vertex Type is initialized to VertexRouter and the Vertex ID is found
- * from the Link State ID of the Link State Advertisement (LSA) passed as a
- * parameter.  The Link State ID is set to the Router ID of the advertising
- * router.  The referenced LSA (m_lsa) is set to the given LSA.  Other than 
- * these members, initialization is as in the default constructor.
- * of the DSRVertex is initialized to empty.
+ * @brief Insert an IP address / Link State Advertisement pair into the Link
+ * State Database.
  *
- * @see DSRVertex::DSRVertex ()
- * @see VertexType
- * @see GlobalRoutingLSA
- * @param lsa The Link State Advertisement used for finding initial values.
- */
-  DSRVertex(DSRRoutingLSA* lsa);
-
-/**
- * @brief Destroy an DSRVertex (Shortest Path First Vertex).
+ * The IPV4 address and the DSRRoutingLSA given as parameters are converted
+ * to an STL pair and are inserted into the database map.
  *
- * The children vertices of the DSRVertex are recursively deleted.
+ * @see DSRRoutingLSA
+ * @see Ipv4Address
+ * The database takes over one reference to the LSA, which it releases
+ * when it is destroyed, or right away if the address is already present.
  *
- * @see DSRVertex::DSRVertex ()
+ * @param addr The IP address associated with the LSA.  Typically the Router 
+ * ID.
+ * @param lsa A pointer to the Link State Advertisement for the router.
  */
-  ~DSRVertex();
+  void Insert (Ipv4Address addr, DSRRoutingLSA* lsa);
 
 /**
- * @brief Get the Vertex Type field of a DSRVertex object.
+ * @brief Insert an IP address / Link State Advertisement pair into the Link
+ * State Database, sharing the LSA.
  *
- * The Vertex Type describes the kind of simulation object a given DSRVertex
- * represents.
+ * The database adds its own reference to the LSA, so that the LSA a router
+ * discovered is not copied.
  *
- * @see VertexType
- * @returns The VertexType of the current DSRVertex object.
+ * @param addr The IP address associated with the LSA.  Typically the Router
+ * ID.
+ * @param lsa The Link State Advertisement for the router.
  */
-  VertexType GetVertexType (void) const;
+  void Insert (Ipv4Address addr, Ptr<DSRRoutingLSA> lsa);
 
 /**
- * @brief Set the Vertex Type field of a DSRVertex object.
+ * @brief Look up the Link State Advertisement associated with the given
+ * link state ID (address).
  *
- * The Vertex Type describes the kind of simulation object a given DSRVertex
- * represents.
+ * The database map is searched for the given IPV4 address and corresponding
+ * DSRRoutingLSA is returned.
  *
- * @see VertexType
- * @param type The new VertexType for the current DSRVertex object.
+ * @see DSRRoutingLSA
+ * @see Ipv4Address
+ * @param addr The IP address associated with the LSA.  Typically the Router 
+ * ID.
+ * @returns A pointer to the Link State Advertisement for the router specified
+ * by the IP address addr.
  */
-  void SetVertexType (VertexType type);
-
+  DSRRoutingLSA* GetLSA (Ipv4Address addr) const;
 /**
- * @brief Get the Vertex ID field of a DSRVertex object.
- *
- * The Vertex ID uniquely identifies the simulation object a given DSRVertex
- * represents.  Typically, this is the Router ID for DSRVertex objects 
- * representing routers, and comes from the Link State Advertisement of a 
- * router aggregated to a node in the simulation.  These IDs are allocated
- * automatically by the routing environment and look like IP addresses 
- * beginning at 0.0.0.0 and monotonically increasing as new routers are
- * instantiated.
+ * @brief Look up the Link State Advertisement associated with the given
+ * link state ID (address).  This is a variation of the GetLSA call
+ * to allow the LSA to be found by matching addr with the LinkData field
+ * of the TransitNetwork link record.
  *
- * @returns The Ipv4Address Vertex ID of the current DSRVertex object.
+ * @see GetLSA
+ * @param addr The IP address associated with the LSA.  Typically the Router 
+ * @returns A pointer to the Link State Advertisement for the router specified
+ * by the IP address addr.
+ * ID.
  */
-  Ipv4Address GetVertexId (void) const;
+  DSRRoutingLSA* GetLSAByLinkData (Ipv4Address addr) const;
+
+  /**
+   * @brief Look up the External Link State Advertisement associated with the given
+   * index.
+   *
+   * The external database map is searched for the given index and corresponding
+   * DSRRoutingLSA is returned.
+   *
+   * @see DSRRoutingLSA
+   * @param index the index associated with the LSA.
+   * @returns A pointer to the Link State Advertisement.
+   */
+  DSRRoutingLSA* GetExtLSA (uint32_t index) const;
+  /**
+   * @brief Get the number of External Link State Advertisements.
+   *
+   * @see DSRRoutingLSA
+   * @returns the number of External Link State Advertisements.
+   */
+  uint32_t GetNumExtLSAs () const;
+
+  /**
+   * @brief Get the number of (non-external) Link State Advertisements.
+   *
+   * Router and network LSAs are numbered densely in insertion order, so
+   * that SPF computations can keep their per-LSA state in flat arrays
+   * instead of in the LSAs themselves.
+   *
+   * @returns the number of Link State Advertisements.
+   */
+  uint32_t GetNumLSAs () const;
+
+  /**
+   * @brief Look up the dense index of the LSA with the given link state ID.
+   *
+   * @param addr The IP address associated with the LSA.
+   * @returns the index of the LSA, or GetNumLSAs () if there is none.
+   */
+  uint32_t GetLSAIndex (Ipv4Address addr) const;
+
+  /**
+   * @brief Look up a Link State Advertisement by its dense index.
+   *
+   * @param index the index, smaller than GetNumLSAs ().
+   * @returns A pointer to the Link State Advertisement.
+   */
+  DSRRoutingLSA* GetLSAByIndex (uint32_t index) const;
+
+private:
+  typedef std::map<Ipv4Address, DSRRoutingLSA*> LSDBMap_t; //!< container of IPv4 addresses / Link State Advertisements
+  typedef std::pair<Ipv4Address, DSRRoutingLSA*> LSDBPair_t; //!< pair of IPv4 addresses / Link State Advertisements
+
+  LSDBMap_t m_database; //!< database of IPv4 addresses / Link State Advertisements
+  std::map<Ipv4Address, uint32_t> m_index; //!< link state ID to dense LSA index
+  std::vector<DSRRoutingLSA*> m_lsas; //!< LSAs of m_database by dense index
+  std::vector<DSRRoutingLSA*> m_extdatabase; //!< database of External Link State Advertisements
 
 /**
- * @brief Set the Vertex ID field of a DSRVertex object.
- *
- * The Vertex ID uniquely identifies the simulation object a given DSRVertex
- * represents.  Typically, this is the Router ID for DSRVertex objects 
- * representing routers, and comes from the Link State Advertisement of a 
- * router aggregated to a node in the simulation.  These IDs are allocated
- * automatically by the routing environment and look like IP addresses 
- * beginning at 0.0.0.0 and monotonically increase as new routers are
- * instantiated.  This method is an explicit override of the automatically
- * generated value.
- *
- * @param id The new Ipv4Address Vertex ID for the current DSRVertex object.
+ * @brief DSRRouteManagerLSDB copy construction is disallowed.  There's no 
+ * need for it and a compiler provided shallow copy would be wrong.
+ * @param lsdb object to copy from
  */
-  void SetVertexId (Ipv4Address id);
+  DSRRouteManagerLSDB (DSRRouteManagerLSDB& lsdb);
 
 /**
- * @brief Get the Global Router Link State Advertisement returned by the 
- * Global Router represented by this DSRVertex during the route discovery 
- * process.
- *
- * @see DSRRouter
- * @see DSRRoutingLSA
- * @see DSRRouter::DiscoverLSAs ()
- * @returns A pointer to the DSRRoutingLSA found by the router represented
- * by this DSRVertex object.
+ * @brief The DSRRouteManagerLSDB copy assignment operator is disallowed.  There's no 
+ * need for it and a compiler provided shallow copy would be wrong.
+ * @param lsdb object to copy from
+ * @returns the copied object
  */
-  DSRRoutingLSA* GetLSA (void) const;
+  DSRRouteManagerLSDB& operator= (DSRRouteManagerLSDB& lsdb);
+};
 
 /**
- * @brief Set the Global Router Link State Advertisement returned by the 
- * Global Router represented by this DSRVertex during the route discovery 
- * process.
- *
- * @see DSRVertex::GetLSA ()
- * @see DSRRouter
- * @see DSRRoutingLSA
- * @see DSRRouter::DiscoverLSAs ()
- * @warning Ownership of the LSA is transferred to the "this" DSRVertex.  You
- * must not delete the LSA after calling this method.
- * @param lsa A pointer to the DSRRoutingLSA.
+ * @brief A routing table write produced by an SPF run.
+ *
+ * SPF runs may execute on worker threads, where touching the nodes'
+ * Ipv4DSRRouting objects would race.  Instead each run records the routes
+ * it would have added, and the route manager replays the records on the
+ * main thread in the same order the serial computation would have used.
+ * Addresses are kept in host order and only turned back into Ipv4Address
+ * and Ipv4Mask objects when the routes are installed.
  */
-  void SetLSA (DSRRoutingLSA* lsa);
+struct DSRRouteRecord
+{
+  /**
+   * @enum RouteType
+   * @brief The table the route is written to.
+   */
+  enum RouteType
+  {
+    HostRoute,              /**< Ipv4DSRRouting::AddHostRouteTo with a distance */
+    NodeRoute,              /**< Ipv4DSRRouting::AddNodeRouteTo, to a router ID */
+    NetworkRoute,           /**< Ipv4DSRRouting::AddNetworkRouteTo */
+    ASExternalRoute,        /**< Ipv4DSRRouting::AddASExternalRouteTo */
+    BestEffortHostRoute,    /**< Ipv4DSRRouting::AddBestEffortHostRouteTo with a hop count */
+    BestEffortNetworkRoute, /**< Ipv4DSRRouting::AddBestEffortNetworkRouteTo */
+    SummaryRoute            /**< Ipv4DSRRouting::AddNetworkRouteTo with a distance, to an area range */
+  };
+
+  RouteType m_type;       //!< which table the route goes to
+  uint32_t m_nodeId;      //!< node whose routing table receives the route
+  uint32_t m_dest;        //!< destination host, router ID or network
+  uint32_t m_mask;        //!< destination network mask (unused for host and node routes)
+  uint32_t m_nextHop;     //!< next hop address
+  uint32_t m_interface;   //!< outgoing interface index
+  uint32_t m_distance;    //!< distance from the node to the destination (host, node and summary routes)
+  uint32_t m_roundTrip;   //!< distance from the node to the next hop and back (host and node routes), 0 if unknown
+};
 
 /**
- * @brief Get the distance from the root vertex to "this" DSRVertex object.
+ * @brief Monotonic memory arena for the scratch data of SPF runs.
  *
- * Each router in the simulation is associated with an DSRVertex object.  When
- * calculating routes, each of these routers is, in turn, chosen as the "root"
- * of the calculation and routes to all of the other routers are eventually
- * saved in the routing tables of each of the chosen nodes.  Each of these 
- * routers in the calculation has an associated DSRVertex.
- *
- * The "Root" vertex is then the DSRVertex representing the router that is
- * having its routing tables set.  The "this" DSRVertex is the vertex to which
- * a route is being calculated from the root.  The distance from the root that
- * we're asking for is the number of hops from the root vertex to the vertex
- * in question.
- *
- * The distance is calculated during route discovery and is stored in a
- * member variable.  This method simply fetches that value.
- *
- * @returns The distance, in hops, from the root DSRVertex to "this" DSRVertex.
+ * Memory is carved out of large chunks by bumping an offset.  Nothing is
+ * freed individually: Reset () hands the whole arena back in O(1) at the end
+ * of an SPF run and keeps the chunks, so once the first few runs have grown
+ * the arena, later runs of the same computation make no heap allocations at
+ * all.  Only objects with trivial destructors may be placed in the arena.
  */
-  uint32_t GetDistanceFromRoot (void) const;
+class DSRSPFArena
+{
+public:
+  DSRSPFArena ();
+  ~DSRSPFArena ();
+
+  /**
+   * @brief Allocate uninitialized storage for an array.
+   * @param n the number of elements
+   * @returns storage for \a n objects of type T, valid until Reset ()
+   */
+  template <typename T>
+  T* Allocate (uint32_t n)
+  {
+    return static_cast<T*> (AllocateBytes (n * sizeof (T)));
+  }
+
+  /**
+   * @brief Release everything allocated since the last reset.
+   */
+  void Reset (void);
+
+  /**
+   * @returns the number of chunks the arena obtained from the heap
+   */
+  uint64_t GetChunkAllocations (void) const;
+
+  /**
+   * @returns the number of bytes handed out since the arena was created
+   */
+  uint64_t GetBytesAllocated (void) const;
+
+  /**
+   * @returns the number of small vectors that outgrew their inline storage
+   */
+  uint64_t GetSpills (void) const;
+
+  /**
+   * @brief Count a small vector moving out of its inline storage
+   */
+  void NotifySpill (void);
+
+private:
+  /**
+   * @brief Arenas own their chunks and are not copyable.
+   * @param arena object to copy from
+   */
+  DSRSPFArena (const DSRSPFArena& arena);
+
+  /**
+   * @brief Arenas own their chunks and are not copyable.
+   * @param arena object to copy from
+   * @returns the copied object
+   */
+  DSRSPFArena& operator= (const DSRSPFArena& arena);
+
+  /**
+   * @brief Bump-allocate raw storage, suitably aligned for any scalar.
+   * @param size the number of bytes
+   * @returns the storage
+   */
+  void* AllocateBytes (uint32_t size);
+
+  /**
+   * @brief A block of memory obtained from the heap
+   */
+  struct Chunk
+  {
+    char* m_data;   //!< the memory
+    uint32_t m_size; //!< its size in bytes
+  };
+
+  std::vector<Chunk> m_chunks; //!< chunks in allocation order
+  uint32_t m_current;          //!< chunk allocations are served from
+  uint32_t m_offset;           //!< first free byte in the current chunk
+  uint64_t m_chunkAllocations; //!< chunks obtained from the heap
+  uint64_t m_bytesAllocated;   //!< bytes handed out
+  uint64_t m_spills;           //!< small vectors moved into the arena
+};
 
 /**
- * @brief Set the distance from the root vertex to "this" DSRVertex object.
- *
- * Each router in the simulation is associated with an DSRVertex object.  When
- * calculating routes, each of these routers is, in turn, chosen as the "root"
- * of the calculation and routes to all of the other routers are eventually
- * saved in the routing tables of each of the chosen nodes.  Each of these 
- * routers in the calculation has an associated DSRVertex.
- *
- * The "Root" vertex is then the DSRVertex representing the router that is
- * having its routing tables set.  The "this" DSRVertex is the vertex to which
- * a route is being calculated from the root.  The distance from the root that
- * we're asking for is the number of hops from the root vertex to the vertex
- * in question.
+ * @brief Vector of up to N elements stored inline, growing into an arena.
  *
- * @param distance The distance, in hops, from the root DSRVertex to "this"
- * DSRVertex.
+ * The parents and root exits of an SPF vertex almost always number one or
+ * two, so they are kept inline; a vertex with more equal-cost paths spills
+ * into the arena of the SPF run, whose storage is abandoned rather than
+ * freed.  Clear () therefore must be called for every vector whenever the
+ * arena is reset.  Only trivially destructible T are supported.
  */
-  void SetDistanceFromRoot (uint32_t distance);
+template <typename T, uint32_t N>
+class DSRArenaVector
+{
+public:
+  DSRArenaVector ()
+    : m_data (m_inline),
+      m_size (0),
+      m_capacity (N)
+  {
+  }
+
+  /**
+   * @brief Copy a vector; storage is shared with \a o only if it spilled.
+   * @param o the vector to copy
+   */
+  DSRArenaVector (const DSRArenaVector& o)
+    : m_data (m_inline),
+      m_size (0),
+      m_capacity (N)
+  {
+    *this = o;
+  }
+
+  /**
+   * @brief Copy a vector; storage is shared with \a o only if it spilled.
+   * @param o the vector to copy
+   * @returns this vector
+   */
+  DSRArenaVector& operator= (const DSRArenaVector& o)
+  {
+    if (this != &o)
+      {
+        if (o.m_data == o.m_inline)
+          {
+            std::copy (o.m_inline, o.m_inline + o.m_size, m_inline);
+            m_data = m_inline;
+            m_capacity = N;
+          }
+        else
+          {
+            m_data = o.m_data;
+            m_capacity = o.m_capacity;
+          }
+        m_size = o.m_size;
+      }
+    return *this;
+  }
+
+  /**
+   * @brief Forget all elements and go back to the inline storage
+   */
+  void Clear (void)
+  {
+    m_data = m_inline;
+    m_size = 0;
+    m_capacity = N;
+  }
+
+  /**
+   * @returns the number of elements
+   */
+  uint32_t Size (void) const
+  {
+    return m_size;
+  }
+
+  /**
+   * @returns true if there are no elements
+   */
+  bool Empty (void) const
+  {
+    return m_size == 0;
+  }
+
+  /**
+   * @param i the index of an element
+   * @returns the element
+   */
+  const T& operator[] (uint32_t i) const
+  {
+    return m_data[i];
+  }
+
+  /**
+   * @returns a pointer to the first element
+   */
+  T* Begin (void)
+  {
+    return m_data;
+  }
+
+  /**
+   * @returns a pointer past the last element
+   */
+  T* End (void)
+  {
+    return m_data + m_size;
+  }
+
+  /**
+   * @returns a pointer to the first element
+   */
+  const T* Begin (void) const
+  {
+    return m_data;
+  }
+
+  /**
+   * @returns a pointer past the last element
+   */
+  const T* End (void) const
+  {
+    return m_data + m_size;
+  }
+
+  /**
+   * @brief Replace the contents by a single element
+   * @param value the element
+   */
+  void Assign (const T& value)
+  {
+    Clear ();
+    m_inline[0] = value;
+    m_size = 1;
+  }
+
+  /**
+   * @brief Replace the contents by a copy of another vector's elements
+   * @param o the vector to copy from
+   * @param arena where the elements go if they do not fit inline
+   */
+  void Assign (const DSRArenaVector& o, DSRSPFArena& arena)
+  {
+    Clear ();
+    Reserve (o.m_size, arena);
+    std::copy (o.Begin (), o.End (), m_data);
+    m_size = o.m_size;
+  }
+
+  /**
+   * @brief Append an element
+   * @param value the element
+   * @param arena where the elements go if they no longer fit
+   */
+  void PushBack (const T& value, DSRSPFArena& arena)
+  {
+    if (m_size == m_capacity)
+      {
+        Reserve (2 * m_capacity, arena);
+      }
+    m_data[m_size++] = value;
+  }
+
+  /**
+   * @brief Drop the elements past the first \a size ones
+   * @param size the new number of elements, not more than Size ()
+   */
+  void Truncate (uint32_t size)
+  {
+    m_size = size;
+  }
+
+private:
+  /**
+   * @brief Make room for at least \a capacity elements
+   * @param capacity the number of elements
+   * @param arena where the elements go if they do not fit inline
+   */
+  void Reserve (uint32_t capacity, DSRSPFArena& arena)
+  {
+    if (capacity <= m_capacity)
+      {
+        return;
+      }
+    if (m_data == m_inline)
+      {
+        arena.NotifySpill ();
+      }
+    T* data = arena.Allocate<T> (capacity);
+    std::copy (m_data, m_data + m_size, data);
+    m_data = data;
+    m_capacity = capacity;
+  }
+
+  T m_inline[N];       //!< inline storage
+  T* m_data;           //!< m_inline or arena storage
+  uint32_t m_size;     //!< number of elements
+  uint32_t m_capacity; //!< number of elements m_data can hold
+};
 
 /**
- * @brief Set the IP address and outgoing interface index that should be used 
- * to begin forwarding packets from the root DSRVertex to "this" DSRVertex.
- *
- * Each router node in the simulation is associated with an DSRVertex object.
- * When calculating routes, each of these routers is, in turn, chosen as the 
- * "root" of the calculation and routes to all of the other routers are
- * eventually saved in the routing tables of each of the chosen nodes.
+ * @brief Timers and counters of the last route computation.
  *
- * The "Root" vertex is then the DSRVertex representing the router that is
- * having its routing tables set.  The "this" DSRVertex is the vertex that
- * represents the host or network to which a route is being calculated from 
- * the root.  The IP address that we're asking for is the address on the 
- * remote side of a link off of the root node that should be used as the
- * destination for packets along the path to "this" vertex.
- *
- * When initializing the root DSRVertex, the IP address used when forwarding
- * packets is determined by examining the Global Router Link Records of the
- * Link State Advertisement generated by the root node's DSRRouter.  This
- * address is used to forward packets off of the root's network down those
- * links.  As other vertices / nodes are discovered which are further away
- * from the root, they will be accessible down one of the paths via a link
- * described by one of these Global Router Link Records.
- * 
- * To forward packets to these hosts or networks, the root node must begin
- * the forwarding process by sending the packets to a first hop router down
- * an interface.  This means that the first hop address and interface ID must
- * be the same for all downstream SPFVertices.  We call this "inheriting"
- * the interface and next hop.
- *
- * In this method we are telling the root node which exit direction it should send
- * should I send a packet to the network or host represented by 'this' DSRVertex.
- *
- * @see DSRRouter
- * @see DSRRoutingLSA
- * @see DSRRoutingLinkRecord
- * @param nextHop The IP address to use when forwarding packets to the host
- * or network represented by "this" DSRVertex.
- * @param id The interface index to use when forwarding packets to the host or
- * network represented by "this" DSRVertex.
+ * The discovery and LSDB fields describe the last
+ * DSRRouteManagerImpl::BuildDSRRoutingDatabase () call; the others the
+ * last DSRRouteManagerImpl::InitializeRoutes () or
+ * DSRRouteManagerImpl::UpdateRoutes () call.  Times are wall-clock
+ * seconds.
  */
-  void SetRootExitDirection (Ipv4Address nextHop, int32_t id = DISTINFINITY);
+struct DSRRouteComputationStats
+{
+  DSRRouteComputationStats ();
 
-  typedef std::pair<Ipv4Address, int32_t> NodeExit_t; //!< IPv4 / interface container for exit nodes.
+  /**
+   * @brief Print a summary of the timers and counters.
+   * @param os the output stream
+   */
+  void Print (std::ostream& os) const;
+
+  uint32_t m_lsas;              //!< LSAs discovered
+  double m_discoveryTime;       //!< time spent discovering the LSAs of the routers
+  double m_lsdbTime;            //!< time spent inserting LSAs and building the graph snapshot
+  double m_spfTime;             //!< time spent computing routes
+  double m_installTime;         //!< time spent installing routes in the tables
+  uint32_t m_spfRuns;           //!< SPF computations run
+  uint32_t m_spfReused;         //!< SPF results kept by an incremental update
+  uint64_t m_arenaChunks;       //!< heap allocations made by the SPF arenas
+  uint64_t m_arenaBytes;        //!< bytes handed out by the SPF arenas
+  uint64_t m_inlineSpills;      //!< small vectors that outgrew their inline storage
+  uint32_t m_kspRuns;           //!< K-shortest paths computations run
+  uint64_t m_kspRoutes;         //!< ranked routes added by the K-shortest paths engine
+  uint32_t m_bestEffortRuns;    //!< best-effort table computations run
+  uint64_t m_queueOperations;   //!< candidate queue pushes and pops
+  uint64_t m_verticesReached;   //!< vertex states initialized by the runs
+  uint64_t m_routesInstalled;   //!< routes in all the tables afterwards
+  uint32_t m_coalescedEvents;   //!< interface events served by a scheduled update, 0 for a direct call
+  uint64_t m_routesAdded;       //!< routes inserted in the tables
+  uint64_t m_routesRemoved;     //!< routes removed from the tables
+  uint64_t m_routesUpdated;     //!< routes kept with a new distance
+  uint32_t m_lazyRuns;          //!< destinations whose routes DsrLazyRouting computed on demand
+  uint32_t m_matrixVertices;    //!< vertices of the distance matrix the SPF jobs replayed, 0 if they ran Dijkstra
+  std::vector<uint32_t> m_routesPerNode; //!< routes in the table of each node, by node ID
+  std::vector<uint32_t> m_churnPerNode;  //!< routes added, removed or updated in the table of each node, by node ID
+};
 
 /**
- * @brief Set the IP address and outgoing interface index that should be used 
- * to begin forwarding packets from the root DSRVertex to "this" DSRVertex.
- *
- * Each router node in the simulation is associated with an DSRVertex object.
- * When calculating routes, each of these routers is, in turn, chosen as the 
- * "root" of the calculation and routes to all of the other routers are
- * eventually saved in the routing tables of each of the chosen nodes.
- *
- * The "Root" vertex is then the DSRVertex representing the router that is
- * having its routing tables set.  The "this" DSRVertex is the vertex that
- * represents the host or network to which a route is being calculated from 
- * the root.  The IP address that we're asking for is the address on the 
- * remote side of a link off of the root node that should be used as the
- * destination for packets along the path to "this" vertex.
- *
- * When initializing the root DSRVertex, the IP address used when forwarding
- * packets is determined by examining the Global Router Link Records of the
- * Link State Advertisement generated by the root node's DSRRouter.  This
- * address is used to forward packets off of the root's network down those
- * links.  As other vertices / nodes are discovered which are further away
- * from the root, they will be accessible down one of the paths via a link
- * described by one of these Global Router Link Records.
- * 
- * To forward packets to these hosts or networks, the root node must begin
- * the forwarding process by sending the packets to a first hop router down
- * an interface.  This means that the first hop address and interface ID must
- * be the same for all downstream SPFVertices.  We call this "inheriting"
- * the interface and next hop.
- *
- * In this method we are telling the root node which exit direction it should send
- * should I send a packet to the network or host represented by 'this' DSRVertex.
- *
- * @see DSRRouter
- * @see DSRRoutingLSA
- * @see DSRRoutingLinkRecord
- * @param exit The pair of next-hop-IP and outgoing-interface-index to use when 
- * forwarding packets to the host or network represented by "this" DSRVertex.
+ * @brief Compressed sparse row (CSR) snapshot of the link state database.
+ *
+ * Walking the LSDB during SPF means a map lookup per link and a pointer
+ * chase through separately allocated LSAs and link records.  The snapshot
+ * flattens the LSDB into arrays once per BuildDSRRoutingDatabase (), and
+ * the SPF runs only ever read these arrays.
+ *
+ * Vertex i is the LSA at dense index i of the LSDB.  Its transit edges
+ * (point-to-point and transit network records of a router-LSA, attached
+ * routers of a network-LSA) are [m_rowStart[i], m_rowStart[i+1]) in the edge
+ * arrays, in link record order.  Its stub networks are
+ * [m_stubStart[i], m_stubStart[i+1]) in the stub arrays, and the addresses
+ * a neighbour installs host routes to are [m_hostStart[i], m_hostStart[i+1])
+ * in m_hostAddr.  All addresses and masks are stored in host order.
  */
-  void SetRootExitDirection (DSRVertex::NodeExit_t exit);
+class DSRGraphSnapshot
+{
+public:
   /**
-   * \brief Obtain a pair indicating the exit direction from the root
-   *
-   * \param i An index to a pair
-   * \return A pair of next-hop-IP and outgoing-interface-index for
-   * indicating an exit direction from the root. It is 0 if the index 'i'
-   * is out-of-range
+   * @brief A way out of the SPF root: next hop address and outgoing interface
    */
-  NodeExit_t GetRootExitDirection (uint32_t i) const;
+  typedef std::pair<uint32_t, int32_t> Exit_t;
+
+  /**
+   * @brief The address ranges of each area: (network, mask) pairs in host
+   * order, by area ID
+   */
+  typedef std::map<uint32_t, std::vector<std::pair<uint32_t, uint32_t> > > AreaRanges_t;
+
   /**
-   * \brief Obtain a pair indicating the exit direction from the root
+   * @brief The type of a vertex, as in \RFC{2328}, Section 16
+   */
+  enum VertexType {
+    VertexUnknown = 0,  /**< Uninitialized vertex */
+    VertexRouter,       /**< Vertex representing a router in the topology */
+    VertexNetwork       /**< Vertex representing a network in the topology */
+  };
+
+  DSRGraphSnapshot ();
+
+  /**
+   * @brief Rebuild the snapshot from a link state database.
    *
-   * This method assumes there is only a single exit direction from the root.
-   * Error occur if this assumption is invalid.
+   * Must run on the main thread: the originating node of each LSA is
+   * queried for its interface addresses, so that the SPF runs never need to
+   * touch the nodes.  If there are no nodes (an LSDB supplied through
+   * DSRRouteManagerImpl::DebugUseLsdb) the node data is left empty.
    *
-   * \return The pair of next-hop-IP and outgoing-interface-index for reaching
-   * 'this' vertex from the root
+   * The area of each vertex is the AreaId of the DSRRouter of its node,
+   * and the ranges of the areas that have vertices are kept.
+   *
+   * @param lsdb the link state database
+   * @param ranges the address ranges of the areas
+   */
+  void Build (const DSRRouteManagerLSDB& lsdb, const AreaRanges_t& ranges = AreaRanges_t ());
+
+  /**
+   * @brief Release all the arrays
+   */
+  void Clear (void);
+
+  /**
+   * @returns the number of vertices (LSAs) in the snapshot
    */
-  NodeExit_t GetRootExitDirection () const;
+  uint32_t GetNVertices (void) const;
+
+  /**
+   * @returns the number of transit edges in the snapshot
+   */
+  uint32_t GetNEdges (void) const;
+
   /**
-   * \brief Merge into 'this' vertex the list of exit directions from
-   * another vertex
+   * @returns the largest metric of any transit edge, 0 if there are none
+   */
+  uint32_t GetMaxWeight (void) const;
+
+  /**
+   * @returns the number of area ranges in the snapshot, over all areas
+   */
+  uint32_t GetNRanges (void) const;
+
+  /**
+   * @brief Find the range of an area that holds a network
+   * @param network the network number or host address, in host order
+   * @param mask the network mask, in host order
+   * @param area the area index
+   * @returns the first range of the area that holds the whole network, or
+   * -1 if there is none
+   */
+  int32_t GetAreaRange (uint32_t network, uint32_t mask, uint32_t area) const;
+
+  /**
+   * @brief Test if a network is reached through an area summary
    *
-   * This merge is necessary when ECMP are found. 
+   * The routes of a router towards a network of another area, held by one
+   * of the ranges of that area, are replaced by a summary route to the
+   * range.
    *
-   * \param vertex From which the list of exit directions are obtain
-   * and are merged into 'this' vertex
+   * @param network the network number or host address, in host order
+   * @param mask the network mask, in host order
+   * @param area the area index of the vertex the network belongs to
+   * @param routerArea the area index of the router that gets the routes
+   * @returns the range that summarizes the network, or -1 if the network
+   * is routed to on its own
    */
-  void MergeRootExitDirections (const DSRVertex* vertex);
+  int32_t GetSummaryRange (uint32_t network, uint32_t mask, uint32_t area, uint32_t routerArea) const;
+
   /**
-   * \brief Inherit all root exit directions from a given vertex to 'this' vertex
-   * \param vertex The vertex from which all root exit directions are to be inherited
+   * @brief Test if a point-to-point address of a router is summarized
    *
-   * After the call of this method, the original root exit directions
-   * in 'this' vertex are all lost.
+   * @param v the vertex index of the router
+   * @param routerArea the area index of the router that gets the routes
+   * @returns true if GetSummaryRange () finds a range for one of the
+   * addresses, which a node route to the router would then wrongly cover
    */
-  void InheritAllRootExitDirections (const DSRVertex* vertex);
+  bool HasSummarizedAddress (uint32_t v, uint32_t routerArea) const;
+
   /**
-   * \brief Get the number of exit directions from root for reaching 'this' vertex
-   * \return The number of exit directions from root
+   * @brief Index the edges by the vertex they lead to
+   *
+   * Fills m_inStart, m_inEdge and m_inSource, which Build () leaves empty;
+   * only the reverse SPF runs of DsrLazyRouting walk the edges backwards.
    */
-  uint32_t GetNRootExitDirections () const;
+  void BuildInEdges (void);
 
-/**
- * @brief Get a pointer to the SPFVector that is the parent of "this" 
- * DSRVertex.
- *
- * Each router node in the simulation is associated with an DSRVertex object.
- * When calculating routes, each of these routers is, in turn, chosen as the 
- * "root" of the calculation and routes to all of the other routers are
- * eventually saved in the routing tables of each of the chosen nodes.
- *
- * The "Root" vertex is then the DSRVertex representing the router that is
- * having its routing tables set and is the root of the SPF tree.
- *
- * This method returns a pointer to the parent node of "this" DSRVertex
- * (both of which reside in that SPF tree).
- *
- * @param i The index to one of the parents
- * @returns A pointer to the DSRVertex that is the parent of "this" DSRVertex
- * in the SPF tree.
- */
-  DSRVertex* GetParent (uint32_t i = 0) const;
-
-/**
- * @brief Set the pointer to the SPFVector that is the parent of "this" 
- * DSRVertex.
- *
- * Each router node in the simulation is associated with an DSRVertex object.
- * When calculating routes, each of these routers is, in turn, chosen as the 
- * "root" of the calculation and routes to all of the other routers are
- * eventually saved in the routing tables of each of the chosen nodes.
- *
- * The "Root" vertex is then the DSRVertex representing the router that is
- * having its routing tables set and is the root of the SPF tree.
- *
- * This method sets the parent pointer of "this" DSRVertex (both of which
- * reside in that SPF tree).
- *
- * @param parent A pointer to the DSRVertex that is the parent of "this" 
- * DSRVertex* in the SPF tree.
- */
-  void SetParent (DSRVertex* parent);
   /**
-   * \brief Merge the Parent list from the v into this vertex
+   * @brief Hash every array of the snapshot
+   *
+   * Two snapshots built from LSDBs describing the same topology, the same
+   * addresses and the same metrics hash to the same value.
    *
-   * \param v The vertex from which its list of Parent is read
-   * and then merged into the list of Parent of *this* vertex.
-   * Note that the list in v remains intact
+   * @returns a 64-bit hash of the snapshot
    */
-  void MergeParent (const DSRVertex* v);
+  uint64_t GetHash (void) const;
+
+  std::vector<uint32_t> m_vertexId;     //!< link state ID of each vertex
+  std::vector<uint8_t> m_vertexType;    //!< VertexType of each vertex
+  std::vector<uint32_t> m_networkMask;  //!< network mask of network vertices
+  std::vector<uint32_t> m_nodeId;       //!< originating node of each vertex
+  std::vector<uint32_t> m_rowStart;     //!< first edge of each vertex, plus an end sentinel
+
+  std::vector<int32_t> m_target;        //!< vertex at the far end of each edge, -1 if not in the LSDB
+  std::vector<uint32_t> m_weight;       //!< metric of each edge (0 out of a network vertex)
+  std::vector<uint32_t> m_linkData;     //!< link data of each edge (the local address on P2P links)
+  std::vector<uint8_t> m_linkType;      //!< DSRRoutingLinkRecord::LinkType (Unknown out of a network vertex)
+  std::vector<int32_t> m_reverse;       //!< first edge of the target pointing back at the owner, or -1
+  std::vector<int32_t> m_outIf;         //!< interface of the owner node the edge leaves through, or -1
+
+  std::vector<uint32_t> m_stubStart;    //!< first stub of each vertex, plus an end sentinel
+  std::vector<uint32_t> m_stubNetwork;  //!< stub network number (already masked)
+  std::vector<uint32_t> m_stubMask;     //!< stub network mask
+
+  std::vector<uint32_t> m_hostStart;    //!< first host address of each vertex, plus an end sentinel
+  std::vector<uint32_t> m_hostAddr;     //!< primary address of each non-loopback interface
+
+  std::vector<int32_t> m_extAdvertiser; //!< advertising router vertex of each external LSA, or -1
+  std::vector<uint32_t> m_extNetwork;   //!< external network number (already masked)
+  std::vector<uint32_t> m_extMask;      //!< external network mask
+
+  std::vector<uint32_t> m_vertexArea;   //!< area index of each vertex
+  std::vector<uint32_t> m_areaId;       //!< area ID of each area index, in increasing order
+  std::vector<uint32_t> m_rangeStart;   //!< first range of each area, plus an end sentinel
+  std::vector<uint32_t> m_rangeNetwork; //!< network number of each range (already masked)
+  std::vector<uint32_t> m_rangeMask;    //!< network mask of each range
+
+  std::vector<uint32_t> m_inStart;      //!< first in-edge of each vertex, plus an end sentinel
+  std::vector<uint32_t> m_inEdge;       //!< edges leading to each vertex, by increasing edge index
+  std::vector<uint32_t> m_inSource;     //!< vertex each of the in-edges leaves
 
-/**
- * @brief Get the number of children of "this" DSRVertex.
- *
- * Each router node in the simulation is associated with an DSRVertex object.
- * When calculating routes, each of these routers is, in turn, chosen as the 
- * "root" of the calculation and routes to all of the other routers are
- * eventually saved in the routing tables of each of the chosen nodes.
- *
- * The "Root" vertex is then the DSRVertex representing the router that is
- * having its routing tables set and is the root of the SPF tree.  Each vertex
- * in the SPF tree can have a number of children that represent host or 
- * network routes available via that vertex.
- *
- * This method returns the number of children of "this" DSRVertex (which 
- * reside in the SPF tree).
- *
- * @returns The number of children of "this" DSRVertex (which reside in the
- * SPF tree).
- */
-  uint32_t GetNChildren (void) const;
+private:
+  uint32_t m_maxWeight;                 //!< largest edge metric
+};
 
 /**
- * @brief Get a borrowed DSRVertex pointer to the specified child of "this" 
- * DSRVertex.
- *
- * Each router node in the simulation is associated with an DSRVertex object.
- * When calculating routes, each of these routers is, in turn, chosen as the 
- * "root" of the calculation and routes to all of the other routers are
- * eventually saved in the routing tables of each of the chosen nodes.
- *
- * The "Root" vertex is then the DSRVertex representing the router that is
- * having its routing tables set and is the root of the SPF tree.  Each vertex
- * in the SPF tree can have a number of children that represent host or 
- * network routes available via that vertex.
- *
- * This method the number of children of "this" DSRVertex (which reside in
- * the SPF tree.
- *
- * @see DSRVertex::GetNChildren
- * @param n The index (from 0 to the number of children minus 1) of the 
- * child DSRVertex to return.
- * @warning The pointer returned by GetChild () is a borrowed pointer.  You
- * do not have any ownership of the underlying object and must not delete
- * that object.
- * @returns A pointer to the specified child DSRVertex (which resides in the
- * SPF tree).
+ * @brief Scratch state of one SPF computation.
+ *
+ * Everything an SPF run mutates lives here rather than in the shared
+ * snapshot: the exploration status, distance, parents, children and root
+ * exits of every vertex, the candidate queue, and the routes the run
+ * produces.  One workspace is owned by each worker thread and reused for
+ * every run that thread executes, so the arrays are only allocated once.
+ *
+ * The per-vertex state is stamped with the epoch of the run that last
+ * reached the vertex, and starting a run only increments the epoch.  The
+ * distance, processed flag, parents, children and exits of a vertex are
+ * only meaningful once SetStatus () has been called for it in the current
+ * run.
  */
-  DSRVertex* GetChild (uint32_t n) const;
+class DSRSPFWorkspace
+{
+public:
+  /**
+   * @brief The root exits of a vertex, sorted when more than one
+   */
+  typedef DSRArenaVector<DSRGraphSnapshot::Exit_t, 2> ExitList_t;
+  /**
+   * @brief The parents or children of a vertex
+   */
+  typedef DSRArenaVector<uint32_t, 2> VertexList_t;
 
-/**
- * @brief Get a borrowed DSRVertex pointer to the specified child of "this" 
- * DSRVertex.
- *
- * Each router node in the simulation is associated with an DSRVertex object.
- * When calculating routes, each of these routers is, in turn, chosen as the 
- * "root" of the calculation and routes to all of the other routers are
- * eventually saved in the routing tables of each of the chosen nodes.
- *
- * The "Root" vertex is then the DSRVertex representing the router that is
- * having its routing tables set and is the root of the SPF tree.  Each vertex
- * in the SPF tree can have a number of children that represent host or 
- * network routes available via that vertex.
- *
- * This method the number of children of "this" DSRVertex (which reside in
- * the SPF tree.
- *
- * @see DSRVertex::GetNChildren
- * @warning Ownership of the pointer added to the children of "this" 
- * DSRVertex is transferred to the "this" DSRVertex.  You must not delete the
- * (now) child DSRVertex after calling this method.
- * @param child A pointer to the DSRVertex (which resides in the SPF tree) to
- * be added to the list of children of "this" DSRVertex.
- * @returns The number of children of "this" DSRVertex after the addition of
- * the new child.
- */
-  uint32_t AddChild (DSRVertex* child);
+  /**
+   * @enum QueueType
+   * @brief The priority structure holding the candidate list.
+   */
+  enum QueueType
+  {
+    BinaryHeap,  /**< Comparison-based binary heap, for any metrics */
+    DialBuckets  /**< Dial's circular array of distance buckets, for small integer metrics */
+  };
+
+  DSRSPFWorkspace ();
 
   /**
-   * @brief Set the value of the VertexProcessed flag
+   * @brief Select the candidate queue used by the following runs.
+   *
+   * Dial's bucket queue exploits the monotone integer distances of
+   * Dijkstra's algorithm: the distance of every queued vertex is within
+   * \a maxWeight of the last distance popped, so a circular array of
+   * \a maxWeight + 1 FIFO buckets holds the candidate list with O(1)
+   * pushes and pops amortised over the distance range.  Large metrics would
+   * need too many buckets; the binary heap is kept in that case, from a
+   * \a maxWeight of 65536 on.  DSRRouter::GetLinkMetric () lets metrics
+   * reach 2^24 - 1, and with DsrLinkMetric set to ChannelDelay a link of
+   * more than about 65 ms of delay and serialization already passes the
+   * threshold, so such graphs use the heap.
    *
-   * Flag to note whether vertex has been processed in stage two of 
-   * SPF computation
-   * @param value boolean value to set the flag
-   */ 
-  void SetVertexProcessed (bool value);
+   * @param type the requested queue
+   * @param maxWeight the largest edge metric of the graph
+   */
+  void SetQueueType (QueueType type, uint32_t maxWeight);
+
+  /**
+   * @returns the candidate queue actually in use
+   */
+  QueueType GetQueueType (void) const;
 
   /**
-   * @brief Check the value of the VertexProcessed flag
+   * @brief Prepare the workspace for a new SPF run.
+   * @param nVertices the number of vertices in the snapshot
+   * @param routes where the routes produced by the run are appended
+   */
+  void Reset (uint32_t nVertices, std::vector<DSRRouteRecord>* routes);
+
+  /**
+   * @brief Forget the area ranges reached by the previous run.
+   * @param nRanges the number of area ranges in the snapshot
+   */
+  void ResetRanges (uint32_t nRanges);
+
+  /**
+   * @brief Account for a destination reached through an area summary.
+   * @param range the area range holding the destination
+   * @param distance the distance of the destination
+   * @returns true if the run had not reached the range before
+   */
+  bool ReachRange (uint32_t range, uint32_t distance);
+
+  /**
+   * @brief Get the SPF status of a vertex in the current run.
+   * @param index the vertex
+   * @returns the SPF status
+   */
+  DSRRoutingLSA::SPFStatus GetStatus (uint32_t index) const;
+
+  /**
+   * @brief Set the SPF status of a vertex in the current run.
+   *
+   * The first call for a vertex in a run also reinitializes the rest of its
+   * per-vertex state, so it must precede any other write to that state.
    *
-   * Flag to note whether vertex has been processed in stage two of 
-   * SPF computation
-   * @returns value of underlying flag
-   */ 
-  bool IsVertexProcessed (void) const;
+   * @param index the vertex
+   * @param status the new status
+   */
+  void SetStatus (uint32_t index, DSRRoutingLSA::SPFStatus status);
 
   /**
-   * @brief Clear the value of the VertexProcessed flag
+   * @brief Queue a vertex, or requeue it after its distance decreased.
+   *
+   * The queue orders vertices by distance, then network vertices before
+   * router vertices, then by the time they were (re)queued, which makes
+   * the tie-breaks of the SPF runs deterministic.
    *
-   * Flag to note whether vertex has been processed in stage two of
-   * SPF computation
+   * @param index the vertex
+   * @param distance its distance from the root
+   * @param isNetwork whether the vertex is a network vertex
    */
-  void ClearVertexProcessed (void);
+  void PushCandidate (uint32_t index, uint32_t distance, bool isNetwork);
+
+  /**
+   * @brief Pop the closest candidate, skipping superseded queue entries.
+   * @param index set to the vertex popped
+   * @returns false if there are no candidates left
+   */
+  bool PopCandidate (uint32_t& index);
+
+  uint32_t m_rootIndex;                               //!< vertex at the root of the SPF tree
+  std::vector<DSRRouteRecord>* m_routes;              //!< output of the current run
+  std::vector<uint32_t> m_distance;                   //!< distance from the root of each vertex
+  std::vector<ExitList_t> m_exits;                    //!< root exits of each vertex
+  std::vector<VertexList_t> m_parents;                //!< parents of each vertex in the SPF tree
+  std::vector<VertexList_t> m_children;               //!< children of each vertex, in the order they joined the tree
+  std::vector<uint8_t> m_processed;                   //!< visited flags of the second stage
+  std::vector<uint32_t> m_stack;                      //!< traversal stack of the second stage
+  std::vector<uint32_t> m_rangeDistance;              //!< greatest distance summarized by each area range, or DISTINFINITY
+  std::vector<uint32_t> m_rangesReached;              //!< area ranges reached, in the order they were first reached
+  ExitList_t m_mergeExits;                            //!< exits of an equal-cost path being merged
+  DSRSPFArena m_arena;                                //!< storage of the vertex lists that spill, reset by Reset ()
+  uint64_t m_queueOperations;                         //!< candidate pushes and pops, over every run
+  uint64_t m_verticesReached;                         //!< vertex states initialized, over every run
 
 private:
-  VertexType m_vertexType; //!< Vertex type
-  Ipv4Address m_vertexId; //!< Vertex ID
-  DSRRoutingLSA* m_lsa; //!< Link State Advertisement
-  uint32_t m_distanceFromRoot; //!< Distance from root node
-  int32_t m_rootOif; //!< root Output Interface
-  Ipv4Address m_nextHop; //!< next hop
-  typedef std::list< NodeExit_t > ListOfNodeExit_t; //!< container of Exit nodes
-  ListOfNodeExit_t m_ecmpRootExits; //!< store the multiple root's exits for supporting ECMP
-  typedef std::list<DSRVertex*> ListOfDSRVertex_t; //!< container of DSRVertexes
-  ListOfDSRVertex_t m_parents; //!< parent list
-  ListOfDSRVertex_t m_children; //!< Children list
-  bool m_vertexProcessed; //!< Flag to note whether vertex has been processed in stage two of SPF computation
+  /**
+   * @brief An entry of the candidate queue
+   */
+  struct Candidate
+  {
+    uint32_t m_distance; //!< distance from the root
+    uint32_t m_rank;     //!< 0 for network vertices, 1 for routers
+    uint32_t m_sequence; //!< queueing order
+    uint32_t m_index;    //!< the vertex
+    /**
+     * @param o the other entry
+     * @returns true if this entry pops after \a o
+     */
+    bool operator< (const Candidate& o) const;
+  };
 
-/**
- * @brief The DSRVertex copy construction is disallowed.  There's no need for
- * it and a compiler provided shallow copy would be wrong.
- * @param v object to copy from
- */
-  DSRVertex (DSRVertex& v);
+  /**
+   * @brief A distance bucket of Dial's queue, one FIFO per rank
+   */
+  struct Bucket
+  {
+    std::vector<Candidate> m_entries[2]; //!< entries of each rank, in queueing order
+    uint32_t m_head[2];                  //!< first entry of each rank not popped yet
+  };
 
-/**
- * @brief The DSRVertex copy assignment operator is disallowed.  There's no 
- * need for it and a compiler provided shallow copy would be wrong.
- * @param v object to copy from
- * @returns the copied object
- */
-  DSRVertex& operator= (DSRVertex& v);
+  /**
+   * @brief Pop the next entry of Dial's queue, live or superseded.
+   * @param c set to the entry popped
+   * @returns false if the queue is empty
+   */
+  bool PopBucket (Candidate& c);
 
   /**
-   * \brief Stream insertion operator.
-   *
-   * \param os the reference to the output stream
-   * \param vs a list of DSRVertexes
-   * \returns the reference to the output stream
+   * @brief Empty every bucket of Dial's queue.
    */
-  friend std::ostream& operator<< (std::ostream& os, const DSRVertex::ListOfDSRVertex_t& vs);
+  void ClearBuckets (void);
+
+  std::vector<uint32_t> m_epochOf;    //!< run in which each vertex was last reached
+  uint32_t m_epoch;                   //!< current run; per-vertex state of other runs is stale
+  std::vector<uint8_t> m_status;      //!< SPFStatus of every vertex reached in this run
+  QueueType m_queueType;              //!< candidate queue in use
+  std::vector<Candidate> m_heap;      //!< candidate queue, a binary heap
+  std::vector<Bucket> m_buckets;      //!< candidate queue, Dial's buckets
+  uint32_t m_cursor;                  //!< distance of the bucket being popped
+  uint32_t m_queued;                  //!< entries in the buckets, including superseded ones
+  std::vector<uint32_t> m_sequenceOf; //!< sequence of the live queue entry of each vertex
+  uint32_t m_sequence;                //!< next queueing sequence number
 };
 
 /**
- * @brief The Link State DataBase (LSDB) of the DSR Route Manager.
- *
- * Each node in the simulation participating in global routing has a
- * DSRRouter interface.  The primary job of this interface is to export
- * Global Router Link State Advertisements (LSAs).  These advertisements in
- * turn contain a number of Global Router Link Records that describe the 
- * point to point links from the underlying node to other nodes (that will 
- * also export their own LSAs.
- *
- * This class implements a searchable database of LSAs gathered from every
- * router in the simulation.
+ * @brief A loopless path through a DSRGraphSnapshot.
  */
-class DSRRouteManagerLSDB
+struct DSRPath
 {
-public:
-/**
- * @brief Construct an empty Global Router Manager Link State Database.
- *
- * The database map composing the Link State Database is initialized in
- * this constructor.
- */
-  DSRRouteManagerLSDB ();
+  std::vector<uint32_t> m_vertices; //!< vertices from the source to the target
+  std::vector<uint32_t> m_edges;    //!< m_edges[i] leads from m_vertices[i] to m_vertices[i+1]
+  uint32_t m_distance;              //!< sum of the edge metrics
+};
 
 /**
- * @brief Destroy an empty Global Router Manager Link State Database.
+ * @brief Scratch state of the K-shortest paths engine.
  *
- * The database map is walked and all of the Link State Advertisements stored
- * in the database are freed; then the database map itself is clear ()ed to
- * release any remaining resources.
+ * Yen's algorithm runs one shortest path search per spur vertex, each with
+ * a different set of vertices and edges removed from the graph.  Removal
+ * and search state are stamped with counters, so starting a new search or a
+ * new set of removals costs O(1).  One workspace is owned by each worker
+ * thread.
  */
-  ~DSRRouteManagerLSDB ();
+class DSRKspWorkspace
+{
+public:
+  DSRKspWorkspace ();
 
-/**
- * @brief Insert an IP address / Link State Advertisement pair into the Link
- * State Database.
- *
- * The IPV4 address and the DSRRoutingLSA given as parameters are converted
- * to an STL pair and are inserted into the database map.
- *
- * @see DSRRoutingLSA
- * @see Ipv4Address
- * @param addr The IP address associated with the LSA.  Typically the Router 
- * ID.
- * @param lsa A pointer to the Link State Advertisement for the router.
- */
-  void Insert (Ipv4Address addr, DSRRoutingLSA* lsa);
+  /**
+   * @brief Size the workspace for a snapshot.
+   * @param nVertices the number of vertices in the snapshot
+   * @param nEdges the number of edges in the snapshot
+   */
+  void Reset (uint32_t nVertices, uint32_t nEdges);
 
-/**
- * @brief Look up the Link State Advertisement associated with the given
- * link state ID (address).
- *
- * The database map is searched for the given IPV4 address and corresponding
- * DSRRoutingLSA is returned.
- *
- * @see DSRRoutingLSA
- * @see Ipv4Address
- * @param addr The IP address associated with the LSA.  Typically the Router 
- * ID.
- * @returns A pointer to the Link State Advertisement for the router specified
- * by the IP address addr.
- */
-  DSRRoutingLSA* GetLSA (Ipv4Address addr) const;
-/**
- * @brief Look up the Link State Advertisement associated with the given
- * link state ID (address).  This is a variation of the GetLSA call
- * to allow the LSA to be found by matching addr with the LinkData field
- * of the TransitNetwork link record.
- *
- * @see GetLSA
- * @param addr The IP address associated with the LSA.  Typically the Router 
- * @returns A pointer to the Link State Advertisement for the router specified
- * by the IP address addr.
- * ID.
- */
-  DSRRoutingLSA* GetLSAByLinkData (Ipv4Address addr) const;
+  /**
+   * @brief Put every vertex and edge back into the graph.
+   */
+  void ClearRemoved (void);
+
+  /**
+   * @brief Remove a vertex from the graph until the next ClearRemoved ().
+   * @param v the vertex
+   */
+  void RemoveVertex (uint32_t v);
+
+  /**
+   * @brief Remove an edge from the graph until the next ClearRemoved ().
+   * @param e the edge
+   */
+  void RemoveEdge (uint32_t e);
+
+  /**
+   * @param v a vertex
+   * @returns true if \a v is currently removed
+   */
+  bool IsVertexRemoved (uint32_t v) const;
+
+  /**
+   * @param e an edge
+   * @returns true if \a e is currently removed
+   */
+  bool IsEdgeRemoved (uint32_t e) const;
+
+  /**
+   * @brief Start a new shortest path search: every vertex becomes unreached.
+   */
+  void NewSearch (void);
+
+  /**
+   * @param v a vertex
+   * @returns true if the current search has reached \a v
+   */
+  bool IsReached (uint32_t v) const;
+
+  /**
+   * @brief Record a tentative distance and the edge it was reached through.
+   * @param v the vertex
+   * @param distance the distance from the search source
+   * @param edge the last edge of the path, or -1 at the source
+   */
+  void Reach (uint32_t v, uint32_t distance, int32_t edge);
+
+  std::vector<uint32_t> m_distance;   //!< distance of each reached vertex
+  std::vector<int32_t> m_predEdge;    //!< last edge of the best path to each reached vertex
+  std::vector<uint8_t> m_done;        //!< settled flags of reached vertices
+  std::vector<std::pair<uint32_t, uint32_t> > m_heap; //!< (distance, vertex) min-heap
+  std::vector<DSRRouteRecord>* m_routes; //!< output of the current job
+
+private:
+  std::vector<uint32_t> m_vertexRemoved; //!< removal stamp of each vertex
+  std::vector<uint32_t> m_edgeRemoved;   //!< removal stamp of each edge
+  uint32_t m_removal;                    //!< current removal stamp
+  std::vector<uint32_t> m_reached;       //!< search stamp of each vertex
+  uint32_t m_search;                     //!< current search stamp
+};
 
 /**
- * @brief Set all LSA flags to an initialized state, for SPF computation
- *
- * This function walks the database and resets the status flags of all of the
- * contained Link State Advertisements to LSA_SPF_NOT_EXPLORED.  This is done
- * prior to each SPF calculation to reset the state of the DSRVertex structures
- * that will reference the LSAs during the calculation.
- *
- * @see DSRRoutingLSA
- * @see DSRVertex
+ * @brief Distances between every pair of vertices of a DSRGraphSnapshot.
+ *
+ * Every transit link of a router queues one SPF job, rooted at the far end
+ * of the link, so on a dense graph each vertex is the root of many jobs and
+ * Dijkstra searches the same tree again for each of them.  The matrix is
+ * filled once by a blocked Floyd-Warshall instead: the rows are padded to a
+ * whole number of TILE x TILE tiles, and each relaxation is a min-plus
+ * product of three tiles that fit in the cache together, over contiguous
+ * rows that the compiler vectorises.
+ *
+ * Cells hold distances below INFINITY_CELL, so that the sum of two never
+ * overflows; Fits () tells whether the longest possible path of a snapshot
+ * stays below it.
  */
-  void Initialize ();
+class DSRDistanceMatrix
+{
+public:
+  /**
+   * @enum Backend
+   * @brief How the SPF jobs get their shortest path trees.
+   */
+  enum Backend
+  {
+    AutoBackend,     /**< the matrix for small dense graphs, Dijkstra otherwise */
+    DijkstraBackend, /**< one Dijkstra search per SPF job */
+    MatrixBackend    /**< one distance matrix shared by all the SPF jobs */
+  };
+
+  static const uint32_t TILE = 64;                   //!< side of a tile, in cells
+  static const uint32_t INFINITY_CELL = 0x3fffffff;  //!< cell value of an unreachable vertex
+
+  DSRDistanceMatrix ();
+
+  /**
+   * @param g a graph snapshot
+   * @returns true if no distance of \a g can reach INFINITY_CELL
+   */
+  static bool Fits (const DSRGraphSnapshot& g);
+
+  /**
+   * @brief Size the matrix for a snapshot and fill in its edges.
+   *
+   * Each cell gets the smallest metric of the edges between its two
+   * vertices, 0 on the diagonal and INFINITY_CELL elsewhere.
+   *
+   * @param g the snapshot, for which Fits () holds
+   */
+  void Initialize (const DSRGraphSnapshot& g);
+
+  /**
+   * @brief Release the cells
+   */
+  void Clear (void);
+
+  /**
+   * @returns the number of tiles along each side of the matrix
+   */
+  uint32_t GetNTiles (void) const;
 
   /**
-   * @brief Look up the External Link State Advertisement associated with the given
-   * index.
+   * @brief Relax the paths of tile (i, j) through the vertices of tile k.
    *
-   * The external database map is searched for the given index and corresponding
-   * DSRRoutingLSA is returned.
+   * Tile (i, j) becomes min (C(i, j), C(i, k) + C(k, j)) in the min-plus
+   * sense, one vertex of tile k after the other, so the tiles may be the
+   * same: the three steps of round k of the blocked Floyd-Warshall are
+   * RelaxTile (k, k, k), then the other tiles of row and column k, then
+   * all the others, which only read row and column k.
    *
-   * @see DSRRoutingLSA
-   * @param index the index associated with the LSA.
-   * @returns A pointer to the Link State Advertisement.
+   * @param i the tile row
+   * @param j the tile column
+   * @param k the tile of the intermediate vertices
    */
-  DSRRoutingLSA* GetExtLSA (uint32_t index) const;
+  void RelaxTile (uint32_t i, uint32_t j, uint32_t k);
+
   /**
-   * @brief Get the number of External Link State Advertisements.
-   *
-   * @see DSRRoutingLSA
-   * @returns the number of External Link State Advertisements.
+   * @param from a vertex
+   * @param to a vertex
+   * @returns the distance from \a from to \a to, or DISTINFINITY
    */
-  uint32_t GetNumExtLSAs () const;
-
+  uint32_t Get (uint32_t from, uint32_t to) const;
 
 private:
-  typedef std::map<Ipv4Address, DSRRoutingLSA*> LSDBMap_t; //!< container of IPv4 addresses / Link State Advertisements
-  typedef std::pair<Ipv4Address, DSRRoutingLSA*> LSDBPair_t; //!< pair of IPv4 addresses / Link State Advertisements
-
-  LSDBMap_t m_database; //!< database of IPv4 addresses / Link State Advertisements
-  std::vector<DSRRoutingLSA*> m_extdatabase; //!< database of External Link State Advertisements
-
-/**
- * @brief DSRRouteManagerLSDB copy construction is disallowed.  There's no 
- * need for it and a compiler provided shallow copy would be wrong.
- * @param lsdb object to copy from
- */
-  DSRRouteManagerLSDB (DSRRouteManagerLSDB& lsdb);
+  uint32_t m_nVertices;          //!< vertices of the snapshot
+  uint32_t m_stride;             //!< cells per row, a multiple of TILE
+  std::vector<uint32_t> m_cells; //!< the distances, row by row
+};
 
 /**
- * @brief The DSRVertex copy assignment operator is disallowed.  There's no 
- * need for it and a compiler provided shallow copy would be wrong.
- * @param lsdb object to copy from
- * @returns the copied object
+ * @brief The shortest path tree of one SPF root, read off a DSRDistanceMatrix.
+ *
+ * The jobs rooted at a vertex differ only in the initial node that gets the
+ * routes and the distance they start at, so the tree is derived once per
+ * root and each job then replays it instead of searching the graph.
+ * Vertex m_order[i] has its parents at [m_parentStart[i],
+ * m_parentStart[i+1]) in m_parents and its root exits at [m_exitStart[i],
+ * m_exitStart[i+1]) in m_exits.
  */
-  DSRRouteManagerLSDB& operator= (DSRRouteManagerLSDB& lsdb);
+struct DSRSPFTree
+{
+  std::vector<uint32_t> m_order;       //!< vertices reached from the root, except the root, in the order they join the tree
+  std::vector<uint32_t> m_distance;    //!< distance of each vertex of m_order from the root
+  std::vector<uint32_t> m_parentStart; //!< first parent of each vertex of m_order, plus an end sentinel
+  std::vector<uint32_t> m_parents;     //!< parents of the vertices
+  std::vector<uint32_t> m_exitStart;   //!< first root exit of each vertex of m_order, plus an end sentinel
+  std::vector<DSRGraphSnapshot::Exit_t> m_exits; //!< root exits of the vertices
 };
 
 /**
- * @brief The Neighbor State DataBase (NSDB) of the DSR Route Manager.
+ * @brief Worker threads shared by the parallel steps of one computation.
  *
- * Each node in the simulation participating in the DSR rouring has a
- * list of DSRRouter interface. the NSDB will maintain the neighbor 
- * state information by pair of <IPv4Address, NetDevice *>
+ * The threads are started once, when the pool is created, and then run
+ * every range of jobs handed to Run () until the pool is destroyed, so a
+ * computation made of many batches or rounds does not create threads for
+ * each of them.  The calling thread takes part as worker 0.
  */
-class DSRRouteManagerNSDB
+class DSRWorkerPool
 {
-  public:
-  /**
-   * @brief Construct an empty DSR Router Manager Neighbor State Database.
-   *
-   * The database map composing the Neighbor State Database is initialized in
-   * this constructor.
-   */
-  DSRRouteManagerNSDB ();
+public:
+  /// A job: the job index, then the worker running it
+  typedef std::function<void (uint32_t, uint32_t)> Job_t;
 
   /**
-   * @brief Destroy an empty DSR Router Manager Neighbor State Database.
-   *
-   * The database map is walked and all of the Neighbor State Advertisements stored
-   * in the database are freed; then the database map itself is clear ()ed to
-   * release any remaining resources.
+   * @param nThreads the number of workers, including the calling thread
    */
-  ~DSRRouteManagerNSDB ();
+  DSRWorkerPool (uint32_t nThreads);
+  ~DSRWorkerPool ();
 
   /**
-   * @brief Insert an IP address / NetDevice* pair into the Link
-   * State Database.
-   *
-   * The IPV4 address and the NetDevice* given as parameters are converted
-   * to an STL pair and are inserted into the database map.
-   *
-   * @see NetDevice
-   * @see Ipv4Address
-   * @param addr The IP address associated with the LSA.  Typically the Router 
-   * ID.
-   * @param netDev A pointer to the Link State Advertisement for the router.
+   * @returns the number of workers, including the calling thread
    */
-  void Insert (Ipv4Address addr, NetDevice* netDev);
+  uint32_t GetNThreads (void) const;
 
   /**
-   * @brief Look up the NetDevice* associated with the given
-   * link state ID (address).
+   * @brief Run job (k, worker) for every k in [begin, end), and wait for
+   * all of them.
    *
-   * The database map is searched for the given IPV4 address and corresponding
-   * NetDevice* is returned.
+   * Jobs are handed out to the workers in increasing order; with a single
+   * worker or a single job they run inline on the caller.
    *
-   * @see NetDevice
-   * @see Ipv4Address
-   * @param addr The IP address associated with the LSA.  Typically the Router 
-   * ID.
-   * @returns A pointer to the NetDevice for the router specified
-   * by the IP address addr.
+   * @param begin first job index
+   * @param end one past the last job index
+   * @param job the function to run
    */
-  NetDevice* GetNetDevice (Ipv4Address addr) const;
+  void Run (uint32_t begin, uint32_t end, const Job_t& job);
+
+private:
+  DSRWorkerPool (const DSRWorkerPool&);
+  DSRWorkerPool& operator= (const DSRWorkerPool&);
 
   /**
-   * @brief This function will build up the NetDevice list for all the node installed
-   * DSRRouter
+   * @brief Run the jobs of the current range until none is left.
+   * @param worker the worker
    */
-  void Initialize ();
+  void Drain (uint32_t worker);
 
   /**
-   * @brief Get the number of NetDevices.
-   *
-   * @see DSRRoutingLSA
-   * @returns the number of External Link State Advertisements.
+   * @brief Body of a worker thread: wait for a range and drain it.
+   * @param worker the worker
    */
-  uint32_t GetNumNetDevices () const;
-  private:
-  typedef std::map<Ipv4Address, NetDevice*> NSDBMap_t; //!< container of IPv4 addresses / Pointer of NetDevice
-  typedef std::pair<Ipv4Address, NetDevice*> NSDBPair_t; //!< pair of IPv4 addresses / Pointer of NetDevice
-
-  NSDBMap_t m_neighborstatedatabase; //!< database of IPv4 addresses / Link State Advertisements
-  
-/**
- * @brief DSRRouteManagerLSDB copy construction is disallowed.  There's no 
- * need for it and a compiler provided shallow copy would be wrong.
- * @param nsdb object to copy from
- */
-  DSRRouteManagerNSDB (DSRRouteManagerNSDB& nsdb);
-
-/**
- * @param nsdb object to copy from
- * @returns the copied object
- */
-  DSRRouteManagerNSDB& operator= (DSRRouteManagerNSDB& nsdb);
+  void Work (uint32_t worker);
+
+  uint32_t m_nThreads;                //!< workers, including the calling thread
+  std::vector<std::thread> m_threads; //!< workers 1 to m_nThreads - 1
+  std::mutex m_mutex;                 //!< guards the members below
+  std::condition_variable m_start;    //!< signalled when a range is posted or the pool stops
+  std::condition_variable m_finish;   //!< signalled when a worker has drained the range
+  const Job_t* m_job;                 //!< job of the current range
+  std::atomic<uint32_t> m_next;       //!< next job index of the current range
+  uint32_t m_end;                     //!< end of the current range
+  uint64_t m_round;                   //!< number of ranges posted
+  uint32_t m_busy;                    //!< worker threads still draining the current range
+  bool m_stop;                        //!< set to make the workers exit
 };
 
-
 /**
  * @brief A global router implementation.
  *
@@ -818,6 +1238,9 @@ public:
 /**
  * @brief Build the routing database by gathering Link State Advertisements
  * from each node exporting a DSRRouter interface.
+ *
+ * In a distributed simulation each rank only discovers the LSAs of its own
+ * nodes and the ranks then exchange them, so every rank must call it.
  */
   virtual void BuildDSRRoutingDatabase ();
 
@@ -827,17 +1250,172 @@ public:
  */
   virtual void InitializeRoutes ();
 
+/**
+ * @brief Rebuild the routing database and recompute every route
+ *
+ * Same routes as DeleteDSRRoutes (), BuildDSRRoutingDatabase () and
+ * InitializeRoutes (), but the installed tables are not emptied first: the
+ * new routes are compared with them and only the differences are applied
+ * (see GetRouteComputationStats () for the churn of each node).
+ */
+  virtual void RecomputeRoutes ();
+
+/**
+ * @brief Bring the routes up to date after a link or address change
+ *
+ * Rebuilds the routing database and compares it with the one the installed
+ * routes were computed from.  Only the SPF computations whose shortest path
+ * tree a changed link state can alter are run again, and only the tables
+ * of the nodes whose routes differ are rewritten.  Routes to the addresses
+ * of a link that disappeared are removed in place.  Falls back to
+ * recomputing every route when the set of LSAs or of external routes
+ * changed, or unless DsrIncrementalRouting is enabled (it is off by
+ * default, since the state it keeps grows with the square of the number of
+ * routers).
+ */
+  virtual void UpdateRoutes ();
+
+/**
+ * @brief Schedule an UpdateRoutes () for an interface event
+ *
+ * Interface events rarely come alone: a node failure takes down the
+ * interfaces of all its neighbours in the same instant.  The update runs
+ * DsrSpfDelay after the first event, as a simulator event, and serves every
+ * event received until then.  As with the SPF throttling of OSPF routers,
+ * an event within the hold time of the previous update waits for the hold
+ * time to expire, and the hold time doubles, up to DsrSpfMaxHoldTime, for
+ * as long as the events keep coming that fast.  The first event after the
+ * hold time expired brings it back to DsrSpfHoldTime.
+ */
+  void ScheduleUpdateRoutes ();
+
+/**
+ * @brief Add an address range to an area
+ *
+ * Routers of other areas (see the AreaId attribute of DSRRouter) reach the
+ * addresses and networks of the area that fall in one of its ranges through
+ * one summary route per range and per neighbour, instead of one route per
+ * address and per neighbour; the SPF runs that reach the area install the
+ * summary with the distance of the farthest destination it replaces, so a
+ * delay budget that fits the summary fits every destination behind it.
+ * Within an area, and for addresses outside the ranges, such as those of
+ * links between areas, routes are computed as without areas.  A range must
+ * only hold addresses of its area.  Takes effect at the next
+ * BuildDSRRoutingDatabase ().
+ *
+ * @param area the area ID
+ * @param network the network number of the range
+ * @param mask the network mask of the range
+ */
+  void AddAreaRange (uint32_t area, Ipv4Address network, Ipv4Mask mask);
+
+/**
+ * @brief Compute the routes to a router the first time they are needed
+ *
+ * With DsrLazyRouting, InitializeRoutes () only installs the routes that
+ * need no SPF run: the host routes to the neighbours, the default routes
+ * of stub routers and the best-effort table.  The first lookup of an
+ * address of another router calls this method, which runs one SPF from
+ * the router over the reversed edges.  Its distances give, for every
+ * SPF job of the eager computation, the distance of the node route that
+ * job would have installed, so every local router gets the same routes
+ * to the destination as without DsrLazyRouting.  The routers computed
+ * this way are remembered, and recomputed by the next InitializeRoutes ()
+ * or RecomputeRoutes () until DeleteDSRRoutes ().
+ *
+ * Routes to networks, area summaries and ranked alternative routes are
+ * not computed lazily: without DsrLazyRouting, with DsrKShortestPaths
+ * above 1, with area ranges, or for the in-band protocol, this method
+ * does nothing.  An address in a stub, transit or external network of the
+ * snapshot rather than on a point-to-point link falls back to the eager
+ * computation: every route is computed, and DsrLazyRouting is ignored
+ * until ClearRoutingDatabase ().
+ *
+ * @param address an address of the destination router, or in a network
+ * @returns true if the routes were computed by this call
+ */
+  bool ComputeRoutesTo (Ipv4Address address);
+
 /**
  * @brief Debugging routine; allow client code to supply a pre-built LSDB
  */
   void DebugUseLsdb (DSRRouteManagerLSDB*);
 
+/**
+ * @brief Compute the routes of one node from the LSDB that node has learned
+ *
+ * Used by the in-band link-state protocol (DSRLinkStateProtocol), where each
+ * router owns its own DSRRouteManagerImpl.  The LSDB may be incomplete while
+ * the protocol converges; links that are only advertised by one side must
+ * already be left out.  From this call on, this object only routes for
+ * @p nodeId.
+ *
+ * @param lsdb the LSDB; ownership is taken
+ * @param nodeId the node whose routing table is rewritten
+ */
+  void ComputeNodeRoutes (DSRRouteManagerLSDB* lsdb, uint32_t nodeId);
+
+/**
+ * @brief Get the timers and counters of the last route computation
+ * @returns the statistics of the last BuildDSRRoutingDatabase () and
+ * InitializeRoutes () or UpdateRoutes () calls
+ */
+  const DSRRouteComputationStats& GetRouteComputationStats (void) const;
+
+/**
+ * @brief Hash the topology of the last BuildDSRRoutingDatabase () call
+ *
+ * Covers the LSDB and the global values that change the computed routes,
+ * so that equal hashes mean equal routing tables.
+ *
+ * @returns a 64-bit hash of the topology
+ */
+  uint64_t GetTopologyHash (void) const;
+
 /**
  * @brief Debugging routine; call the core SPF from the unit tests
  * @param root the root node to start calculations
  */
   void DebugSPFCalculate (Ipv4Address root);
 
+/**
+ * @brief Debugging routine; call the K shortest paths engine from the unit
+ * tests, on the snapshot of the last BuildDSRRoutingDatabase ()
+ * @param source the router ID of the first router
+ * @param target the router ID of the last router
+ * @param k the largest number of paths wanted
+ * @param paths set to the paths found, shortest first; empty if either
+ * router is unknown
+ */
+  void DebugKShortestPaths (Ipv4Address source, Ipv4Address target, uint32_t k, std::vector<DSRPath>& paths) const;
+
+/**
+ * @brief Append the LSAs of some nodes to the buffer ExchangeLSAs () sends
+ * to the other ranks
+ *
+ * Each node with LSAs is written as its ID, its number of LSAs and its LSAs,
+ * all in 32-bit words.
+ *
+ * @param byNode the LSAs of each node, by node ID
+ * @param buffer the buffer the LSAs are appended to
+ * @returns the number of LSAs packed
+ */
+  static uint32_t PackLSAs (const std::vector<std::vector<DSRRoutingLSA*> >& byNode,
+                            std::vector<uint32_t>& buffer);
+
+/**
+ * @brief Read the LSAs written by PackLSAs ()
+ * @param buffer the buffer
+ * @param begin the offset of the first word written by PackLSAs ()
+ * @param end the offset past the last word written by PackLSAs ()
+ * @param byNode the LSAs of each node, by node ID; each LSA read is a new
+ * one, holding one reference, appended to the list of its node, which must
+ * be empty
+ * @returns the number of LSAs read
+ */
+  static uint32_t UnpackLSAs (const std::vector<uint32_t>& buffer, uint32_t begin, uint32_t end,
+                              std::vector<std::vector<DSRRoutingLSA*> >& byNode);
+
 private:
 /**
  * @brief DSRRouteManagerImpl copy construction is disallowed.
@@ -858,50 +1436,382 @@ private:
  */
   DSRRouteManagerImpl& operator= (DSRRouteManagerImpl& srmi);
 
-  DSRVertex* m_spfroot; //!< the root node
   DSRRouteManagerLSDB* m_lsdb; //!< the Link State DataBase (LSDB) of the Global Route Manager
+  DSRGraphSnapshot m_graph;    //!< flat view of m_lsdb the SPF runs work on
+  DSRGraphSnapshot::AreaRanges_t m_areaRanges; //!< address ranges of the areas, by area ID
+  DSRRouteComputationStats m_stats; //!< counters of the last route computation
+
+  /**
+   * \brief One SPF computation queued by InitializeRoutes.
+   *
+   * For every point-to-point link of a router, DSR runs SPF rooted at the
+   * neighbour across that link and stores the resulting distances in the
+   * router's own table.
+   */
+  struct SPFJob
+  {
+    uint32_t m_rootIndex;               //!< vertex of the SPF root (the neighbour)
+    uint32_t m_sourceIndex;             //!< vertex of the initial node
+    uint32_t m_initNodeId;              //!< node that receives the host routes
+    uint32_t m_distance;                //!< distance of the root from the initial node
+    uint32_t m_nextHop;                 //!< next hop of the host routes
+    uint32_t m_interface;               //!< outgoing interface of the initial node
+    uint32_t m_nHostRoutes;             //!< leading routes to the addresses of the root
+    uint32_t m_area;                    //!< area index of the initial node
+    std::vector<uint32_t>* m_distances; //!< where the run stores its distances, or 0
+    std::vector<DSRRouteRecord> m_routes; //!< routes produced, in installation order
+  };
+
+  /**
+   * \brief A computation rooted at one local router: its best-effort
+   * routes, or its K-shortest paths.
+   */
+  struct RouterJob
+  {
+    uint32_t m_sourceIndex;               //!< vertex of the local router
+    uint32_t m_nodeId;                    //!< node that receives the routes
+    std::vector<DSRRouteRecord> m_routes; //!< routes produced, in installation order
+  };
+
+  /// New routes of each node, by node ID, in installation order
+  typedef std::vector<std::vector<DSRRouteRecord> > StagedRoutes_t;
+
+  std::vector<SPFJob> m_jobs; //!< computations behind the installed routes, with their routes
+  /**
+   * Distance of every vertex from each SPF root, relative to the root and
+   * DISTINFINITY for vertices the run did not reach; empty for vertices that
+   * are not the root of any job.
+   */
+  std::vector<std::vector<uint32_t> > m_rootDistances;
+  std::vector<RouterJob> m_bestEffortJobs; //!< best-effort computations behind the installed routes
+  bool m_jobsValid;           //!< whether m_jobs and m_rootDistances describe the installed routes
+  bool m_singleNode;          //!< whether only m_routedNode gets routes (ComputeNodeRoutes)
+  uint32_t m_routedNode;      //!< the node routed for when m_singleNode is set
+
+  bool m_lazyReady;           //!< whether m_jobs holds the jobs of the lazy routes
+  bool m_lazyFallback;        //!< whether a network destination turned DsrLazyRouting off
+  std::set<uint32_t> m_lazyRouters; //!< router IDs whose routes were computed on demand
+  Ptr<DSRNodeAddressMap> m_nodeAddresses; //!< router of each point-to-point address of the snapshot
+  DSRSPFWorkspace m_lazyWorkspace; //!< workspace of the on-demand SPF runs
+
+  EventId m_updateEvent;      //!< update scheduled by ScheduleUpdateRoutes ()
+  Time m_lastUpdate;          //!< when the last scheduled update ran
+  Time m_holdTime;            //!< current hold time after a scheduled update
+  uint32_t m_scheduledUpdates; //!< scheduled updates run
+  uint32_t m_pendingEvents;   //!< interface events the scheduled update will serve
+
+  /**
+   * \brief Run the update scheduled by ScheduleUpdateRoutes ()
+   */
+  void RunScheduledUpdate (void);
+
+  /**
+   * \brief Whether the routes of a node are computed here
+   *
+   * \param node the node
+   * \returns true for the node of ComputeNodeRoutes (), or else for the
+   * nodes of this rank
+   */
+  bool IsRoutedNode (Ptr<Node> node) const;
+
+  /**
+   * \brief Queue the SPF computations of every local router
+   *
+   * \param jobs set to one computation per transit link, in installation order
+   * \param routerJobs set to one computation per local router
+   * \param tables set to the routing protocol of each node, by node ID
+   */
+  void CollectSPFJobs (std::vector<SPFJob>& jobs, std::vector<RouterJob>& routerJobs,
+                       std::vector<Ptr<Ipv4DSRRouting> >& tables) const;
+
+  /**
+   * \brief Size the per-thread SPF workspaces and select their queue
+   *
+   * \param workspaces the workspaces, one per thread
+   */
+  void InitializeWorkspaces (std::vector<DSRSPFWorkspace>& workspaces) const;
+
+  /**
+   * \brief Add the arena and queue counters of the workspaces to m_stats
+   *
+   * \param workspaces the workspaces of the last computation
+   */
+  void CountWorkspaces (const std::vector<DSRSPFWorkspace>& workspaces);
+
+  /**
+   * \brief Record the size of every routing table in m_stats
+   *
+   * \param tables the routing protocol of each node, by node ID
+   */
+  void CountRoutes (const std::vector<Ptr<Ipv4DSRRouting> >& tables);
+
+  /**
+   * \brief Reset the counters of m_stats that describe a route computation,
+   * keeping those of BuildDSRRoutingDatabase ()
+   */
+  void ResetComputationStats (void);
+
+  /**
+   * \brief Send the LSAs of the local nodes to every other rank of a
+   * distributed simulation and receive theirs
+   *
+   * A collective operation; does nothing unless built with MPI.  The LSAs
+   * travel as written by PackLSAs () and are read by UnpackLSAs ().
+   *
+   * \param byNode the LSAs discovered by each node, by node ID; the LSAs
+   * of the local nodes on input, those of every node on output, each
+   * holding one reference for DSRRouteManagerLSDB::Insert ()
+   */
+  void ExchangeLSAs (std::vector<std::vector<DSRRoutingLSA*> >& byNode);
+
+  /**
+   * \brief Save the distances of a finished SPF run to job.m_distances
+   *
+   * \param ws the workspace of the run
+   * \param job the computation that ran
+   */
+  void SaveDistances (const DSRSPFWorkspace& ws, const SPFJob& job) const;
+
+  /**
+   * \brief Set the round trip of the routes of a finished SPF run to its
+   * initial node
+   *
+   * The round trip is the distance of the root from the initial node plus
+   * the distance the run found back to it, and lets Ipv4DSRRouting tell the
+   * loop-free alternates among the routes of a destination.
+   *
+   * \param ws the workspace of the run
+   * \param job the computation that ran
+   */
+  void SetRoundTrips (const DSRSPFWorkspace& ws, SPFJob& job) const;
+
+  /**
+   * \brief Rerun the SPF computations a change of the snapshot affects
+   *
+   * \param previous the snapshot the installed routes were computed from
+   * \returns false if the change cannot be applied incrementally and every
+   * route must be recomputed
+   */
+  bool ApplyGraphChange (const DSRGraphSnapshot& previous);
+
+  /**
+   * \brief Remove every route of a routing table
+   *
+   * \param table the routing protocol of a node
+   */
+  void DeleteRoutes (Ptr<Ipv4DSRRouting> table) const;
+
+  /**
+   * \brief Get the number of threads used for route computation
+   *
+   * Reads the DsrRouteComputationThreads global value; zero means one
+   * thread per hardware thread.
+   *
+   * \returns the number of threads
+   */
+  uint32_t GetComputationThreads (void) const;
+
+  /**
+   * \brief Sort routes recorded by SPF runs by the node that gets them
+   *
+   * \param routes the recorded routes, in installation order
+   * \param tables the routing protocol of each node, by node ID; the
+   * routes of nodes without one are dropped
+   * \param staged the routes of each node, appended to
+   * \param nodes if not 0, only the routes of the nodes flagged in it are
+   * staged
+   */
+  void StageRoutes (const std::vector<DSRRouteRecord>& routes,
+                    const std::vector<Ptr<Ipv4DSRRouting> >& tables,
+                    StagedRoutes_t& staged,
+                    const std::vector<uint8_t>* nodes = 0) const;
+
+  /**
+   * \brief Replace the routing tables with the staged routes
+   *
+   * The table of each node gets exactly the routes staged for it, in
+   * staging order, but Ipv4DSRRouting::ApplyRoutes () only inserts, removes
+   * or updates the routes that differ from the installed ones.  The changes
+   * are added to the statistics.
+   *
+   * \param tables the routing protocol of each node, by node ID
+   * \param staged the routes staged for each node, released on return
+   * \param nodes if not 0, only the tables of the nodes flagged in it are
+   * replaced
+   */
+  void ApplyStagedRoutes (const std::vector<Ptr<Ipv4DSRRouting> >& tables,
+                          StagedRoutes_t& staged,
+                          const std::vector<uint8_t>* nodes = 0);
+
+  /**
+   * \brief Forget the routing database and the kept SPF results
+   */
+  void ClearRoutingDatabase ();
+
+  /**
+   * \brief Hand the point-to-point addresses of the routers of the snapshot
+   * to the routing tables of the local routers, for their node routes
+   */
+  void InstallNodeAddresses ();
+
+  /**
+   * \brief Whether the routes to routers are computed on demand
+   *
+   * \returns true if DsrLazyRouting is set and applies to the current
+   * settings (see ComputeRoutesTo ())
+   */
+  bool IsLazy (void) const;
+
+  /**
+   * \brief Whether an address is in a network the SPF runs install routes
+   * to, which the lazy computation does not
+   * \param address the address
+   * \returns true if \p address is in a stub network, a transit network or
+   * an external network of the snapshot
+   */
+  bool IsNetworkDestination (Ipv4Address address) const;
+
+  /**
+   * \brief Queue the SPF jobs of the lazy computation
+   *
+   * The jobs are those of CollectSPFJobs (), but only their stub test runs:
+   * the jobs rooted at a stub router get their default route and are
+   * dropped, the others are kept in m_jobs without routes.
+   *
+   * \param tables set to the routing protocol of each node, by node ID
+   * \param routerJobs set to one computation per local router
+   * \param routes set to the routes of the jobs that need no SPF run, in
+   * installation order
+   */
+  void CollectLazyJobs (std::vector<Ptr<Ipv4DSRRouting> >& tables,
+                        std::vector<RouterJob>& routerJobs,
+                        std::vector<DSRRouteRecord>& routes);
+
+  /**
+   * \brief InitializeRoutes () with DsrLazyRouting
+   *
+   * Installs the routes that need no SPF run, the best-effort table, and
+   * the routes to the routers already computed on demand.
+   */
+  void InitializeLazyRoutes ();
+
+  /**
+   * \brief Calculate the distance of every vertex to one vertex
+   *
+   * Dijkstra over the edges of the snapshot taken backwards.  The vertices
+   * that reach \a dest end in the SPF tree, at their distance to it.
+   *
+   * \param ws the SPF workspace
+   * \param dest the vertex
+   */
+  void ReverseSPFCalculate (DSRSPFWorkspace& ws, uint32_t dest) const;
+
+  /**
+   * \brief Add the node routes of every job of m_jobs to a router
+   *
+   * The job rooted at neighbour W of the initial node V reaches the router
+   * at the distance of the link back from W to V plus the distance from W
+   * to the router, which ReverseSPFCalculate () gives for every W at once.
+   *
+   * \param ws the SPF workspace
+   * \param dest the vertex of the router
+   * \param routes the routes, appended to in job order
+   */
+  void LazyCalculate (DSRSPFWorkspace& ws, uint32_t dest, std::vector<DSRRouteRecord>& routes) const;
 
   /**
-   * \brief Test if a node is a stub, from an OSPF sense.
+   * \brief Test if the SPF root is a stub, from an OSPF sense.
    *
    * If there is only one link of type 1 or 2, then a default route
    * can safely be added to the next-hop router and SPF does not need
    * to be run
    *
-   * \param root the root node
+   * \param ws the SPF workspace, whose root is tested
    * \returns true if the node is a stub
    */
-  bool CheckForStubNode (Ipv4Address root);
+  bool CheckForStubNode (DSRSPFWorkspace& ws) const;
 
   /**
    * \brief Calculate the shortest path first (SPF) tree
    *
-   * Equivalent to quagga ospf_spf_calculate
-   * \param root the root node
+   * Equivalent to quagga ospf_spf_calculate.  This method only reads the
+   * snapshot; all of its state lives in \a ws, so several instances may run
+   * concurrently on different workspaces.
+   *
+   * \param ws the SPF workspace of the calling thread
+   * \param job the computation to run; routes are appended to it
+   */
+  void SPFCalculate (DSRSPFWorkspace& ws, SPFJob& job) const;
+
+  /**
+   * \brief Whether the SPF jobs should replay trees of a distance matrix
+   *
+   * Reads the DsrSpfBackend global value.  AutoBackend picks the matrix
+   * when Floyd-Warshall over the whole snapshot costs less than the edges
+   * the Dijkstra searches of the jobs would scan.
+   *
+   * \param nJobs the number of SPF jobs
+   * \returns true to use a DSRDistanceMatrix
+   */
+  bool UseDistanceMatrix (uint32_t nJobs) const;
+
+  /**
+   * \brief Fill a distance matrix with the blocked Floyd-Warshall
+   *
+   * \param matrix the matrix
+   * \param workers the threads relaxing the tiles of a round
+   */
+  void ComputeDistanceMatrix (DSRDistanceMatrix& matrix, DSRWorkerPool& workers) const;
+
+  /**
+   * \brief Derive the shortest path tree of a root from a distance matrix
+   *
+   * Runs SPFNext () over the edges that lie on a shortest path only, so
+   * every vertex is queued once.  The vertices join the tree in the order,
+   * and with the parents and exits, that SPFCalculate () gives them, and
+   * the replayed jobs install the same routes in the same order.
+   *
+   * \param ws the SPF workspace of the calling thread
+   * \param matrix the distance matrix
+   * \param root the vertex at the root
+   * \param tree where the tree is stored
+   */
+  void MatrixTree (DSRSPFWorkspace& ws, const DSRDistanceMatrix& matrix, uint32_t root,
+                   DSRSPFTree& tree) const;
+
+  /**
+   * \brief Run an SPF job by replaying the tree of its root
+   *
+   * Does what SPFCalculate () does, with the vertices taken from \a tree
+   * instead of the candidate queue.
+   *
+   * \param ws the SPF workspace of the calling thread
+   * \param tree the tree of the root of \a job
+   * \param job the computation to run; routes are appended to it
    */
-  void SPFCalculate (Ipv4Address root, Ipv4Address initroot, DSRRoutingLinkRecord *l, uint32_t Iface);
+  void MatrixCalculate (DSRSPFWorkspace& ws, const DSRSPFTree& tree, SPFJob& job) const;
 
   /**
    * \brief Process Stub nodes
    *
    * Processing logic from RFC 2328, page 166 and quagga ospf_spf_process_stubs ()
    * stub link records will exist for point-to-point interfaces and for
-   * broadcast interfaces for which no neighboring router can be found
+   * broadcast interfaces for which no neighboring router can be found.
+   * The SPF tree is walked depth first from the root.
    *
-   * \param v vertex to be processed
+   * \param ws the SPF workspace
    */
-  void SPFProcessStubs (DSRVertex* v);
+  void SPFProcessStubs (DSRSPFWorkspace& ws) const;
 
   /**
    * \brief Process Autonomous Systems (AS) External LSA
    *
-   * \param v vertex to be processed
-   * \param extlsa external LSA
+   * \param ws the SPF workspace
    */
-  void ProcessASExternals (DSRVertex* v, DSRRoutingLSA* extlsa);
+  void ProcessASExternals (DSRSPFWorkspace& ws) const;
 
   /**
-   * \brief Examine the links in v's LSA and update the list of candidates with any
+   * \brief Examine the edges of v and update the list of candidates with any
    *        vertices not already on the list
    *
    * \internal
@@ -910,134 +1820,173 @@ private:
    * 16.1 (2) for further details.
    *
    * We're passed a parameter \a v that is a vertex which is already in the SPF
-   * tree.  A vertex represents a router node.  We also get a reference to the
-   * SPF candidate queue, which is a priority queue containing the shortest paths
-   * to the networks we know about.
-   *
-   * We examine the links in v's LSA and update the list of candidates with any
-   * vertices not already on the list.  If a lower-cost path is found to a
+   * tree.  We examine the edges of v and update the candidate queue of \a ws
+   * with any vertices not already on it.  If a lower-cost path is found to a
    * vertex already on the candidate list, store the new (lower) cost.
    *
+   * \param ws the SPF workspace
    * \param v the vertex
-   * \param candidate the SPF candidate queue
    */
-  void SPFNext (DSRVertex* v, DsrCandidateQueue& candidate);
+  void SPFNext (DSRSPFWorkspace& ws, uint32_t v) const;
 
   /**
    * \brief Calculate nexthop from root through V (parent) to vertex W (destination)
-   *        with given distance from root->W.
    *
    * This method is derived from quagga ospf_nexthop_calculation() 16.1.1.
    * For now, this is greatly simplified from the quagga code
    *
+   * \param ws the SPF workspace
    * \param v the parent
    * \param w the destination
-   * \param l the link record
-   * \param distance the target distance
-   * \returns 1 on success
+   * \param e the edge from \a v to \a w
+   * \param exits set to the root exits of \a w through \a v
    */
-  int SPFNexthopCalculation (DSRVertex* v, DSRVertex* w, 
-                             DSRRoutingLinkRecord* l, uint32_t distance);
+  void SPFNexthopCalculation (DSRSPFWorkspace& ws, uint32_t v, uint32_t w,
+                              uint32_t e, DSRSPFWorkspace::ExitList_t& exits) const;
 
   /**
    * \brief Adds a vertex to the list of children *in* each of its parents
    *
    * Derived from quagga ospf_vertex_add_parents ()
    *
-   * This is a somewhat oddly named method (blame quagga).  Although you might
-   * expect it to add a parent *to* something, it actually adds a vertex
-   * to the list of children *in* each of its parents.
-   *
-   * Given a pointer to a vertex, it links back to the vertex's parent that it
-   * already has set and adds itself to that vertex's list of children.
-   *
+   * \param ws the SPF workspace
    * \param v the vertex
    */
-  void DSRVertexAddParent (DSRVertex* v);
+  void DSRVertexAddParent (DSRSPFWorkspace& ws, uint32_t v) const;
 
   /**
-   * \brief Search for a link between two vertices.
-   *
-   * This method is derived from quagga ospf_get_next_link ()
+   * \brief Add a route to a router to the routing tables
    *
-   * First search the Global Router Link Records of vertex \a v for one
-   * representing a point-to point link to vertex \a w.
+   * This method is derived from quagga ospf_intra_add_router ()
    *
-   * What is done depends on prev_link.  Contrary to appearances, prev_link just
-   * acts as a flag here.  If prev_link is NULL, we return the first Global
-   * Router Link Record we find that describes a point-to-point link from \a v
-   * to \a w.  If prev_link is not NULL, we return a Global Router Link Record
-   * representing a possible *second* link from \a v to \a w.
+   * The vertex passed as a parameter has just been added to the SPF tree.
+   * For each of its point to point edges, the link data is the local IP
+   * address of the link.  These are the destination IP addresses,
+   * reachable from the initial node of the job, that a single node route
+   * to the router covers.  When some of them fall in a range of another
+   * area, the others get one host route each instead.
    *
-   * \param v first vertex
-   * \param w second vertex
-   * \param prev_link the previous link in the list
-   * \returns the link's record
+   * \param ws the SPF workspace
+   * \param v the vertex
+   * \param job the computation the vertex belongs to
    */
-  DSRRoutingLinkRecord* SPFGetNextLink (DSRVertex* v, DSRVertex* w, 
-                                           DSRRoutingLinkRecord* prev_link);
+  void SPFIntraAddRouter (DSRSPFWorkspace& ws, uint32_t v, const SPFJob& job) const;
 
   /**
-   * \brief Add a host route to the routing tables
-   *
+   * \brief Add the summary routes of the area ranges the run reached
    *
-   * This method is derived from quagga ospf_intra_add_router ()
-   *
-   * This is where we are actually going to add the host routes to the routing
-   * tables of the individual nodes.
-   *
-   * The vertex passed as a parameter has just been added to the SPF tree.
-   * This vertex must have a valid m_root_oid, corresponding to the outgoing
-   * interface on the root router of the tree that is the first hop on the path
-   * to the vertex.  The vertex must also have a next hop address, corresponding
-   * to the next hop on the path to the vertex.  The vertex has an m_lsa field
-   * that has some number of link records.  For each point to point link record,
-   * the m_linkData is the local IP address of the link.  This corresponds to
-   * a destination IP address, reachable from the root, to which we add a host
-   * route.
-   *
-   * \param v the vertex
+   * One route per range, through the job's link, at the distance of the
+   * farthest destination SPFIntraAddRouter () left to the range.
    *
+   * \param ws the SPF workspace
+   * \param job the computation
    */
-  void SPFIntraAddRouter (DSRVertex* v, DSRVertex* v_init, Ipv4Address nextHop,  uint32_t Iface);
+  void SPFAddSummaries (DSRSPFWorkspace& ws, const SPFJob& job) const;
 
   /**
    * \brief Add a transit to the routing tables
    *
+   * \param ws the SPF workspace
    * \param v the vertex
    */
-  void SPFIntraAddTransit (DSRVertex* v);
+  void SPFIntraAddTransit (DSRSPFWorkspace& ws, uint32_t v) const;
 
   /**
    * \brief Add a stub to the routing tables
    *
-   * \param l the global routing link record
+   * \param ws the SPF workspace
+   * \param stub the stub network, index into the snapshot's stub arrays
    * \param v the vertex
    */
-  void SPFIntraAddStub (DSRRoutingLinkRecord *l, DSRVertex* v);
+  void SPFIntraAddStub (DSRSPFWorkspace& ws, uint32_t stub, uint32_t v) const;
 
   /**
    * \brief Add an external route to the routing tables
    *
-   * \param extlsa the external LSA
+   * \param ws the SPF workspace
+   * \param ext the external LSA, index into the snapshot's external arrays
    * \param v the vertex
    */
-  void SPFAddASExternal (DSRRoutingLSA *extlsa, DSRVertex *v);
+  void SPFAddASExternal (DSRSPFWorkspace& ws, uint32_t ext, uint32_t v) const;
+
+  /**
+   * \brief Shortest path between two vertices, avoiding removed vertices
+   * and edges
+   *
+   * Plain Dijkstra over the snapshot, used by the spur searches of Yen's
+   * algorithm.  Ties are broken by vertex index so the result is
+   * deterministic.
+   *
+   * \param ws the K-shortest paths workspace
+   * \param source the first vertex
+   * \param target the last vertex
+   * \param maxDistance paths longer than this are not considered
+   * \param path set to the path found
+   * \returns false if \a target cannot be reached within \a maxDistance
+   */
+  bool KspShortestPath (DSRKspWorkspace& ws, uint32_t source, uint32_t target,
+                        uint32_t maxDistance, DSRPath& path) const;
+
+  /**
+   * \brief K shortest loopless paths between two vertices (Yen's algorithm)
+   *
+   * \param ws the K-shortest paths workspace
+   * \param source the first vertex
+   * \param target the last vertex
+   * \param k the largest number of paths wanted
+   * \param maxDistance paths longer than this are pruned
+   * \param paths set to the paths found, shortest first
+   */
+  void KShortestPaths (DSRKspWorkspace& ws, uint32_t source, uint32_t target, uint32_t k,
+                       uint32_t maxDistance, std::vector<DSRPath>& paths) const;
+
+  /**
+   * \brief Compute the ranked alternative routes of one local router
+   *
+   * For every other router, the K shortest loopless paths are grouped by the
+   * neighbour they leave through.  The shortest path through each neighbour
+   * is the route the SPF job of that neighbour already installed; the
+   * following ones are added as extra node routes, ranked by distance, until
+   * the per-node route cap is reached.
+   *
+   * \param ws the K-shortest paths workspace of the calling thread
+   * \param job the computation to run; routes are appended to it
+   * \param k the largest number of paths per destination
+   * \param maxDistance paths longer than this are pruned
+   * \param maxRoutes the largest number of routes added to the node
+   */
+  void KspCalculate (DSRKspWorkspace& ws, RouterJob& job, uint32_t k,
+                     uint32_t maxDistance, uint32_t maxRoutes) const;
 
   /**
-   * \brief Return the interface number corresponding to a given IP address and mask
+   * \brief Compute the best-effort routes of one local router
    *
-   * This is a wrapper around GetInterfaceForPrefix(), but we first
-   * have to find the right node pointer to pass to that function.
-   * If no such interface is found, return -1 (note:  unit test framework
-   * for routing assumes -1 to be a legal return value)
+   * Breadth-first search from the router, counting one hop per router to
+   * router link and per broadcast network crossed.  Each destination gets
+   * the single next hop of the first minimum hop path found, as a host
+   * route to every point-to-point address of a router and a network route
+   * to every stub and transit network.  The search reuses an SPF workspace
+   * and is queued in the same batches as the SPF jobs, but it is a separate
+   * traversal: a minimum hop path is not a shortest path by metric, so it
+   * cannot be read off the SPF runs, and the table costs one more search
+   * per local router.
+   *
+   * \param ws the SPF workspace of the calling thread
+   * \param job the computation to run; routes are appended to it
+   */
+  void BestEffortCalculate (DSRSPFWorkspace& ws, RouterJob& job) const;
+
+  /**
+   * \brief Add a vertex to the best-effort search tree and emit its routes
    *
-   * \param a the target IP address
-   * \param amask the target subnet mask
-   * \return the outgoing interface number
+   * \param ws the SPF workspace of the calling thread
+   * \param job the computation running
+   * \param v the vertex reached
+   * \param exit the way out of the local router towards it
+   * \param hops its hop count from the local router
    */
-  int32_t FindOutgoingInterfaceId (Ipv4Address a, 
-                                   Ipv4Mask amask = Ipv4Mask ("255.255.255.255"));
+  void BestEffortAddVertex (DSRSPFWorkspace& ws, const RouterJob& job, uint32_t v,
+                            const DSRGraphSnapshot::Exit_t& exit, uint32_t hops) const;
 };
 
 } // namespace ns3
@@ -58,6 +58,69 @@ DSRRouteManager::InitializeRoutes (void)
   InitializeRoutes ();
 }
 
+void
+DSRRouteManager::RecomputeRoutes (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  SimulationSingleton<DSRRouteManagerImpl>::Get ()->
+  RecomputeRoutes ();
+}
+
+void
+DSRRouteManager::AddAreaRange (uint32_t area, Ipv4Address network, Ipv4Mask mask)
+{
+  NS_LOG_FUNCTION (area << network << mask);
+  SimulationSingleton<DSRRouteManagerImpl>::Get ()->
+  AddAreaRange (area, network, mask);
+}
+
+bool
+DSRRouteManager::ComputeRoutesTo (Ipv4Address address)
+{
+  NS_LOG_FUNCTION (address);
+  return SimulationSingleton<DSRRouteManagerImpl>::Get ()->
+         ComputeRoutesTo (address);
+}
+
+void
+DSRRouteManager::UpdateRoutes (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  SimulationSingleton<DSRRouteManagerImpl>::Get ()->
+  UpdateRoutes ();
+}
+
+void
+DSRRouteManager::ScheduleUpdateRoutes (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  SimulationSingleton<DSRRouteManagerImpl>::Get ()->
+  ScheduleUpdateRoutes ();
+}
+
+const DSRRouteComputationStats&
+DSRRouteManager::GetStats (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  return SimulationSingleton<DSRRouteManagerImpl>::Get ()->
+         GetRouteComputationStats ();
+}
+
+void
+DSRRouteManager::PrintStats (std::ostream& os)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  GetStats ().Print (os);
+}
+
+uint64_t
+DSRRouteManager::GetTopologyHash (void)
+{
+  NS_LOG_FUNCTION_NOARGS ();
+  return SimulationSingleton<DSRRouteManagerImpl>::Get ()->
+         GetTopologyHash ();
+}
+
 uint32_t
 DSRRouteManager::AllocateRouterId (void)
 {
@@ -22,8 +22,14 @@
 #ifndef DSR_ROUTE_MANAGER_H
 #define DSR_ROUTE_MANAGER_H
 
+#include <ostream>
+#include <stdint.h>
+#include "ns3/ipv4-address.h"
+
 namespace ns3 {
 
+struct DSRRouteComputationStats;
+
 /**
  * \ingroup globalrouting
  *
@@ -65,6 +71,72 @@ public:
  */
   static void InitializeRoutes ();
 
+/**
+ * @brief Rebuild the routing database and recompute every route, changing
+ * only the routes that differ from the installed ones
+ */
+  static void RecomputeRoutes ();
+
+/**
+ * @brief Summarize a range of addresses of an area to the other areas
+ *
+ * Routers are put in areas with the AreaId attribute of DSRRouter.  The
+ * routers of the other areas get one route to the range instead of the
+ * routes to the addresses of the area inside it.  Takes effect at the next
+ * BuildDSRRoutingDatabase ().
+ *
+ * @param area the area ID
+ * @param network the network address of the range
+ * @param mask the mask of the range
+ */
+  static void AddAreaRange (uint32_t area, Ipv4Address network, Ipv4Mask mask);
+
+/**
+ * @brief Compute the routes to a router on demand (see DsrLazyRouting)
+ *
+ * Called by the routing tables on the first lookup of an address of a
+ * router.  Can also be called before the traffic starts, for instance with
+ * the addresses the sinks are bound to, so that the first packets do not
+ * pay for the computation.  An address in a stub, transit or external
+ * network computes every route up front instead.
+ *
+ * @param address an address of the router, or in a network
+ * @returns true if the routes were computed by this call
+ */
+  static bool ComputeRoutesTo (Ipv4Address address);
+
+/**
+ * @brief Rebuild the routing database after a link or address change and
+ * recompute only the routes the change affects
+ */
+  static void UpdateRoutes ();
+
+/**
+ * @brief Schedule an UpdateRoutes () that serves every interface event of
+ * a hold-down window, with exponential back-off under sustained churn
+ * (see DsrSpfDelay, DsrSpfHoldTime and DsrSpfMaxHoldTime)
+ */
+  static void ScheduleUpdateRoutes ();
+
+/**
+ * @brief Get the phase timers and counters of the last route computation
+ * @returns the statistics of the last BuildDSRRoutingDatabase () and
+ * InitializeRoutes () or UpdateRoutes () call
+ */
+  static const DSRRouteComputationStats& GetStats ();
+
+/**
+ * @brief Print a summary of the last route computation
+ * @param os the output stream
+ */
+  static void PrintStats (std::ostream& os);
+
+/**
+ * @brief Hash the topology gathered by the last BuildDSRRoutingDatabase ()
+ * @returns a 64-bit hash that only equal topologies and route settings share
+ */
+  static uint64_t GetTopologyHash ();
+
 private:
 /**
  * @brief Global Route Manager copy construction is disallowed.  There's no 
@@ -30,6 +30,13 @@
 #include "ipv4-dsr-routing.h"
 #include "dsr-router-interface.h"
 #include "ns3/loopback-net-device.h"
+#include "ns3/global-value.h"
+#include "ns3/enum.h"
+#include "ns3/uinteger.h"
+#include "ns3/nstime.h"
+#include "ns3/data-rate.h"
+#include <algorithm>
+#include <unordered_map>
 #include <vector>
 
 namespace ns3 {
@@ -56,7 +63,7 @@ DSRRoutingLinkRecord::DSRRoutingLinkRecord (
   LinkType    linkType, 
   Ipv4Address linkId, 
   Ipv4Address linkData, 
-  uint16_t    metric)
+  uint32_t    metric)
   :
     m_linkId (linkId),
     m_linkData (linkData),
@@ -114,7 +121,7 @@ DSRRoutingLinkRecord::SetLinkType (
   m_linkType = linkType;
 }
 
-uint16_t
+uint32_t
 DSRRoutingLinkRecord::GetMetric (void) const
 {
   NS_LOG_FUNCTION (this);
@@ -122,7 +129,7 @@ DSRRoutingLinkRecord::GetMetric (void) const
 }
 
 void
-DSRRoutingLinkRecord::SetMetric (uint16_t metric)
+DSRRoutingLinkRecord::SetMetric (uint32_t metric)
 {
   NS_LOG_FUNCTION (this << metric);
   m_metric = metric;
@@ -198,21 +205,7 @@ void
 DSRRoutingLSA::CopyLinkRecords (const DSRRoutingLSA& lsa)
 {
   NS_LOG_FUNCTION (this << &lsa);
-  for (ListOfLinkRecords_t::const_iterator i = lsa.m_linkRecords.begin ();
-       i != lsa.m_linkRecords.end (); 
-       i++)
-    {
-      DSRRoutingLinkRecord *pSrc = *i;
-      DSRRoutingLinkRecord *pDst = new DSRRoutingLinkRecord;
-
-      pDst->SetLinkType (pSrc->GetLinkType ());
-      pDst->SetLinkId (pSrc->GetLinkId ());
-      pDst->SetLinkData (pSrc->GetLinkData ());
-      pDst->SetMetric (pSrc->GetMetric ());
-
-      m_linkRecords.push_back (pDst);
-      pDst = 0;
-    }
+  m_linkRecords.insert (m_linkRecords.end (), lsa.m_linkRecords.begin (), lsa.m_linkRecords.end ());
 
   m_attachedRouters = lsa.m_attachedRouters;
 }
@@ -227,19 +220,6 @@ void
 DSRRoutingLSA::ClearLinkRecords (void)
 {
   NS_LOG_FUNCTION (this);
-  for ( ListOfLinkRecords_t::iterator i = m_linkRecords.begin ();
-        i != m_linkRecords.end (); 
-        i++)
-    {
-      NS_LOG_LOGIC ("Free link record");
-
-      DSRRoutingLinkRecord *p = *i;
-      delete p;
-      p = 0;
-
-      *i = 0;
-    }
-  NS_LOG_LOGIC ("Clear list");
   m_linkRecords.clear ();
 }
 
@@ -247,6 +227,15 @@ uint32_t
 DSRRoutingLSA::AddLinkRecord (DSRRoutingLinkRecord* lr)
 {
   NS_LOG_FUNCTION (this << lr);
+  m_linkRecords.push_back (*lr);
+  delete lr;
+  return m_linkRecords.size ();
+}
+
+uint32_t
+DSRRoutingLSA::AddLinkRecord (const DSRRoutingLinkRecord& lr)
+{
+  NS_LOG_FUNCTION (this << &lr);
   m_linkRecords.push_back (lr);
   return m_linkRecords.size ();
 }
@@ -258,22 +247,12 @@ DSRRoutingLSA::GetNLinkRecords (void) const
   return m_linkRecords.size ();
 }
 
-DSRRoutingLinkRecord *
+const DSRRoutingLinkRecord *
 DSRRoutingLSA::GetLinkRecord (uint32_t n) const
 {
   NS_LOG_FUNCTION (this << n);
-  uint32_t j = 0;
-  for ( ListOfLinkRecords_t::const_iterator i = m_linkRecords.begin ();
-        i != m_linkRecords.end (); 
-        i++, j++)
-    {
-      if (j == n) 
-        {
-          return *i;
-        }
-    }
-  NS_ASSERT_MSG (false, "DSRRoutingLSA::GetLinkRecord (): invalid index");
-  return 0;
+  NS_ASSERT_MSG (n < m_linkRecords.size (), "DSRRoutingLSA::GetLinkRecord (): invalid index");
+  return &m_linkRecords[n];
 }
 
 bool
@@ -283,6 +262,31 @@ DSRRoutingLSA::IsEmpty (void) const
   return m_linkRecords.size () == 0;
 }
 
+bool
+DSRRoutingLSA::IsEquivalent (const DSRRoutingLSA& lsa) const
+{
+  NS_LOG_FUNCTION (this << &lsa);
+  if (m_lsType != lsa.m_lsType || m_linkStateId != lsa.m_linkStateId
+      || m_advertisingRtr != lsa.m_advertisingRtr || m_node_id != lsa.m_node_id
+      || m_networkLSANetworkMask != lsa.m_networkLSANetworkMask
+      || m_linkRecords.size () != lsa.m_linkRecords.size ()
+      || m_attachedRouters != lsa.m_attachedRouters)
+    {
+      return false;
+    }
+  for (uint32_t i = 0; i < m_linkRecords.size (); i++)
+    {
+      const DSRRoutingLinkRecord& a = m_linkRecords[i];
+      const DSRRoutingLinkRecord& b = lsa.m_linkRecords[i];
+      if (a.m_linkType != b.m_linkType || a.m_linkId != b.m_linkId
+          || a.m_linkData != b.m_linkData || a.m_metric != b.m_metric)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
 DSRRoutingLSA::LSType
 DSRRoutingLSA::GetLSType (void) const
 {
@@ -434,7 +438,7 @@ DSRRoutingLSA::Print (std::ostream &os) const
             i != m_linkRecords.end (); 
             i++)
         {
-          DSRRoutingLinkRecord *p = *i;
+          const DSRRoutingLinkRecord *p = &*i;
 
           os << "---------- RouterLSA Link Record ----------" << std::endl;
           os << "m_linkType = " << p->m_linkType;
@@ -499,6 +503,166 @@ std::ostream& operator<< (std::ostream& os, DSRRoutingLSA& lsa)
   return os;
 }
 
+// ---------------------------------------------------------------------------
+//
+// DSRDeviceIndex Implementation
+//
+// ---------------------------------------------------------------------------
+
+void
+DSRDeviceIndex::Build (void)
+{
+  NS_LOG_FUNCTION (this);
+  Clear ();
+  m_nodes.resize (NodeList::GetNNodes ());
+  std::unordered_map<const NetDevice *, uint32_t> devices;
+  std::unordered_map<const Channel *, uint32_t> channels;
+
+  //
+  // Number the devices first, so that the interfaces, bridge ports and
+  // channels below can be resolved to device indices.
+  //
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); i++)
+    {
+      Ptr<ns3::Node> node = *i;
+      Node &n = m_nodes[node->GetId ()];
+      n.m_firstDevice = m_devices.size ();
+      n.m_nDevices = node->GetNDevices ();
+      n.m_ipv4 = node->GetObject<Ipv4> () != 0;
+      Ptr<DSRRouter> rtr = node->GetObject<DSRRouter> ();
+      n.m_router = rtr != 0;
+      n.m_routerId = rtr ? rtr->GetRouterId () : Ipv4Address ();
+      for (uint32_t j = 0; j < n.m_nDevices; ++j)
+        {
+          Ptr<NetDevice> nd = node->GetDevice (j);
+          Device d;
+          d.m_node = node->GetId ();
+          d.m_channel = NONE;
+          d.m_bridge = NONE;
+          d.m_interface = NONE;
+          d.m_nAddresses = 0;
+          d.m_metric = 0;
+          d.m_linkMetric = 0;
+          d.m_up = false;
+          d.m_forwarding = false;
+          d.m_loopback = DynamicCast<LoopbackNetDevice> (nd) != 0;
+          d.m_broadcast = nd->IsBroadcast ();
+          d.m_pointToPoint = nd->IsPointToPoint ();
+          d.m_isBridge = nd->IsBridge ();
+          devices[PeekPointer (nd)] = m_devices.size ();
+          m_devices.push_back (d);
+        }
+    }
+
+  for (NodeList::Iterator i = NodeList::Begin (); i != NodeList::End (); i++)
+    {
+      Ptr<ns3::Node> node = *i;
+      const Node &n = m_nodes[node->GetId ()];
+      for (uint32_t j = 0; j < n.m_nDevices; ++j)
+        {
+          Ptr<NetDevice> nd = node->GetDevice (j);
+          Device &d = m_devices[n.m_firstDevice + j];
+          Ptr<Channel> ch = nd->GetChannel ();
+          if (ch)
+            {
+              std::pair<std::unordered_map<const Channel *, uint32_t>::iterator, bool> c =
+                channels.insert (std::make_pair (PeekPointer (ch), m_channels.size ()));
+              if (c.second)
+                {
+                  m_channels.push_back (std::vector<uint32_t> ());
+                  for (std::size_t k = 0; k < ch->GetNDevices (); ++k)
+                    {
+                      std::unordered_map<const NetDevice *, uint32_t>::const_iterator other =
+                        devices.find (PeekPointer (ch->GetDevice (k)));
+                      NS_ABORT_MSG_IF (other == devices.end (),
+                                       "DSRDeviceIndex::Build (): Channel device of no node");
+                      m_channels.back ().push_back (other->second);
+                    }
+                }
+              d.m_channel = c.first->second;
+            }
+          //
+          // A port is bridged by the first bridge of its node that lists it,
+          // as the scan of the node's devices used to find.
+          //
+          if (d.m_isBridge)
+            {
+              Ptr<BridgeNetDevice> bnd = nd->GetObject<BridgeNetDevice> ();
+              NS_ABORT_MSG_UNLESS (bnd, "DSRRouter::DiscoverLSAs (): GetObject for <BridgeNetDevice> failed");
+              std::vector<uint32_t> &ports = m_bridgePorts[n.m_firstDevice + j];
+              for (uint32_t k = 0; k < bnd->GetNBridgePorts (); ++k)
+                {
+                  uint32_t port = devices[PeekPointer (bnd->GetBridgePort (k))];
+                  ports.push_back (port);
+                  if (m_devices[port].m_bridge == NONE)
+                    {
+                      m_devices[port].m_bridge = n.m_firstDevice + j;
+                    }
+                }
+            }
+        }
+
+      Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+      if (ipv4 == 0)
+        {
+          continue;
+        }
+      Ptr<DSRRouter> rtr = node->GetObject<DSRRouter> ();
+      for (uint32_t j = 0; j < ipv4->GetNInterfaces (); ++j)
+        {
+          Ptr<NetDevice> nd = ipv4->GetNetDevice (j);
+          std::unordered_map<const NetDevice *, uint32_t>::const_iterator found = devices.find (PeekPointer (nd));
+          if (found == devices.end ())
+            {
+              continue;
+            }
+          Device &d = m_devices[found->second];
+          bool up = ipv4->IsUp (j);
+          d.m_forwarding = d.m_forwarding || (up && ipv4->IsForwarding (j));
+          if (d.m_interface != NONE)
+            {
+              continue;
+            }
+          d.m_interface = j;
+          d.m_up = up;
+          d.m_nAddresses = ipv4->GetNAddresses (j);
+          if (d.m_nAddresses > 0)
+            {
+              d.m_address = ipv4->GetAddress (j, 0).GetLocal ();
+              d.m_mask = ipv4->GetAddress (j, 0).GetMask ();
+            }
+          d.m_metric = ipv4->GetMetric (j);
+        }
+      //
+      // The link metric may read channel attributes, so it is only worked
+      // out for the devices that DiscoverLSAs () will advertise it for.
+      //
+      if (rtr == 0)
+        {
+          continue;
+        }
+      for (uint32_t j = 0; j < n.m_nDevices; ++j)
+        {
+          Device &d = m_devices[n.m_firstDevice + j];
+          if (d.m_forwarding && d.m_pointToPoint && !d.m_loopback)
+            {
+              d.m_linkMetric = rtr->GetLinkMetric (node->GetDevice (j), ipv4, d.m_interface);
+            }
+        }
+    }
+  NS_LOG_LOGIC ("Indexed " << m_devices.size () << " devices and " << m_channels.size () << " channels");
+}
+
+void
+DSRDeviceIndex::Clear (void)
+{
+  NS_LOG_FUNCTION (this);
+  std::vector<Node> ().swap (m_nodes);
+  std::vector<Device> ().swap (m_devices);
+  std::vector<std::vector<uint32_t> > ().swap (m_channels);
+  m_bridgePorts.clear ();
+}
+
 // ---------------------------------------------------------------------------
 //
 // DSRRouter Implementation
@@ -507,17 +671,34 @@ std::ostream& operator<< (std::ostream& os, DSRRoutingLSA& lsa)
 
 NS_OBJECT_ENSURE_REGISTERED (DSRRouter);
 
+static GlobalValue g_dsrLinkMetric ("DsrLinkMetric",
+                                    "Metric of the point-to-point link records: the interface "
+                                    "metric, or the channel delay plus MTU serialization time",
+                                    EnumValue (DSRRouter::InterfaceMetric),
+                                    MakeEnumChecker (DSRRouter::InterfaceMetric, "InterfaceMetric",
+                                                     DSRRouter::ChannelDelay, "ChannelDelay"));
+
+/// Largest derived link metric, about 16.8 s in microseconds
+static const uint32_t DSR_MAX_LINK_METRIC = 0x00ffffff;
+
 TypeId 
 DSRRouter::GetTypeId (void)
 {
   static TypeId tid = TypeId ("ns3::DSRRouter")
     .SetParent<Object> ()
-    .SetGroupName ("dsr-routing");
+    .SetGroupName ("dsr-routing")
+    .AddAttribute ("AreaId",
+                   "Area of the router, for the area summaries of DSRRouteManager",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&DSRRouter::m_areaId),
+                   MakeUintegerChecker<uint32_t> ())
+  ;
   return tid;
 }
 
 DSRRouter::DSRRouter ()
-  : m_LSAs ()
+  : m_LSAs (),
+    m_areaId (0)
 {
   NS_LOG_FUNCTION (this);
   m_routerId.Set (DSRRouteManager::AllocateRouterId ());
@@ -560,19 +741,7 @@ void
 DSRRouter::ClearLSAs ()
 {
   NS_LOG_FUNCTION (this);
-  for ( ListOfLSAs_t::iterator i = m_LSAs.begin ();
-        i != m_LSAs.end (); 
-        i++)
-    {
-      NS_LOG_LOGIC ("Free LSA");
-
-      DSRRoutingLSA *p = *i;
-      delete p;
-      p = 0;
-
-      *i = 0;
-    }
-  NS_LOG_LOGIC ("Clear list of LSAs");
+  NS_LOG_LOGIC ("Release list of LSAs");
   m_LSAs.clear ();
 }
 
@@ -583,6 +752,12 @@ DSRRouter::GetRouterId (void) const
   return m_routerId;
 }
 
+uint32_t
+DSRRouter::GetAreaId (void) const
+{
+  return m_areaId;
+}
+
 //
 // DiscoverLSAs is called on all nodes in the system that have a DSRRouter
 // interface aggregated.  We need to go out and discover any adjacent routers 
@@ -593,54 +768,64 @@ uint32_t
 DSRRouter::DiscoverLSAs ()
 {
   NS_LOG_FUNCTION (this);
+  DSRDeviceIndex index;
+  index.Build ();
+  return DiscoverLSAs (index);
+}
+
+uint32_t 
+DSRRouter::DiscoverLSAs (const DSRDeviceIndex &index)
+{
+  NS_LOG_FUNCTION (this << &index);
   Ptr<Node> node = GetObject<Node> ();
   NS_ABORT_MSG_UNLESS (node, "DSRRouter::DiscoverLSAs (): GetObject for <Node> interface failed");
   NS_LOG_LOGIC ("For node " << node->GetId () );
+  NS_ABORT_MSG_UNLESS (node->GetId () < index.m_nodes.size (), "DSRRouter::DiscoverLSAs (): Node not in the device index");
 
-  ClearLSAs ();
+  //
+  // Keep the previous advertisements aside: those that come out the same are
+  // reused below, so that the link state database still shares them.
+  //
+  ListOfLSAs_t previous;
+  previous.swap (m_LSAs);
 
   //
-  // While building the Router-LSA, keep a list of those NetDevices for
-  // which the current node is the designated router and we will later build 
-  // a NetworkLSA for.
+  // While building the Router-LSA, keep a list of those devices for which
+  // the current node is the designated router and we will later build a
+  // NetworkLSA for.
   //
-  NetDeviceContainer c;
+  std::vector<uint32_t> c;
 
   //
-  // We're aggregated to a node.  We need to ask the node for a pointer to its
-  // Ipv4 interface.  This is where the information regarding the attached 
+  // We're aggregated to a node.  The index tells whether the node has an Ipv4
+  // interface.  This is where the information regarding the attached 
   // interfaces lives.  If we're a router, we had better have an Ipv4 interface.
   //
-  Ptr<Ipv4> ipv4Local = node->GetObject<Ipv4> ();
-  NS_ABORT_MSG_UNLESS (ipv4Local, "DSRRouter::DiscoverLSAs (): GetObject for <Ipv4> interface failed");
+  const DSRDeviceIndex::Node &nodeLocal = index.m_nodes[node->GetId ()];
+  NS_ABORT_MSG_UNLESS (nodeLocal.m_ipv4, "DSRRouter::DiscoverLSAs (): GetObject for <Ipv4> interface failed");
 
   //
   // Every router node originates a Router-LSA
   //
-  DSRRoutingLSA *pLSA = new DSRRoutingLSA;
+  Ptr<DSRRoutingLSA> pLSA = Create<DSRRoutingLSA> ();
   pLSA->SetLSType (DSRRoutingLSA::RouterLSA);
   pLSA->SetLinkStateId (m_routerId);
   pLSA->SetAdvertisingRouter (m_routerId);
   pLSA->SetStatus (DSRRoutingLSA::LSA_SPF_NOT_EXPLORED);
   pLSA->SetNode (node);
 
-  //
-  // Ask the node for the number of net devices attached. This isn't necessarily 
-  // equal to the number of links to adjacent nodes (other routers) as the number
-  // of devices may include those for stub networks (e.g., ethernets, etc.) and 
-  // bridge devices also take up an "extra" net device.
-  //
-  uint32_t numDevices = node->GetNDevices ();
-
   //
   // Iterate through the devices on the node and walk the channel to see what's
-  // on the other side of the standalone devices..
+  // on the other side of the standalone devices.  The number of devices isn't
+  // necessarily equal to the number of links to adjacent nodes (other routers)
+  // as it may include those for stub networks (e.g., ethernets, etc.) and
+  // bridge devices also take up an "extra" net device.
   //
-  for (uint32_t i = 0; i < numDevices; ++i)
+  for (uint32_t i = nodeLocal.m_firstDevice; i < nodeLocal.m_firstDevice + nodeLocal.m_nDevices; ++i)
     {
-      Ptr<NetDevice> ndLocal = node->GetDevice (i);
+      const DSRDeviceIndex::Device &ndLocal = index.m_devices[i];
 
-      if (DynamicCast <LoopbackNetDevice> (ndLocal))
+      if (ndLocal.m_loopback)
         {
           continue;
         }
@@ -650,13 +835,8 @@ DSRRouter::DiscoverLSAs ()
       // associated with them.  This turns out to be a very convenient place to
       // check and make sure that this is the case.
       //
-      if (NetDeviceIsBridged (ndLocal))
-        {
-          // Initialize to value out of bounds to silence compiler
-          uint32_t interfaceBridge = ipv4Local->GetNInterfaces () + 1;
-          bool rc = FindInterfaceForDevice (node, ndLocal, interfaceBridge);
-          NS_ABORT_MSG_IF (rc, "DSRRouter::DiscoverLSAs(): Bridge ports must not have an IPv4 interface index");
-        }
+      NS_ABORT_MSG_IF (ndLocal.m_bridge != DSRDeviceIndex::NONE && ndLocal.m_interface != DSRDeviceIndex::NONE,
+                       "DSRRouter::DiscoverLSAs(): Bridge ports must not have an IPv4 interface index");
 
       //
       // Check to see if the net device we just got has a corresponding IP 
@@ -664,20 +844,9 @@ DSRRouter::DiscoverLSAs ()
       // associated with a bridge.  We are only going to involve devices with 
       // IP addresses in routing.
       //
-      bool isForwarding = false;
-      for (uint32_t j = 0; j < ipv4Local->GetNInterfaces (); ++j )
+      if (!ndLocal.m_forwarding)
         {
-          if (ipv4Local->GetNetDevice (j) == ndLocal && ipv4Local->IsUp (j) &&
-              ipv4Local->IsForwarding (j)) 
-            {
-              isForwarding = true;
-              break;
-            }
-        }
-
-      if (!isForwarding)
-        {
-          NS_LOG_LOGIC ("Net device " << ndLocal << "has no IP interface or is not enabled for forwarding, skipping");
+          NS_LOG_LOGIC ("Net device " << i << " has no IP interface or is not enabled for forwarding, skipping");
           continue;
         }
 
@@ -691,15 +860,15 @@ DSRRouter::DiscoverLSAs ()
       // that case, there may be zero, one, or two link records added.
       //
 
-      if (ndLocal->IsBroadcast () && !ndLocal->IsPointToPoint () )
+      if (ndLocal.m_broadcast && !ndLocal.m_pointToPoint)
         {
           NS_LOG_LOGIC ("Broadcast link");
-          ProcessBroadcastLink (ndLocal, pLSA, c);
+          ProcessBroadcastLink (index, i, PeekPointer (pLSA), c);
         }
-      else if (ndLocal->IsPointToPoint () )
+      else if (ndLocal.m_pointToPoint)
         {
           NS_LOG_LOGIC ("Point=to-point link");
-          ProcessPointToPointLink (ndLocal, pLSA);
+          ProcessPointToPointLink (index, i, PeekPointer (pLSA));
         }
       else
         {
@@ -716,11 +885,11 @@ DSRRouter::DiscoverLSAs ()
   // Now, determine whether we need to build a NetworkLSA.  This is the case if
   // we found at least one designated router.
   //
-  uint32_t nDesignatedRouters = c.GetN ();
+  uint32_t nDesignatedRouters = c.size ();
   if (nDesignatedRouters > 0)
     {
       NS_LOG_LOGIC ("Build Network LSAs");
-      BuildNetworkLSAs (c);
+      BuildNetworkLSAs (index, c);
     }
 
   //
@@ -731,7 +900,7 @@ DSRRouter::DiscoverLSAs ()
        i != m_injectedRoutes.end ();
        i++)
     {
-      DSRRoutingLSA *pLSA = new DSRRoutingLSA;
+      Ptr<DSRRoutingLSA> pLSA = Create<DSRRoutingLSA> ();
       pLSA->SetLSType (DSRRoutingLSA::ASExternalLSAs);
       pLSA->SetLinkStateId ((*i)->GetDestNetwork ());
       pLSA->SetAdvertisingRouter (m_routerId);
@@ -739,26 +908,43 @@ DSRRouter::DiscoverLSAs ()
       pLSA->SetStatus (DSRRoutingLSA::LSA_SPF_NOT_EXPLORED);
       m_LSAs.push_back (pLSA); 
     }
+
+  //
+  // The LSAs are discovered in the same order every time, so an unchanged
+  // advertisement is found at the same position.
+  //
+  uint32_t reused = 0;
+  for (uint32_t j = 0; j < m_LSAs.size () && j < previous.size (); j++)
+    {
+      if (previous[j]->IsEquivalent (*m_LSAs[j]))
+        {
+          m_LSAs[j] = previous[j];
+          reused++;
+        }
+    }
+  NS_LOG_LOGIC ("Reused " << reused << " of " << m_LSAs.size () << " LSAs");
   return m_LSAs.size ();
 }
 
 void
-DSRRouter::ProcessBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA, NetDeviceContainer &c)
+DSRRouter::ProcessBroadcastLink (const DSRDeviceIndex &index, uint32_t nd, DSRRoutingLSA *pLSA,
+                                 std::vector<uint32_t> &c)
 {
   NS_LOG_FUNCTION (this << nd << pLSA << &c);
 
-  if (nd->IsBridge ())
+  if (index.m_devices[nd].m_isBridge)
     {
-      ProcessBridgedBroadcastLink (nd, pLSA, c);
+      ProcessBridgedBroadcastLink (index, nd, pLSA, c);
     }
   else
     {
-      ProcessSingleBroadcastLink (nd, pLSA, c);
+      ProcessSingleBroadcastLink (index, nd, pLSA, c);
     }
 }
 
 void
-DSRRouter::ProcessSingleBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA, NetDeviceContainer &c)
+DSRRouter::ProcessSingleBroadcastLink (const DSRDeviceIndex &index, uint32_t nd, DSRRoutingLSA *pLSA,
+                                       std::vector<uint32_t> &c)
 {
   NS_LOG_FUNCTION (this << nd << pLSA << &c);
 
@@ -772,24 +958,18 @@ DSRRouter::ProcessSingleBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA, N
   // work with devices attached to the internet stack (have an ipv4 interface
   // associated to them.
   //
-  Ptr<Node> node = nd->GetNode ();
+  const DSRDeviceIndex::Device &ndLocal = index.m_devices[nd];
+  NS_ABORT_MSG_IF (ndLocal.m_interface == DSRDeviceIndex::NONE,
+                   "DSRRouter::ProcessSingleBroadcastLink(): No interface index associated with device");
 
-  Ptr<Ipv4> ipv4Local = node->GetObject<Ipv4> ();
-  NS_ABORT_MSG_UNLESS (ipv4Local, "DSRRouter::ProcessSingleBroadcastLink (): GetObject for <Ipv4> interface failed");
-
-  // Initialize to value out of bounds to silence compiler
-  uint32_t interfaceLocal = ipv4Local->GetNInterfaces () + 1;
-  bool rc = FindInterfaceForDevice (node, nd, interfaceLocal);
-  NS_ABORT_MSG_IF (rc == false, "DSRRouter::ProcessSingleBroadcastLink(): No interface index associated with device");
-
-  if (ipv4Local->GetNAddresses (interfaceLocal) > 1)
+  if (ndLocal.m_nAddresses > 1)
     {
       NS_LOG_WARN ("Warning, interface has multiple IP addresses; using only the primary one");
     }
-  Ipv4Address addrLocal = ipv4Local->GetAddress (interfaceLocal, 0).GetLocal ();
-  Ipv4Mask maskLocal = ipv4Local->GetAddress (interfaceLocal, 0).GetMask ();
+  Ipv4Address addrLocal = ndLocal.m_address;
+  Ipv4Mask maskLocal = ndLocal.m_mask;
   NS_LOG_LOGIC ("Working with local address " << addrLocal);
-  uint16_t metricLocal = ipv4Local->GetMetric (interfaceLocal);
+  uint16_t metricLocal = ndLocal.m_metric;
 
   //
   // Check to see if the net device is connected to a channel/network that has
@@ -797,8 +977,8 @@ DSRRouter::ProcessSingleBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA, N
   // this is a stub network.  If we find another router, then what we have here
   // is a transit network.
   //
-  ClearBridgesVisited ();
-  if (AnotherRouterOnLink (nd) == false)
+  std::set<uint32_t> bridgesVisited;
+  if (AnotherRouterOnLink (index, nd, bridgesVisited) == false)
     {
       //
       // This is a net device connected to a stub network
@@ -837,9 +1017,9 @@ DSRRouter::ProcessSingleBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA, N
       // gets the IP interface address of the designated router in this 
       // case.
       //
-      ClearBridgesVisited ();
+      bridgesVisited.clear ();
       Ipv4Address desigRtr;
-      desigRtr = FindDesignatedRouterForLink (nd);
+      desigRtr = FindDesignatedRouterForLink (index, nd, bridgesVisited);
 
       //
       // Let's double-check that any designated router we find out on our
@@ -856,8 +1036,8 @@ DSRRouter::ProcessSingleBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA, N
         }
       if (desigRtr == addrLocal)
         {
-          c.Add (nd);
-          NS_LOG_LOGIC ("Node " << node->GetId () << " elected a designated router");
+          c.push_back (nd);
+          NS_LOG_LOGIC ("Node " << ndLocal.m_node << " elected a designated router");
         }
       plr->SetLinkId (desigRtr);
 
@@ -872,10 +1052,11 @@ DSRRouter::ProcessSingleBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA, N
 }
 
 void
-DSRRouter::ProcessBridgedBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA, NetDeviceContainer &c)
+DSRRouter::ProcessBridgedBroadcastLink (const DSRDeviceIndex &index, uint32_t nd, DSRRoutingLSA *pLSA,
+                                        std::vector<uint32_t> &c)
 {
   NS_LOG_FUNCTION (this << nd << pLSA << &c);
-  NS_ASSERT_MSG (nd->IsBridge (), "DSRRouter::ProcessBridgedBroadcastLink(): Called with non-bridge net device");
+  NS_ASSERT_MSG (index.m_devices[nd].m_isBridge, "DSRRouter::ProcessBridgedBroadcastLink(): Called with non-bridge net device");
 
 #if 0
   //
@@ -888,9 +1069,6 @@ DSRRouter::ProcessBridgedBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA,
   // but rather something you will have to go and turn on.
   //
 
-  Ptr<BridgeNetDevice> bnd = nd->GetObject<BridgeNetDevice> ();
-  NS_ABORT_MSG_UNLESS (bnd, "DSRRouter::DiscoverLSAs (): GetObject for <BridgeNetDevice> failed");
-
   //
   // We have some preliminaries to do to get enough information to proceed.
   // This information we need comes from the internet stack, so notice that
@@ -898,23 +1076,18 @@ DSRRouter::ProcessBridgedBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA,
   // work with devices attached to the internet stack (have an ipv4 interface
   // associated to them.
   //
-  Ptr<Node> node = nd->GetNode ();
-  Ptr<Ipv4> ipv4Local = node->GetObject<Ipv4> ();
-  NS_ABORT_MSG_UNLESS (ipv4Local, "DSRRouter::ProcessBridgedBroadcastLink (): GetObject for <Ipv4> interface failed");
+  const DSRDeviceIndex::Device &ndLocal = index.m_devices[nd];
+  NS_ABORT_MSG_IF (ndLocal.m_interface == DSRDeviceIndex::NONE,
+                   "DSRRouter::ProcessBridgedBroadcastLink(): No interface index associated with device");
 
-  // Initialize to value out of bounds to silence compiler
-  uint32_t interfaceLocal = ipv4Local->GetNInterfaces () + 1;
-  bool rc = FindInterfaceForDevice (node, nd, interfaceLocal);
-  NS_ABORT_MSG_IF (rc == false, "DSRRouter::ProcessBridgedBroadcastLink(): No interface index associated with device");
-
-  if (ipv4Local->GetNAddresses (interfaceLocal) > 1)
+  if (ndLocal.m_nAddresses > 1)
     {
       NS_LOG_WARN ("Warning, interface has multiple IP addresses; using only the primary one");
     }
-  Ipv4Address addrLocal = ipv4Local->GetAddress (interfaceLocal, 0).GetLocal ();
-  Ipv4Mask maskLocal = ipv4Local->GetAddress (interfaceLocal, 0).GetMask ();
+  Ipv4Address addrLocal = ndLocal.m_address;
+  Ipv4Mask maskLocal = ndLocal.m_mask;
   NS_LOG_LOGIC ("Working with local address " << addrLocal);
-  uint16_t metricLocal = ipv4Local->GetMetric (interfaceLocal);
+  uint16_t metricLocal = ndLocal.m_metric;
 
   //
   // We need to handle a bridge on the router.  This means that we have been 
@@ -928,17 +1101,18 @@ DSRRouter::ProcessBridgedBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA,
   bool areTransitNetwork = false;
   Ipv4Address desigRtr ("255.255.255.255");
 
-  for (uint32_t i = 0; i < bnd->GetNBridgePorts (); ++i)
+  const std::vector<uint32_t> &ports = index.m_bridgePorts.find (nd)->second;
+  for (uint32_t i = 0; i < ports.size (); ++i)
     {
-      Ptr<NetDevice> ndTemp = bnd->GetBridgePort (i);
+      uint32_t ndTemp = ports[i];
 
       //
       // We have to decide if we are a transit network.  This is characterized
       // by the presence of another router on the network segment.  If we find
       // another router on any of our bridged links, we are a transit network.
       //
-      ClearBridgesVisited ();
-      if (AnotherRouterOnLink (ndTemp))
+      std::set<uint32_t> bridgesVisited;
+      if (AnotherRouterOnLink (index, ndTemp, bridgesVisited))
         {
           areTransitNetwork = true;
 
@@ -949,8 +1123,8 @@ DSRRouter::ProcessBridgedBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA,
           // for the lowest address on each segment and pick the lowest of them
           // all.
           //
-          ClearBridgesVisited ();
-          Ipv4Address desigRtrTemp = FindDesignatedRouterForLink (ndTemp);
+          bridgesVisited.clear ();
+          Ipv4Address desigRtrTemp = FindDesignatedRouterForLink (index, ndTemp, bridgesVisited);
 
           //
           // Let's double-check that any designated router we find out on our
@@ -1020,8 +1194,8 @@ DSRRouter::ProcessBridgedBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA,
       //
       if (desigRtr == addrLocal) 
         {
-          c.Add (nd);
-          NS_LOG_LOGIC ("Node " << node->GetId () << " elected a designated router");
+          c.push_back (nd);
+          NS_LOG_LOGIC ("Node " << ndLocal.m_node << " elected a designated router");
         }
       plr->SetLinkId (desigRtr);
 
@@ -1037,7 +1211,7 @@ DSRRouter::ProcessBridgedBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA,
 }
 
 void
-DSRRouter::ProcessPointToPointLink (Ptr<NetDevice> ndLocal, DSRRoutingLSA *pLSA)
+DSRRouter::ProcessPointToPointLink (const DSRDeviceIndex &index, uint32_t ndLocal, DSRRoutingLSA *pLSA)
 {
   NS_LOG_FUNCTION (this << ndLocal << pLSA);
 
@@ -1048,45 +1222,33 @@ DSRRouter::ProcessPointToPointLink (Ptr<NetDevice> ndLocal, DSRRoutingLSA *pLSA)
   // work with devices attached to the internet stack (have an ipv4 interface
   // associated to them.
   //
-  Ptr<Node> nodeLocal = ndLocal->GetNode ();
-
-  Ptr<Ipv4> ipv4Local = nodeLocal->GetObject<Ipv4> ();
-  NS_ABORT_MSG_UNLESS (ipv4Local, "DSRRouter::ProcessPointToPointLink (): GetObject for <Ipv4> interface failed");
+  const DSRDeviceIndex::Device &deviceLocal = index.m_devices[ndLocal];
+  NS_ABORT_MSG_IF (deviceLocal.m_interface == DSRDeviceIndex::NONE,
+                   "DSRRouter::ProcessPointToPointLink (): No interface index associated with device");
 
-  uint32_t interfaceLocal = ipv4Local->GetNInterfaces () + 1;
-  bool rc = FindInterfaceForDevice (nodeLocal, ndLocal, interfaceLocal);
-  NS_ABORT_MSG_IF (rc == false, "DSRRouter::ProcessPointToPointLink (): No interface index associated with device");
-
-  if (ipv4Local->GetNAddresses (interfaceLocal) > 1)
+  if (deviceLocal.m_nAddresses > 1)
     {
       NS_LOG_WARN ("Warning, interface has multiple IP addresses; using only the primary one");
     }
-  Ipv4Address addrLocal = ipv4Local->GetAddress (interfaceLocal, 0).GetLocal ();
+  Ipv4Address addrLocal = deviceLocal.m_address;
   NS_LOG_LOGIC ("Working with local address " << addrLocal);
-  uint16_t metricLocal = ipv4Local->GetMetric (interfaceLocal);
+  uint32_t metricLocal = deviceLocal.m_linkMetric;
 
   //
   // Now, we're going to walk over to the remote net device on the other end of 
   // the point-to-point channel we know we have.  This is where our adjacent 
   // router (to use OSPF lingo) is running.
   //
-  Ptr<Channel> ch = ndLocal->GetChannel ();
-
-  //
-  // Get the net device on the other side of the point-to-point channel.
-  //
-  Ptr<NetDevice> ndRemote = GetAdjacent (ndLocal, ch);
+  uint32_t ndRemote = GetAdjacent (index, ndLocal);
+  const DSRDeviceIndex::Device &deviceRemote = index.m_devices[ndRemote];
 
   //
-  // The adjacent net device is aggregated to a node.  We need to ask that net 
-  // device for its node, then ask that node for its Ipv4 interface.  Note a
-  // requirement that nodes on either side of a point-to-point link must have 
-  // internet stacks; and an assumption that point-to-point links are incompatible 
-  // with bridging.
+  // The adjacent net device is aggregated to a node.  Note a requirement that
+  // nodes on either side of a point-to-point link must have internet stacks;
+  // and an assumption that point-to-point links are incompatible with bridging.
   //
-  Ptr<Node> nodeRemote = ndRemote->GetNode ();
-  Ptr<Ipv4> ipv4Remote = nodeRemote->GetObject<Ipv4> ();
-  NS_ABORT_MSG_UNLESS (ipv4Remote, 
+  const DSRDeviceIndex::Node &nodeRemote = index.m_nodes[deviceRemote.m_node];
+  NS_ABORT_MSG_UNLESS (nodeRemote.m_ipv4, 
                        "DSRRouter::ProcessPointToPointLink(): GetObject for remote <Ipv4> failed");
 
   //
@@ -1094,8 +1256,7 @@ DSRRouter::ProcessPointToPointLink (Ptr<NetDevice> ndLocal, DSRRoutingLSA *pLSA)
   // link must participate in global routing and therefore have a DSRRouter
   // interface aggregated.
   //
-  Ptr<DSRRouter> rtrRemote = nodeRemote->GetObject<DSRRouter> ();
-  if (rtrRemote == 0)
+  if (!nodeRemote.m_router)
     {
       // This case is possible if the remote does not participate in global routing
       return;
@@ -1103,27 +1264,26 @@ DSRRouter::ProcessPointToPointLink (Ptr<NetDevice> ndLocal, DSRRoutingLSA *pLSA)
   //
   // We're going to need the remote router ID, so we might as well get it now.
   //
-  Ipv4Address rtrIdRemote = rtrRemote->GetRouterId ();
+  Ipv4Address rtrIdRemote = nodeRemote.m_routerId;
   NS_LOG_LOGIC ("Working with remote router " << rtrIdRemote);
 
   //
-  // Now, just like we did above, we need to get the IP interface index for the 
-  // net device on the other end of the point-to-point channel.
+  // Now, just like we did above, we need the IP interface of the net device on
+  // the other end of the point-to-point channel.
   //
-  uint32_t interfaceRemote = ipv4Remote->GetNInterfaces () + 1;
-  rc = FindInterfaceForDevice (nodeRemote, ndRemote, interfaceRemote);
-  NS_ABORT_MSG_IF (rc == false, "DSRRouter::ProcessPointToPointLinks(): No interface index associated with remote device");
+  NS_ABORT_MSG_IF (deviceRemote.m_interface == DSRDeviceIndex::NONE,
+                   "DSRRouter::ProcessPointToPointLinks(): No interface index associated with remote device");
 
   //
   // Now that we have the Ipv4 interface, we can get the (remote) address and
   // mask we need.
   //
-  if (ipv4Remote->GetNAddresses (interfaceRemote) > 1)
+  if (deviceRemote.m_nAddresses > 1)
     {
       NS_LOG_WARN ("Warning, interface has multiple IP addresses; using only the primary one");
     }
-  Ipv4Address addrRemote = ipv4Remote->GetAddress (interfaceRemote, 0).GetLocal ();
-  Ipv4Mask maskRemote = ipv4Remote->GetAddress (interfaceRemote, 0).GetMask ();
+  Ipv4Address addrRemote = deviceRemote.m_address;
+  Ipv4Mask maskRemote = deviceRemote.m_mask;
   NS_LOG_LOGIC ("Working with remote address " << addrRemote);
 
   //
@@ -1132,9 +1292,9 @@ DSRRouter::ProcessPointToPointLink (Ptr<NetDevice> ndLocal, DSRRoutingLSA *pLSA)
   // the second is a stub network record with the network number.
   //
   DSRRoutingLinkRecord *plr;
-  if (ipv4Remote->IsUp (interfaceRemote))
+  if (deviceRemote.m_up)
     {
-      NS_LOG_LOGIC ("Remote side interface " << interfaceRemote << " is up-- add a type 1 link");
+      NS_LOG_LOGIC ("Remote side interface " << deviceRemote.m_interface << " is up-- add a type 1 link");
  
       plr  = new DSRRoutingLinkRecord;
       NS_ABORT_MSG_IF (plr == 0, "DSRRouter::ProcessPointToPointLink(): Can't alloc link record");
@@ -1157,12 +1317,59 @@ DSRRouter::ProcessPointToPointLink (Ptr<NetDevice> ndLocal, DSRRoutingLSA *pLSA)
   plr = 0;
 }
 
+uint32_t
+DSRRouter::GetLinkMetric (Ptr<NetDevice> ndLocal, Ptr<Ipv4> ipv4Local, uint32_t interfaceLocal) const
+{
+  NS_LOG_FUNCTION (this << ndLocal << ipv4Local << interfaceLocal);
+  EnumValue mode;
+  g_dsrLinkMetric.GetValue (mode);
+  TimeValue delay;
+  Ptr<Channel> ch = ndLocal->GetChannel ();
+  uint64_t queueing = GetQueueingDelay (interfaceLocal);
+  if (mode.Get () != ChannelDelay || ch == 0 || !ch->GetAttributeFailSafe ("Delay", delay))
+    {
+      return std::min<uint64_t> (ipv4Local->GetMetric (interfaceLocal) + queueing, DSR_MAX_LINK_METRIC);
+    }
+  uint64_t metric = delay.Get ().GetMicroSeconds () + queueing;
+  DataRateValue rate;
+  if (ndLocal->GetAttributeFailSafe ("DataRate", rate) && rate.Get ().GetBitRate () > 0)
+    {
+      metric += rate.Get ().CalculateBytesTxTime (ndLocal->GetMtu ()).GetMicroSeconds ();
+    }
+  //
+  // A zero metric would make the link free; a huge one would let a path sum
+  // reach DISTINFINITY.
+  //
+  metric = std::min<uint64_t> (std::max<uint64_t> (metric, 1), DSR_MAX_LINK_METRIC);
+  NS_LOG_LOGIC ("Link metric from channel delay " << delay.Get () << ": " << metric);
+  return metric;
+}
+
 void
-DSRRouter::BuildNetworkLSAs (NetDeviceContainer c)
+DSRRouter::SetQueueingDelay (uint32_t interface, uint32_t delay)
+{
+  NS_LOG_FUNCTION (this << interface << delay);
+  if (delay == 0)
+    {
+      m_queueingDelays.erase (interface);
+      return;
+    }
+  m_queueingDelays[interface] = delay;
+}
+
+uint32_t
+DSRRouter::GetQueueingDelay (uint32_t interface) const
+{
+  std::map<uint32_t, uint32_t>::const_iterator i = m_queueingDelays.find (interface);
+  return i == m_queueingDelays.end () ? 0 : i->second;
+}
+
+void
+DSRRouter::BuildNetworkLSAs (const DSRDeviceIndex &index, const std::vector<uint32_t> &c)
 {
   NS_LOG_FUNCTION (this << &c);
 
-  uint32_t nDesignatedRouters = c.GetN ();
+  uint32_t nDesignatedRouters = c.size ();
   NS_LOG_DEBUG ("Number of designated routers: " << nDesignatedRouters);
 
   for (uint32_t i = 0; i < nDesignatedRouters; ++i)
@@ -1171,25 +1378,21 @@ DSRRouter::BuildNetworkLSAs (NetDeviceContainer c)
       // Build one NetworkLSA for each net device talking to a network that we are the 
       // designated router for.  These devices are in the provided container.
       //
-      Ptr<NetDevice> ndLocal = c.Get (i);
-      Ptr<Node> node = ndLocal->GetNode ();
-
-      Ptr<Ipv4> ipv4Local = node->GetObject<Ipv4> ();
-      NS_ABORT_MSG_UNLESS (ipv4Local, "DSRRouter::ProcessPointToPointLink (): GetObject for <Ipv4> interface failed");
+      uint32_t ndLocal = c[i];
+      const DSRDeviceIndex::Device &deviceLocal = index.m_devices[ndLocal];
+      Ptr<Node> node = GetObject<Node> ();
 
-      uint32_t interfaceLocal = ipv4Local->GetNInterfaces () + 1;
-      bool rc = FindInterfaceForDevice (node, ndLocal, interfaceLocal);
-      NS_ABORT_MSG_IF (rc == false, "DSRRouter::BuildNetworkLSAs (): No interface index associated with device");
+      NS_ABORT_MSG_IF (deviceLocal.m_interface == DSRDeviceIndex::NONE,
+                       "DSRRouter::BuildNetworkLSAs (): No interface index associated with device");
 
-      if (ipv4Local->GetNAddresses (interfaceLocal) > 1)
+      if (deviceLocal.m_nAddresses > 1)
         {
           NS_LOG_WARN ("Warning, interface has multiple IP addresses; using only the primary one");
         }
-      Ipv4Address addrLocal = ipv4Local->GetAddress (interfaceLocal, 0).GetLocal ();
-      Ipv4Mask maskLocal = ipv4Local->GetAddress (interfaceLocal, 0).GetMask ();
+      Ipv4Address addrLocal = deviceLocal.m_address;
+      Ipv4Mask maskLocal = deviceLocal.m_mask;
 
-      DSRRoutingLSA *pLSA = new DSRRoutingLSA;
-      NS_ABORT_MSG_IF (pLSA == 0, "DSRRouter::BuildNetworkLSAs(): Can't alloc link record");
+      Ptr<DSRRoutingLSA> pLSA = Create<DSRRoutingLSA> ();
 
       pLSA->SetLSType (DSRRoutingLSA::NetworkLSA);
       pLSA->SetLinkStateId (addrLocal);
@@ -1203,32 +1406,30 @@ DSRRouter::BuildNetworkLSAs (NetDeviceContainer c)
       // and, if we find a node with a DSRRouter interface and an IPv4 
       // interface associated with that device, we call it an attached router.
       //
-      ClearBridgesVisited ();
-      Ptr<Channel> ch = ndLocal->GetChannel ();
-      std::size_t nDevices = ch->GetNDevices ();
-      NS_ASSERT (nDevices);
-      NetDeviceContainer deviceList = FindAllNonBridgedDevicesOnLink (ch);
-      NS_LOG_LOGIC ("Found " << deviceList.GetN () << " non-bridged devices on channel");
-
-      for (uint32_t i = 0; i < deviceList.GetN (); i++)
+      NS_ASSERT (deviceLocal.m_channel != DSRDeviceIndex::NONE);
+      NS_ASSERT (index.m_channels[deviceLocal.m_channel].size ());
+      std::set<uint32_t> bridgesVisited;
+      std::vector<uint32_t> deviceList;
+      FindAllNonBridgedDevicesOnLink (index, deviceLocal.m_channel, bridgesVisited, deviceList);
+      NS_LOG_LOGIC ("Found " << deviceList.size () << " non-bridged devices on channel");
+
+      for (uint32_t i = 0; i < deviceList.size (); i++)
         {
-          Ptr<NetDevice> tempNd = deviceList.Get (i);
-          NS_ASSERT (tempNd);
+          uint32_t tempNd = deviceList[i];
           if (tempNd == ndLocal)
             {
               NS_LOG_LOGIC ("Adding " << addrLocal << " to Network LSA");
               pLSA->AddAttachedRouter (addrLocal);
               continue;
             }
-          Ptr<Node> tempNode = tempNd->GetNode ();
+          const DSRDeviceIndex::Device &tempDevice = index.m_devices[tempNd];
 
           // Does the node in question have a DSRRouter interface?  If not it can
           // hardly be considered an attached router.
           //
-          Ptr<DSRRouter> rtr = tempNode->GetObject<DSRRouter> ();
-          if (rtr == 0)
+          if (!index.m_nodes[tempDevice.m_node].m_router)
             { 
-              NS_LOG_LOGIC ("Node " << tempNode->GetId () << " does not have DSRRouter interface--skipping");
+              NS_LOG_LOGIC ("Node " << tempDevice.m_node << " does not have DSRRouter interface--skipping");
               continue;
             }
 
@@ -1236,29 +1437,26 @@ DSRRouter::BuildNetworkLSAs (NetDeviceContainer c)
           // Does the attached node have an ipv4 interface for the device we're probing?
           // If not, it can't play router.
           //
-          uint32_t tempInterface = 0;
-          if (FindInterfaceForDevice (tempNode, tempNd, tempInterface))
+          if (tempDevice.m_interface != DSRDeviceIndex::NONE)
             {
-              Ptr<Ipv4> tempIpv4 = tempNode->GetObject<Ipv4> ();
-              NS_ASSERT (tempIpv4);
-              if (!tempIpv4->IsUp (tempInterface))
+              if (!tempDevice.m_up)
                 {
-                  NS_LOG_LOGIC ("Remote side interface " << tempInterface << " not up");
+                  NS_LOG_LOGIC ("Remote side interface " << tempDevice.m_interface << " not up");
                 }
               else 
                 {
-                  if (tempIpv4->GetNAddresses (tempInterface) > 1)
+                  if (tempDevice.m_nAddresses > 1)
                     {
                       NS_LOG_WARN ("Warning, interface has multiple IP addresses; using only the primary one");
                     }
-                  Ipv4Address tempAddr = tempIpv4->GetAddress (tempInterface, 0).GetLocal ();
+                  Ipv4Address tempAddr = tempDevice.m_address;
                   NS_LOG_LOGIC ("Adding " << tempAddr << " to Network LSA");
                   pLSA->AddAttachedRouter (tempAddr);
                 }
             }
           else
             {
-              NS_LOG_LOGIC ("Node " << tempNode->GetId () << " device " << tempNd << " does not have IPv4 interface; skipping");
+              NS_LOG_LOGIC ("Node " << tempDevice.m_node << " device " << tempNd << " does not have IPv4 interface; skipping");
             }
         }
       m_LSAs.push_back (pLSA);
@@ -1268,43 +1466,44 @@ DSRRouter::BuildNetworkLSAs (NetDeviceContainer c)
     }
 }
 
-NetDeviceContainer
-DSRRouter::FindAllNonBridgedDevicesOnLink (Ptr<Channel> ch) const
+void
+DSRRouter::FindAllNonBridgedDevicesOnLink (const DSRDeviceIndex &index, uint32_t ch,
+                                           std::set<uint32_t> &bridgesVisited,
+                                           std::vector<uint32_t> &devices) const
 {
   NS_LOG_FUNCTION (this << ch);
-  NetDeviceContainer c;
+  const std::vector<uint32_t> &onChannel = index.m_channels[ch];
 
-  for (std::size_t i = 0; i < ch->GetNDevices (); i++)
+  for (std::size_t i = 0; i < onChannel.size (); i++)
     {
-      Ptr<NetDevice> nd = ch->GetDevice (i);
+      uint32_t nd = onChannel[i];
       NS_LOG_LOGIC ("checking to see if the device " << nd << " is bridged");
-      Ptr<BridgeNetDevice> bnd = NetDeviceIsBridged (nd);
-      if (bnd && BridgeHasAlreadyBeenVisited (bnd) == false)
+      uint32_t bnd = index.m_devices[nd].m_bridge;
+      if (bnd != DSRDeviceIndex::NONE && bridgesVisited.insert (bnd).second)
         {
-          NS_LOG_LOGIC ("Device is bridged by BridgeNetDevice " << bnd << " with " << bnd->GetNBridgePorts () << " ports");
-          MarkBridgeAsVisited (bnd);
+          const std::vector<uint32_t> &ports = index.m_bridgePorts.find (bnd)->second;
+          NS_LOG_LOGIC ("Device is bridged by BridgeNetDevice " << bnd << " with " << ports.size () << " ports");
           // Find all channels bridged together, and recursively call
           // on all other channels
-          for (uint32_t j = 0; j < bnd->GetNBridgePorts (); j++)
+          for (uint32_t j = 0; j < ports.size (); j++)
             {
-              Ptr<NetDevice> bridgedDevice = bnd->GetBridgePort (j);
-              if (bridgedDevice->GetChannel () == ch)
+              uint32_t bridgedChannel = index.m_devices[ports[j]].m_channel;
+              if (bridgedChannel == ch || bridgedChannel == DSRDeviceIndex::NONE)
                 {
                   NS_LOG_LOGIC ("Skipping my own device/channel");
                   continue;
                 }
-              NS_LOG_LOGIC ("Calling on channel " << bridgedDevice->GetChannel ());
-              c.Add (FindAllNonBridgedDevicesOnLink (bridgedDevice->GetChannel ()));
+              NS_LOG_LOGIC ("Calling on channel " << bridgedChannel);
+              FindAllNonBridgedDevicesOnLink (index, bridgedChannel, bridgesVisited, devices);
             }
         }
       else
         {
           NS_LOG_LOGIC ("Device is not bridged; adding");
-          c.Add (nd);
+          devices.push_back (nd);
         }
     }
-  NS_LOG_LOGIC ("Found " << c.GetN () << " devices");
-  return c;
+  NS_LOG_LOGIC ("Found " << devices.size () << " devices");
 }
 
 //
@@ -1314,16 +1513,19 @@ DSRRouter::FindAllNonBridgedDevicesOnLink (Ptr<Channel> ch) const
 // connecting to the channel becomes the designated router for the link.
 //
 Ipv4Address
-DSRRouter::FindDesignatedRouterForLink (Ptr<NetDevice> ndLocal) const
+DSRRouter::FindDesignatedRouterForLink (const DSRDeviceIndex &index, uint32_t ndLocal,
+                                        std::set<uint32_t> &bridgesVisited) const
 {
   NS_LOG_FUNCTION (this << ndLocal);
 
-  Ptr<Channel> ch = ndLocal->GetChannel ();
-  uint32_t nDevices = ch->GetNDevices ();
+  uint32_t ch = index.m_devices[ndLocal].m_channel;
+  NS_ASSERT (ch != DSRDeviceIndex::NONE);
+  const std::vector<uint32_t> &onChannel = index.m_channels[ch];
+  uint32_t nDevices = onChannel.size ();
   NS_ASSERT (nDevices);
 
   NS_LOG_LOGIC ("Looking for designated router off of net device " << ndLocal << " on node " << 
-                ndLocal->GetNode ()->GetId ());
+                index.m_devices[ndLocal].m_node);
 
   Ipv4Address desigRtr ("255.255.255.255");
 
@@ -1333,12 +1535,10 @@ DSRRouter::FindDesignatedRouterForLink (Ptr<NetDevice> ndLocal) const
   //
   for (uint32_t i = 0; i < nDevices; i++)
     {
-      Ptr<NetDevice> ndOther = ch->GetDevice (i);
-      NS_ASSERT (ndOther);
+      uint32_t ndOther = onChannel[i];
+      const DSRDeviceIndex::Node &nodeOther = index.m_nodes[index.m_devices[ndOther].m_node];
 
-      Ptr<Node> nodeOther = ndOther->GetNode ();
-
-      NS_LOG_LOGIC ("Examine channel device " << i << " on node " << nodeOther->GetId ());
+      NS_LOG_LOGIC ("Examine channel device " << i << " on node " << index.m_devices[ndOther].m_node);
 
       //
       // For all other net devices, we need to check and see if a router
@@ -1347,8 +1547,8 @@ DSRRouter::FindDesignatedRouterForLink (Ptr<NetDevice> ndLocal) const
       // bridge as well (all of the bridge ports.
       //
       NS_LOG_LOGIC ("checking to see if the device is bridged");
-      Ptr<BridgeNetDevice> bnd = NetDeviceIsBridged (ndOther);
-      if (bnd)
+      uint32_t bnd = index.m_devices[ndOther].m_bridge;
+      if (bnd != DSRDeviceIndex::NONE)
         {
           NS_LOG_LOGIC ("Device is bridged by BridgeNetDevice " << bnd);
 
@@ -1371,28 +1571,22 @@ DSRRouter::FindDesignatedRouterForLink (Ptr<NetDevice> ndLocal) const
           // it can't play router.
           //
           NS_LOG_LOGIC ("Checking for router on bridge net device " << bnd);
-          Ptr<DSRRouter> rtr = nodeOther->GetObject<DSRRouter> ();
-          Ptr<Ipv4> ipv4 = nodeOther->GetObject<Ipv4> ();
-          if (rtr && ipv4)
+          const DSRDeviceIndex::Device &bridge = index.m_devices[bnd];
+          if (nodeOther.m_router && nodeOther.m_ipv4 && bridge.m_interface != DSRDeviceIndex::NONE)
             {
-              // Initialize to value out of bounds to silence compiler
-              uint32_t interfaceOther = ipv4->GetNInterfaces () + 1;
-              if (FindInterfaceForDevice (nodeOther, bnd, interfaceOther))
+              NS_LOG_LOGIC ("Found router on bridge net device " << bnd);
+              if (!bridge.m_up)
                 {
-                  NS_LOG_LOGIC ("Found router on bridge net device " << bnd);
-                  if (!ipv4->IsUp (interfaceOther))
-                    {
-                      NS_LOG_LOGIC ("Remote side interface " << interfaceOther << " not up");
-                      continue;
-                    }
-                  if (ipv4->GetNAddresses (interfaceOther) > 1)
-                    {
-                      NS_LOG_WARN ("Warning, interface has multiple IP addresses; using only the primary one");
-                    }
-                  Ipv4Address addrOther = ipv4->GetAddress (interfaceOther, 0).GetLocal ();
-                  desigRtr = addrOther < desigRtr ? addrOther : desigRtr;
-                  NS_LOG_LOGIC ("designated router now " << desigRtr);
+                  NS_LOG_LOGIC ("Remote side interface " << bridge.m_interface << " not up");
+                  continue;
+                }
+              if (bridge.m_nAddresses > 1)
+                {
+                  NS_LOG_WARN ("Warning, interface has multiple IP addresses; using only the primary one");
                 }
+              Ipv4Address addrOther = bridge.m_address;
+              desigRtr = addrOther < desigRtr ? addrOther : desigRtr;
+              NS_LOG_LOGIC ("designated router now " << desigRtr);
             }
 
           // 
@@ -1401,17 +1595,16 @@ DSRRouter::FindDesignatedRouterForLink (Ptr<NetDevice> ndLocal) const
           // to us, go ahead and process it. If we have already processed it,
           // move to the next
           // 
-          if(BridgeHasAlreadyBeenVisited(bnd))
+          if (!bridgesVisited.insert (bnd).second)
             {
               NS_ABORT_MSG ("ERROR: L2 forwarding loop detected!");
             }
 
-          MarkBridgeAsVisited(bnd);
-
           NS_LOG_LOGIC ("Looking through bridge ports of bridge net device " << bnd);
-          for (uint32_t j = 0; j < bnd->GetNBridgePorts (); ++j)
+          const std::vector<uint32_t> &ports = index.m_bridgePorts.find (bnd)->second;
+          for (uint32_t j = 0; j < ports.size (); ++j)
             {
-              Ptr<NetDevice> ndBridged = bnd->GetBridgePort (j);
+              uint32_t ndBridged = ports[j];
               NS_LOG_LOGIC ("Examining bridge port " << j << " device " << ndBridged);
               if (ndBridged == ndOther)
                 {
@@ -1420,7 +1613,7 @@ DSRRouter::FindDesignatedRouterForLink (Ptr<NetDevice> ndLocal) const
                 }
 
               NS_LOG_LOGIC ("Recursively looking for routers down bridge port " << ndBridged);
-              Ipv4Address addrOther = FindDesignatedRouterForLink (ndBridged);
+              Ipv4Address addrOther = FindDesignatedRouterForLink (index, ndBridged, bridgesVisited);
               desigRtr = addrOther < desigRtr ? addrOther : desigRtr;
               NS_LOG_LOGIC ("designated router now " << desigRtr);
             }
@@ -1428,35 +1621,27 @@ DSRRouter::FindDesignatedRouterForLink (Ptr<NetDevice> ndLocal) const
       else
         {
           NS_LOG_LOGIC ("This device is not bridged");
-          Ptr<Node> nodeOther = ndOther->GetNode ();
-          NS_ASSERT (nodeOther);
 
           //
           // We require a designated router to have a DSRRouter interface and
           // an internet stack that includes the Ipv4 interface.  If it doesn't
           //
-          Ptr<DSRRouter> rtr = nodeOther->GetObject<DSRRouter> ();
-          Ptr<Ipv4> ipv4 = nodeOther->GetObject<Ipv4> ();
-          if (rtr && ipv4)
+          const DSRDeviceIndex::Device &other = index.m_devices[ndOther];
+          if (nodeOther.m_router && nodeOther.m_ipv4 && other.m_interface != DSRDeviceIndex::NONE)
             {
-              // Initialize to value out of bounds to silence compiler
-              uint32_t interfaceOther = ipv4->GetNInterfaces () + 1;
-              if (FindInterfaceForDevice (nodeOther, ndOther, interfaceOther))
+              if (!other.m_up)
                 {
-                  if (!ipv4->IsUp (interfaceOther))
-                    {
-                      NS_LOG_LOGIC ("Remote side interface " << interfaceOther << " not up");
-                      continue;
-                    }
-                  NS_LOG_LOGIC ("Found router on net device " << ndOther);
-                  if (ipv4->GetNAddresses (interfaceOther) > 1)
-                    {
-                      NS_LOG_WARN ("Warning, interface has multiple IP addresses; using only the primary one");
-                    }
-                  Ipv4Address addrOther = ipv4->GetAddress (interfaceOther, 0).GetLocal ();
-                  desigRtr = addrOther < desigRtr ? addrOther : desigRtr;
-                  NS_LOG_LOGIC ("designated router now " << desigRtr);
+                  NS_LOG_LOGIC ("Remote side interface " << other.m_interface << " not up");
+                  continue;
+                }
+              NS_LOG_LOGIC ("Found router on net device " << ndOther);
+              if (other.m_nAddresses > 1)
+                {
+                  NS_LOG_WARN ("Warning, interface has multiple IP addresses; using only the primary one");
                 }
+              Ipv4Address addrOther = other.m_address;
+              desigRtr = addrOther < desigRtr ? addrOther : desigRtr;
+              NS_LOG_LOGIC ("designated router now " << desigRtr);
             }
         }
     }
@@ -1470,20 +1655,22 @@ DSRRouter::FindDesignatedRouterForLink (Ptr<NetDevice> ndLocal) const
 // when there is a bridged net device on the other side.
 //
 bool
-DSRRouter::AnotherRouterOnLink (Ptr<NetDevice> nd) const
+DSRRouter::AnotherRouterOnLink (const DSRDeviceIndex &index, uint32_t nd,
+                                std::set<uint32_t> &bridgesVisited) const
 {
   NS_LOG_FUNCTION (this << nd);
 
-  Ptr<Channel> ch = nd->GetChannel ();
-  if (!ch)
+  uint32_t ch = index.m_devices[nd].m_channel;
+  if (ch == DSRDeviceIndex::NONE)
     {
       // It may be that this net device is a stub device, without a channel
       return false;
     }
-  uint32_t nDevices = ch->GetNDevices ();
+  const std::vector<uint32_t> &onChannel = index.m_channels[ch];
+  uint32_t nDevices = onChannel.size ();
   NS_ASSERT (nDevices);
 
-  NS_LOG_LOGIC ("Looking for routers off of net device " << nd << " on node " << nd->GetNode ()->GetId ());
+  NS_LOG_LOGIC ("Looking for routers off of net device " << nd << " on node " << index.m_devices[nd].m_node);
 
   //
   // Look through all of the devices on the channel to which the net device
@@ -1491,10 +1678,9 @@ DSRRouter::AnotherRouterOnLink (Ptr<NetDevice> nd) const
   //
   for (uint32_t i = 0; i < nDevices; i++)
     {
-      Ptr<NetDevice> ndOther = ch->GetDevice (i);
-      NS_ASSERT (ndOther);
+      uint32_t ndOther = onChannel[i];
 
-      NS_LOG_LOGIC ("Examine channel device " << i << " on node " << ndOther->GetNode ()->GetId ());
+      NS_LOG_LOGIC ("Examine channel device " << i << " on node " << index.m_devices[ndOther].m_node);
 
       // 
       // Ignore the net device itself.
@@ -1512,8 +1698,8 @@ DSRRouter::AnotherRouterOnLink (Ptr<NetDevice> nd) const
       // bridge.
       //
       NS_LOG_LOGIC ("checking to see if device is bridged");
-      Ptr<BridgeNetDevice> bnd = NetDeviceIsBridged (ndOther);
-      if (bnd)
+      uint32_t bnd = index.m_devices[ndOther].m_bridge;
+      if (bnd != DSRDeviceIndex::NONE)
         {
           NS_LOG_LOGIC ("Device is bridged by net device " << bnd);
 
@@ -1523,17 +1709,16 @@ DSRRouter::AnotherRouterOnLink (Ptr<NetDevice> nd) const
           // to us, go ahead and process it. If we have already processed it,
           // move to the next
           // 
-          if(BridgeHasAlreadyBeenVisited(bnd))
+          if (!bridgesVisited.insert (bnd).second)
             {
               NS_ABORT_MSG ("ERROR: L2 forwarding loop detected!");
             }
 
-          MarkBridgeAsVisited(bnd);
-
           NS_LOG_LOGIC ("Looking through bridge ports of bridge net device " << bnd);
-          for (uint32_t j = 0; j < bnd->GetNBridgePorts (); ++j)
+          const std::vector<uint32_t> &ports = index.m_bridgePorts.find (bnd)->second;
+          for (uint32_t j = 0; j < ports.size (); ++j)
             {
-              Ptr<NetDevice> ndBridged = bnd->GetBridgePort (j);
+              uint32_t ndBridged = ports[j];
               NS_LOG_LOGIC ("Examining bridge port " << j << " device " << ndBridged);
               if (ndBridged == ndOther)
                 {
@@ -1542,7 +1727,7 @@ DSRRouter::AnotherRouterOnLink (Ptr<NetDevice> nd) const
                 }
 
               NS_LOG_LOGIC ("Recursively looking for routers on bridge port " << ndBridged);
-              if (AnotherRouterOnLink (ndBridged))
+              if (AnotherRouterOnLink (index, ndBridged, bridgesVisited))
                 {
                   NS_LOG_LOGIC ("Found routers on bridge port, return true");
                   return true;
@@ -1553,11 +1738,7 @@ DSRRouter::AnotherRouterOnLink (Ptr<NetDevice> nd) const
         }
 
       NS_LOG_LOGIC ("This device is not bridged");
-      Ptr<Node> nodeTemp = ndOther->GetNode ();
-      NS_ASSERT (nodeTemp);
-
-      Ptr<DSRRouter> rtr = nodeTemp->GetObject<DSRRouter> ();
-      if (rtr)
+      if (index.m_nodes[index.m_devices[ndOther].m_node].m_router)
         {
           NS_LOG_LOGIC ("Found DSRRouter interface, return true");
           return true;
@@ -1588,25 +1769,28 @@ DSRRouter::GetLSA (uint32_t n, DSRRoutingLSA &lsa) const
   NS_ASSERT_MSG (lsa.IsEmpty (), "DSRRouter::GetLSA (): Must pass empty LSA");
 //
 // All of the work was done in GetNumLSAs.  All we have to do here is to
-// walk the list of link state advertisements created there and return the 
-// one the client is interested in.
+// copy the link state advertisement the client is interested in.
 //
-  ListOfLSAs_t::const_iterator i = m_LSAs.begin ();
-  uint32_t j = 0;
-
-  for (; i != m_LSAs.end (); i++, j++)
+  if (n < m_LSAs.size ())
     {
-      if (j == n)
-        {
-          DSRRoutingLSA *p = *i;
-          lsa = *p;
-          return true;
-        }
+      lsa = *m_LSAs[n];
+      return true;
     }
 
   return false;
 }
 
+Ptr<DSRRoutingLSA>
+DSRRouter::GetLSA (uint32_t n) const
+{
+  NS_LOG_FUNCTION (this << n);
+  if (n < m_LSAs.size ())
+    {
+      return m_LSAs[n];
+    }
+  return 0;
+}
+
 void
 DSRRouter::InjectRoute (Ipv4Address network, Ipv4Mask networkMask)
 {
@@ -1692,16 +1876,18 @@ DSRRouter::WithdrawRoute (Ipv4Address network, Ipv4Mask networkMask)
 // Link through the given channel and find the net device that's on the
 // other end.  This only makes sense with a point-to-point channel.
 //
-Ptr<NetDevice>
-DSRRouter::GetAdjacent (Ptr<NetDevice> nd, Ptr<Channel> ch) const
+uint32_t
+DSRRouter::GetAdjacent (const DSRDeviceIndex &index, uint32_t nd) const
 {
-  NS_LOG_FUNCTION (this << nd << ch);
-  NS_ASSERT_MSG (ch->GetNDevices () == 2, "DSRRouter::GetAdjacent (): Channel with other than two devices");
+  NS_LOG_FUNCTION (this << nd);
+  uint32_t ch = index.m_devices[nd].m_channel;
+  NS_ASSERT_MSG (ch != DSRDeviceIndex::NONE && index.m_channels[ch].size () == 2,
+                 "DSRRouter::GetAdjacent (): Channel with other than two devices");
 //
 // This is a point to point channel with two endpoints.  Get both of them.
 //
-  Ptr<NetDevice> nd1 = ch->GetDevice (0);
-  Ptr<NetDevice> nd2 = ch->GetDevice (1);
+  uint32_t nd1 = index.m_channels[ch][0];
+  uint32_t nd2 = index.m_channels[ch][1];
 //
 // One of the endpoints is going to be "us" -- that is the net device attached
 // to the node on which we're running -- i.e., "nd".  The other endpoint (the
@@ -1719,123 +1905,8 @@ DSRRouter::GetAdjacent (Ptr<NetDevice> nd, Ptr<Channel> ch) const
     {
       NS_ASSERT_MSG (false,
                      "DSRRouter::GetAdjacent (): Wrong or confused channel?");
-      return 0;
-    }
-}
-
-//
-// Given a node and a net device, find an IPV4 interface index that corresponds
-// to that net device.  This function may fail for various reasons.  If a node
-// does not have an internet stack (for example if it is a bridge) we won't have
-// an IPv4 at all.  If the node does have a stack, but the net device in question
-// is bridged, there will not be an interface associated directly with the device.
-//
-bool
-DSRRouter::FindInterfaceForDevice (Ptr<Node> node, Ptr<NetDevice> nd, uint32_t &index) const
-{
-  NS_LOG_FUNCTION (this << node << nd << &index);
-  NS_LOG_LOGIC ("For node " << node->GetId () << " for net device " << nd );
-
-  Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
-  if (ipv4 == 0)
-    {
-      NS_LOG_LOGIC ("No Ipv4 interface on node " << node->GetId ());
-      return false;
-    }
-
-  for (uint32_t i = 0; i < ipv4->GetNInterfaces (); ++i )
-    {
-      if (ipv4->GetNetDevice (i) == nd)
-        {
-          NS_LOG_LOGIC ("Device " << nd << " has associated ipv4 index " << i);
-          index = i;
-          return true;
-        }
-    }
-
-  NS_LOG_LOGIC ("Device " << nd << " has no associated ipv4 index");
-  return false;
-}
-
-//
-// Decide whether or not a given net device is being bridged by a BridgeNetDevice.
-//
-Ptr<BridgeNetDevice>
-DSRRouter::NetDeviceIsBridged (Ptr<NetDevice> nd) const
-{
-  NS_LOG_FUNCTION (this << nd);
-
-  Ptr<Node> node = nd->GetNode ();
-  uint32_t nDevices = node->GetNDevices ();
-
-  //
-  // There is no bit on a net device that says it is being bridged, so we have
-  // to look for bridges on the node to which the device is attached.  If we
-  // find a bridge, we need to look through its bridge ports (the devices it
-  // bridges) to see if we find the device in question.
-  //
-  for (uint32_t i = 0; i < nDevices; ++i)
-    {
-      Ptr<NetDevice> ndTest = node->GetDevice (i);
-      NS_LOG_LOGIC ("Examine device " << i << " " << ndTest);
-
-      if (ndTest->IsBridge ())
-        {
-          NS_LOG_LOGIC ("device " << i << " is a bridge net device");
-          Ptr<BridgeNetDevice> bnd = ndTest->GetObject<BridgeNetDevice> ();
-          NS_ABORT_MSG_UNLESS (bnd, "DSRRouter::DiscoverLSAs (): GetObject for <BridgeNetDevice> failed");
-
-          for (uint32_t j = 0; j < bnd->GetNBridgePorts (); ++j)
-            {
-              NS_LOG_LOGIC ("Examine bridge port " << j << " " << bnd->GetBridgePort (j));
-              if (bnd->GetBridgePort (j) == nd)
-                {
-                  NS_LOG_LOGIC ("Net device " << nd << " is bridged by " << bnd);
-                  return bnd;
-                }
-            }
-        }
-    }
-  NS_LOG_LOGIC ("Net device " << nd << " is not bridged");
-  return 0;
-}
-
-//
-// Start a new enumeration of an L2 broadcast domain by clearing m_bridgesVisited
-//
-void 
-DSRRouter::ClearBridgesVisited (void) const
-{
-  m_bridgesVisited.clear();
-}
-
-//
-// Check if we have already visited a given bridge net device by searching m_bridgesVisited
-//
-bool
-DSRRouter::BridgeHasAlreadyBeenVisited (Ptr<BridgeNetDevice> bridgeNetDevice) const
-{
-  std::vector<Ptr<BridgeNetDevice> >::iterator iter;
-  for (iter = m_bridgesVisited.begin (); iter != m_bridgesVisited.end (); ++iter)
-    {
-      if (bridgeNetDevice == *iter)
-        {
-          NS_LOG_LOGIC ("Bridge " << bridgeNetDevice << " has been visited.");
-          return true;
-        }
+      return DSRDeviceIndex::NONE;
     }
-  return false;
-}
-
-//
-// Remember that we visited a bridge net device by adding it to m_bridgesVisited
-//
-void 
-DSRRouter::MarkBridgeAsVisited (Ptr<BridgeNetDevice> bridgeNetDevice) const
-{
-  NS_LOG_FUNCTION (this << bridgeNetDevice);
-  m_bridgesVisited.push_back (bridgeNetDevice);
 }
 
-
 } // namespace ns3
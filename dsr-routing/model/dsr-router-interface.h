@@ -24,8 +24,12 @@
 
 #include <stdint.h>
 #include <list>
+#include <map>
+#include <set>
+#include <vector>
 #include "ns3/object.h"
 #include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
 #include "ns3/node.h"
 #include "ns3/channel.h"
 #include "ns3/ipv4-address.h"
@@ -97,7 +101,7 @@ public:
     LinkType    linkType, 
     Ipv4Address linkId, 
     Ipv4Address linkData, 
-    uint16_t    metric);
+    uint32_t    metric);
 
 /**
  * @brief Destroy a Global Routing Link Record.
@@ -191,7 +195,7 @@ public:
  *
  * @returns The metric field of the Global Routing Link Record.
  */
-  uint16_t GetMetric (void) const;
+  uint32_t GetMetric (void) const;
 
 /**
  * @brief Set the Metric Data field of the Global Routing Link Record.
@@ -204,7 +208,7 @@ public:
  *
  * @param metric The new metric for the current Global Routing Link Record.
  */
-  void SetMetric (uint16_t metric);
+  void SetMetric (uint32_t metric);
 
 private:
 /**
@@ -243,9 +247,10 @@ private:
  * link.  A sum of metrics must have a well-defined meaning.  That is, you 
  * shouldn't use bandwidth as a metric (how does the sum of the bandwidth 
  * of two hops relate to the cost of sending a packet); rather you should
- * use something like delay.
+ * use something like delay.  It is 32 bits wide so that delays in
+ * microseconds fit.
  */
-  uint16_t m_metric;
+  uint32_t m_metric;
 };
 
 /**
@@ -255,8 +260,13 @@ private:
  * Roughly equivalent to a global incarnation of the OSPF link state header
  * combined with a list of Link Records.  Since it's global, there's
  * no need for age or sequence number.  See \RFC{2328}, Appendix A.
+ *
+ * The LSAs a DSRRouter discovers are not changed afterwards: they are
+ * reference counted and shared between the router and the link state
+ * database, rather than copied into it.  The link records are stored by
+ * value in a contiguous vector.
  */
-class DSRRoutingLSA
+class DSRRoutingLSA : public SimpleRefCount<DSRRoutingLSA>
 {
 public:
 /**
@@ -347,11 +357,21 @@ public:
 /**
  * @brief Add a given Global Routing Link Record to the LSA.
  *
+ * The record is copied into the LSA and then freed.
+ *
  * @param lr The Global Routing Link Record to be added.
  * @returns The number of link records in the list.
  */
   uint32_t AddLinkRecord (DSRRoutingLinkRecord* lr);
 
+/**
+ * @brief Add a copy of a given Global Routing Link Record to the LSA.
+ *
+ * @param lr The Global Routing Link Record to be added.
+ * @returns The number of link records in the list.
+ */
+  uint32_t AddLinkRecord (const DSRRoutingLinkRecord& lr);
+
 /**
  * @brief Return the number of Global Routing Link Records in the LSA.
  *
@@ -362,10 +382,12 @@ public:
 /**
  * @brief Return a pointer to the specified Global Routing Link Record.
  *
- * @param n The LSA number desired.
- * @returns The number of link records in the list.
+ * The pointer is valid until a link record is added to the LSA.
+ *
+ * @param n The link record number desired.
+ * @returns A pointer to the link record.
  */
-  DSRRoutingLinkRecord* GetLinkRecord (uint32_t n) const;
+  const DSRRoutingLinkRecord* GetLinkRecord (uint32_t n) const;
 
 /**
  * @brief Release all of the Global Routing Link Records present in the Global
@@ -381,6 +403,17 @@ public:
  */
   bool IsEmpty (void) const;
 
+/**
+ * @brief Check whether another LSA advertises the same links.
+ *
+ * The SPF status is not compared.
+ *
+ * @param lsa The LSA to compare with.
+ * @returns True if the type, the identifiers, the node, the network mask,
+ * the link records and the attached routers are all the same.
+ */
+  bool IsEquivalent (const DSRRoutingLSA& lsa) const;
+
 /**
  * @brief Print the contents of the Global Routing Link State Advertisement and
  * any Global Routing Link Records present in the list.  Quite verbose.
@@ -530,14 +563,14 @@ private:
 /**
  * A convenience typedef to avoid too much writers cramp.
  */
-  typedef std::list<DSRRoutingLinkRecord*> ListOfLinkRecords_t;
+  typedef std::vector<DSRRoutingLinkRecord> ListOfLinkRecords_t;
 
 /**
  * Each Link State Advertisement contains a number of Link Records that
  * describe the kinds of links that are attached to a given node.  We 
  * consider PointToPoint and StubNetwork links.
  *
- * m_linkRecords is an STL list container to hold the Link Records that have
+ * m_linkRecords is an STL vector container to hold the Link Records that have
  * been discovered and prepared for the advertisement.
  *
  * @see GlobalRouting::DiscoverLSAs ()
@@ -583,6 +616,79 @@ private:
  */
 std::ostream& operator<< (std::ostream& os, DSRRoutingLSA& lsa);
 
+/**
+ * @brief The net devices, Ipv4 interfaces and channels of all the nodes,
+ * as LSA discovery reads them.
+ *
+ * Discovery needs to know, for every device it meets, which Ipv4 interface
+ * and which bridge the device belongs to, which the nodes only answer by
+ * scanning their lists.  Build () reads every node once, on the main
+ * thread, and indexes the devices by number.  The index holds no Ptr and
+ * no ns-3 object is queried through it, so several routers can discover
+ * their LSAs from the same index concurrently.
+ */
+class DSRDeviceIndex
+{
+public:
+  /// No interface, channel or bridge
+  static const uint32_t NONE = 0xffffffff;
+
+  /**
+   * @brief A net device, with the primary address of its first Ipv4
+   * interface
+   */
+  struct Device
+  {
+    uint32_t m_node;         //!< ID of the node of the device
+    uint32_t m_channel;      //!< index of the channel, NONE if there is none
+    uint32_t m_bridge;       //!< device index of the bridge the device is a port of, or NONE
+    uint32_t m_interface;    //!< first Ipv4 interface of the device, or NONE
+    uint32_t m_nAddresses;   //!< number of addresses of the interface
+    Ipv4Address m_address;   //!< first local address of the interface
+    Ipv4Mask m_mask;         //!< network mask of that address
+    uint16_t m_metric;       //!< metric of the interface
+    uint32_t m_linkMetric;   //!< DSRRouter::GetLinkMetric () of forwarding point-to-point devices of routers
+    bool m_up;               //!< the interface is up
+    bool m_forwarding;       //!< some interface of the device is up and forwarding
+    bool m_loopback;         //!< the device is a LoopbackNetDevice
+    bool m_broadcast;        //!< NetDevice::IsBroadcast ()
+    bool m_pointToPoint;     //!< NetDevice::IsPointToPoint ()
+    bool m_isBridge;         //!< NetDevice::IsBridge ()
+  };
+
+  /**
+   * @brief A node: its devices are numbered m_firstDevice onwards, in the
+   * order of Node::GetDevice ()
+   */
+  struct Node
+  {
+    uint32_t m_firstDevice;  //!< device index of the first device
+    uint32_t m_nDevices;     //!< number of devices
+    bool m_ipv4;             //!< the node has an Ipv4
+    bool m_router;           //!< the node has a DSRRouter
+    Ipv4Address m_routerId;  //!< router ID of the DSRRouter
+  };
+
+  /**
+   * @brief Rebuild the index from the nodes of the NodeList.
+   *
+   * Must run on the main thread.  Each node, device, interface and channel
+   * is queried once, and the bridge ports and channels are linked through
+   * hash maps, so the cost is linear in the number of devices.
+   */
+  void Build (void);
+
+  /**
+   * @brief Release all the arrays
+   */
+  void Clear (void);
+
+  std::vector<Node> m_nodes;                         //!< nodes, by node ID
+  std::vector<Device> m_devices;                     //!< devices of all the nodes
+  std::vector<std::vector<uint32_t> > m_channels;    //!< devices of each channel, in channel order
+  std::map<uint32_t, std::vector<uint32_t> > m_bridgePorts; //!< ports of each bridge, by device index
+};
+
 /**
  * @brief An interface aggregated to a node to provide global routing info
  *
@@ -601,6 +707,17 @@ public:
    */
   static TypeId GetTypeId (void);
 
+  /**
+   * @enum LinkMetric
+   * @brief Where the metric of a point-to-point link record comes from,
+   * selected by the DsrLinkMetric global value.
+   */
+  enum LinkMetric
+  {
+    InterfaceMetric, /**< The metric of the Ipv4 interface, set by hand */
+    ChannelDelay     /**< Channel delay plus MTU serialization time, in microseconds */
+  };
+
 /**
  * @brief Create a Global Router class 
  */
@@ -629,6 +746,17 @@ public:
  */
   Ipv4Address GetRouterId (void) const;
 
+/**
+ * @brief Get the area of the router.
+ *
+ * With DSRRouteManager::AddAreaRange (), the routers of other areas reach
+ * the addresses of this area's ranges through one summary route per range
+ * instead of one host route per address.
+ *
+ * @returns The AreaId attribute, 0 unless set.
+ */
+  uint32_t GetAreaId (void) const;
+
 /**
  * @brief Walk the connected channels, discover the adjacent routers and build
  * the associated number of Global Routing Link State Advertisements that 
@@ -642,12 +770,26 @@ public:
  * advertisements after a network topology change by calling DiscoverLSAs 
  * and then by reading those advertisements.
  *
+ * This builds a DSRDeviceIndex of the whole network for the one router;
+ * DSRRouteManagerImpl builds one index and hands it to every router.
+ *
  * @see GlobalRoutingLSA
  * @see GlobalRouter::GetLSA ()
  * @returns The number of Global Routing Link State Advertisements.
  */
   uint32_t DiscoverLSAs (void);
 
+/**
+ * @brief Discover the LSAs of this router from an index of the devices.
+ *
+ * Only the router itself and its node are touched besides the index, so
+ * distinct routers can run this concurrently on the same index.
+ *
+ * @param index the devices of all the nodes, built after the last change
+ * @returns The number of Global Routing Link State Advertisements.
+ */
+  uint32_t DiscoverLSAs (const DSRDeviceIndex &index);
+
 /**
  * @brief Get the Number of Global Routing Link State Advertisements that this
  * router can export.
@@ -685,6 +827,20 @@ public:
  */
   bool GetLSA (uint32_t n, DSRRoutingLSA &lsa) const;
 
+/**
+ * @brief Get a Global Routing Link State Advertisement that this router has
+ * said that it can export, without copying it.
+ *
+ * The LSA is shared with the router and must not be modified.  DiscoverLSAs
+ * keeps the LSAs whose content did not change, so after a topology change
+ * only the LSAs of the routers the change touched are new objects.
+ *
+ * @see GlobalRouting::GetNumLSAs ()
+ * @param n The index number of the LSA you want to read.
+ * @returns The LSA, or 0 if n is out of range.
+ */
+  Ptr<DSRRoutingLSA> GetLSA (uint32_t n) const;
+
 /**
  * @brief Inject a route to be circulated to other routers as an external
  * route
@@ -733,6 +889,43 @@ public:
  */
   bool WithdrawRoute (Ipv4Address network, Ipv4Mask networkMask);
 
+  /**
+   * \brief Compute the metric of a point-to-point link
+   *
+   * With DsrLinkMetric set to ChannelDelay, the metric is the propagation
+   * delay of the channel plus the time the device takes to serialize an
+   * MTU-sized packet at its DataRate, in microseconds.  Otherwise, or when
+   * the channel has no Delay attribute, it is the metric of the interface.
+   * Either way, the queueing delay set by SetQueueingDelay () is added, and
+   * the sum is clamped to 2^24 - 1.  A DialBuckets SPF queue only handles
+   * metrics below 65536 and falls back to a binary heap above.
+   *
+   * \param ndLocal the local NetDevice of the link
+   * \param ipv4Local the local Ipv4
+   * \param interfaceLocal the Ipv4 interface of ndLocal
+   * \returns the metric, at least 1
+   */
+  uint32_t GetLinkMetric (Ptr<NetDevice> ndLocal, Ptr<Ipv4> ipv4Local, uint32_t interfaceLocal) const;
+
+  /**
+   * \brief Set the queueing delay added to the metric of an interface
+   *
+   * GetLinkMetric () adds it to the metric of the point-to-point links of
+   * the interface, so that the next LSAs advertise it.  DSRRouteController
+   * sets it from the backlog of the interface queue.
+   *
+   * \param interface the Ipv4 interface
+   * \param delay the queueing delay, in microseconds
+   */
+  void SetQueueingDelay (uint32_t interface, uint32_t delay);
+
+  /**
+   * \brief Get the queueing delay added to the metric of an interface
+   * \param interface the Ipv4 interface
+   * \returns the queueing delay in microseconds, 0 unless set
+   */
+  uint32_t GetQueueingDelay (uint32_t interface) const;
+
 private:
   virtual ~DSRRouter ();
 
@@ -746,27 +939,11 @@ private:
    *
    * This only makes sense with a point-to-point channel.
    *
-   * \param nd outgoing NetDevice
-   * \param ch channel
-   * \returns the NetDevice on the other end
-   */
-  Ptr<NetDevice> GetAdjacent (Ptr<NetDevice> nd, Ptr<Channel> ch) const;
-
-  /**
-   * \brief Given a node and a net device, find an IPV4 interface index that corresponds
-   *        to that net device.
-   *
-   * This function may fail for various reasons.  If a node
-   * does not have an internet stack (for example if it is a bridge) we won't have
-   * an IPv4 at all.  If the node does have a stack, but the net device in question
-   * is bridged, there will not be an interface associated directly with the device.
-   *
-   * \param node the node
-   * \param nd outgoing NetDevice
-   * \param index the IPV4 interface index
-   * \returns true on success
+   * \param index the device index
+   * \param nd outgoing device, by index
+   * \returns the index of the device on the other end
    */
-  bool FindInterfaceForDevice (Ptr<Node> node, Ptr<NetDevice> nd, uint32_t &index) const;
+  uint32_t GetAdjacent (const DSRDeviceIndex &index, uint32_t nd) const;
 
   /**
    * \brief Finds a designated router
@@ -776,10 +953,13 @@ private:
    * will be us).  Of these, the router with the lowest IP address on the net device
    * connecting to the channel becomes the designated router for the link.
    *
-   * \param ndLocal local NetDevice to scan
+   * \param index the device index
+   * \param ndLocal local device to scan, by index
+   * \param bridgesVisited the bridges already enumerated in this L2 broadcast domain
    * \returns the IP address of the designated router
    */
-  Ipv4Address FindDesignatedRouterForLink (Ptr<NetDevice> ndLocal) const;
+  Ipv4Address FindDesignatedRouterForLink (const DSRDeviceIndex &index, uint32_t ndLocal,
+                                           std::set<uint32_t> &bridgesVisited) const;
 
   /**
    * \brief Checks for the presence of another router on the NetDevice
@@ -788,83 +968,91 @@ private:
    * which the net device is attached and look for a node on the other side
    * that has a GlobalRouter interface aggregated.  
    *
-   * \param nd NetDevice to scan
+   * \param index the device index
+   * \param nd device to scan, by index
+   * \param bridgesVisited the bridges already enumerated in this L2 broadcast domain
    * \returns true if a router is found
    */
-  bool AnotherRouterOnLink (Ptr<NetDevice> nd) const;
+  bool AnotherRouterOnLink (const DSRDeviceIndex &index, uint32_t nd,
+                            std::set<uint32_t> &bridgesVisited) const;
 
   /**
    * \brief Process a generic broadcast link
    *
-   * \param nd the NetDevice
+   * \param index the device index
+   * \param nd the device, by index
    * \param pLSA the Global LSA
-   * \param c the returned NetDevice container
+   * \param c the returned devices we are the designated router for
    */
-  void ProcessBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA, NetDeviceContainer &c);
+  void ProcessBroadcastLink (const DSRDeviceIndex &index, uint32_t nd, DSRRoutingLSA *pLSA,
+                             std::vector<uint32_t> &c);
 
   /**
    * \brief Process a single broadcast link
    *
-   * \param nd the NetDevice
+   * \param index the device index
+   * \param nd the device, by index
    * \param pLSA the Global LSA
-   * \param c the returned NetDevice container
+   * \param c the returned devices we are the designated router for
    */
-  void ProcessSingleBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA, NetDeviceContainer &c);
+  void ProcessSingleBroadcastLink (const DSRDeviceIndex &index, uint32_t nd, DSRRoutingLSA *pLSA,
+                                   std::vector<uint32_t> &c);
 
   /**
    * \brief Process a bridged broadcast link
    *
-   * \param nd the NetDevice
+   * \param index the device index
+   * \param nd the device, by index
    * \param pLSA the Global LSA
-   * \param c the returned NetDevice container
+   * \param c the returned devices we are the designated router for
    */
-  void ProcessBridgedBroadcastLink (Ptr<NetDevice> nd, DSRRoutingLSA *pLSA, NetDeviceContainer &c);
+  void ProcessBridgedBroadcastLink (const DSRDeviceIndex &index, uint32_t nd, DSRRoutingLSA *pLSA,
+                                    std::vector<uint32_t> &c);
 
   /**
    * \brief Process a point to point link
    *
-   * \param ndLocal the NetDevice
+   * \param index the device index
+   * \param ndLocal the device, by index
    * \param pLSA the Global LSA
    */
-  void ProcessPointToPointLink (Ptr<NetDevice> ndLocal, DSRRoutingLSA *pLSA);
+  void ProcessPointToPointLink (const DSRDeviceIndex &index, uint32_t ndLocal, DSRRoutingLSA *pLSA);
 
   /**
    * \brief Build one NetworkLSA for each net device talking to a network that we are the
    * designated router for.
    *
-   * \param c the devices.
+   * \param index the device index
+   * \param c the devices, by index
    */
-  void BuildNetworkLSAs (NetDeviceContainer c);
+  void BuildNetworkLSAs (const DSRDeviceIndex &index, const std::vector<uint32_t> &c);
 
   /**
-   * \brief Return a container of all non-bridged NetDevices on a link
+   * \brief Find all non-bridged devices on a link
    *
    * This method will recursively find all of the 'edge' devices in an
    * L2 broadcast domain.  If there are no bridged devices, then the
-   * container returned is simply the set of devices on the channel
-   * passed in as an argument.  If the link has bridges on it 
-   * (and therefore multiple ns3::Channel objects interconnected by 
-   * bridges), the method will find all of the non-bridged devices
-   * in the L2 broadcast domain.
-   *
-   * \param ch a channel from the link
-   * \returns the NetDeviceContainer.
-   */
-  NetDeviceContainer FindAllNonBridgedDevicesOnLink (Ptr<Channel> ch) const;
-
-  /**
-   * \brief Decide whether or not a given net device is being bridged by a BridgeNetDevice.
+   * devices found are simply the devices on the channel passed in as an
+   * argument.  If the link has bridges on it (and therefore multiple
+   * ns3::Channel objects interconnected by bridges), the method will find
+   * all of the non-bridged devices in the L2 broadcast domain.
    *
-   * \param nd the NetDevice
-   * \returns the BridgeNetDevice smart pointer or null if not found
+   * \param index the device index
+   * \param ch a channel from the link, by index
+   * \param bridgesVisited the bridges already enumerated in this L2 broadcast domain
+   * \param devices the devices found are appended to it, by index
    */
-  Ptr<BridgeNetDevice> NetDeviceIsBridged (Ptr<NetDevice> nd) const;
+  void FindAllNonBridgedDevicesOnLink (const DSRDeviceIndex &index, uint32_t ch,
+                                       std::set<uint32_t> &bridgesVisited,
+                                       std::vector<uint32_t> &devices) const;
 
 
-  typedef std::list<DSRRoutingLSA*> ListOfLSAs_t; //!< container for the GlobalRoutingLSAs
+  typedef std::vector<Ptr<DSRRoutingLSA> > ListOfLSAs_t; //!< container for the GlobalRoutingLSAs
   ListOfLSAs_t m_LSAs; //!< database of GlobalRoutingLSAs
 
   Ipv4Address m_routerId; //!< router ID (its IPv4 address)
+  uint32_t m_areaId;      //!< area of the router
+  std::map<uint32_t, uint32_t> m_queueingDelays; //!< queueing delay added to the metric, by interface
   Ptr<Ipv4DSRRouting> m_routingProtocol; //!< the Ipv4GlobalRouting in use
 
   typedef std::list<Ipv4DSRRoutingTableEntry *> InjectedRoutes; //!< container of Ipv4RoutingTableEntry
@@ -872,32 +1060,6 @@ private:
   typedef std::list<Ipv4DSRRoutingTableEntry *>::iterator InjectedRoutesI; //!< Iterator to container of Ipv4RoutingTableEntry
   InjectedRoutes m_injectedRoutes; //!< Routes we are exporting
 
-  // Declared mutable so that const member functions can clear it
-  // (supporting the logical constness of the search methods of this class) 
-  /**
-   * Container of bridges visited.
-   */
-  mutable std::vector<Ptr<BridgeNetDevice> > m_bridgesVisited;
-  /**
-   * Clear the list of bridges visited on the link 
-   */
-  void ClearBridgesVisited (void) const;
-  /**
-   * When recursively checking for devices on the link, check whether a
-   * given device has already been visited.
-   *
-   * \param device the bridge device to check
-   * \return true if bridge has already been visited 
-   */
-  bool BridgeHasAlreadyBeenVisited (Ptr<BridgeNetDevice> device) const;
-  /**
-   * When recursively checking for devices on the link, mark a given device 
-   * as having been visited.
-   *
-   * \param device the bridge device to mark
-   */
-  void MarkBridgeAsVisited (Ptr<BridgeNetDevice> device) const;
-
   // inherited from Object
   virtual void DoDispose (void);
 
@@ -55,6 +55,7 @@ DsrVirtualQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
   BudgetTag budgetTag;
   TimestampTag timestampTag;
   item->GetPacket ()->PeekPacketTag (timestampTag);
+  item->SetTimeStamp (Simulator::Now ());
   
   // Enqueue Best-Effort to best effort lane
   if (!item->GetPacket ()->PeekPacketTag (budgetTag))
@@ -133,6 +134,7 @@ DsrVirtualQueueDisc::DoDequeue (void)
     {
       NS_LOG_LOGIC ("Popped from band " << prio << ": " << item);
       NS_LOG_LOGIC ("Number packets band " << prio << ": " << GetInternalQueue (prio)->GetNPackets ());
+      m_laneSojourn[prio] = Simulator::Now () - item->GetTimeStamp ();
       // std::cout << "++++++ Current Queue length: " << GetInternalQueue (prio)->GetNPackets () << " at band: " << item <<  std::endl;
       return item;
     }
@@ -201,6 +203,20 @@ DsrVirtualQueueDisc::DoPeek (void)
   return item;
 }
 
+uint32_t
+DsrVirtualQueueDisc::GetLaneBacklog (uint32_t lane) const
+{
+  NS_ASSERT (lane < GetNInternalQueues ());
+  return GetInternalQueue (lane)->GetNPackets ();
+}
+
+Time
+DsrVirtualQueueDisc::GetLaneSojournTime (uint32_t lane) const
+{
+  NS_ASSERT (lane < 3);
+  return m_laneSojourn[lane];
+}
+
 bool
 DsrVirtualQueueDisc::CheckConfig (void)
 {
@@ -3,6 +3,7 @@
 #define DSR_VIRTUAL_QUEUE_DISC_H
 
 #include "ns3/queue-disc.h"
+#include "ns3/nstime.h"
 
 namespace ns3 {
 
@@ -27,6 +28,20 @@ public:
   static constexpr const char* TIMEOUT_DROP = "time out !!!!!!!!";
   static constexpr const char* BUFFERBLOAT_DROP = "Buffer bloat !!!!!!!!";
 
+  /**
+   * \brief Get the number of packets waiting in a lane
+   * \param lane the lane: 0 fast, 1 slow, 2 best effort
+   * \return the backlog of the lane, in packets
+   */
+  uint32_t GetLaneBacklog (uint32_t lane) const;
+
+  /**
+   * \brief Get the time the last packet dequeued from a lane spent in it
+   * \param lane the lane: 0 fast, 1 slow, 2 best effort
+   * \return the sojourn time of the packet, or 0 if none was dequeued
+   */
+  Time GetLaneSojournTime (uint32_t lane) const;
+
 private:
   // packet size = 1kB
   // packet size for test = 52B
@@ -38,6 +53,7 @@ private:
   uint32_t currentFastWeight = 0;
   uint32_t currentSlowWeight = 0;
   uint32_t currentNormalWeight = 0;
+  Time m_laneSojourn[3];  // sojourn time of the last packet dequeued from each lane
   virtual bool DoEnqueue (Ptr<QueueDiscItem> item);
   virtual Ptr<QueueDiscItem> DoDequeue (void);
   // virtual void DoPrioDequeue (void);
@@ -14,6 +14,7 @@ NS_LOG_COMPONENT_DEFINE ("Ipv4DSRRoutingTableEntry");
  *****************************************************/
 
 Ipv4DSRRoutingTableEntry::Ipv4DSRRoutingTableEntry ()
+  : m_roundTrip (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -27,7 +28,8 @@ Ipv4DSRRoutingTableEntry::Ipv4DSRRoutingTableEntry (Ipv4DSRRoutingTableEntry con
     m_destNetworkMask (route.m_destNetworkMask),
     m_gateway (route.m_gateway),
     m_interface (route.m_interface),
-    m_distance (route.m_distance)
+    m_distance (route.m_distance),
+    m_roundTrip (route.m_roundTrip)
 {
   NS_LOG_FUNCTION (this << route);
 }
@@ -37,11 +39,25 @@ Ipv4DSRRoutingTableEntry::Ipv4DSRRoutingTableEntry (Ipv4DSRRoutingTableEntry con
     m_destNetworkMask (route->m_destNetworkMask),
     m_gateway (route->m_gateway),
     m_interface (route->m_interface),
-    m_distance (route->m_distance)
+    m_distance (route->m_distance),
+    m_roundTrip (route->m_roundTrip)
 {
   NS_LOG_FUNCTION (this << route);
 }
 
+Ipv4DSRRoutingTableEntry&
+Ipv4DSRRoutingTableEntry::operator= (Ipv4DSRRoutingTableEntry const &route)
+{
+  NS_LOG_FUNCTION (this << route);
+  m_dest = route.m_dest;
+  m_destNetworkMask = route.m_destNetworkMask;
+  m_gateway = route.m_gateway;
+  m_interface = route.m_interface;
+  m_distance = route.m_distance;
+  m_roundTrip = route.m_roundTrip;
+  return *this;
+}
+
 Ipv4DSRRoutingTableEntry::Ipv4DSRRoutingTableEntry (Ipv4Address dest,
                                               Ipv4Address gateway,
                                               uint32_t interface)
@@ -49,7 +65,8 @@ Ipv4DSRRoutingTableEntry::Ipv4DSRRoutingTableEntry (Ipv4Address dest,
     m_destNetworkMask (Ipv4Mask::GetOnes ()),
     m_gateway (gateway),
     m_interface (interface),
-    m_distance (MAX_UINT32)
+    m_distance (MAX_UINT32),
+    m_roundTrip (0)
 {
 }
 Ipv4DSRRoutingTableEntry::Ipv4DSRRoutingTableEntry (Ipv4Address dest,
@@ -58,7 +75,8 @@ Ipv4DSRRoutingTableEntry::Ipv4DSRRoutingTableEntry (Ipv4Address dest,
     m_destNetworkMask (Ipv4Mask::GetOnes ()),
     m_gateway (Ipv4Address::GetZero ()),
     m_interface (interface),
-    m_distance (MAX_UINT32)
+    m_distance (MAX_UINT32),
+    m_roundTrip (0)
 {
 }
 Ipv4DSRRoutingTableEntry::Ipv4DSRRoutingTableEntry (Ipv4Address network,
@@ -69,10 +87,25 @@ Ipv4DSRRoutingTableEntry::Ipv4DSRRoutingTableEntry (Ipv4Address network,
     m_destNetworkMask (networkMask),
     m_gateway (gateway),
     m_interface (interface),
-    m_distance (MAX_UINT32)
+    m_distance (MAX_UINT32),
+    m_roundTrip (0)
 {
   NS_LOG_FUNCTION (this << network << networkMask << gateway << interface);
 }
+Ipv4DSRRoutingTableEntry::Ipv4DSRRoutingTableEntry (Ipv4Address network,
+                                              Ipv4Mask networkMask,
+                                              Ipv4Address gateway,
+                                              uint32_t interface,
+                                              uint32_t distance)
+  : m_dest (network),
+    m_destNetworkMask (networkMask),
+    m_gateway (gateway),
+    m_interface (interface),
+    m_distance (distance),
+    m_roundTrip (0)
+{
+  NS_LOG_FUNCTION (this << network << networkMask << gateway << interface << distance);
+}
 Ipv4DSRRoutingTableEntry::Ipv4DSRRoutingTableEntry (Ipv4Address network,
                                               Ipv4Mask networkMask,
                                               uint32_t interface)
@@ -80,7 +113,8 @@ Ipv4DSRRoutingTableEntry::Ipv4DSRRoutingTableEntry (Ipv4Address network,
     m_destNetworkMask (networkMask),
     m_gateway (Ipv4Address::GetZero ()),
     m_interface (interface),
-    m_distance (MAX_UINT32)
+    m_distance (MAX_UINT32),
+    m_roundTrip (0)
 {
   NS_LOG_FUNCTION (this << network << networkMask << interface);
 }
@@ -100,12 +134,28 @@ Ipv4DSRRoutingTableEntry::Ipv4DSRRoutingTableEntry (Ipv4Address dest,
     m_destNetworkMask (Ipv4Mask::GetOnes ()),
     m_gateway (gateway),
     m_interface (interface),
-    m_distance (distance)
+    m_distance (distance),
+    m_roundTrip (0)
 {
     // std::cout << "CreateNetworkRouteTo with distance" << distance << std::endl;
     NS_LOG_FUNCTION (this << dest << gateway << interface << distance);
 }
 
+Ipv4DSRRoutingTableEntry::Ipv4DSRRoutingTableEntry (Ipv4Address dest,
+                                              Ipv4Address gateway,
+                                              uint32_t interface,
+                                              uint32_t distance,
+                                              uint32_t roundTrip)
+  : m_dest (dest),
+    m_destNetworkMask (Ipv4Mask::GetOnes ()),
+    m_gateway (gateway),
+    m_interface (interface),
+    m_distance (distance),
+    m_roundTrip (roundTrip)
+{
+  NS_LOG_FUNCTION (this << dest << gateway << interface << distance << roundTrip);
+}
+
 
 
 
@@ -196,6 +246,20 @@ Ipv4DSRRoutingTableEntry::GetDistance (void) const
   return m_distance;
 }
 
+uint32_t
+Ipv4DSRRoutingTableEntry::GetRoundTrip (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_roundTrip;
+}
+
+bool
+Ipv4DSRRoutingTableEntry::IsLoopFree (uint32_t shortest) const
+{
+  NS_LOG_FUNCTION (this << shortest);
+  return static_cast<uint64_t> (m_distance) < static_cast<uint64_t> (m_roundTrip) + shortest;
+}
+
 Ipv4DSRRoutingTableEntry 
 Ipv4DSRRoutingTableEntry::CreateHostRouteTo (Ipv4Address dest, 
                                           Ipv4Address nextHop,
@@ -227,6 +291,17 @@ Ipv4DSRRoutingTableEntry::CreateHostRouteTo (Ipv4Address dest,
   return Ipv4DSRRoutingTableEntry (dest, nextHop, interface, distance);
 }
 
+Ipv4DSRRoutingTableEntry
+Ipv4DSRRoutingTableEntry::CreateHostRouteTo (Ipv4Address dest, 
+                                          Ipv4Address nextHop,
+                                          uint32_t interface,
+                                          uint32_t distance,
+                                          uint32_t roundTrip)
+{
+  NS_LOG_FUNCTION (dest << nextHop << interface << distance << roundTrip);
+  return Ipv4DSRRoutingTableEntry (dest, nextHop, interface, distance, roundTrip);
+}
+
 Ipv4DSRRoutingTableEntry 
 Ipv4DSRRoutingTableEntry::CreateNetworkRouteTo (Ipv4Address network, 
                                              Ipv4Mask networkMask,
@@ -238,6 +313,17 @@ Ipv4DSRRoutingTableEntry::CreateNetworkRouteTo (Ipv4Address network,
                                 nextHop, interface);
 }
 Ipv4DSRRoutingTableEntry 
+Ipv4DSRRoutingTableEntry::CreateNetworkRouteTo (Ipv4Address network, 
+                                             Ipv4Mask networkMask,
+                                             Ipv4Address nextHop,
+                                             uint32_t interface,
+                                             uint32_t distance)
+{
+  NS_LOG_FUNCTION (network << networkMask << nextHop << interface << distance);
+  return Ipv4DSRRoutingTableEntry (network, networkMask, 
+                                nextHop, interface, distance);
+}
+Ipv4DSRRoutingTableEntry 
 Ipv4DSRRoutingTableEntry::CreateNetworkRouteTo (Ipv4Address network, 
                                              Ipv4Mask networkMask,
                                              uint32_t interface)
@@ -32,6 +32,12 @@ public:
    * \param route The route to copy
    */
   Ipv4DSRRoutingTableEntry (Ipv4DSRRoutingTableEntry const *route);
+  /**
+   * \brief Assignment operator
+   * \param route The route to copy
+   * \return this route
+   */
+  Ipv4DSRRoutingTableEntry& operator= (Ipv4DSRRoutingTableEntry const &route);
   /**
    * \return True if this route is a host route (mask of all ones); false otherwise
    */
@@ -74,6 +80,25 @@ public:
    * \return the distance 
   */
   uint32_t GetDistance (void) const;
+  /**
+   * \return the distance from this node to the first hop of the route and
+   * back, 0 if unknown and 0xffffffff if the first hop never routes back
+   * through this node
+   */
+  uint32_t GetRoundTrip (void) const;
+  /**
+   * \brief Whether the route is a loop-free alternate (RFC 5286).
+   *
+   * The first hop N of the route reaches the destination D without going
+   * back through this node S if D(N,D) < D(N,S) + D(S,D).  GetDistance ()
+   * and GetRoundTrip () both include the link from S to N, so the test is
+   * GetDistance () < GetRoundTrip () + D(S,D).  Such a route still leads
+   * to D when the links of the other routes to D fail.
+   *
+   * \param shortest the distance of the shortest route to the destination
+   * \return true if the route avoids this node beyond its first hop
+   */
+  bool IsLoopFree (uint32_t shortest) const;
 
   /**
    * \return An Ipv4RoutingTableEntry object corresponding to the input parameters.
@@ -104,6 +129,19 @@ public:
                                                   Ipv4Address nextHop,
                                                   uint32_t interface,
                                                   uint32_t distance);
+  /**
+   * \return An Ipv4RoutingTableEntry object corresponding to the input parameters.
+   * \param dest Ipv4Address of the destination
+   * \param nextHop the Ipv4Address the nextHop
+   * \param interface Outgoing interface
+   * \param distance The distance between root and destination 
+   * \param roundTrip The distance to the next hop and back (see GetRoundTrip ())
+   */
+  static Ipv4DSRRoutingTableEntry CreateHostRouteTo (Ipv4Address dest, 
+                                                  Ipv4Address nextHop,
+                                                  uint32_t interface,
+                                                  uint32_t distance,
+                                                  uint32_t roundTrip);
   /**
    * \return An Ipv4RoutingTableEntry object corresponding to the input parameters.
    * \param network Ipv4Address of the destination network
@@ -115,6 +153,20 @@ public:
                                                      Ipv4Mask networkMask,
                                                      Ipv4Address nextHop,
                                                      uint32_t interface);
+  /**
+   * \return An Ipv4RoutingTableEntry object corresponding to the input parameters.
+   * \param network Ipv4Address of the destination network
+   * \param networkMask Ipv4Mask of the destination network mask
+   * \param nextHop Ipv4Address of the next hop
+   * \param interface Outgoing interface 
+   * \param distance The distance between root and the farthest destination
+   * of the network
+   */
+  static Ipv4DSRRoutingTableEntry CreateNetworkRouteTo (Ipv4Address network, 
+                                                     Ipv4Mask networkMask,
+                                                     Ipv4Address nextHop,
+                                                     uint32_t interface,
+                                                     uint32_t distance);
   /**
    * \return An Ipv4RoutingTableEntry object corresponding to the input parameters.
    * \param network Ipv4Address of the destination network
@@ -146,6 +198,19 @@ private:
                          Ipv4Mask mask,
                          Ipv4Address gateway,
                          uint32_t interface);
+  /**
+   * \brief Constructor.
+   * \param network network address
+   * \param mask network mask
+   * \param gateway the gateway
+   * \param interface the interface index
+   * \param distance the distance between root and the farthest destination
+   */
+  Ipv4DSRRoutingTableEntry (Ipv4Address network,
+                         Ipv4Mask mask,
+                         Ipv4Address gateway,
+                         uint32_t interface,
+                         uint32_t distance);
   /**
    * \brief Constructor.
    * \param dest destination address
@@ -184,11 +249,26 @@ private:
                          uint32_t interface,
                          uint32_t distance);
 
+  /**
+   * \brief Constructor.
+   * \param dest destination address
+   * \param gateway gateway address
+   * \param interface the interface index
+   * \param distance the distance between root and destination
+   * \param roundTrip the distance to the gateway and back
+   */
+  Ipv4DSRRoutingTableEntry (Ipv4Address dest,
+                         Ipv4Address gateway,
+                         uint32_t interface,
+                         uint32_t distance,
+                         uint32_t roundTrip);
+
   Ipv4Address m_dest;         //!< destination address
   Ipv4Mask m_destNetworkMask; //!< destination network mask
   Ipv4Address m_gateway;      //!< gateway
   uint32_t m_interface;       //!< output interface
   uint32_t m_distance;        //!< the distance between root and destination
+  uint32_t m_roundTrip;       //!< the distance to the gateway and back, 0 if unknown
 };
 
 /**
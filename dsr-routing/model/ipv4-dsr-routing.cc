@@ -17,6 +17,7 @@
 //
 
 #include <vector>
+#include <algorithm>
 #include <iomanip>
 #include "ns3/names.h"
 #include "ns3/log.h"
@@ -29,14 +30,18 @@
 #include "ns3/ipv4-route.h"
 #include "ns3/ipv4-routing-table-entry.h"
 #include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
 #include "ns3/node.h"
 #include "ipv4-dsr-routing.h"
 #include "dsr-route-manager.h"
+#include "dsr-link-state-protocol.h"
 #include "cost-tag.h"
 #include "budget-tag.h"
 #include "flag-tag.h"
 #include "timestamp-tag.h"
 #include "priority-tag.h"
+#include "telemetry-tag.h"
 
 namespace ns3 {
 
@@ -44,6 +49,48 @@ NS_LOG_COMPONENT_DEFINE ("Ipv4DSRRouting");
 
 NS_OBJECT_ENSURE_REGISTERED (Ipv4DSRRouting);
 
+void
+DSRNodeAddressMap::Add (Ipv4Address address, Ipv4Address routerId)
+{
+  m_routers.push_back (std::make_pair (address.Get (), routerId.Get ()));
+}
+
+void
+DSRNodeAddressMap::Sort (void)
+{
+  std::stable_sort (m_routers.begin (), m_routers.end (),
+                    [] (const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b)
+                      {
+                        return a.first < b.first;
+                      });
+  m_routers.erase (std::unique (m_routers.begin (), m_routers.end (),
+                                [] (const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b)
+                                  {
+                                    return a.first == b.first;
+                                  }),
+                   m_routers.end ());
+  std::vector<std::pair<uint32_t, uint32_t> > (m_routers).swap (m_routers);
+}
+
+bool
+DSRNodeAddressMap::Lookup (Ipv4Address address, Ipv4Address& routerId) const
+{
+  std::vector<std::pair<uint32_t, uint32_t> >::const_iterator i =
+    std::lower_bound (m_routers.begin (), m_routers.end (), std::make_pair (address.Get (), uint32_t (0)));
+  if (i == m_routers.end () || i->first != address.Get ())
+    {
+      return false;
+    }
+  routerId = Ipv4Address (i->second);
+  return true;
+}
+
+uint32_t
+DSRNodeAddressMap::GetN (void) const
+{
+  return m_routers.size ();
+}
+
 TypeId 
 Ipv4DSRRouting::GetTypeId (void)
 { 
@@ -61,13 +108,46 @@ Ipv4DSRRouting::GetTypeId (void)
                    BooleanValue (false),
                    MakeBooleanAccessor (&Ipv4DSRRouting::m_respondToInterfaceEvents),
                    MakeBooleanChecker ())
+    .AddAttribute ("FastReroute",
+                   "Set to true to stop using the routes through an interface as soon as it goes down, and to send the traffic of the destinations it served over their loop-free alternates until the routes are recomputed",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&Ipv4DSRRouting::m_fastReroute),
+                   MakeBooleanChecker ())
+    .AddAttribute ("InBandProtocol",
+                   "Set to true to learn the routes with hellos and LSA flooding over the simulated links (DSRLinkStateProtocol) instead of from DSRRouteManager",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&Ipv4DSRRouting::m_inBandProtocol),
+                   MakeBooleanChecker ())
+    .AddAttribute ("Telemetry",
+                   "Set to true to record the queueing delay of each hop in delay-guaranteed packets and add the smoothed delays, in microseconds, to the distances of the routes back towards their sources; the link metrics must then be in microseconds too, as the delay budgets are",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&Ipv4DSRRouting::m_telemetry),
+                   MakeBooleanChecker ())
+    .AddAttribute ("TelemetryMaxBytes",
+                   "Maximum size of the telemetry carried by a packet, in bytes; older hops are summed once it is reached",
+                   UintegerValue (21),
+                   MakeUintegerAccessor (&Ipv4DSRRouting::m_telemetryMaxBytes),
+                   MakeUintegerChecker<uint32_t> (TelemetryTag::FIXED_SIZE))
+    .AddAttribute ("TelemetryWeight",
+                   "Weight of a new sample in the smoothed queueing delays",
+                   DoubleValue (0.125),
+                   MakeDoubleAccessor (&Ipv4DSRRouting::m_telemetryWeight),
+                   MakeDoubleChecker<double> (0, 1))
   ;
   return tid;
 }
 
 Ipv4DSRRouting::Ipv4DSRRouting () 
   : m_randomEcmpRouting (false),
-    m_respondToInterfaceEvents (false)
+    m_respondToInterfaceEvents (false),
+    m_fastReroute (false),
+    m_nInterfacesDown (0),
+    m_inBandProtocol (false),
+    m_telemetry (false),
+    m_telemetryMaxBytes (21),
+    m_telemetryWeight (0.125),
+    m_lazyRouting (false),
+    m_indexValid (false)
 {
   NS_LOG_FUNCTION (this);
 
@@ -88,6 +168,7 @@ Ipv4DSRRouting::AddHostRouteTo (Ipv4Address dest,
   Ipv4DSRRoutingTableEntry *route = new Ipv4DSRRoutingTableEntry ();
   *route = Ipv4DSRRoutingTableEntry::CreateHostRouteTo (dest, nextHop, interface);
   m_hostRoutes.push_back (route);
+  m_indexValid = false;
 }
 
 void 
@@ -98,6 +179,7 @@ Ipv4DSRRouting::AddHostRouteTo (Ipv4Address dest,
   Ipv4DSRRoutingTableEntry *route = new Ipv4DSRRoutingTableEntry ();
   *route = Ipv4DSRRoutingTableEntry::CreateHostRouteTo (dest, interface);
   m_hostRoutes.push_back (route);
+  m_indexValid = false;
 }
 
 /**
@@ -121,10 +203,42 @@ Ipv4DSRRouting::AddHostRouteTo (Ipv4Address dest,
   // std::cout << "add host route with the distance = " << distance;
   *route = Ipv4DSRRoutingTableEntry::CreateHostRouteTo(dest, nextHop, interface, distance);
   m_hostRoutes.push_back (route);
+  m_indexValid = false;
 }
 
 
 
+void
+Ipv4DSRRouting::AddNodeRouteTo (Ipv4Address routerId,
+                                Ipv4Address nextHop,
+                                uint32_t interface,
+                                uint32_t distance)
+{
+  NS_LOG_FUNCTION (this << routerId << nextHop << interface << distance);
+  Ipv4DSRRoutingTableEntry *route = new Ipv4DSRRoutingTableEntry ();
+  *route = Ipv4DSRRoutingTableEntry::CreateHostRouteTo (routerId, nextHop, interface, distance);
+  m_nodeRoutes.push_back (route);
+  // the new route is the last one in the table, so the index stays in table order
+  if (m_indexValid)
+    {
+      m_nodeIndex[routerId.Get ()].push_back (route);
+    }
+}
+
+void
+Ipv4DSRRouting::SetNodeAddresses (Ptr<const DSRNodeAddressMap> addresses)
+{
+  NS_LOG_FUNCTION (this << addresses);
+  m_nodeAddresses = addresses;
+}
+
+void
+Ipv4DSRRouting::SetLazyRouting (bool lazy)
+{
+  NS_LOG_FUNCTION (this << lazy);
+  m_lazyRouting = lazy;
+}
+
 void 
 Ipv4DSRRouting::AddNetworkRouteTo (Ipv4Address network, 
                                       Ipv4Mask networkMask, 
@@ -138,6 +252,25 @@ Ipv4DSRRouting::AddNetworkRouteTo (Ipv4Address network,
                                                         nextHop,
                                                         interface);
   m_networkRoutes.push_back (route);
+  m_indexValid = false;
+}
+
+void 
+Ipv4DSRRouting::AddNetworkRouteTo (Ipv4Address network, 
+                                   Ipv4Mask networkMask, 
+                                   Ipv4Address nextHop, 
+                                   uint32_t interface,
+                                   uint32_t distance)
+{
+  NS_LOG_FUNCTION (this << network << networkMask << nextHop << interface << distance);
+  Ipv4DSRRoutingTableEntry *route = new Ipv4DSRRoutingTableEntry ();
+  *route = Ipv4DSRRoutingTableEntry::CreateNetworkRouteTo (network,
+                                                        networkMask,
+                                                        nextHop,
+                                                        interface,
+                                                        distance);
+  m_networkRoutes.push_back (route);
+  m_indexValid = false;
 }
 
 void 
@@ -151,6 +284,7 @@ Ipv4DSRRouting::AddNetworkRouteTo (Ipv4Address network,
                                                         networkMask,
                                                         interface);
   m_networkRoutes.push_back (route);
+  m_indexValid = false;
 }
 
 void 
@@ -168,6 +302,179 @@ Ipv4DSRRouting::AddASExternalRouteTo (Ipv4Address network,
   m_ASexternalRoutes.push_back (route);
 }
 
+void
+Ipv4DSRRouting::AddBestEffortHostRouteTo (Ipv4Address dest,
+                                          Ipv4Address nextHop,
+                                          uint32_t interface,
+                                          uint32_t hops)
+{
+  NS_LOG_FUNCTION (this << dest << nextHop << interface << hops);
+  Ipv4DSRRoutingTableEntry *route = new Ipv4DSRRoutingTableEntry ();
+  *route = Ipv4DSRRoutingTableEntry::CreateHostRouteTo (dest, nextHop, interface, hops);
+  m_beHostRoutes.push_back (route);
+  m_indexValid = false;
+}
+
+void
+Ipv4DSRRouting::AddBestEffortNetworkRouteTo (Ipv4Address network,
+                                             Ipv4Mask networkMask,
+                                             Ipv4Address nextHop,
+                                             uint32_t interface)
+{
+  NS_LOG_FUNCTION (this << network << networkMask << nextHop << interface);
+  Ipv4DSRRoutingTableEntry *route = new Ipv4DSRRoutingTableEntry ();
+  *route = Ipv4DSRRoutingTableEntry::CreateNetworkRouteTo (network,
+                                                        networkMask,
+                                                        nextHop,
+                                                        interface);
+  m_beNetworkRoutes.push_back (route);
+}
+
+void
+Ipv4DSRRouting::UpdateLookupIndex (void)
+{
+  if (m_indexValid)
+    {
+      return;
+    }
+  NS_LOG_FUNCTION (this);
+  m_hostIndex.clear ();
+  m_nodeIndex.clear ();
+  m_beHostIndex.clear ();
+  for (HostRoutesCI i = m_hostRoutes.begin (); i != m_hostRoutes.end (); i++)
+    {
+      m_hostIndex[(*i)->GetDest ().Get ()].push_back (*i);
+    }
+  for (HostRoutesCI i = m_nodeRoutes.begin (); i != m_nodeRoutes.end (); i++)
+    {
+      m_nodeIndex[(*i)->GetDest ().Get ()].push_back (*i);
+    }
+  for (HostRoutesCI i = m_beHostRoutes.begin (); i != m_beHostRoutes.end (); i++)
+    {
+      m_beHostIndex.insert (std::make_pair ((*i)->GetDest ().Get (), *i));
+    }
+  m_indexValid = true;
+}
+
+void
+Ipv4DSRRouting::ComputeLazyRoutes (Ipv4Address dest)
+{
+  Ipv4Address routerId;
+  if (!m_lazyRouting || m_nodeAddresses == 0)
+    {
+      return;
+    }
+  if (!m_nodeAddresses->Lookup (dest, routerId))
+    {
+      // a network destination makes the route manager compute every route
+      if (DSRRouteManager::ComputeRoutesTo (dest))
+        {
+          UpdateLookupIndex ();
+        }
+      return;
+    }
+  if (m_nodeIndex.find (routerId.Get ()) != m_nodeIndex.end ())
+    {
+      return;
+    }
+  NS_LOG_LOGIC ("No route to router " << routerId << " yet");
+  DSRRouteManager::ComputeRoutesTo (dest);
+  UpdateLookupIndex ();
+}
+
+void
+Ipv4DSRRouting::GetHostRoutes (Ipv4Address dest, Ptr<NetDevice> oif,
+                               std::vector<Ipv4DSRRoutingTableEntry *>& routes) const
+{
+  typedef std::vector<Ipv4DSRRoutingTableEntry*> RouteVec_t;
+  const RouteVec_t* lists[2] = {0, 0};
+  std::unordered_map<uint32_t, RouteVec_t>::const_iterator hosts = m_hostIndex.find (dest.Get ());
+  if (hosts != m_hostIndex.end ())
+    {
+      lists[0] = &hosts->second;
+    }
+  Ipv4Address routerId;
+  if (m_nodeAddresses && m_nodeAddresses->Lookup (dest, routerId))
+    {
+      std::unordered_map<uint32_t, RouteVec_t>::const_iterator nodes = m_nodeIndex.find (routerId.Get ());
+      if (nodes != m_nodeIndex.end ())
+        {
+          lists[1] = &nodes->second;
+        }
+    }
+  std::size_t first = routes.size ();
+  uint32_t shortest = DISTINFINITY;
+  bool bypassed = false;
+  for (uint32_t l = 0; l < 2; l++)
+    {
+      if (lists[l] == 0)
+        {
+          continue;
+        }
+      for (RouteVec_t::const_iterator i = lists[l]->begin (); i != lists[l]->end (); i++)
+        {
+          NS_ASSERT ((*i)->IsHost ());
+          shortest = std::min (shortest, (*i)->GetDistance ());
+          if (IsBypassed ((*i)->GetInterface ()))
+            {
+              NS_LOG_LOGIC ("Interface down, skipping");
+              bypassed = true;
+              continue;
+            }
+          if (oif != 0)
+            {
+              if (oif != m_ipv4->GetNetDevice ((*i)->GetInterface ()))
+                {
+                  NS_LOG_LOGIC ("Not on requested interface, skipping");
+                  continue;
+                }
+            }
+          routes.push_back (*i);
+          NS_LOG_LOGIC (routes.size () << "Found dsr host route" << *i << " with Cost: " << (*i)->GetDistance ());
+        }
+    }
+  if (!bypassed)
+    {
+      return;
+    }
+  // A shortest path went down with its interface: keep the loop-free
+  // alternates (RFC 5286) among the remaining routes, whose next hop does
+  // not route the packet back through this node, or all the remaining
+  // routes if none is.
+  std::size_t kept = first;
+  for (std::size_t i = first; i < routes.size (); i++)
+    {
+      if (routes[i]->IsLoopFree (shortest))
+        {
+          routes[kept++] = routes[i];
+        }
+    }
+  if (kept > first)
+    {
+      routes.resize (kept);
+    }
+  NS_LOG_LOGIC ((routes.size () - first) << " alternate routes to " << dest);
+}
+
+bool
+Ipv4DSRRouting::IsBypassed (uint32_t interface) const
+{
+  return m_fastReroute && m_nInterfacesDown > 0
+         && interface < m_interfaceDown.size () && m_interfaceDown[interface];
+}
+
+Ptr<Ipv4Route>
+Ipv4DSRRouting::CreateRoute (const Ipv4DSRRoutingTableEntry* route, Ipv4Address dest) const
+{
+  Ptr<Ipv4Route> rtentry = Create<Ipv4Route> ();
+  rtentry->SetDestination (route->IsHost () ? dest : route->GetDest ());
+  /// \todo handle multi-address case
+  rtentry->SetSource (m_ipv4->GetAddress (route->GetInterface (), 0).GetLocal ());
+  rtentry->SetGateway (route->GetGateway ());
+  rtentry->SetOutputDevice (m_ipv4->GetNetDevice (route->GetInterface ()));
+  return rtentry;
+}
+
 
 Ptr<Ipv4Route>
 Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<NetDevice> oif)
@@ -185,26 +492,11 @@ Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<NetDevice> oif)
   typedef std::vector<Ipv4DSRRoutingTableEntry*> RouteVec_t;
   RouteVec_t allRoutes;
 
+  UpdateLookupIndex ();
   NS_LOG_LOGIC ("Number of m_hostRoutes = " << m_hostRoutes.size ());
-  for (HostRoutesCI i = m_hostRoutes.begin (); 
-       i != m_hostRoutes.end (); 
-       i++) 
-    {
-      NS_ASSERT ((*i)->IsHost ());
-      if ((*i)->GetDest () == dest)
-        {
-          if (oif != 0)
-            {
-              if (oif != m_ipv4->GetNetDevice ((*i)->GetInterface ()))
-                {
-                  NS_LOG_LOGIC ("Not on requested interface, skipping");
-                  continue;
-                }
-            }
-          allRoutes.push_back (*i);
-          NS_LOG_LOGIC (allRoutes.size () << "Found dsr host route" << *i); 
-        }
-    }
+  // the host routes to dest, then those to its router, in table order
+  ComputeLazyRoutes (dest);
+  GetHostRoutes (dest, oif, allRoutes);
   if (allRoutes.size () == 0) // if no host route is found
     {
       NS_LOG_LOGIC ("Number of m_networkRoutes" << m_networkRoutes.size ());
@@ -216,6 +508,11 @@ Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<NetDevice> oif)
           Ipv4Address entry = (*j)->GetDestNetwork ();
           if (mask.IsMatch (dest, entry)) 
             {
+              if (IsBypassed ((*j)->GetInterface ()))
+                {
+                  NS_LOG_LOGIC ("Interface down, skipping");
+                  continue;
+                }
               if (oif != 0)
                 {
                   if (oif != m_ipv4->GetNetDevice ((*j)->GetInterface ()))
@@ -240,6 +537,11 @@ Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<NetDevice> oif)
           if (mask.IsMatch (dest, entry))
             {
               NS_LOG_LOGIC ("Found external route" << *k);
+              if (IsBypassed ((*k)->GetInterface ()))
+                {
+                  NS_LOG_LOGIC ("Interface down, skipping");
+                  continue;
+                }
               if (oif != 0)
                 {
                   if (oif != m_ipv4->GetNetDevice ((*k)->GetInterface ()))
@@ -275,13 +577,7 @@ Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<NetDevice> oif)
       Ipv4DSRRoutingTableEntry* route = allRoutes.at (flagNum);
 
       // create a Ipv4Route object from the selected routing table entry
-      rtentry = Create<Ipv4Route> ();
-      rtentry->SetDestination (route->GetDest ());
-      /// \todo handle multi-address case
-      rtentry->SetSource (m_ipv4->GetAddress (route->GetInterface (), 0).GetLocal ());
-      rtentry->SetGateway (route->GetGateway ());
-      uint32_t interfaceIdx = route->GetInterface ();
-      rtentry->SetOutputDevice (m_ipv4->GetNetDevice (interfaceIdx));
+      rtentry = CreateRoute (route, dest);
       /**
        * \author Pu Yang
        * \brief set the distance
@@ -296,6 +592,33 @@ Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<NetDevice> oif)
     }
 }
 
+Ptr<Ipv4Route>
+Ipv4DSRRouting::LookupBestEffortRoute (Ipv4Address dest, Ptr<NetDevice> oif)
+{
+  NS_LOG_FUNCTION (this << dest << oif);
+  UpdateLookupIndex ();
+  std::unordered_map<uint32_t, Ipv4DSRRoutingTableEntry *>::const_iterator be = m_beHostIndex.find (dest.Get ());
+  if (be != m_beHostIndex.end () && !IsBypassed (be->second->GetInterface ())
+      && (oif == 0 || oif == m_ipv4->GetNetDevice (be->second->GetInterface ())))
+    {
+      NS_LOG_LOGIC ("Found best-effort host route" << be->second);
+      return CreateRoute (be->second, dest);
+    }
+  for (NetworkRoutesCI j = m_beNetworkRoutes.begin (); 
+       j != m_beNetworkRoutes.end (); 
+       j++) 
+    {
+      if ((*j)->GetDestNetworkMask ().IsMatch (dest, (*j)->GetDestNetwork ())
+          && !IsBypassed ((*j)->GetInterface ())
+          && (oif == 0 || oif == m_ipv4->GetNetDevice ((*j)->GetInterface ())))
+        {
+          NS_LOG_LOGIC ("Found best-effort network route" << *j);
+          return CreateRoute (*j, dest);
+        }
+    }
+  return 0;
+}
+
 Ptr<Ipv4Route>
 Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<Packet> p, Ptr<NetDevice> oif)
 {
@@ -313,25 +636,10 @@ Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<Packet> p, Ptr<NetDevice>
   RouteVec_t allRoutes;
 
   NS_LOG_LOGIC ("Number of m_hostRoutes = " << m_hostRoutes.size ());
-  for (HostRoutesCI i = m_hostRoutes.begin (); 
-       i != m_hostRoutes.end (); 
-       i++) 
-    {
-      NS_ASSERT ((*i)->IsHost ());
-      if ((*i)->GetDest () == dest)
-        {
-          if (oif != 0)
-            {
-              if (oif != m_ipv4->GetNetDevice ((*i)->GetInterface ()))
-                {
-                  NS_LOG_LOGIC ("Not on requested interface, skipping");
-                  continue;
-                }
-            }
-          allRoutes.push_back (*i);
-          NS_LOG_LOGIC (allRoutes.size () << "Found dsr host route" << *i << " with Cost: " << (*i)->GetDistance ()); 
-        }
-    }
+  // the host routes to dest, then those to its router, in table order
+  UpdateLookupIndex ();
+  ComputeLazyRoutes (dest);
+  GetHostRoutes (dest, oif, allRoutes);
   if (allRoutes.size () == 0) // if no host route is found
     {
       NS_LOG_LOGIC ("Number of m_networkRoutes" << m_networkRoutes.size ());
@@ -343,6 +651,11 @@ Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<Packet> p, Ptr<NetDevice>
           Ipv4Address entry = (*j)->GetDestNetwork ();
           if (mask.IsMatch (dest, entry)) 
             {
+              if (IsBypassed ((*j)->GetInterface ()))
+                {
+                  NS_LOG_LOGIC ("Interface down, skipping");
+                  continue;
+                }
               if (oif != 0)
                 {
                   if (oif != m_ipv4->GetNetDevice ((*j)->GetInterface ()))
@@ -367,6 +680,11 @@ Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<Packet> p, Ptr<NetDevice>
           if (mask.IsMatch (dest, entry))
             {
               NS_LOG_LOGIC ("Found external route" << *k);
+              if (IsBypassed ((*k)->GetInterface ()))
+                {
+                  NS_LOG_LOGIC ("Interface down, skipping");
+                  continue;
+                }
               if (oif != 0)
                 {
                   if (oif != m_ipv4->GetNetDevice ((*k)->GetInterface ()))
@@ -415,11 +733,11 @@ Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<Packet> p, Ptr<NetDevice>
         {
           // std::cout << "All Distance: " << allRoutes.at(i)->GetDistance () << std::endl;
           // use FINEROUTE to filter out route beyond packet cost
-          if (allRoutes.at(i)->GetDistance () < budget) // push route i to fineRoute if the current budget > route i's cost
+          if (GetEffectiveDistance (allRoutes.at(i), dest) < budget) // push route i to fineRoute if the current budget > route i's cost
             {
               fineRoutes.push_back(allRoutes.at (i));  // BUG: Route not properly erased
               NS_LOG_LOGIC ("FINEROUTE CURRENT NODE GATEWAY " << allRoutes.at (i)->GetGateway());
-              cost += allRoutes.at(i)->GetDistance ();
+              cost += GetEffectiveDistance (allRoutes.at(i), dest);
               numFineRoute ++;
             }
           else
@@ -451,7 +769,7 @@ Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<Packet> p, Ptr<NetDevice>
       // use GOODROUTE to filter avoid loop when budget is sufficient
       for (uint32_t i = 0; i < fineRoutes.size (); i ++)
       {
-        double flag = fineRoutes.at(i)->GetDistance () * 1.0 ; // In MicroSeconds
+        double flag = GetEffectiveDistance (fineRoutes.at(i), dest) * 1.0 ; // In MicroSeconds
         // std::cout<< "avgCost: " << avgCost << "   " << "route Cost: " << flag << std::endl;
         if (flag <= avgCost)                
         {
@@ -480,18 +798,20 @@ Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<Packet> p, Ptr<NetDevice>
       uint32_t bf_slow = 36;
 
       double weight[goodRoutes.size ()* (internalNqueue - 1)];  // Exclude best-effort lane
+      double laneDelay[goodRoutes.size ()* (internalNqueue - 1)]; // queueing delay of each lane, in Milliseconds
       double tempSum = 0;
       for (uint32_t i = 0; i < goodRoutes.size (); i ++)
       {
         double dn = 0.0;
         // weight[i] = 1.0 / (m_ipv4->GetNetDevice (allRoutes.at(i)->GetInterface ())->GetNode ()->GetObject<TrafficControlLayer> ()->GetRootQueueDiscOnDevice (m_ipv4->GetNetDevice(allRoutes.at (i)->GetInterface()))->GetCurrentSize ().GetValue () + 0.01);
-        if (budget < goodRoutes.at (i)->GetDistance())
+        uint32_t distance = GetEffectiveDistance (goodRoutes.at (i), dest);
+        if (budget < distance)
         {
           dn = 0.0 ;
         }
         else
         {
-          dn = (budget - goodRoutes.at (i)->GetDistance()) * 1.0; // dn: per-hop budget in Microseconds
+          dn = (budget - distance) * 1.0; // dn: per-hop budget in Microseconds
           dn = dn/1000; // in Milliseconds
         }
         // ql_fast: fast lane queue length;  ql_slow: slow lane queue length; bf: buffer size
@@ -518,6 +838,8 @@ Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<Packet> p, Ptr<NetDevice>
         
         double edq_fast = ((ql_fast+1)*packet_size*8 / (0.5*linkrate))*1000;  // in Milliseconds
         double edq_slow = ((ql_slow+1)*packet_size*8 / (0.3*linkrate))*1000;
+        laneDelay[2*i] = ((ql_fast)*packet_size*8 / (0.5*linkrate))*1000;
+        laneDelay[2*i+1] = ((ql_slow)*packet_size*8 / (0.3*linkrate))*1000;
         double dnn = std::max(dn, 0.0); // in Milliseconds
         double delayFlag;
 
@@ -632,15 +954,20 @@ Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<Packet> p, Ptr<NetDevice>
       p->RemovePacketTag (priorityTag);
       priorityTag.SetPriority (selectLaneIndex);
       p->AddPacketTag (priorityTag);
+
+      if (m_telemetry)
+        {
+          // record the time the packet will wait behind the chosen lane
+          TelemetryTag telemetryTag;
+          p->RemovePacketTag (telemetryTag);
+          uint32_t lane = (internalNqueue - 1) * selectRouteIndex + selectLaneIndex;
+          telemetryTag.AddHop (static_cast<uint32_t> (laneDelay[lane] * 1000),
+                               (m_telemetryMaxBytes - TelemetryTag::FIXED_SIZE) / TelemetryTag::RECORD_SIZE);
+          p->AddPacketTag (telemetryTag);
+        }
       
       // create a Ipv4Route object from the selected routing table entry
-      rtentry = Create<Ipv4Route> ();
-      rtentry->SetDestination (route->GetDest ());
-      /// \todo handle multi-address case
-      rtentry->SetSource (m_ipv4->GetAddress (route->GetInterface (), 0).GetLocal ());
-      rtentry->SetGateway (route->GetGateway ());
-      uint32_t interfaceIdx = route->GetInterface ();
-      rtentry->SetOutputDevice (m_ipv4->GetNetDevice (interfaceIdx));
+      rtentry = CreateRoute (route, dest);
 
       return rtentry;
     }
@@ -650,14 +977,71 @@ Ipv4DSRRouting::LookupDSRRoute (Ipv4Address dest, Ptr<Packet> p, Ptr<NetDevice>
     }
 }
 
+uint32_t
+Ipv4DSRRouting::GetEffectiveDistance (const Ipv4DSRRoutingTableEntry* route, Ipv4Address dest) const
+{
+  if (!m_telemetry)
+    {
+      return route->GetDistance ();
+    }
+  return route->GetDistance () + GetQueueingDelayEstimate (route->GetInterface (), dest);
+}
+
+uint32_t
+Ipv4DSRRouting::GetQueueingDelayEstimate (uint32_t interface, Ipv4Address dest) const
+{
+  NS_LOG_FUNCTION (this << interface << dest);
+  std::unordered_map<uint64_t, double>::const_iterator i =
+    m_queueingDelays.find ((static_cast<uint64_t> (interface) << 32) | dest.Get ());
+  if (i == m_queueingDelays.end ())
+    {
+      return 0;
+    }
+  return static_cast<uint32_t> (i->second);
+}
+
+//
+// The packets only tell the queueing delay of the path from their source to
+// this router, while the estimate is used on the way back to the source,
+// through the queues of the other direction of the same links.  Feeding the
+// forward delays back would take an acknowledgement the UDP flows of this
+// module do not send, so the reverse path stands in for the forward one.
+// Both directions cross the same neighbours, which is what the estimate
+// ranks; it is close under symmetric traffic, and it misses congestion
+// that only builds up towards the source.
+//
+void
+Ipv4DSRRouting::UpdateQueueingDelay (Ptr<const Packet> p, uint32_t interface, Ipv4Address source)
+{
+  NS_LOG_FUNCTION (this << p << interface << source);
+  TelemetryTag telemetryTag;
+  if (!p->PeekPacketTag (telemetryTag))
+    {
+      return;
+    }
+  double sample = telemetryTag.GetTotalDelay ();
+  uint64_t key = (static_cast<uint64_t> (interface) << 32) | source.Get ();
+  std::pair<std::unordered_map<uint64_t, double>::iterator, bool> i =
+    m_queueingDelays.insert (std::make_pair (key, sample));
+  if (!i.second)
+    {
+      i.first->second += m_telemetryWeight * (sample - i.first->second);
+    }
+  NS_LOG_LOGIC ("Queueing delay towards " << source << " on interface " << interface
+                << ": sample " << sample << " us, estimate " << i.first->second << " us");
+}
+
 uint32_t 
 Ipv4DSRRouting::GetNRoutes (void) const
 {
   NS_LOG_FUNCTION (this);
   uint32_t n = 0;
   n += m_hostRoutes.size ();
+  n += m_nodeRoutes.size ();
   n += m_networkRoutes.size ();
   n += m_ASexternalRoutes.size ();
+  n += m_beHostRoutes.size ();
+  n += m_beNetworkRoutes.size ();
   return n;
 }
 
@@ -681,6 +1065,21 @@ Ipv4DSRRouting::GetRoute (uint32_t index) const
     }
   index -= m_hostRoutes.size ();
   uint32_t tmp = 0;
+  if (index < m_nodeRoutes.size ())
+    {
+      for (HostRoutesCI i = m_nodeRoutes.begin (); 
+           i != m_nodeRoutes.end (); 
+           i++) 
+        {
+          if (tmp == index)
+            {
+              return *i;
+            }
+          tmp++;
+        }
+    }
+  index -= m_nodeRoutes.size ();
+  tmp = 0;
   if (index < m_networkRoutes.size ())
     {
       for (NetworkRoutesCI j = m_networkRoutes.begin (); 
@@ -696,13 +1095,44 @@ Ipv4DSRRouting::GetRoute (uint32_t index) const
     }
   index -= m_networkRoutes.size ();
   tmp = 0;
-  for (ASExternalRoutesCI k = m_ASexternalRoutes.begin (); 
-       k != m_ASexternalRoutes.end (); 
-       k++) 
+  if (index < m_ASexternalRoutes.size ())
+    {
+      for (ASExternalRoutesCI k = m_ASexternalRoutes.begin (); 
+           k != m_ASexternalRoutes.end (); 
+           k++) 
+        {
+          if (tmp == index)
+            {
+              return *k;
+            }
+          tmp++;
+        }
+    }
+  // the best-effort table follows the delay-guaranteed one
+  index -= m_ASexternalRoutes.size ();
+  tmp = 0;
+  if (index < m_beHostRoutes.size ())
+    {
+      for (HostRoutesCI i = m_beHostRoutes.begin (); 
+           i != m_beHostRoutes.end (); 
+           i++) 
+        {
+          if (tmp == index)
+            {
+              return *i;
+            }
+          tmp++;
+        }
+    }
+  index -= m_beHostRoutes.size ();
+  tmp = 0;
+  for (NetworkRoutesCI j = m_beNetworkRoutes.begin (); 
+       j != m_beNetworkRoutes.end (); 
+       j++) 
     {
       if (tmp == index)
         {
-          return *k;
+          return *j;
         }
       tmp++;
     }
@@ -714,6 +1144,7 @@ void
 Ipv4DSRRouting::RemoveRoute (uint32_t index)
 {
   NS_LOG_FUNCTION (this << index);
+  m_indexValid = false;
   if (index < m_hostRoutes.size ())
     {
       uint32_t tmp = 0;
@@ -734,6 +1165,22 @@ Ipv4DSRRouting::RemoveRoute (uint32_t index)
     }
   index -= m_hostRoutes.size ();
   uint32_t tmp = 0;
+  for (HostRoutesI i = m_nodeRoutes.begin (); 
+       i != m_nodeRoutes.end ();
+       i++)
+    {
+      if (tmp == index)
+        {
+          NS_LOG_LOGIC ("Removing route " << index << "; size = " << m_nodeRoutes.size ());
+          delete *i;
+          m_nodeRoutes.erase (i);
+          NS_LOG_LOGIC ("Done removing node route " << index << "; remaining size = " << m_nodeRoutes.size ());
+          return;
+        }
+      tmp++;
+    }
+  index -= m_nodeRoutes.size ();
+  tmp = 0;
   for (NetworkRoutesI j = m_networkRoutes.begin (); 
        j != m_networkRoutes.end (); 
        j++) 
@@ -764,9 +1211,199 @@ Ipv4DSRRouting::RemoveRoute (uint32_t index)
         }
       tmp++;
     }
+  index -= m_ASexternalRoutes.size ();
+  tmp = 0;
+  for (HostRoutesI i = m_beHostRoutes.begin (); 
+       i != m_beHostRoutes.end ();
+       i++)
+    {
+      if (tmp == index)
+        {
+          NS_LOG_LOGIC ("Removing route " << index << "; size = " << m_beHostRoutes.size ());
+          delete *i;
+          m_beHostRoutes.erase (i);
+          NS_LOG_LOGIC ("Done removing best-effort host route " << index << "; remaining size = " << m_beHostRoutes.size ());
+          return;
+        }
+      tmp++;
+    }
+  index -= m_beHostRoutes.size ();
+  tmp = 0;
+  for (NetworkRoutesI j = m_beNetworkRoutes.begin (); 
+       j != m_beNetworkRoutes.end ();
+       j++)
+    {
+      if (tmp == index)
+        {
+          NS_LOG_LOGIC ("Removing route " << index << "; size = " << m_beNetworkRoutes.size ());
+          delete *j;
+          m_beNetworkRoutes.erase (j);
+          NS_LOG_LOGIC ("Done removing best-effort network route " << index << "; remaining size = " << m_beNetworkRoutes.size ());
+          return;
+        }
+      tmp++;
+    }
   NS_ASSERT (false);
 }
 
+uint32_t
+Ipv4DSRRouting::RemoveHostRoutesTo (Ipv4Address dest)
+{
+  NS_LOG_FUNCTION (this << dest);
+  uint32_t removed = 0;
+  HostRoutes* lists[] = {&m_hostRoutes, &m_beHostRoutes};
+  for (uint32_t l = 0; l < 2; l++)
+    {
+      for (HostRoutesI i = lists[l]->begin (); i != lists[l]->end (); )
+        {
+          if ((*i)->GetDest () == dest)
+            {
+              delete *i;
+              i = lists[l]->erase (i);
+              removed++;
+            }
+          else
+            {
+              i++;
+            }
+        }
+    }
+  m_indexValid = false;
+  NS_LOG_LOGIC ("Removed " << removed << " host routes to " << dest);
+  return removed;
+}
+
+uint32_t
+Ipv4DSRRouting::RemoveNetworkRoutesTo (Ipv4Address network, Ipv4Mask networkMask)
+{
+  NS_LOG_FUNCTION (this << network << networkMask);
+  uint32_t removed = 0;
+  NetworkRoutes* lists[] = {&m_networkRoutes, &m_beNetworkRoutes};
+  for (uint32_t l = 0; l < 2; l++)
+    {
+      for (NetworkRoutesI j = lists[l]->begin (); j != lists[l]->end (); )
+        {
+          if ((*j)->GetDestNetwork () == network && (*j)->GetDestNetworkMask () == networkMask)
+            {
+              delete *j;
+              j = lists[l]->erase (j);
+              removed++;
+            }
+          else
+            {
+              j++;
+            }
+        }
+    }
+  NS_LOG_LOGIC ("Removed " << removed << " network routes to " << network << "/" << networkMask);
+  return removed;
+}
+
+void
+Ipv4DSRRouting::GetRoutes (RouteTable table, std::vector<Ipv4DSRRoutingTableEntry>& routes) const
+{
+  NS_LOG_FUNCTION (this << table);
+  const HostRoutes* lists[] = {&m_hostRoutes, &m_nodeRoutes, &m_networkRoutes, &m_ASexternalRoutes, &m_beHostRoutes,
+                                &m_beNetworkRoutes};
+  NS_ASSERT (table < N_ROUTE_TABLES);
+  routes.reserve (routes.size () + lists[table]->size ());
+  for (HostRoutesCI i = lists[table]->begin (); i != lists[table]->end (); i++)
+    {
+      routes.push_back (**i);
+    }
+}
+
+void
+Ipv4DSRRouting::AddRoutes (RouteTable table, const std::vector<Ipv4DSRRoutingTableEntry>& routes)
+{
+  NS_LOG_FUNCTION (this << table << routes.size ());
+  HostRoutes* lists[] = {&m_hostRoutes, &m_nodeRoutes, &m_networkRoutes, &m_ASexternalRoutes, &m_beHostRoutes,
+                          &m_beNetworkRoutes};
+  NS_ASSERT (table < N_ROUTE_TABLES);
+  for (std::vector<Ipv4DSRRoutingTableEntry>::const_iterator i = routes.begin (); i != routes.end (); i++)
+    {
+      lists[table]->push_back (new Ipv4DSRRoutingTableEntry (*i));
+    }
+  m_indexValid = false;
+}
+
+Ipv4DSRRouting::RouteChurn
+Ipv4DSRRouting::ApplyRoutes (RouteTable table, const std::vector<Ipv4DSRRoutingTableEntry>& routes)
+{
+  NS_LOG_FUNCTION (this << table << routes.size ());
+  HostRoutes* lists[] = {&m_hostRoutes, &m_nodeRoutes, &m_networkRoutes, &m_ASexternalRoutes, &m_beHostRoutes,
+                          &m_beNetworkRoutes};
+  NS_ASSERT (table < N_ROUTE_TABLES);
+  HostRoutes& installed = *lists[table];
+  RouteChurn churn = {0, 0, 0};
+
+  typedef std::vector<Ipv4DSRRoutingTableEntry*> RouteVec_t;
+  // installed routes by (destination, gateway), in table order; a matched
+  // route is cleared from its slot so that duplicates pair up in order
+  std::unordered_map<uint64_t, RouteVec_t> candidates;
+  candidates.reserve (installed.size ());
+  for (HostRoutesCI i = installed.begin (); i != installed.end (); i++)
+    {
+      uint64_t key = (static_cast<uint64_t> ((*i)->GetDestNetwork ().Get ()) << 32) | (*i)->GetGateway ().Get ();
+      candidates[key].push_back (*i);
+    }
+
+  HostRoutes applied;
+  for (std::vector<Ipv4DSRRoutingTableEntry>::const_iterator r = routes.begin (); r != routes.end (); r++)
+    {
+      uint64_t key = (static_cast<uint64_t> (r->GetDestNetwork ().Get ()) << 32) | r->GetGateway ().Get ();
+      Ipv4DSRRoutingTableEntry* route = 0;
+      std::unordered_map<uint64_t, RouteVec_t>::iterator c = candidates.find (key);
+      if (c != candidates.end ())
+        {
+          for (RouteVec_t::iterator k = c->second.begin (); k != c->second.end (); k++)
+            {
+              if (*k != 0 && (*k)->GetInterface () == r->GetInterface ()
+                  && (*k)->GetDestNetworkMask () == r->GetDestNetworkMask ())
+                {
+                  route = *k;
+                  *k = 0;
+                  break;
+                }
+            }
+        }
+      if (route == 0)
+        {
+          route = new Ipv4DSRRoutingTableEntry (*r);
+          churn.m_added++;
+        }
+      else if (route->GetDistance () != r->GetDistance ()
+               || route->GetRoundTrip () != r->GetRoundTrip ())
+        {
+          *route = *r;
+          churn.m_updated++;
+        }
+      applied.push_back (route);
+    }
+
+  for (std::unordered_map<uint64_t, RouteVec_t>::iterator c = candidates.begin (); c != candidates.end (); c++)
+    {
+      for (RouteVec_t::iterator k = c->second.begin (); k != c->second.end (); k++)
+        {
+          if (*k != 0)
+            {
+              delete *k;
+              churn.m_removed++;
+            }
+        }
+    }
+
+  // the indexes point into the table, in table order
+  if (applied != installed)
+    {
+      m_indexValid = false;
+    }
+  installed.swap (applied);
+  NS_LOG_LOGIC ("table " << table << ": " << churn.m_added << " added, "
+                << churn.m_removed << " removed, " << churn.m_updated << " updated");
+  return churn;
+}
+
 int64_t
 Ipv4DSRRouting::AssignStreams (int64_t stream)
 {
@@ -775,16 +1412,46 @@ Ipv4DSRRouting::AssignStreams (int64_t stream)
   return 1;
 }
 
+Ptr<DSRLinkStateProtocol>
+Ipv4DSRRouting::GetLinkStateProtocol (void) const
+{
+  return m_linkStateProtocol;
+}
+
+void
+Ipv4DSRRouting::DoInitialize (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_inBandProtocol)
+    {
+      m_linkStateProtocol = CreateObject<DSRLinkStateProtocol> ();
+      m_linkStateProtocol->SetIpv4 (m_ipv4);
+      m_linkStateProtocol->Start ();
+    }
+  Ipv4RoutingProtocol::DoInitialize ();
+}
+
 void
 Ipv4DSRRouting::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
+  if (m_linkStateProtocol)
+    {
+      m_linkStateProtocol->Dispose ();
+      m_linkStateProtocol = 0;
+    }
   for (HostRoutesI i = m_hostRoutes.begin (); 
        i != m_hostRoutes.end (); 
        i = m_hostRoutes.erase (i)) 
     {
       delete (*i);
     }
+  for (HostRoutesI i = m_nodeRoutes.begin (); 
+       i != m_nodeRoutes.end (); 
+       i = m_nodeRoutes.erase (i)) 
+    {
+      delete (*i);
+    }
   for (NetworkRoutesI j = m_networkRoutes.begin (); 
        j != m_networkRoutes.end (); 
        j = m_networkRoutes.erase (j)) 
@@ -797,6 +1464,24 @@ Ipv4DSRRouting::DoDispose (void)
     {
       delete (*l);
     }
+  for (HostRoutesI i = m_beHostRoutes.begin (); 
+       i != m_beHostRoutes.end (); 
+       i = m_beHostRoutes.erase (i)) 
+    {
+      delete (*i);
+    }
+  for (NetworkRoutesI j = m_beNetworkRoutes.begin (); 
+       j != m_beNetworkRoutes.end (); 
+       j = m_beNetworkRoutes.erase (j)) 
+    {
+      delete (*j);
+    }
+  m_hostIndex.clear ();
+  m_nodeIndex.clear ();
+  m_beHostIndex.clear ();
+  m_indexValid = false;
+  m_nodeAddresses = 0;
+  m_queueingDelays.clear ();
 
   Ipv4RoutingProtocol::DoDispose ();
 }
@@ -815,7 +1500,9 @@ Ipv4DSRRouting::PrintRoutingTable (Ptr<OutputStreamWrapper> stream, Time::Unit u
 
   if (GetNRoutes () > 0)
     {
-      *os << "Destination     Gateway         Genmask         Flags Metric Ref    Use Iface" << std::endl;
+      *os << "Destination     Gateway         Genmask         Flags Metric Ref    Use Class Iface" << std::endl;
+      uint32_t nDelayGuaranteed = m_hostRoutes.size () + m_nodeRoutes.size () + m_networkRoutes.size ()
+        + m_ASexternalRoutes.size ();
       for (uint32_t j = 0; j < GetNRoutes (); j++)
         {
           /**
@@ -852,6 +1539,7 @@ Ipv4DSRRouting::PrintRoutingTable (Ptr<OutputStreamWrapper> stream, Time::Unit u
           *os << "-" << "      ";
           // Use not implemented
           *os << "-" << "   ";
+          *os << std::setiosflags (std::ios::left) << std::setw (6) << (j < nDelayGuaranteed ? "DG" : "BE");
           if (Names::FindName (m_ipv4->GetNetDevice (route.GetInterface ())) != "")
             {
               *os << Names::FindName (m_ipv4->GetNetDevice (route.GetInterface ()));
@@ -893,7 +1581,12 @@ Ipv4DSRRouting::RouteOutput (Ptr<Packet> p, const Ipv4Header &header, Ptr<NetDev
   }
   else
   {
-    rtentry = LookupDSRRoute (header.GetDestination (), oif);
+    // packets without a delay budget take the best-effort table first
+    rtentry = LookupBestEffortRoute (header.GetDestination (), oif);
+    if (rtentry == 0)
+      {
+        rtentry = LookupDSRRoute (header.GetDestination (), oif);
+      }
   }
   if (rtentry)
     {
@@ -934,6 +1627,11 @@ Ipv4DSRRouting::RouteInput  (Ptr<const Packet> p, const Ipv4Header &header, Ptr<
   NS_ASSERT (m_ipv4->GetInterfaceForDevice (idev) >= 0);
   uint32_t iif = m_ipv4->GetInterfaceForDevice (idev);
 
+  if (m_telemetry)
+    {
+      UpdateQueueingDelay (p, iif, header.GetSource ());
+    }
+
   if (m_ipv4->IsDestinationAddress (header.GetDestination (), iif))
     {
       if (!lcb.IsNull ())
@@ -981,7 +1679,11 @@ Ipv4DSRRouting::RouteInput  (Ptr<const Packet> p, const Ipv4Header &header, Ptr<
   }
   else
   {
-    rtentry = LookupDSRRoute (header.GetDestination ());
+    rtentry = LookupBestEffortRoute (header.GetDestination ());
+    if (rtentry == 0)
+      {
+        rtentry = LookupDSRRoute (header.GetDestination ());
+      }
   }
   if (rtentry != 0)
     {
@@ -1012,11 +1714,19 @@ void
 Ipv4DSRRouting::NotifyInterfaceUp (uint32_t i)
 {
   NS_LOG_FUNCTION (this << i);
+  if (i < m_interfaceDown.size () && m_interfaceDown[i])
+    {
+      m_interfaceDown[i] = 0;
+      m_nInterfacesDown--;
+    }
+  if (m_linkStateProtocol)
+    {
+      m_linkStateProtocol->NotifyInterfaceUp (i);
+      return;
+    }
   if (m_respondToInterfaceEvents && Simulator::Now ().GetSeconds () > 0)  // avoid startup events
     {
-      DSRRouteManager::DeleteDSRRoutes ();
-      DSRRouteManager::BuildDSRRoutingDatabase ();
-      DSRRouteManager::InitializeRoutes ();
+      DSRRouteManager::ScheduleUpdateRoutes ();
     }
 }
 
@@ -1024,11 +1734,25 @@ void
 Ipv4DSRRouting::NotifyInterfaceDown (uint32_t i)
 {
   NS_LOG_FUNCTION (this << i);
+  // the routes through the interface are bypassed at once, whatever
+  // recomputes them later
+  if (i >= m_interfaceDown.size ())
+    {
+      m_interfaceDown.resize (i + 1, 0);
+    }
+  if (!m_interfaceDown[i])
+    {
+      m_interfaceDown[i] = 1;
+      m_nInterfacesDown++;
+    }
+  if (m_linkStateProtocol)
+    {
+      m_linkStateProtocol->NotifyInterfaceDown (i);
+      return;
+    }
   if (m_respondToInterfaceEvents && Simulator::Now ().GetSeconds () > 0)  // avoid startup events
     {
-      DSRRouteManager::DeleteDSRRoutes ();
-      DSRRouteManager::BuildDSRRoutingDatabase ();
-      DSRRouteManager::InitializeRoutes ();
+      DSRRouteManager::ScheduleUpdateRoutes ();
     }
 }
 
@@ -1036,11 +1760,14 @@ void
 Ipv4DSRRouting::NotifyAddAddress (uint32_t interface, Ipv4InterfaceAddress address)
 {
   NS_LOG_FUNCTION (this << interface << address);
+  if (m_linkStateProtocol)
+    {
+      m_linkStateProtocol->NotifyAddressChange (interface);
+      return;
+    }
   if (m_respondToInterfaceEvents && Simulator::Now ().GetSeconds () > 0)  // avoid startup events
     {
-      DSRRouteManager::DeleteDSRRoutes ();
-      DSRRouteManager::BuildDSRRoutingDatabase ();
-      DSRRouteManager::InitializeRoutes ();
+      DSRRouteManager::ScheduleUpdateRoutes ();
     }
 }
 
@@ -1048,11 +1775,14 @@ void
 Ipv4DSRRouting::NotifyRemoveAddress (uint32_t interface, Ipv4InterfaceAddress address)
 {
   NS_LOG_FUNCTION (this << interface << address);
+  if (m_linkStateProtocol)
+    {
+      m_linkStateProtocol->NotifyAddressChange (interface);
+      return;
+    }
   if (m_respondToInterfaceEvents && Simulator::Now ().GetSeconds () > 0)  // avoid startup events
     {
-      DSRRouteManager::DeleteDSRRoutes ();
-      DSRRouteManager::BuildDSRRoutingDatabase ();
-      DSRRouteManager::InitializeRoutes ();
+      DSRRouteManager::ScheduleUpdateRoutes ();
     }
 }
 
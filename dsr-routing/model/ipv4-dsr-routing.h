@@ -24,10 +24,13 @@
 #define IPV4_DSR_ROUTING_H
 
 #include <list>
+#include <unordered_map>
+#include <vector>
 #include <stdint.h>
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv4-header.h"
 #include "ns3/ptr.h"
+#include "ns3/simple-ref-count.h"
 #include "ns3/ipv4.h"
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/random-variable-stream.h"
@@ -44,6 +47,57 @@ class Ipv4Header;
 class Ipv4DSRRoutingTableEntry;
 class Ipv4MulticastRoutingTableEntry;
 class Node;
+class DSRLinkStateProtocol;
+
+/**
+ * \ingroup dsr-routing
+ *
+ * \brief Router ID of each point-to-point interface address
+ *
+ * DSRRouteManager installs the routes to a router once, to its router ID,
+ * in the NODE_ROUTES table of Ipv4DSRRouting, rather than once per
+ * interface address.  This map resolves a destination address to the
+ * router ID at lookup time.  It is built with the routing database and
+ * shared by all the routing tables of the simulation, as a vector sorted
+ * by address.
+ */
+class DSRNodeAddressMap : public SimpleRefCount<DSRNodeAddressMap>
+{
+public:
+  /**
+   * \brief Add an interface address of a router
+   *
+   * Call Sort () once all the addresses are in.
+   *
+   * \param address the interface address
+   * \param routerId the router ID
+   */
+  void Add (Ipv4Address address, Ipv4Address routerId);
+
+  /**
+   * \brief Sort the addresses for Lookup (); an address added twice keeps
+   * the router it was first added with
+   */
+  void Sort (void);
+
+  /**
+   * \brief Get the router of an address
+   * \param address the address
+   * \param routerId the router ID, if found
+   * \return true if \p address is an interface address of a router
+   */
+  bool Lookup (Ipv4Address address, Ipv4Address& routerId) const;
+
+  /**
+   * \brief Get the number of addresses
+   * \return the number of addresses in the map
+   */
+  uint32_t GetN (void) const;
+
+private:
+  /// (address, router ID) pairs, sorted by address
+  std::vector<std::pair<uint32_t, uint32_t> > m_routers;
+};
 
 /**
  * \ingroup ipv4
@@ -144,6 +198,43 @@ public:
                        uint32_t interface,
                        uint32_t distance);
 
+  /**
+   * \brief Add a route to every interface address of a router.
+   *
+   * The route applies to the addresses the DSRNodeAddressMap set with
+   * SetNodeAddresses () resolves to \p routerId.  A lookup considers the
+   * host routes to the destination address first, then the routes to its
+   * router.
+   *
+   * \param routerId The router ID of the destination router.
+   * \param nextHop The next hop Ipv4Address
+   * \param interface The network interface index used to send packets to the
+   *  destination
+   * \param distance The distance between root and destination
+   */
+  void AddNodeRouteTo (Ipv4Address routerId,
+                       Ipv4Address nextHop,
+                       uint32_t interface,
+                       uint32_t distance);
+
+  /**
+   * \brief Set the map that resolves addresses to the routers of the node routes.
+   *
+   * \param addresses The map, shared with the other routing tables.
+   */
+  void SetNodeAddresses (Ptr<const DSRNodeAddressMap> addresses);
+
+  /**
+   * \brief Compute the routes to a router when a lookup first needs them.
+   *
+   * Set by DSRRouteManager when the DsrLazyRouting global value applies: a
+   * lookup for an address of a router the table has no node route to asks
+   * DSRRouteManager::ComputeRoutesTo () for them first.
+   *
+   * \param lazy whether the node routes are computed on demand
+   */
+  void SetLazyRouting (bool lazy);
+
   /**
    * \brief Add a network route to the global routing table.
    *
@@ -160,6 +251,28 @@ public:
                           Ipv4Address nextHop, 
                           uint32_t interface);
 
+  /**
+   * \brief Add a network route with a distance to the global routing table.
+   *
+   * Used for the area summaries of DSRRouteManager: the distance is that
+   * of the farthest destination of the network, so that a delay budget
+   * that fits it fits every destination.
+   *
+   * \param network The Ipv4Address network for this route.
+   * \param networkMask The Ipv4Mask to extract the network.
+   * \param nextHop The next hop in the route to the destination network.
+   * \param interface The network interface index used to send packets to the
+   * destination.
+   * \param distance The distance between root and the farthest destination.
+   *
+   * \see Ipv4Address
+   */
+  void AddNetworkRouteTo (Ipv4Address network, 
+                          Ipv4Mask networkMask, 
+                          Ipv4Address nextHop, 
+                          uint32_t interface,
+                          uint32_t distance);
+
   /**
    * \brief Add a network route to the global routing table.
    *
@@ -188,6 +301,37 @@ public:
                              Ipv4Address nextHop,
                              uint32_t interface);
 
+  /**
+   * \brief Add a host route to the best-effort routing table.
+   *
+   * Packets without a BudgetTag are forwarded with the best-effort table
+   * first, which holds the single next hop of a minimum hop path.
+   *
+   * \param dest The Ipv4Address destination for this route.
+   * \param nextHop The next hop Ipv4Address
+   * \param interface The network interface index used to send packets to the
+   *  destination
+   * \param hops The number of hops between root and destination
+   */
+  void AddBestEffortHostRouteTo (Ipv4Address dest,
+                                 Ipv4Address nextHop,
+                                 uint32_t interface,
+                                 uint32_t hops);
+
+  /**
+   * \brief Add a network route to the best-effort routing table.
+   *
+   * \param network The Ipv4Address network for this route.
+   * \param networkMask The Ipv4Mask to extract the network.
+   * \param nextHop The next hop Ipv4Address
+   * \param interface The network interface index used to send packets to the
+   * destination.
+   */
+  void AddBestEffortNetworkRouteTo (Ipv4Address network,
+                                    Ipv4Mask networkMask,
+                                    Ipv4Address nextHop,
+                                    uint32_t interface);
+
   /**
    * \brief Get the number of individual unicast routes that have been added
    * to the routing table.
@@ -237,6 +381,79 @@ public:
    */
   void RemoveRoute (uint32_t i);
 
+  /**
+   * \brief Remove every host route to a destination, in both tables.
+   *
+   * \param dest The destination address.
+   * \returns the number of routes removed
+   */
+  uint32_t RemoveHostRoutesTo (Ipv4Address dest);
+
+  /**
+   * \brief Remove every network route to a network, in both tables.
+   *
+   * \param network The network number.
+   * \param networkMask The network mask.
+   * \returns the number of routes removed
+   */
+  uint32_t RemoveNetworkRoutesTo (Ipv4Address network, Ipv4Mask networkMask);
+
+  /// The tables of the routing protocol, in the order GetRoute () lists them
+  enum RouteTable
+  {
+    HOST_ROUTES = 0,            //!< Routes to hosts
+    NODE_ROUTES,                //!< Routes to routers, by router ID
+    NETWORK_ROUTES,             //!< Routes to networks
+    AS_EXTERNAL_ROUTES,         //!< External routes imported
+    BEST_EFFORT_HOST_ROUTES,    //!< Best-effort routes to hosts
+    BEST_EFFORT_NETWORK_ROUTES, //!< Best-effort routes to networks
+    N_ROUTE_TABLES              //!< Number of tables
+  };
+
+  /**
+   * \brief Copy the routes of one table.
+   *
+   * \param table The table.
+   * \param routes The vector the routes are appended to, in table order.
+   */
+  void GetRoutes (RouteTable table, std::vector<Ipv4DSRRoutingTableEntry>& routes) const;
+
+  /**
+   * \brief Append routes to one table.
+   *
+   * Bulk counterpart of the Add*RouteTo () methods, for restoring routes
+   * read with GetRoutes ().
+   *
+   * \param table The table.
+   * \param routes The routes, in table order.
+   */
+  void AddRoutes (RouteTable table, const std::vector<Ipv4DSRRoutingTableEntry>& routes);
+
+  /// Changes ApplyRoutes () made to a table
+  struct RouteChurn
+  {
+    uint32_t m_added;   //!< routes inserted
+    uint32_t m_removed; //!< routes removed
+    uint32_t m_updated; //!< routes kept with a new distance
+  };
+
+  /**
+   * \brief Replace the routes of one table, changing only what differs.
+   *
+   * An installed route with the destination, mask, gateway and interface
+   * of a new route is kept, and only its distance and round trip are
+   * updated; the other
+   * installed routes are removed and the missing ones inserted.  The table
+   * ends up listing the routes in the given order, exactly as if it had
+   * been emptied and refilled, but the entries that did not change are
+   * neither freed nor allocated again.
+   *
+   * \param table The table.
+   * \param routes The new routes, in table order.
+   * \returns the changes made to the table
+   */
+  RouteChurn ApplyRoutes (RouteTable table, const std::vector<Ipv4DSRRoutingTableEntry>& routes);
+
 
   /**
    * @brief Build the routing database by gathering Link State Advertisements
@@ -254,18 +471,67 @@ public:
    */
   int64_t AssignStreams (int64_t stream);
 
+  /**
+   * \brief Get the in-band link-state protocol of the router
+   *
+   * \return the protocol, or 0 unless the InBandProtocol attribute is set
+   * and the router was initialized
+   */
+  Ptr<DSRLinkStateProtocol> GetLinkStateProtocol (void) const;
+
+  /**
+   * \brief Get the queueing delay telemetry reports towards a destination
+   *
+   * Delay-guaranteed packets carry a TelemetryTag when the Telemetry
+   * attribute is set.  The queueing delay of the path a packet from \p dest
+   * arrived on is taken as an estimate of the queueing delay towards \p dest
+   * through the same neighbour, and smoothed per (interface, address) with
+   * an EWMA of weight TelemetryWeight.  This is a reverse-path estimate:
+   * the packets from \p dest crossed the queues towards this router, not
+   * those towards \p dest.
+   *
+   * The estimate is added to route distances, which are compared with
+   * delay budgets in microseconds; it only makes sense with link metrics in
+   * microseconds too, such as those of DsrLinkMetric set to ChannelDelay.
+   *
+   * \param interface the interface of the neighbour
+   * \param dest the destination address
+   * \return the smoothed queueing delay in microseconds, or 0 if no packet
+   * from \p dest arrived on \p interface
+   */
+  uint32_t GetQueueingDelayEstimate (uint32_t interface, Ipv4Address dest) const;
+
   // static bool CompareRouteCost(Ipv4DSRRoutingTableEntry* route1, Ipv4DSRRoutingTableEntry* route2);
 
 protected:
   void DoDispose (void);
+  virtual void DoInitialize (void);
 
 private:
   /// Set to true if packets are randomly routed among ECMP; set to false for using only one route consistently
   bool m_randomEcmpRouting;
   /// Set to true if this interface should respond to interface events by globallly recomputing routes 
   bool m_respondToInterfaceEvents;
+  /// Set to true to bypass the routes through a down interface until the routes are recomputed
+  bool m_fastReroute;
+  /// Nonzero for the interfaces reported down, by interface index
+  std::vector<uint8_t> m_interfaceDown;
+  /// Number of interfaces reported down
+  uint32_t m_nInterfacesDown;
+  /// Set to true if the routes are learned by the in-band link-state protocol rather than from DSRRouteManager
+  bool m_inBandProtocol;
+  /// The in-band link-state protocol, when m_inBandProtocol is set
+  Ptr<DSRLinkStateProtocol> m_linkStateProtocol;
   /// A uniform random number generator for randomly routing packets among ECMP 
   Ptr<UniformRandomVariable> m_rand;
+  /// Set to true to record queueing delays in delay-guaranteed packets and add them to the route costs
+  bool m_telemetry;
+  /// Maximum size of the TelemetryTag of a packet, in bytes
+  uint32_t m_telemetryMaxBytes;
+  /// Weight of a new sample in the queueing delay estimates
+  double m_telemetryWeight;
+  /// Smoothed queueing delay in microseconds by (interface << 32 | address)
+  std::unordered_map<uint64_t, double> m_queueingDelays;
 
   /// container of Ipv4RoutingTableEntry (routes to hosts)
   typedef std::list<Ipv4DSRRoutingTableEntry *> HostRoutes;
@@ -297,13 +563,97 @@ private:
   Ptr<Ipv4Route> LookupDSRRoute (Ipv4Address dest, Ptr<NetDevice> oif = 0);
   Ptr<Ipv4Route> LookupDSRRoute (Ipv4Address dest, Ptr<Packet> p, Ptr<NetDevice> oif = 0);
 
+  /**
+   * \brief Lookup in the best-effort tables for destination.
+   *
+   * Only packets without a BudgetTag are routed with these tables; the
+   * callers check the tag first.
+   *
+   * \param dest destination address
+   * \param oif output interface if any (put 0 otherwise)
+   * \return the minimum hop route to dest, 0 if the tables have none
+   */
+  Ptr<Ipv4Route> LookupBestEffortRoute (Ipv4Address dest, Ptr<NetDevice> oif = 0);
+
+  /**
+   * \brief Get the cost of a delay-guaranteed route, queueing included.
+   * \param route the route
+   * \param dest the destination address
+   * \return the distance of the route plus the queueing delay estimate
+   * through its interface, in microseconds
+   */
+  uint32_t GetEffectiveDistance (const Ipv4DSRRoutingTableEntry* route, Ipv4Address dest) const;
+
+  /**
+   * \brief Fold the telemetry of a received packet into the estimates.
+   * \param p the packet
+   * \param interface the receiving interface
+   * \param source the source address of the packet
+   */
+  void UpdateQueueingDelay (Ptr<const Packet> p, uint32_t interface, Ipv4Address source);
+
+  /**
+   * \brief Rebuild the host route indexes if a route changed since the last lookup.
+   */
+  void UpdateLookupIndex (void);
+
+  /**
+   * \brief Have the node routes to the router of a destination computed if
+   * the table has none yet (see SetLazyRouting ()); a destination that is
+   * not a router address may have every route computed.
+   * \param dest the destination address
+   */
+  void ComputeLazyRoutes (Ipv4Address dest);
+
+  /**
+   * \brief Collect the delay-guaranteed host and node routes to a destination.
+   * \param dest the destination address
+   * \param oif output interface if any (put 0 otherwise)
+   * \param routes the vector the routes are appended to, host routes first,
+   * each kind in table order
+   *
+   * If a route is bypassed (see IsBypassed ()), only the loop-free
+   * alternates among the others are appended when there are any.
+   */
+  void GetHostRoutes (Ipv4Address dest, Ptr<NetDevice> oif, std::vector<Ipv4DSRRoutingTableEntry *>& routes) const;
+
+  /**
+   * \brief Whether the routes through an interface are skipped because the
+   * interface went down and the FastReroute attribute is set.
+   * \param interface the interface index
+   * \return true if the interface is bypassed
+   */
+  bool IsBypassed (uint32_t interface) const;
+
+  /**
+   * \brief Create the Ipv4Route of a routing table entry.
+   * \param route the entry
+   * \param dest the destination address of the packet, which a node route
+   * does not hold
+   * \return the route
+   */
+  Ptr<Ipv4Route> CreateRoute (const Ipv4DSRRoutingTableEntry* route, Ipv4Address dest) const;
+
   HostRoutes m_hostRoutes;             //!< Routes to hosts
+  HostRoutes m_nodeRoutes;             //!< Routes to routers, by router ID
   NetworkRoutes m_networkRoutes;       //!< Routes to networks
   ASExternalRoutes m_ASexternalRoutes; //!< External routes imported
+  HostRoutes m_beHostRoutes;           //!< Best-effort routes to hosts
+  NetworkRoutes m_beNetworkRoutes;     //!< Best-effort routes to networks
 
-  Ptr<Ipv4> m_ipv4; //!< associated IPv4 instance
+  /// Delay-guaranteed host routes by destination, in table order
+  std::unordered_map<uint32_t, std::vector<Ipv4DSRRoutingTableEntry *> > m_hostIndex;
+  /// Node routes by router ID, in table order
+  std::unordered_map<uint32_t, std::vector<Ipv4DSRRoutingTableEntry *> > m_nodeIndex;
+  /// Router ID of the addresses, for the node routes
+  Ptr<const DSRNodeAddressMap> m_nodeAddresses;
+  /// Set to true if the node routes are computed on the first lookup of their router
+  bool m_lazyRouting;
+  /// Best-effort host route by destination
+  std::unordered_map<uint32_t, Ipv4DSRRoutingTableEntry *> m_beHostIndex;
+  bool m_indexValid;                   //!< whether the indexes match the tables
 
-  // DSRRouteManagerNSDB* m_nsdb;
+  Ptr<Ipv4> m_ipv4; //!< associated IPv4 instance
 };
 
 } // Namespace ns3
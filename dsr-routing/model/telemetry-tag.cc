@@ -0,0 +1,122 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+
+#include <iostream>
+#include <limits>
+
+#include "ns3/core-module.h"
+#include "telemetry-tag.h"
+
+namespace ns3 {
+
+namespace {
+
+/// Add two delays, saturating rather than wrapping
+uint32_t
+SaturatingAdd (uint32_t a, uint32_t b)
+{
+  return b > std::numeric_limits<uint32_t>::max () - a ? std::numeric_limits<uint32_t>::max () : a + b;
+}
+
+} // anonymous namespace
+
+//----------------------------------------------------------------------
+//-- TelemetryTag
+//------------------------------------------------------
+TypeId
+TelemetryTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("TelemetryTag")
+    .SetParent<Tag> ()
+    .AddConstructor<TelemetryTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+TelemetryTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+TelemetryTag::TelemetryTag ()
+  : m_folded (0)
+{
+}
+
+uint32_t
+TelemetryTag::GetSerializedSize (void) const
+{
+  return FIXED_SIZE + m_records.size () * RECORD_SIZE;
+}
+
+void
+TelemetryTag::Serialize (TagBuffer i) const
+{
+  i.WriteU8 (m_records.size ());
+  i.WriteU32 (m_folded);
+  for (uint32_t r = 0; r < m_records.size (); r++)
+    {
+      i.WriteU32 (m_records[r]);
+    }
+}
+
+void
+TelemetryTag::Deserialize (TagBuffer i)
+{
+  uint8_t n = i.ReadU8 ();
+  m_folded = i.ReadU32 ();
+  m_records.resize (n);
+  for (uint32_t r = 0; r < n; r++)
+    {
+      m_records[r] = i.ReadU32 ();
+    }
+}
+
+void
+TelemetryTag::AddHop (uint32_t delay, uint32_t maxRecords)
+{
+  // the record count is serialized on one byte
+  maxRecords = std::min<uint32_t> (maxRecords, std::numeric_limits<uint8_t>::max ());
+  m_records.push_back (delay);
+  while (m_records.size () > maxRecords)
+    {
+      m_folded = SaturatingAdd (m_folded, m_records.front ());
+      m_records.erase (m_records.begin ());
+    }
+}
+
+uint32_t
+TelemetryTag::GetNRecords (void) const
+{
+  return m_records.size ();
+}
+
+uint32_t
+TelemetryTag::GetRecord (uint32_t i) const
+{
+  NS_ASSERT (i < m_records.size ());
+  return m_records[i];
+}
+
+uint32_t
+TelemetryTag::GetTotalDelay (void) const
+{
+  uint32_t total = m_folded;
+  for (uint32_t r = 0; r < m_records.size (); r++)
+    {
+      total = SaturatingAdd (total, m_records[r]);
+    }
+  return total;
+}
+
+void
+TelemetryTag::Print (std::ostream &os) const
+{
+  os << "folded=" << m_folded << " hops=";
+  for (uint32_t r = 0; r < m_records.size (); r++)
+    {
+      os << (r ? "," : "") << m_records[r];
+    }
+}
+
+}
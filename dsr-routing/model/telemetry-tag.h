@@ -0,0 +1,67 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef TELEMETRYTAG_H
+#define TELEMETRYTAG_H
+
+#include <vector>
+#include "ns3/tag.h"
+#include "ns3/packet.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup dsr-routing
+ *
+ * \brief Queueing delays met by a delay-guaranteed packet along its path
+ *
+ * Every hop appends the queueing delay of the lane it chose for the packet.
+ * The tag lists at most a given number of hops: when it is full, the delay
+ * of the oldest listed hop is folded into a running sum, so the total delay
+ * stays exact while the tag never grows beyond
+ * FIXED_SIZE + maxRecords * RECORD_SIZE bytes.
+ */
+class TelemetryTag : public Tag
+{
+public:
+  static const uint32_t FIXED_SIZE = 5;  //!< bytes of the record count and of the folded sum
+  static const uint32_t RECORD_SIZE = 4; //!< bytes of one hop record
+
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  TelemetryTag ();
+
+  /**
+   * \brief Record the queueing delay of one hop
+   * \param delay the queueing delay of the chosen lane, in microseconds
+   * \param maxRecords the number of hops the tag may list
+   */
+  void AddHop (uint32_t delay, uint32_t maxRecords);
+  /**
+   * \brief Get the number of hops listed
+   * \return the number of hop records
+   */
+  uint32_t GetNRecords (void) const;
+  /**
+   * \brief Get the queueing delay of a listed hop
+   * \param i the record index, the oldest hop first
+   * \return the queueing delay, in microseconds
+   */
+  uint32_t GetRecord (uint32_t i) const;
+  /**
+   * \brief Get the queueing delay of the whole path so far
+   * \return the folded sum plus the listed delays, in microseconds
+   */
+  uint32_t GetTotalDelay (void) const;
+
+private:
+  uint32_t m_folded;                // delay of the hops no longer listed, in microseconds
+  std::vector<uint32_t> m_records;  // delay of the last hops, in microseconds
+};
+
+}
+
+#endif /* TELEMETRYTAG_H */
@@ -1,7 +1,28 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
 
+#include <sstream>
+#include <set>
+#include <map>
+#include <limits>
+
 // Include a header file from your module to test.
-#include "ns3/dsr-routing.h"
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/point-to-point-module.h"
+#include "ns3/traffic-control-module.h"
+#include "ns3/ipv4-dsr-routing-helper.h"
+#include "ns3/dsr-route-manager.h"
+#include "ns3/dsr-route-manager-impl.h"
+#include "ns3/dsr-router-interface.h"
+#include "ns3/ipv4-dsr-routing.h"
+#include "ns3/ipv4-dsr-routing-table-entry.h"
+#include "ns3/dsr-route-controller.h"
+#include "ns3/dsr-virtual-queue-disc.h"
+#include "ns3/budget-tag.h"
+#include "ns3/priority-tag.h"
+#include "ns3/timestamp-tag.h"
+#include "ns3/telemetry-tag.h"
 
 // An essential include is test.h
 #include "ns3/test.h"
@@ -46,6 +67,1660 @@ DsrRoutingTestCase1::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ_TOL (0.01, 0.01, 0.001, "Numbers are not equal within tolerance");
 }
 
+// Binds a GlobalValue for the lifetime of the object, then binds back the
+// value it had before, so that a test leaves the defaults behind even when
+// one of its assertions returns early.
+class DsrScopedGlobalValue
+{
+public:
+  DsrScopedGlobalValue (std::string name, const AttributeValue& value)
+    : m_name (name)
+  {
+    GlobalValue::GetValueByName (name, m_saved);
+    GlobalValue::Bind (name, value);
+  }
+  ~DsrScopedGlobalValue ()
+  {
+    GlobalValue::Bind (m_name, m_saved);
+  }
+
+private:
+  std::string m_name;  //!< the name of the GlobalValue
+  StringValue m_saved; //!< the value before the binding
+};
+
+// Sets the default value of an attribute, as Config::SetDefault () does, for
+// the lifetime of the object, then sets back the default it had before.
+class DsrScopedDefault
+{
+public:
+  DsrScopedDefault (std::string path, const AttributeValue& value)
+    : m_path (path)
+  {
+    std::string::size_type sep = path.rfind ("::");
+    struct TypeId::AttributeInformation info;
+    bool found = TypeId::LookupByName (path.substr (0, sep)).LookupAttributeByName (path.substr (sep + 2), &info);
+    NS_ABORT_MSG_UNLESS (found, "No attribute " << path);
+    m_saved = info.initialValue->Copy ();
+    Config::SetDefault (path, value);
+  }
+  ~DsrScopedDefault ()
+  {
+    Config::SetDefault (m_path, *m_saved);
+  }
+
+private:
+  std::string m_path;          //!< the attribute, as given to Config::SetDefault ()
+  Ptr<AttributeValue> m_saved; //!< the default before the change
+};
+
+// Installs an Internet stack routed by DSR on some nodes.
+static void
+InstallDsrStack (NodeContainer& nodes)
+{
+  Ipv4DSRRoutingHelper dsr;
+  Ipv4ListRoutingHelper list;
+  list.Add (dsr, 10);
+  InternetStackHelper internet;
+  internet.SetRoutingHelper (list);
+  internet.Install (nodes);
+}
+
+// Builds a side x side grid of routers joined by point-to-point links, with
+// the diagonals unless told otherwise, and link metrics of 1 to 3 that leave
+// many equal-cost paths.  The devices of each link are appended to links, if
+// given.
+static void
+BuildDsrMesh (uint32_t side, NodeContainer& nodes, std::vector<NetDeviceContainer>* links = 0,
+              bool diagonals = true)
+{
+  nodes.Create (side * side);
+  InstallDsrStack (nodes);
+
+  PointToPointHelper p2p;
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.255.255.252");
+  uint32_t link = 0;
+  for (uint32_t row = 0; row < side; row++)
+    {
+      for (uint32_t col = 0; col < side; col++)
+        {
+          uint32_t n = row * side + col;
+          std::vector<uint32_t> peers;
+          if (col + 1 < side)
+            {
+              peers.push_back (n + 1);
+            }
+          if (row + 1 < side)
+            {
+              peers.push_back (n + side);
+              if (diagonals && col + 1 < side)
+                {
+                  peers.push_back (n + side + 1);
+                }
+            }
+          for (uint32_t p = 0; p < peers.size (); p++)
+            {
+              NetDeviceContainer devices = p2p.Install (nodes.Get (n), nodes.Get (peers[p]));
+              Ipv4InterfaceContainer interfaces = address.Assign (devices);
+              address.NewNetwork ();
+              uint16_t metric = 1 + link++ % 3;
+              for (uint32_t j = 0; j < 2; j++)
+                {
+                  interfaces.Get (j).first->SetMetric (interfaces.Get (j).second, metric);
+                }
+              if (links)
+                {
+                  links->push_back (devices);
+                }
+            }
+        }
+    }
+}
+
+// Builds a triangle of routers: node 0 reaches node 2 over a direct link of
+// the given metric, or over a detour of two links of metric 1 through node 1.
+// Returns the address of node 2 on the link from node 1.
+static Ipv4Address
+BuildDsrTriangle (uint16_t directMetric, NodeContainer& nodes, NetDeviceContainer& direct,
+                  NetDeviceContainer& detour)
+{
+  nodes.Create (3);
+  InstallDsrStack (nodes);
+
+  PointToPointHelper p2p;
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.255.255.252");
+  direct = p2p.Install (nodes.Get (0), nodes.Get (2));
+  Ipv4InterfaceContainer interfaces = address.Assign (direct);
+  for (uint32_t j = 0; j < 2; j++)
+    {
+      interfaces.Get (j).first->SetMetric (interfaces.Get (j).second, directMetric);
+    }
+  address.NewNetwork ();
+  detour = p2p.Install (nodes.Get (0), nodes.Get (1));
+  address.Assign (detour);
+  address.NewNetwork ();
+  Ipv4InterfaceContainer last = address.Assign (p2p.Install (nodes.Get (1), nodes.Get (2)));
+  return last.GetAddress (1);
+}
+
+// Returns the routing table of each router, one line per route.
+static std::vector<std::string>
+DumpDsrRoutes (const NodeContainer& nodes)
+{
+  std::vector<std::string> routes;
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      Ptr<Ipv4DSRRouting> routing = nodes.Get (i)->GetObject<DSRRouter> ()->GetRoutingProtocol ();
+      std::ostringstream os;
+      for (uint32_t j = 0; j < routing->GetNRoutes (); j++)
+        {
+          Ipv4DSRRoutingTableEntry* route = routing->GetRoute (j);
+          os << *route << ", distance=" << route->GetDistance () << "\n";
+        }
+      routes.push_back (os.str ());
+    }
+  return routes;
+}
+
+// Returns the host and node routes of a router, one string per route, with
+// their round trips.
+static std::vector<std::string>
+DumpDsrRoundTrips (Ptr<Ipv4DSRRouting> routing)
+{
+  std::vector<Ipv4DSRRoutingTableEntry> routes;
+  routing->GetRoutes (Ipv4DSRRouting::HOST_ROUTES, routes);
+  routing->GetRoutes (Ipv4DSRRouting::NODE_ROUTES, routes);
+  std::vector<std::string> dump;
+  for (uint32_t j = 0; j < routes.size (); j++)
+    {
+      std::ostringstream os;
+      os << routes[j] << ", distance=" << routes[j].GetDistance () << ", roundTrip=" << routes[j].GetRoundTrip ();
+      dump.push_back (os.str ());
+    }
+  return dump;
+}
+
+// Checks that the work of the route computation, as reported by
+// DSRRouteManager::GetStats (), grows sub-quadratically with the size of
+// a grid of routers.
+class DsrRoutingScalingTestCase : public TestCase
+{
+public:
+  DsrRoutingScalingTestCase ();
+  virtual ~DsrRoutingScalingTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Compute the routes of a side x side grid of point-to-point links, without
+   * diagonals
+   * \param side the number of routers along each side of the grid
+   * \returns the statistics of the computation
+   */
+  DSRRouteComputationStats RunGrid (uint32_t side);
+};
+
+DsrRoutingScalingTestCase::DsrRoutingScalingTestCase ()
+  : TestCase ("DsrRouting route computation counters scale sub-quadratically")
+{
+}
+
+DsrRoutingScalingTestCase::~DsrRoutingScalingTestCase ()
+{
+}
+
+DSRRouteComputationStats
+DsrRoutingScalingTestCase::RunGrid (uint32_t side)
+{
+  NodeContainer nodes;
+  BuildDsrMesh (side, nodes, 0, false);
+  DSRRouteManager::DeleteDSRRoutes ();
+  DSRRouteManager::BuildDSRRoutingDatabase ();
+  DSRRouteManager::InitializeRoutes ();
+  DSRRouteComputationStats stats = DSRRouteManager::GetStats ();
+  Simulator::Destroy ();
+  return stats;
+}
+
+void
+DsrRoutingScalingTestCase::DoRun (void)
+{
+  DSRRouteComputationStats small = RunGrid (4);
+  DSRRouteComputationStats large = RunGrid (8);
+
+  // The large grid has four times the routers; anything growing like the
+  // square of the grid size would grow sixteen times.
+  double quadratic = 16;
+  NS_TEST_ASSERT_MSG_EQ (small.m_routesPerNode.size (), 16, "Route counts not reported for every node");
+  NS_TEST_ASSERT_MSG_EQ (large.m_routesPerNode.size (), 64, "Route counts not reported for every node");
+  NS_TEST_ASSERT_MSG_GT (small.m_spfRuns, 0, "No SPF runs counted");
+  NS_TEST_ASSERT_MSG_GT (small.m_routesInstalled, 0, "No routes counted");
+
+  double runs = double (large.m_spfRuns) / small.m_spfRuns;
+  NS_TEST_ASSERT_MSG_LT (runs, quadratic, "SPF runs grow quadratically");
+  double queue = (double (large.m_queueOperations) / large.m_spfRuns) /
+    (double (small.m_queueOperations) / small.m_spfRuns);
+  NS_TEST_ASSERT_MSG_LT (queue, quadratic, "Queue operations per SPF run grow quadratically");
+  double vertices = (double (large.m_verticesReached) / large.m_spfRuns) /
+    (double (small.m_verticesReached) / small.m_spfRuns);
+  NS_TEST_ASSERT_MSG_LT (vertices, quadratic, "Vertices per SPF run grow quadratically");
+  uint32_t smallRoutes = *std::max_element (small.m_routesPerNode.begin (), small.m_routesPerNode.end ());
+  uint32_t largeRoutes = *std::max_element (large.m_routesPerNode.begin (), large.m_routesPerNode.end ());
+  NS_TEST_ASSERT_MSG_LT (double (largeRoutes) / smallRoutes, quadratic, "Routes per node grow quadratically");
+}
+
+// Checks that the SPF trees read off the Floyd-Warshall distance matrix give
+// every router the same routes, in the same order, as one Dijkstra search per
+// SPF job, on a grid with diagonals and uneven link metrics.
+class DsrRoutingDistanceMatrixTestCase : public TestCase
+{
+public:
+  DsrRoutingDistanceMatrixTestCase ();
+  virtual ~DsrRoutingDistanceMatrixTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Compute the routes of a side x side grid of point-to-point links with
+   * diagonals, using one SPF backend
+   * \param side the number of routers along each side of the grid
+   * \param backend the value of DsrSpfBackend
+   * \param routes the routing table of each router, one line per route
+   * \returns the statistics of the computation
+   */
+  DSRRouteComputationStats RunMesh (uint32_t side, std::string backend, std::vector<std::string>& routes);
+};
+
+DsrRoutingDistanceMatrixTestCase::DsrRoutingDistanceMatrixTestCase ()
+  : TestCase ("DsrRouting distance matrix backend installs the routes of Dijkstra")
+{
+}
+
+DsrRoutingDistanceMatrixTestCase::~DsrRoutingDistanceMatrixTestCase ()
+{
+}
+
+DSRRouteComputationStats
+DsrRoutingDistanceMatrixTestCase::RunMesh (uint32_t side, std::string backend, std::vector<std::string>& routes)
+{
+  DsrScopedGlobalValue spfBackend ("DsrSpfBackend", StringValue (backend));
+  NodeContainer nodes;
+  BuildDsrMesh (side, nodes);
+  DSRRouteManager::DeleteDSRRoutes ();
+  DSRRouteManager::BuildDSRRoutingDatabase ();
+  DSRRouteManager::InitializeRoutes ();
+  DSRRouteComputationStats stats = DSRRouteManager::GetStats ();
+  routes = DumpDsrRoutes (nodes);
+  Simulator::Destroy ();
+  return stats;
+}
+
+void
+DsrRoutingDistanceMatrixTestCase::DoRun (void)
+{
+  std::vector<std::string> dijkstra;
+  std::vector<std::string> matrix;
+  DSRRouteComputationStats dijkstraStats = RunMesh (5, "Dijkstra", dijkstra);
+  DSRRouteComputationStats matrixStats = RunMesh (5, "FloydWarshall", matrix);
+
+  NS_TEST_ASSERT_MSG_EQ (dijkstraStats.m_matrixVertices, 0, "Dijkstra backend used the distance matrix");
+  NS_TEST_ASSERT_MSG_GT (matrixStats.m_matrixVertices, 0, "FloydWarshall backend did not use the distance matrix");
+  NS_TEST_ASSERT_MSG_EQ (matrixStats.m_spfRuns, dijkstraStats.m_spfRuns, "Backends ran a different number of SPF jobs");
+  NS_TEST_ASSERT_MSG_EQ (matrix.size (), dijkstra.size (), "Backends filled a different number of tables");
+  for (uint32_t i = 0; i < dijkstra.size () && i < matrix.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_NE (dijkstra[i].size (), 0, "No routes for node " << i);
+      NS_TEST_ASSERT_MSG_EQ (matrix[i], dijkstra[i], "Routes of node " << i << " differ between the backends");
+    }
+}
+
+// Checks that the routing tables do not depend on the number of threads
+// computing them, with either SPF backend.  The grid has more routers than
+// a tile of the distance matrix, so that its rounds run in parallel too.
+class DsrRoutingThreadsTestCase : public TestCase
+{
+public:
+  DsrRoutingThreadsTestCase ();
+  virtual ~DsrRoutingThreadsTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Compute the routes of a grid
+   * \param threads the value of DsrRouteComputationThreads
+   * \param backend the value of DsrSpfBackend
+   * \returns the routing table of each router, one line per route
+   */
+  std::vector<std::string> RunMesh (uint32_t threads, std::string backend);
+};
+
+DsrRoutingThreadsTestCase::DsrRoutingThreadsTestCase ()
+  : TestCase ("DsrRouting routes are the same with one or several threads")
+{
+}
+
+DsrRoutingThreadsTestCase::~DsrRoutingThreadsTestCase ()
+{
+}
+
+std::vector<std::string>
+DsrRoutingThreadsTestCase::RunMesh (uint32_t threads, std::string backend)
+{
+  DsrScopedGlobalValue computationThreads ("DsrRouteComputationThreads", UintegerValue (threads));
+  DsrScopedGlobalValue spfBackend ("DsrSpfBackend", StringValue (backend));
+  NodeContainer nodes;
+  BuildDsrMesh (9, nodes);
+  DSRRouteManager::DeleteDSRRoutes ();
+  DSRRouteManager::BuildDSRRoutingDatabase ();
+  DSRRouteManager::InitializeRoutes ();
+  std::vector<std::string> routes = DumpDsrRoutes (nodes);
+  Simulator::Destroy ();
+  return routes;
+}
+
+void
+DsrRoutingThreadsTestCase::DoRun (void)
+{
+  const char* backends[] = {"Dijkstra", "FloydWarshall"};
+  for (uint32_t b = 0; b < 2; b++)
+    {
+      std::vector<std::string> one = RunMesh (1, backends[b]);
+      std::vector<std::string> four = RunMesh (4, backends[b]);
+      NS_TEST_ASSERT_MSG_EQ (four.size (), one.size (), "Different number of tables with " << backends[b]);
+      for (uint32_t i = 0; i < one.size () && i < four.size (); i++)
+        {
+          NS_TEST_ASSERT_MSG_NE (one[i].size (), 0, "No routes for node " << i);
+          NS_TEST_ASSERT_MSG_EQ (four[i], one[i], "Routes of node " << i << " differ with 4 threads and " << backends[b]);
+        }
+    }
+}
+
+// Checks that the K shortest paths engine finds K loopless paths between two
+// routers of a grid, shortest first, and that DsrKShortestPaths adds exactly
+// the ranked routes it reports to the tables.
+class DsrRoutingKShortestPathsTestCase : public TestCase
+{
+public:
+  DsrRoutingKShortestPathsTestCase ();
+  virtual ~DsrRoutingKShortestPathsTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+DsrRoutingKShortestPathsTestCase::DsrRoutingKShortestPathsTestCase ()
+  : TestCase ("DsrRouting K shortest paths are loopless and ranked")
+{
+}
+
+DsrRoutingKShortestPathsTestCase::~DsrRoutingKShortestPathsTestCase ()
+{
+}
+
+void
+DsrRoutingKShortestPathsTestCase::DoRun (void)
+{
+  const uint32_t k = 4;
+  NodeContainer nodes;
+  BuildDsrMesh (4, nodes);
+  DSRRouteManagerImpl impl;
+  impl.BuildDSRRoutingDatabase ();
+  Ipv4Address source = nodes.Get (0)->GetObject<DSRRouter> ()->GetRouterId ();
+  for (uint32_t i = 1; i < nodes.GetN (); i++)
+    {
+      std::vector<DSRPath> paths;
+      impl.DebugKShortestPaths (source, nodes.Get (i)->GetObject<DSRRouter> ()->GetRouterId (), k, paths);
+      NS_TEST_ASSERT_MSG_EQ (paths.size (), k, "Not " << k << " paths to node " << i);
+      for (uint32_t p = 0; p < paths.size (); p++)
+        {
+          const std::vector<uint32_t>& vertices = paths[p].m_vertices;
+          NS_TEST_ASSERT_MSG_EQ (paths[p].m_edges.size () + 1, vertices.size (), "Path " << p << " to node " << i << " is not a chain");
+          NS_TEST_ASSERT_MSG_EQ (vertices.front (), paths[0].m_vertices.front (), "Path " << p << " to node " << i << " has another source");
+          NS_TEST_ASSERT_MSG_EQ (vertices.back (), paths[0].m_vertices.back (), "Path " << p << " to node " << i << " has another target");
+          std::set<uint32_t> distinct (vertices.begin (), vertices.end ());
+          NS_TEST_ASSERT_MSG_EQ (distinct.size (), vertices.size (), "Path " << p << " to node " << i << " has a loop");
+          if (p > 0)
+            {
+              NS_TEST_ASSERT_MSG_EQ ((paths[p].m_distance >= paths[p - 1].m_distance), true, "Paths to node " << i << " are not ranked");
+              for (uint32_t q = 0; q < p; q++)
+                {
+                  NS_TEST_ASSERT_MSG_EQ ((vertices != paths[q].m_vertices), true, "Paths " << q << " and " << p << " to node " << i << " are the same");
+                }
+            }
+        }
+    }
+  Simulator::Destroy ();
+
+  uint64_t installed[2];
+  uint64_t ranked[2];
+  for (uint32_t run = 0; run < 2; run++)
+    {
+      DsrScopedGlobalValue kShortestPaths ("DsrKShortestPaths", UintegerValue (run ? k : 1));
+      NodeContainer mesh;
+      BuildDsrMesh (4, mesh);
+      DSRRouteManager::DeleteDSRRoutes ();
+      DSRRouteManager::BuildDSRRoutingDatabase ();
+      DSRRouteManager::InitializeRoutes ();
+      DSRRouteComputationStats stats = DSRRouteManager::GetStats ();
+      installed[run] = stats.m_routesInstalled;
+      ranked[run] = stats.m_kspRoutes;
+      Simulator::Destroy ();
+    }
+  NS_TEST_ASSERT_MSG_EQ (ranked[0], 0, "Ranked routes added with DsrKShortestPaths 1");
+  NS_TEST_ASSERT_MSG_GT (ranked[1], 0, "No ranked routes added with DsrKShortestPaths " << k);
+  NS_TEST_ASSERT_MSG_EQ (installed[1], installed[0] + ranked[1], "The ranked routes are not added to the shortest path routes");
+}
+
+// Checks that UpdateRoutes () after a link goes down leaves every router
+// with the routes a computation from scratch gives.  Without areas only the
+// SPF runs the link can affect are repeated; with an area range, the link
+// addresses that disappear make ApplyGraphChange () fall back to computing
+// every route.
+class DsrRoutingIncrementalTestCase : public TestCase
+{
+public:
+  DsrRoutingIncrementalTestCase ();
+  virtual ~DsrRoutingIncrementalTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Take a link of a grid down and update the routes
+   * \param areas whether the right columns of the grid are an area with a range
+   * \param updated the routing tables after UpdateRoutes ()
+   * \param reference the routing tables computed from scratch
+   * \returns the statistics of the UpdateRoutes () call
+   */
+  DSRRouteComputationStats RunUpdate (bool areas, std::vector<std::string>& updated,
+                                      std::vector<std::string>& reference);
+};
+
+DsrRoutingIncrementalTestCase::DsrRoutingIncrementalTestCase ()
+  : TestCase ("DsrRouting incremental update installs the routes of a full computation")
+{
+}
+
+DsrRoutingIncrementalTestCase::~DsrRoutingIncrementalTestCase ()
+{
+}
+
+DSRRouteComputationStats
+DsrRoutingIncrementalTestCase::RunUpdate (bool areas, std::vector<std::string>& updated,
+                                          std::vector<std::string>& reference)
+{
+  const uint32_t side = 5;
+  DsrScopedGlobalValue incremental ("DsrIncrementalRouting", BooleanValue (true));
+  NodeContainer nodes;
+  std::vector<NetDeviceContainer> links;
+  BuildDsrMesh (side, nodes, &links);
+  if (areas)
+    {
+      for (uint32_t i = 0; i < nodes.GetN (); i++)
+        {
+          if (i % side >= 3)
+            {
+              nodes.Get (i)->GetObject<DSRRouter> ()->SetAttribute ("AreaId", UintegerValue (1));
+            }
+        }
+      DSRRouteManager::AddAreaRange (1, Ipv4Address ("10.0.0.0"), Ipv4Mask ("255.0.0.0"));
+    }
+  DSRRouteManager::DeleteDSRRoutes ();
+  DSRRouteManager::BuildDSRRoutingDatabase ();
+  DSRRouteManager::InitializeRoutes ();
+
+  NetDeviceContainer down = links[links.size () / 2];
+  for (uint32_t j = 0; j < 2; j++)
+    {
+      Ptr<Ipv4> ipv4 = down.Get (j)->GetNode ()->GetObject<Ipv4> ();
+      ipv4->SetDown (ipv4->GetInterfaceForDevice (down.Get (j)));
+    }
+  DSRRouteManager::UpdateRoutes ();
+  DSRRouteComputationStats stats = DSRRouteManager::GetStats ();
+  updated = DumpDsrRoutes (nodes);
+
+  DSRRouteManager::DeleteDSRRoutes ();
+  DSRRouteManager::BuildDSRRoutingDatabase ();
+  DSRRouteManager::InitializeRoutes ();
+  reference = DumpDsrRoutes (nodes);
+  Simulator::Destroy ();
+  return stats;
+}
+
+void
+DsrRoutingIncrementalTestCase::DoRun (void)
+{
+  for (uint32_t areas = 0; areas < 2; areas++)
+    {
+      std::vector<std::string> updated;
+      std::vector<std::string> reference;
+      DSRRouteComputationStats stats = RunUpdate (areas, updated, reference);
+      if (areas)
+        {
+          NS_TEST_ASSERT_MSG_EQ (stats.m_spfReused, 0, "SPF runs kept although the area range needs a full computation");
+        }
+      else
+        {
+          NS_TEST_ASSERT_MSG_GT (stats.m_spfReused, 0, "The update reran every SPF computation");
+        }
+      NS_TEST_ASSERT_MSG_EQ (updated.size (), reference.size (), "Different number of tables");
+      for (uint32_t i = 0; i < reference.size () && i < updated.size (); i++)
+        {
+          NS_TEST_ASSERT_MSG_NE (reference[i].size (), 0, "No routes for node " << i);
+          NS_TEST_ASSERT_MSG_EQ (updated[i], reference[i], "Updated routes of node " << i << " differ from a full computation" <<
+                                 (areas ? " with areas" : ""));
+        }
+    }
+}
+
+// Checks that the interface events raised at the same instant, here by three
+// links of a grid going down, are served by one scheduled route update: if
+// they had been split among several updates, the last one would report
+// fewer than all of them.
+class DsrRoutingCoalescingTestCase : public TestCase
+{
+public:
+  DsrRoutingCoalescingTestCase ();
+  virtual ~DsrRoutingCoalescingTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Take both ends of some links down
+   * \param links the devices of each link
+   */
+  void SetLinksDown (std::vector<NetDeviceContainer> links);
+};
+
+DsrRoutingCoalescingTestCase::DsrRoutingCoalescingTestCase ()
+  : TestCase ("DsrRouting coalesces simultaneous interface events into one update")
+{
+}
+
+DsrRoutingCoalescingTestCase::~DsrRoutingCoalescingTestCase ()
+{
+}
+
+void
+DsrRoutingCoalescingTestCase::SetLinksDown (std::vector<NetDeviceContainer> links)
+{
+  for (uint32_t i = 0; i < links.size (); i++)
+    {
+      for (uint32_t j = 0; j < 2; j++)
+        {
+          Ptr<Ipv4> ipv4 = links[i].Get (j)->GetNode ()->GetObject<Ipv4> ();
+          ipv4->SetDown (ipv4->GetInterfaceForDevice (links[i].Get (j)));
+        }
+    }
+}
+
+void
+DsrRoutingCoalescingTestCase::DoRun (void)
+{
+  DsrScopedDefault respond ("ns3::dsr-routing::Ipv4DSRRouting::RespondToInterfaceEvents", BooleanValue (true));
+  NodeContainer nodes;
+  std::vector<NetDeviceContainer> links;
+  BuildDsrMesh (4, nodes, &links);
+  DSRRouteManager::DeleteDSRRoutes ();
+  Ipv4DSRRoutingHelper::PopulateRoutingTables ();
+  NS_TEST_ASSERT_MSG_EQ (DSRRouteManager::GetStats ().m_coalescedEvents, 0, "Initial computation reports interface events");
+
+  std::vector<NetDeviceContainer> down;
+  for (uint32_t i = 0; i < 3; i++)
+    {
+      down.push_back (links[i * links.size () / 3]);
+    }
+  Simulator::Schedule (Seconds (1), &DsrRoutingCoalescingTestCase::SetLinksDown, this, down);
+  Simulator::Stop (Seconds (10));
+  Simulator::Run ();
+
+  DSRRouteComputationStats stats = DSRRouteManager::GetStats ();
+  NS_TEST_ASSERT_MSG_EQ (stats.m_coalescedEvents, 2 * down.size (), "The interface events were not served by one update");
+  NS_TEST_ASSERT_MSG_NE (stats.m_routesInstalled, 0, "The scheduled update installed no route");
+  Simulator::Destroy ();
+}
+
+// Checks that the routes a router keeps per destination router, which a
+// lookup resolves each address of that router to, forward every address
+// over the first link of a shortest path to its router, as the host routes
+// kept per address did.  The shortest distances come from a separate
+// Floyd-Warshall pass over the link metrics of the grid.
+class DsrRoutingNodeRoutesTestCase : public TestCase
+{
+public:
+  DsrRoutingNodeRoutesTestCase ();
+  virtual ~DsrRoutingNodeRoutesTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+DsrRoutingNodeRoutesTestCase::DsrRoutingNodeRoutesTestCase ()
+  : TestCase ("DsrRouting node routes forward every address on a shortest path")
+{
+}
+
+DsrRoutingNodeRoutesTestCase::~DsrRoutingNodeRoutesTestCase ()
+{
+}
+
+void
+DsrRoutingNodeRoutesTestCase::DoRun (void)
+{
+  NodeContainer nodes;
+  std::vector<NetDeviceContainer> links;
+  BuildDsrMesh (4, nodes, &links);
+  DSRRouteManager::DeleteDSRRoutes ();
+  Ipv4DSRRoutingHelper::PopulateRoutingTables ();
+
+  const uint32_t nNodes = nodes.GetN ();
+  const uint32_t infinity = std::numeric_limits<uint32_t>::max () / 2;
+  std::map<uint32_t, uint32_t> indexOf;
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      indexOf[nodes.Get (i)->GetId ()] = i;
+    }
+  std::vector<std::vector<uint32_t> > distance (nNodes, std::vector<uint32_t> (nNodes, infinity));
+  std::map<uint32_t, uint32_t> owner;
+  std::map<Ptr<NetDevice>, uint32_t> peerOf;
+  for (uint32_t l = 0; l < links.size (); l++)
+    {
+      uint32_t ends[2];
+      uint32_t metric[2];
+      for (uint32_t j = 0; j < 2; j++)
+        {
+          Ptr<NetDevice> device = links[l].Get (j);
+          Ptr<Ipv4> ipv4 = device->GetNode ()->GetObject<Ipv4> ();
+          int32_t interface = ipv4->GetInterfaceForDevice (device);
+          ends[j] = indexOf[device->GetNode ()->GetId ()];
+          metric[j] = ipv4->GetMetric (interface);
+          owner[ipv4->GetAddress (interface, 0).GetLocal ().Get ()] = ends[j];
+        }
+      for (uint32_t j = 0; j < 2; j++)
+        {
+          peerOf[links[l].Get (j)] = ends[1 - j];
+          distance[ends[j]][ends[1 - j]] = std::min (distance[ends[j]][ends[1 - j]], metric[j]);
+        }
+    }
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      distance[i][i] = 0;
+    }
+  for (uint32_t k = 0; k < nNodes; k++)
+    {
+      for (uint32_t i = 0; i < nNodes; i++)
+        {
+          for (uint32_t j = 0; j < nNodes; j++)
+            {
+              distance[i][j] = std::min (distance[i][j], distance[i][k] + distance[k][j]);
+            }
+        }
+    }
+
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      Ptr<Ipv4DSRRouting> routing = nodes.Get (i)->GetObject<DSRRouter> ()->GetRoutingProtocol ();
+      std::vector<Ipv4DSRRoutingTableEntry> nodeRoutes;
+      routing->GetRoutes (Ipv4DSRRouting::NODE_ROUTES, nodeRoutes);
+      NS_TEST_ASSERT_MSG_NE (nodeRoutes.size (), 0, "Node " << i << " has no node route");
+      for (std::map<uint32_t, uint32_t>::const_iterator a = owner.begin (); a != owner.end (); a++)
+        {
+          uint32_t dest = a->second;
+          if (dest == i)
+            {
+              continue;
+            }
+          Ipv4Header header;
+          header.SetDestination (Ipv4Address (a->first));
+          Socket::SocketErrno sockerr;
+          Ptr<Ipv4Route> route = routing->RouteOutput (Create<Packet> (), header, 0, sockerr);
+          NS_TEST_ASSERT_MSG_NE (route, 0, "No route from node " << i << " to " << Ipv4Address (a->first));
+          std::map<uint32_t, uint32_t>::const_iterator gateway = owner.find (route->GetGateway ().Get ());
+          NS_TEST_ASSERT_MSG_EQ ((gateway != owner.end ()), true, "Unknown next hop " << route->GetGateway ());
+          uint32_t hop = gateway->second;
+          NS_TEST_ASSERT_MSG_EQ (peerOf[route->GetOutputDevice ()], hop,
+                                 "Next hop " << route->GetGateway () << " is not on the output link of node " << i);
+          NS_TEST_ASSERT_MSG_EQ (distance[i][hop] + distance[hop][dest], distance[i][dest],
+                                 "Node " << i << " forwards " << Ipv4Address (a->first) << " off a shortest path");
+        }
+    }
+  Simulator::Destroy ();
+}
+
+// Checks the changes ApplyRoutes () reports when it replaces a table: a route
+// kept as is or with a new distance stays the same entry, in its new place,
+// and only the routes that are gone or new are removed or inserted.
+class DsrRoutingApplyRoutesTestCase : public TestCase
+{
+public:
+  DsrRoutingApplyRoutesTestCase ();
+  virtual ~DsrRoutingApplyRoutesTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+DsrRoutingApplyRoutesTestCase::DsrRoutingApplyRoutesTestCase ()
+  : TestCase ("DsrRouting ApplyRoutes changes only the routes that differ")
+{
+}
+
+DsrRoutingApplyRoutesTestCase::~DsrRoutingApplyRoutesTestCase ()
+{
+}
+
+void
+DsrRoutingApplyRoutesTestCase::DoRun (void)
+{
+  Ptr<Ipv4DSRRouting> routing = CreateObject<Ipv4DSRRouting> ();
+  Ipv4Address gateway ("10.1.0.1");
+  std::vector<Ipv4DSRRoutingTableEntry> routes;
+  routes.push_back (Ipv4DSRRoutingTableEntry::CreateHostRouteTo (Ipv4Address ("10.0.0.1"), gateway, 1, 5));
+  routes.push_back (Ipv4DSRRoutingTableEntry::CreateHostRouteTo (Ipv4Address ("10.0.0.2"), gateway, 1, 3));
+  routes.push_back (Ipv4DSRRoutingTableEntry::CreateHostRouteTo (Ipv4Address ("10.0.0.3"), gateway, 2, 4));
+  Ipv4DSRRouting::RouteChurn churn = routing->ApplyRoutes (Ipv4DSRRouting::HOST_ROUTES, routes);
+  NS_TEST_ASSERT_MSG_EQ (churn.m_added, 3, "Routes of an empty table not all added");
+  NS_TEST_ASSERT_MSG_EQ (churn.m_removed + churn.m_updated, 0, "Routes of an empty table removed or updated");
+  Ipv4DSRRoutingTableEntry* first = routing->GetRoute (0);
+  Ipv4DSRRoutingTableEntry* second = routing->GetRoute (1);
+
+//
+// Keep the second route, move the first one after it with a new distance,
+// drop the third one and add a route to a new destination.
+//
+  std::vector<Ipv4DSRRoutingTableEntry> changed;
+  changed.push_back (routes[1]);
+  changed.push_back (Ipv4DSRRoutingTableEntry::CreateHostRouteTo (Ipv4Address ("10.0.0.1"), gateway, 1, 7));
+  changed.push_back (Ipv4DSRRoutingTableEntry::CreateHostRouteTo (Ipv4Address ("10.0.0.4"), gateway, 2, 6));
+  churn = routing->ApplyRoutes (Ipv4DSRRouting::HOST_ROUTES, changed);
+  NS_TEST_ASSERT_MSG_EQ (churn.m_added, 1, "Wrong number of routes added");
+  NS_TEST_ASSERT_MSG_EQ (churn.m_removed, 1, "Wrong number of routes removed");
+  NS_TEST_ASSERT_MSG_EQ (churn.m_updated, 1, "Wrong number of routes updated");
+  NS_TEST_ASSERT_MSG_EQ (routing->GetNRoutes (), changed.size (), "Wrong number of routes");
+  NS_TEST_ASSERT_MSG_EQ (routing->GetRoute (0), second, "The unchanged route is a new entry");
+  NS_TEST_ASSERT_MSG_EQ (routing->GetRoute (1), first, "The updated route is a new entry");
+  for (uint32_t j = 0; j < changed.size (); j++)
+    {
+      Ipv4DSRRoutingTableEntry* route = routing->GetRoute (j);
+      NS_TEST_ASSERT_MSG_EQ (*route == changed[j], true, "Route " << j << " is not the one applied");
+      NS_TEST_ASSERT_MSG_EQ (route->GetDistance (), changed[j].GetDistance (), "Wrong distance of route " << j);
+    }
+
+  Ipv4DSRRoutingTableEntry* third = routing->GetRoute (2);
+  churn = routing->ApplyRoutes (Ipv4DSRRouting::HOST_ROUTES, changed);
+  NS_TEST_ASSERT_MSG_EQ (churn.m_added + churn.m_removed + churn.m_updated, 0, "Applying the same routes changed the table");
+  NS_TEST_ASSERT_MSG_EQ (routing->GetRoute (0), second, "Entry 0 replaced by the same routes");
+  NS_TEST_ASSERT_MSG_EQ (routing->GetRoute (1), first, "Entry 1 replaced by the same routes");
+  NS_TEST_ASSERT_MSG_EQ (routing->GetRoute (2), third, "Entry 2 replaced by the same routes");
+}
+
+// Checks that the routing tables saved to an image and loaded back are the
+// tables that were computed, table by table and in order, and that an image
+// is rejected once a link metric changes the topology hash.
+class DsrRoutingImageTestCase : public TestCase
+{
+public:
+  DsrRoutingImageTestCase ();
+  virtual ~DsrRoutingImageTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Get every routing table of some routers
+   * \param nodes the routers
+   * \returns the routes of each table of each router, one line per route
+   */
+  std::vector<std::string> GetTables (const NodeContainer& nodes) const;
+};
+
+DsrRoutingImageTestCase::DsrRoutingImageTestCase ()
+  : TestCase ("DsrRouting routing table image round trip")
+{
+}
+
+DsrRoutingImageTestCase::~DsrRoutingImageTestCase ()
+{
+}
+
+std::vector<std::string>
+DsrRoutingImageTestCase::GetTables (const NodeContainer& nodes) const
+{
+  std::vector<std::string> tables;
+  std::vector<Ipv4DSRRoutingTableEntry> routes;
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      Ptr<Ipv4DSRRouting> routing = nodes.Get (i)->GetObject<DSRRouter> ()->GetRoutingProtocol ();
+      for (uint32_t t = 0; t < Ipv4DSRRouting::N_ROUTE_TABLES; t++)
+        {
+          routes.clear ();
+          routing->GetRoutes (Ipv4DSRRouting::RouteTable (t), routes);
+          std::ostringstream os;
+          for (uint32_t j = 0; j < routes.size (); j++)
+            {
+              os << routes[j] << ", distance=" << routes[j].GetDistance () << "\n";
+            }
+          tables.push_back (os.str ());
+        }
+    }
+  return tables;
+}
+
+void
+DsrRoutingImageTestCase::DoRun (void)
+{
+  std::string path = CreateTempDirFilename ("dsr-routing-tables.img");
+  NodeContainer nodes;
+  std::vector<NetDeviceContainer> links;
+  BuildDsrMesh (4, nodes, &links);
+  DSRRouteManager::DeleteDSRRoutes ();
+  Ipv4DSRRoutingHelper::PopulateRoutingTables ();
+  std::vector<std::string> computed = GetTables (nodes);
+  NS_TEST_ASSERT_MSG_EQ (Ipv4DSRRoutingHelper::SaveRoutingTables (path), true, "Cannot save the routing tables");
+
+  DSRRouteManager::DeleteDSRRoutes ();
+  NS_TEST_ASSERT_MSG_EQ (Ipv4DSRRoutingHelper::LoadRoutingTables (path), true, "Cannot load the routing tables");
+  std::vector<std::string> loaded = GetTables (nodes);
+  NS_TEST_ASSERT_MSG_EQ (loaded.size (), computed.size (), "Different number of tables");
+  for (uint32_t i = 0; i < computed.size () && i < loaded.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (loaded[i], computed[i], "Loaded table " << i % Ipv4DSRRouting::N_ROUTE_TABLES <<
+                             " of node " << i / Ipv4DSRRouting::N_ROUTE_TABLES << " differs");
+    }
+
+  Ptr<Ipv4> ipv4 = links[0].Get (0)->GetNode ()->GetObject<Ipv4> ();
+  ipv4->SetMetric (ipv4->GetInterfaceForDevice (links[0].Get (0)), 7);
+  NS_TEST_ASSERT_MSG_EQ (Ipv4DSRRoutingHelper::LoadRoutingTables (path), false,
+                         "Image of another topology loaded");
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (nodes.Get (i)->GetObject<DSRRouter> ()->GetRoutingProtocol ()->GetNRoutes (), 0,
+                             "Routes of node " << i << " installed from a rejected image");
+    }
+  Simulator::Destroy ();
+}
+
+// Checks which table a packet without a BudgetTag is routed with.  Node 0 of
+// a triangle reaches node 2 over an expensive direct link or over two cheap
+// links through node 1: the delay-guaranteed routes take the cheap detour,
+// and only with DsrBestEffortRoutes set does the lookup take the one hop
+// route of the best-effort table.
+class DsrRoutingBestEffortTestCase : public TestCase
+{
+public:
+  DsrRoutingBestEffortTestCase ();
+  virtual ~DsrRoutingBestEffortTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+DsrRoutingBestEffortTestCase::DsrRoutingBestEffortTestCase ()
+  : TestCase ("DsrRouting best-effort table is only used when enabled")
+{
+}
+
+DsrRoutingBestEffortTestCase::~DsrRoutingBestEffortTestCase ()
+{
+}
+
+void
+DsrRoutingBestEffortTestCase::DoRun (void)
+{
+  for (uint32_t bestEffort = 0; bestEffort < 2; bestEffort++)
+    {
+      DsrScopedGlobalValue bestEffortRoutes ("DsrBestEffortRoutes", BooleanValue (bestEffort));
+      NodeContainer nodes;
+      NetDeviceContainer direct;
+      NetDeviceContainer detour;
+      Ipv4Address far = BuildDsrTriangle (10, nodes, direct, detour);
+
+      DSRRouteManager::DeleteDSRRoutes ();
+      DSRRouteManager::BuildDSRRoutingDatabase ();
+      DSRRouteManager::InitializeRoutes ();
+      DSRRouteComputationStats stats = DSRRouteManager::GetStats ();
+      NS_TEST_ASSERT_MSG_EQ (stats.m_bestEffortRuns != 0, bestEffort != 0, "Best-effort table built " <<
+                             (bestEffort ? "without" : "with") << " DsrBestEffortRoutes");
+
+      Ptr<Ipv4DSRRouting> routing = nodes.Get (0)->GetObject<DSRRouter> ()->GetRoutingProtocol ();
+      Ipv4Header header;
+      header.SetDestination (far);
+      Socket::SocketErrno sockerr;
+      Ptr<Ipv4Route> route = routing->RouteOutput (Create<Packet> (), header, 0, sockerr);
+      NS_TEST_ASSERT_MSG_NE (route, 0, "No route from node 0 to node 2");
+      if (bestEffort)
+        {
+          NS_TEST_ASSERT_MSG_EQ (route->GetOutputDevice (), direct.Get (0), "Node 0 does not take the fewest hops");
+        }
+      else
+        {
+          NS_TEST_ASSERT_MSG_EQ (route->GetOutputDevice (), detour.Get (0), "Node 0 does not take the shortest distance");
+        }
+      Simulator::Destroy ();
+    }
+}
+
+// Checks DSRRouter::GetLinkMetric () on a point-to-point link: the interface
+// metric by default, the channel delay plus the serialization of an MTU with
+// ChannelDelay, the queueing delay added to either, and the clamp to 2^24 - 1.
+class DsrRoutingLinkMetricTestCase : public TestCase
+{
+public:
+  DsrRoutingLinkMetricTestCase ();
+  virtual ~DsrRoutingLinkMetricTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+DsrRoutingLinkMetricTestCase::DsrRoutingLinkMetricTestCase ()
+  : TestCase ("DsrRouting link metrics follow DsrLinkMetric")
+{
+}
+
+DsrRoutingLinkMetricTestCase::~DsrRoutingLinkMetricTestCase ()
+{
+}
+
+void
+DsrRoutingLinkMetricTestCase::DoRun (void)
+{
+  NodeContainer nodes;
+  nodes.Create (2);
+  InstallDsrStack (nodes);
+
+  // 2 ms of delay, and 12 ms to serialize 1500 bytes at 1 Mb/s
+  PointToPointHelper p2p;
+  p2p.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  p2p.SetDeviceAttribute ("DataRate", DataRateValue (DataRate ("1Mbps")));
+  NetDeviceContainer devices = p2p.Install (nodes.Get (0), nodes.Get (1));
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.255.255.252");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+  Ptr<Ipv4> ipv4 = interfaces.Get (0).first;
+  uint32_t interface = interfaces.Get (0).second;
+  ipv4->SetMetric (interface, 7);
+  Ptr<DSRRouter> router = nodes.Get (0)->GetObject<DSRRouter> ();
+
+  DsrScopedGlobalValue linkMetric ("DsrLinkMetric", StringValue ("InterfaceMetric"));
+  NS_TEST_ASSERT_MSG_EQ (router->GetLinkMetric (devices.Get (0), ipv4, interface), 7,
+                         "InterfaceMetric does not use the interface metric");
+  GlobalValue::Bind ("DsrLinkMetric", StringValue ("ChannelDelay"));
+  NS_TEST_ASSERT_MSG_EQ (router->GetLinkMetric (devices.Get (0), ipv4, interface), 14000,
+                         "ChannelDelay is not the delay plus the serialization of an MTU");
+
+  router->SetQueueingDelay (interface, 500);
+  NS_TEST_ASSERT_MSG_EQ (router->GetLinkMetric (devices.Get (0), ipv4, interface), 14500,
+                         "Queueing delay not added to the channel delay");
+  GlobalValue::Bind ("DsrLinkMetric", StringValue ("InterfaceMetric"));
+  NS_TEST_ASSERT_MSG_EQ (router->GetLinkMetric (devices.Get (0), ipv4, interface), 507,
+                         "Queueing delay not added to the interface metric");
+  router->SetQueueingDelay (interface, 0);
+
+  GlobalValue::Bind ("DsrLinkMetric", StringValue ("ChannelDelay"));
+  devices.Get (0)->GetChannel ()->SetAttribute ("Delay", TimeValue (Seconds (100)));
+  NS_TEST_ASSERT_MSG_EQ (router->GetLinkMetric (devices.Get (0), ipv4, interface), 0x00ffffff,
+                         "ChannelDelay metric not clamped to 2^24 - 1");
+
+  Simulator::Destroy ();
+}
+
+// Checks that with FastReroute set, a router stops using the link to a
+// neighbour as soon as its interface goes down, and sends the traffic over
+// the loop-free alternate through the third router of a triangle, before any
+// route is recomputed.  The second run first saves the routing tables and
+// loads them back.
+class DsrRoutingFastRerouteTestCase : public TestCase
+{
+public:
+  DsrRoutingFastRerouteTestCase ();
+  virtual ~DsrRoutingFastRerouteTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+DsrRoutingFastRerouteTestCase::DsrRoutingFastRerouteTestCase ()
+  : TestCase ("DsrRouting fast reroute bypasses a down interface")
+{
+}
+
+DsrRoutingFastRerouteTestCase::~DsrRoutingFastRerouteTestCase ()
+{
+}
+
+void
+DsrRoutingFastRerouteTestCase::DoRun (void)
+{
+  DsrScopedDefault fastReroute ("ns3::dsr-routing::Ipv4DSRRouting::FastReroute", BooleanValue (true));
+  for (uint32_t load = 0; load < 2; load++)
+    {
+      NodeContainer nodes;
+      NetDeviceContainer direct;
+      NetDeviceContainer detour;
+      Ipv4Address far = BuildDsrTriangle (1, nodes, direct, detour);
+
+      DSRRouteManager::DeleteDSRRoutes ();
+      DSRRouteManager::BuildDSRRoutingDatabase ();
+      DSRRouteManager::InitializeRoutes ();
+
+      Ptr<Ipv4> ipv4 = nodes.Get (0)->GetObject<Ipv4> ();
+      Ptr<Ipv4DSRRouting> routing = nodes.Get (0)->GetObject<DSRRouter> ()->GetRoutingProtocol ();
+      if (load)
+        {
+//
+// The loop-free alternates are told apart by the round trips of the routes,
+// which the routing table image must keep.
+//
+          std::vector<Ipv4DSRRoutingTableEntry> routes;
+          routing->GetRoutes (Ipv4DSRRouting::NODE_ROUTES, routes);
+          uint32_t known = 0;
+          for (uint32_t j = 0; j < routes.size (); j++)
+            {
+              known += routes[j].GetRoundTrip () != 0;
+            }
+          NS_TEST_ASSERT_MSG_NE (known, 0, "No node route of node 0 knows its round trip");
+          std::vector<std::string> computed = DumpDsrRoundTrips (routing);
+          std::string path = CreateTempDirFilename ("dsr-fast-reroute.img");
+          NS_TEST_ASSERT_MSG_EQ (Ipv4DSRRoutingHelper::SaveRoutingTables (path), true, "Cannot save the routing tables");
+          NS_TEST_ASSERT_MSG_EQ (Ipv4DSRRoutingHelper::LoadRoutingTables (path), true, "Cannot load the routing tables");
+          std::vector<std::string> loaded = DumpDsrRoundTrips (routing);
+          NS_TEST_ASSERT_MSG_EQ (loaded.size (), computed.size (), "Different number of routes loaded");
+          for (uint32_t j = 0; j < computed.size () && j < loaded.size (); j++)
+            {
+              NS_TEST_ASSERT_MSG_EQ (loaded[j], computed[j], "Route " << j << " of node 0 loaded with another round trip");
+            }
+        }
+
+      Ipv4Header header;
+      header.SetDestination (far);
+      Socket::SocketErrno sockerr;
+      Ptr<Ipv4Route> route = routing->RouteOutput (Create<Packet> (), header, 0, sockerr);
+      NS_TEST_ASSERT_MSG_NE (route, 0, "No route from node 0 to node 2");
+      NS_TEST_ASSERT_MSG_EQ (route->GetOutputDevice (), direct.Get (0), "Node 0 does not use the direct link");
+
+      ipv4->SetDown (ipv4->GetInterfaceForDevice (direct.Get (0)));
+      route = routing->RouteOutput (Create<Packet> (), header, 0, sockerr);
+      NS_TEST_ASSERT_MSG_NE (route, 0, "No alternate route from node 0 to node 2" << (load ? " after loading" : ""));
+      NS_TEST_ASSERT_MSG_EQ (route->GetOutputDevice (), detour.Get (0), "Node 0 does not reroute through node 1" <<
+                             (load ? " after loading" : ""));
+
+      Simulator::Destroy ();
+    }
+}
+
+// Checks that with DsrLazyRouting set, the routes a lookup computes on demand
+// send every point-to-point address of a grid through the same next hop and
+// interface as the routes computed up front, and that each router is only
+// computed once.  A router of the grid also has a stub network, which lazy
+// routes do not cover: looking it up must compute every route, and find the
+// same routes to it as up front.
+class DsrRoutingLazyTestCase : public TestCase
+{
+public:
+  DsrRoutingLazyTestCase ();
+  virtual ~DsrRoutingLazyTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Look up every point-to-point address of a grid from every router, then
+   * an address of a stub network
+   * \param lazy whether the routes are computed on demand
+   * \param lookups the next hop and output device of each lookup
+   * \param stubStats set to the statistics of the route computation after
+   * the lookups of the stub network
+   * \returns the statistics of the route computation after the lookups of
+   * the point-to-point addresses
+   */
+  DSRRouteComputationStats RunLookups (bool lazy, std::vector<std::string>& lookups,
+                                       DSRRouteComputationStats& stubStats);
+  /**
+   * Look up an address and describe the route found
+   * \param routing the routing protocol of the router
+   * \param i the index of the router
+   * \param dest the destination
+   * \returns the next hop and output device of the route
+   */
+  std::string Lookup (Ptr<Ipv4DSRRouting> routing, uint32_t i, Ipv4Address dest) const;
+};
+
+DsrRoutingLazyTestCase::DsrRoutingLazyTestCase ()
+  : TestCase ("DsrRouting lazy routes match the routes computed up front")
+{
+}
+
+DsrRoutingLazyTestCase::~DsrRoutingLazyTestCase ()
+{
+}
+
+std::string
+DsrRoutingLazyTestCase::Lookup (Ptr<Ipv4DSRRouting> routing, uint32_t i, Ipv4Address dest) const
+{
+  Ipv4Header header;
+  header.SetDestination (dest);
+  Socket::SocketErrno sockerr;
+  Ptr<Ipv4Route> route = routing->RouteOutput (Create<Packet> (), header, 0, sockerr);
+  std::ostringstream os;
+  os << "node " << i << " to " << dest << ": ";
+  if (route == 0)
+    {
+      os << "no route";
+    }
+  else
+    {
+      os << route->GetGateway () << " on device " << route->GetOutputDevice ()->GetIfIndex ();
+    }
+  return os.str ();
+}
+
+DSRRouteComputationStats
+DsrRoutingLazyTestCase::RunLookups (bool lazy, std::vector<std::string>& lookups,
+                                    DSRRouteComputationStats& stubStats)
+{
+  DsrScopedGlobalValue lazyRouting ("DsrLazyRouting", BooleanValue (lazy));
+  NodeContainer nodes;
+  std::vector<NetDeviceContainer> links;
+  BuildDsrMesh (4, nodes, &links);
+  // a broadcast link with no other router on it is a stub network
+  Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice> ();
+  device->SetAddress (Mac48Address::Allocate ());
+  device->SetChannel (CreateObject<SimpleChannel> ());
+  nodes.Get (5)->AddDevice (device);
+  Ipv4AddressHelper address;
+  address.SetBase ("10.9.0.0", "255.255.255.0");
+  address.Assign (NetDeviceContainer (device));
+  DSRRouteManager::DeleteDSRRoutes ();
+  Ipv4DSRRoutingHelper::PopulateRoutingTables ();
+
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      Ptr<Ipv4DSRRouting> routing = nodes.Get (i)->GetObject<DSRRouter> ()->GetRoutingProtocol ();
+      for (uint32_t l = 0; l < links.size (); l++)
+        {
+          for (uint32_t j = 0; j < 2; j++)
+            {
+              Ptr<Node> node = links[l].Get (j)->GetNode ();
+              if (node == nodes.Get (i))
+                {
+                  continue;
+                }
+              Ptr<Ipv4> ipv4 = node->GetObject<Ipv4> ();
+              Ipv4Address dest = ipv4->GetAddress (ipv4->GetInterfaceForDevice (links[l].Get (j)), 0).GetLocal ();
+              lookups.push_back (Lookup (routing, i, dest));
+            }
+        }
+    }
+  DSRRouteComputationStats stats = DSRRouteManager::GetStats ();
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      if (i != 5)
+        {
+          lookups.push_back (Lookup (nodes.Get (i)->GetObject<DSRRouter> ()->GetRoutingProtocol (), i,
+                                     Ipv4Address ("10.9.0.2")));
+        }
+    }
+  stubStats = DSRRouteManager::GetStats ();
+  Simulator::Destroy ();
+  return stats;
+}
+
+void
+DsrRoutingLazyTestCase::DoRun (void)
+{
+  std::vector<std::string> eager;
+  std::vector<std::string> lazy;
+  DSRRouteComputationStats stubStats;
+  DSRRouteComputationStats stats = RunLookups (false, eager, stubStats);
+  NS_TEST_ASSERT_MSG_EQ (stats.m_lazyRuns, 0, "Routes computed on demand without DsrLazyRouting");
+  stats = RunLookups (true, lazy, stubStats);
+  NS_TEST_ASSERT_MSG_EQ (stats.m_lazyRuns, 16, "Each router of the grid is not computed exactly once");
+  NS_TEST_ASSERT_MSG_GT (stubStats.m_spfRuns, stats.m_spfRuns, "The stub network did not have every route computed");
+  NS_TEST_ASSERT_MSG_EQ (eager.back ().find ("no route"), std::string::npos, "No route to the stub network");
+  NS_TEST_ASSERT_MSG_EQ (lazy.size (), eager.size (), "Different number of lookups");
+  for (uint32_t i = 0; i < eager.size () && i < lazy.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (lazy[i], eager[i], "Lazy lookup differs");
+    }
+}
+
+// Checks that the LSAs ExchangeLSAs () sends between MPI ranks come out of
+// UnpackLSAs () as they went into PackLSAs (), with their link records,
+// attached routers and nodes, and only for the nodes that had some, as a
+// rank only holds those of its own nodes.  The round trip needs no MPI.
+class DsrRoutingLSAExchangeTestCase : public TestCase
+{
+public:
+  DsrRoutingLSAExchangeTestCase ();
+  virtual ~DsrRoutingLSAExchangeTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Describe the LSAs of each node and release them
+   * \param byNode the LSAs of each node, each holding one reference
+   * \returns the LSAs and node of each node, one string per node
+   */
+  std::vector<std::string> Release (std::vector<std::vector<DSRRoutingLSA*> >& byNode) const;
+};
+
+DsrRoutingLSAExchangeTestCase::DsrRoutingLSAExchangeTestCase ()
+  : TestCase ("DsrRouting LSAs exchanged between ranks round trip")
+{
+}
+
+DsrRoutingLSAExchangeTestCase::~DsrRoutingLSAExchangeTestCase ()
+{
+}
+
+std::vector<std::string>
+DsrRoutingLSAExchangeTestCase::Release (std::vector<std::vector<DSRRoutingLSA*> >& byNode) const
+{
+  std::vector<std::string> dump;
+  for (uint32_t n = 0; n < byNode.size (); n++)
+    {
+      std::ostringstream os;
+      for (uint32_t j = 0; j < byNode[n].size (); j++)
+        {
+          Ptr<Node> node = byNode[n][j]->GetNode ();
+          os << *byNode[n][j] << "node=" << (node ? int32_t (node->GetId ()) : -1) << "\n";
+          byNode[n][j]->Unref ();
+        }
+      byNode[n].clear ();
+      dump.push_back (os.str ());
+    }
+  return dump;
+}
+
+void
+DsrRoutingLSAExchangeTestCase::DoRun (void)
+{
+  NodeContainer nodes;
+  BuildDsrMesh (3, nodes);
+  std::vector<std::vector<DSRRoutingLSA*> > byNode (NodeList::GetNNodes ());
+  for (uint32_t i = 0; i < nodes.GetN (); i += 2)
+    {
+      Ptr<DSRRouter> router = nodes.Get (i)->GetObject<DSRRouter> ();
+      router->DiscoverLSAs ();
+      for (uint32_t j = 0; j < router->GetNumLSAs (); j++)
+        {
+          Ptr<DSRRoutingLSA> lsa = router->GetLSA (j);
+          lsa->Ref ();
+          byNode[nodes.Get (i)->GetId ()].push_back (PeekPointer (lsa));
+        }
+    }
+  DSRRoutingLSA* network = new DSRRoutingLSA ();
+  network->SetLSType (DSRRoutingLSA::NetworkLSA);
+  network->SetLinkStateId (Ipv4Address ("10.1.0.1"));
+  network->SetAdvertisingRouter (Ipv4Address ("10.1.0.1"));
+  network->SetNetworkLSANetworkMask (Ipv4Mask ("255.255.255.0"));
+  network->AddAttachedRouter (Ipv4Address ("10.1.0.1"));
+  network->AddAttachedRouter (Ipv4Address ("10.1.0.2"));
+  network->SetNode (nodes.Get (0));
+  byNode[nodes.Get (0)->GetId ()].push_back (network);
+
+//
+// The words of the other ranks come before and after those of this one in
+// the buffer MPI gathers.
+//
+  std::vector<uint32_t> buffer (3, 0xffffffff);
+  uint32_t packed = DSRRouteManagerImpl::PackLSAs (byNode, buffer);
+  uint32_t end = buffer.size ();
+  buffer.push_back (0xffffffff);
+  std::vector<std::vector<DSRRoutingLSA*> > received (byNode.size ());
+  uint32_t unpacked = DSRRouteManagerImpl::UnpackLSAs (buffer, 3, end, received);
+
+  std::vector<std::string> sent = Release (byNode);
+  std::vector<std::string> got = Release (received);
+  Simulator::Destroy ();
+  NS_TEST_ASSERT_MSG_GT (packed, nodes.GetN () / 2, "Too few LSAs packed");
+  NS_TEST_ASSERT_MSG_EQ (unpacked, packed, "Not every LSA packed was unpacked");
+  for (uint32_t n = 0; n < sent.size (); n++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (got[n], sent[n], "LSAs of node " << n << " changed on the way");
+    }
+}
+
+// Checks the in-band link-state protocol on a line of three routers: once
+// the hellos and LSAs are through, the first router reaches the last one
+// through the middle one, and once the second link fails the first router
+// and the middle one both drop their routes to the last one.
+class DsrRoutingLinkStateTestCase : public TestCase
+{
+public:
+  DsrRoutingLinkStateTestCase ();
+  virtual ~DsrRoutingLinkStateTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Look up a destination from the routers of the line
+   * \param nodes the routers
+   * \param dest the destination
+   * \param routes set to the route of each router but the last, 0 if none
+   */
+  void Lookup (NodeContainer nodes, Ipv4Address dest, std::vector<Ptr<Ipv4Route> >* routes);
+};
+
+DsrRoutingLinkStateTestCase::DsrRoutingLinkStateTestCase ()
+  : TestCase ("DsrRouting in-band link-state protocol follows a link failure")
+{
+}
+
+DsrRoutingLinkStateTestCase::~DsrRoutingLinkStateTestCase ()
+{
+}
+
+void
+DsrRoutingLinkStateTestCase::Lookup (NodeContainer nodes, Ipv4Address dest, std::vector<Ptr<Ipv4Route> >* routes)
+{
+  Ipv4Header header;
+  header.SetDestination (dest);
+  for (uint32_t i = 0; i + 1 < nodes.GetN (); i++)
+    {
+      Ptr<Ipv4DSRRouting> routing = nodes.Get (i)->GetObject<DSRRouter> ()->GetRoutingProtocol ();
+      Socket::SocketErrno sockerr;
+      routes->push_back (routing->RouteOutput (Create<Packet> (), header, 0, sockerr));
+    }
+}
+
+void
+DsrRoutingLinkStateTestCase::DoRun (void)
+{
+  DsrScopedDefault inBand ("ns3::dsr-routing::Ipv4DSRRouting::InBandProtocol", BooleanValue (true));
+  NodeContainer nodes;
+  nodes.Create (3);
+  InstallDsrStack (nodes);
+
+  PointToPointHelper p2p;
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.255.255.252");
+  Ipv4InterfaceContainer first = address.Assign (p2p.Install (nodes.Get (0), nodes.Get (1)));
+  address.NewNetwork ();
+  NetDeviceContainer second = p2p.Install (nodes.Get (1), nodes.Get (2));
+  Ipv4InterfaceContainer last = address.Assign (second);
+
+  std::vector<Ptr<Ipv4Route> > before;
+  std::vector<Ptr<Ipv4Route> > after;
+  Simulator::Schedule (Seconds (10), &DsrRoutingLinkStateTestCase::Lookup, this, nodes, last.GetAddress (1), &before);
+  for (uint32_t j = 0; j < 2; j++)
+    {
+      Ptr<Ipv4> ipv4 = second.Get (j)->GetNode ()->GetObject<Ipv4> ();
+      Simulator::Schedule (Seconds (11), &Ipv4::SetDown, ipv4, ipv4->GetInterfaceForDevice (second.Get (j)));
+    }
+  Simulator::Schedule (Seconds (30), &DsrRoutingLinkStateTestCase::Lookup, this, nodes, last.GetAddress (1), &after);
+  Simulator::Stop (Seconds (31));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  NS_TEST_ASSERT_MSG_EQ (before.size (), 2, "Lookups not run before the failure");
+  NS_TEST_ASSERT_MSG_NE (before[0], 0, "No route from the first router to the last one");
+  NS_TEST_ASSERT_MSG_EQ (before[0]->GetGateway (), first.GetAddress (1), "The first router does not go through the middle one");
+  NS_TEST_ASSERT_MSG_NE (before[1], 0, "No route from the middle router to the last one");
+  NS_TEST_ASSERT_MSG_EQ (before[1]->GetGateway (), last.GetAddress (1), "The middle router does not go straight to the last one");
+  NS_TEST_ASSERT_MSG_EQ (after.size (), 2, "Lookups not run after the failure");
+  NS_TEST_ASSERT_MSG_EQ (after[0], 0, "The first router still routes to the last one after the failure");
+  NS_TEST_ASSERT_MSG_EQ (after[1], 0, "The middle router still routes to the last one after the failure");
+}
+
+// Checks the TelemetryTag and the estimates built from it: the tag survives
+// a packet tag round trip, keeps within its byte cap by folding the oldest
+// hops into its running sum without losing any delay, and with Telemetry
+// set RouteInput smooths the delays of the packets from a source with an
+// EWMA kept per incoming interface and source.
+class DsrRoutingTelemetryTestCase : public TestCase
+{
+public:
+  DsrRoutingTelemetryTestCase ();
+  virtual ~DsrRoutingTelemetryTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Hand a packet to RouteInput
+   * \param routing the routing protocol of the receiving router
+   * \param device the receiving device
+   * \param header the IP header of the packet
+   * \param delay the queueing delay the packet reports, none if 0
+   */
+  void Receive (Ptr<Ipv4DSRRouting> routing, Ptr<NetDevice> device, const Ipv4Header& header, uint32_t delay);
+};
+
+DsrRoutingTelemetryTestCase::DsrRoutingTelemetryTestCase ()
+  : TestCase ("DsrRouting telemetry tag and queueing delay estimates")
+{
+}
+
+DsrRoutingTelemetryTestCase::~DsrRoutingTelemetryTestCase ()
+{
+}
+
+void
+DsrRoutingTelemetryTestCase::Receive (Ptr<Ipv4DSRRouting> routing, Ptr<NetDevice> device,
+                                      const Ipv4Header& header, uint32_t delay)
+{
+  Ptr<Packet> packet = Create<Packet> (100);
+  if (delay)
+    {
+      TelemetryTag tag;
+      tag.AddHop (delay, 4);
+      packet->AddPacketTag (tag);
+    }
+  routing->RouteInput (packet, header, device, Ipv4RoutingProtocol::UnicastForwardCallback (),
+                       Ipv4RoutingProtocol::MulticastForwardCallback (),
+                       Ipv4RoutingProtocol::LocalDeliverCallback (),
+                       Ipv4RoutingProtocol::ErrorCallback ());
+}
+
+void
+DsrRoutingTelemetryTestCase::DoRun (void)
+{
+  const uint32_t maxRecords = 3;
+  TelemetryTag tag;
+  uint32_t total = 0;
+  for (uint32_t hop = 1; hop <= 5; hop++)
+    {
+      tag.AddHop (hop * 100, maxRecords);
+      total += hop * 100;
+    }
+  NS_TEST_ASSERT_MSG_EQ (tag.GetNRecords (), maxRecords, "Hops listed beyond the cap");
+  NS_TEST_ASSERT_MSG_EQ (tag.GetSerializedSize (), TelemetryTag::FIXED_SIZE + maxRecords * TelemetryTag::RECORD_SIZE,
+                         "Tag larger than its cap");
+  NS_TEST_ASSERT_MSG_EQ (tag.GetRecord (0), 300, "The oldest hops were not the ones folded");
+  NS_TEST_ASSERT_MSG_EQ (tag.GetTotalDelay (), total, "Folding the oldest hops lost some delay");
+
+  Ptr<Packet> packet = Create<Packet> (100);
+  packet->AddPacketTag (tag);
+  TelemetryTag copy;
+  NS_TEST_ASSERT_MSG_EQ (packet->PeekPacketTag (copy), true, "Tag lost by the packet");
+  NS_TEST_ASSERT_MSG_EQ (copy.GetNRecords (), tag.GetNRecords (), "Different number of hops after the round trip");
+  for (uint32_t r = 0; r < tag.GetNRecords () && r < copy.GetNRecords (); r++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (copy.GetRecord (r), tag.GetRecord (r), "Hop " << r << " changed by the round trip");
+    }
+  NS_TEST_ASSERT_MSG_EQ (copy.GetTotalDelay (), total, "Folded delay changed by the round trip");
+
+  TelemetryTag saturated;
+  saturated.AddHop (std::numeric_limits<uint32_t>::max (), 1);
+  saturated.AddHop (10, 1);
+  NS_TEST_ASSERT_MSG_EQ (saturated.GetTotalDelay (), std::numeric_limits<uint32_t>::max (), "Total delay wrapped around");
+
+  DsrScopedDefault telemetry ("ns3::dsr-routing::Ipv4DSRRouting::Telemetry", BooleanValue (true));
+  DsrScopedDefault weight ("ns3::dsr-routing::Ipv4DSRRouting::TelemetryWeight", DoubleValue (0.25));
+  NodeContainer nodes;
+  nodes.Create (2);
+  InstallDsrStack (nodes);
+  PointToPointHelper p2p;
+  NetDeviceContainer devices = p2p.Install (nodes.Get (0), nodes.Get (1));
+  Ipv4AddressHelper address;
+  address.SetBase ("10.0.0.0", "255.255.255.252");
+  Ipv4InterfaceContainer interfaces = address.Assign (devices);
+  Ptr<Ipv4DSRRouting> routing = nodes.Get (1)->GetObject<DSRRouter> ()->GetRoutingProtocol ();
+  uint32_t interface = interfaces.Get (1).second;
+  Ipv4Address source = interfaces.GetAddress (0);
+  Ipv4Header header;
+  header.SetSource (source);
+  header.SetDestination (interfaces.GetAddress (1));
+
+  NS_TEST_ASSERT_MSG_EQ (routing->GetQueueingDelayEstimate (interface, source), 0, "Estimate before any packet");
+  Receive (routing, devices.Get (1), header, 1000);
+  NS_TEST_ASSERT_MSG_EQ (routing->GetQueueingDelayEstimate (interface, source), 1000, "The first sample is not the estimate");
+  Receive (routing, devices.Get (1), header, 2000);
+  NS_TEST_ASSERT_MSG_EQ (routing->GetQueueingDelayEstimate (interface, source), 1250, "Sample not weighted by TelemetryWeight");
+  Receive (routing, devices.Get (1), header, 0);
+  NS_TEST_ASSERT_MSG_EQ (routing->GetQueueingDelayEstimate (interface, source), 1250, "A packet without telemetry moved the estimate");
+  NS_TEST_ASSERT_MSG_EQ (routing->GetQueueingDelayEstimate (interface, Ipv4Address ("10.9.9.9")), 0,
+                         "Estimate for a source that sent nothing");
+  Simulator::Destroy ();
+}
+
+// Checks DSRRouteController on a square of routers, 0-1-3 and 0-2-3, where
+// node 0 reaches node 3 through node 2.  A backlog is loaded by hand in the
+// fast lane of node 2 towards node 3; the next poll must move the shortest
+// route of node 0 to node 1, and count the choice node 0 would still make
+// from its own queues as one the global view improves.
+class DsrRoutingControllerTestCase : public TestCase
+{
+public:
+  DsrRoutingControllerTestCase ();
+  virtual ~DsrRoutingControllerTestCase ();
+
+private:
+  virtual void DoRun (void);
+  /**
+   * Get the interface of the shortest route of a router to an address
+   * \param routing the routing protocol of the router
+   * \param dest the destination
+   * \return the outgoing interface, or the largest uint32_t if none
+   */
+  uint32_t GetBestInterface (Ptr<Ipv4DSRRouting> routing, Ipv4Address dest) const;
+  /**
+   * Enqueue packets in the fast lane of a queue disc
+   * \param queue the queue disc
+   * \param n the number of packets
+   */
+  void Load (Ptr<QueueDisc> queue, uint32_t n);
+  /**
+   * Dequeue one packet, which sets the sojourn time of its lane
+   * \param queue the queue disc
+   */
+  void Drain (Ptr<QueueDisc> queue);
+  /**
+   * Record the interface of the shortest route of node 0 to node 3
+   * \param routing the routing protocol of node 0
+   * \param dest the address of node 3
+   */
+  void RecordRoute (Ptr<Ipv4DSRRouting> routing, Ipv4Address dest);
+
+  std::vector<uint32_t> m_interfaces; //!< recorded interfaces of the shortest route
+};
+
+DsrRoutingControllerTestCase::DsrRoutingControllerTestCase ()
+  : TestCase ("DsrRouting route controller moves the routes off a loaded queue")
+{
+}
+
+DsrRoutingControllerTestCase::~DsrRoutingControllerTestCase ()
+{
+}
+
+uint32_t
+DsrRoutingControllerTestCase::GetBestInterface (Ptr<Ipv4DSRRouting> routing, Ipv4Address dest) const
+{
+  std::vector<Ipv4DSRRoutingTableEntry> routes;
+  routing->GetRoutes (Ipv4DSRRouting::HOST_ROUTES, routes);
+  routing->GetRoutes (Ipv4DSRRouting::NODE_ROUTES, routes);
+  uint32_t best = std::numeric_limits<uint32_t>::max ();
+  uint32_t interface = std::numeric_limits<uint32_t>::max ();
+  for (uint32_t r = 0; r < routes.size (); r++)
+    {
+      if (routes[r].GetDest () == dest && routes[r].GetDistance () < best)
+        {
+          best = routes[r].GetDistance ();
+          interface = routes[r].GetInterface ();
+        }
+    }
+  return interface;
+}
+
+void
+DsrRoutingControllerTestCase::Load (Ptr<QueueDisc> queue, uint32_t n)
+{
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Ptr<Packet> packet = Create<Packet> (100);
+      BudgetTag budgetTag;
+      budgetTag.SetBudget (1000000);
+      packet->AddPacketTag (budgetTag);
+      TimestampTag timestampTag;
+      timestampTag.SetTimestamp (Simulator::Now ());
+      packet->AddPacketTag (timestampTag);
+      PriorityTag priorityTag;
+      priorityTag.SetPriority (0);
+      packet->AddPacketTag (priorityTag);
+      queue->Enqueue (Create<Ipv4QueueDiscItem> (packet, Address (), Ipv4L3Protocol::PROT_NUMBER, Ipv4Header ()));
+    }
+}
+
+void
+DsrRoutingControllerTestCase::Drain (Ptr<QueueDisc> queue)
+{
+  queue->Dequeue ();
+}
+
+void
+DsrRoutingControllerTestCase::RecordRoute (Ptr<Ipv4DSRRouting> routing, Ipv4Address dest)
+{
+  m_interfaces.push_back (GetBestInterface (routing, dest));
+}
+
+void
+DsrRoutingControllerTestCase::DoRun (void)
+{
+  // Start () turns DsrIncrementalRouting on; bind it back afterwards.
+  DsrScopedGlobalValue incremental ("DsrIncrementalRouting", BooleanValue (false));
+  NodeContainer nodes;
+  std::vector<NetDeviceContainer> links;
+  // links 0-1, 0-2, 1-3 and 2-3, of metrics 1, 2, 3 and 1
+  BuildDsrMesh (2, nodes, &links, false);
+  TrafficControlHelper tch;
+  tch.SetRootQueueDisc ("ns3::DsrVirtualQueueDisc", "MaxSize", StringValue ("1000p"));
+  tch.Uninstall (links[3].Get (0));
+  Ptr<QueueDisc> queue = tch.Install (links[3].Get (0)).Get (0);
+  Ipv4DSRRoutingHelper::PopulateRoutingTables ();
+
+  Ptr<Ipv4> ipv4 = nodes.Get (0)->GetObject<Ipv4> ();
+  uint32_t viaNode1 = ipv4->GetInterfaceForDevice (links[0].Get (0));
+  uint32_t viaNode2 = ipv4->GetInterfaceForDevice (links[1].Get (0));
+  Ptr<Ipv4> ipv4Dest = nodes.Get (3)->GetObject<Ipv4> ();
+  Ipv4Address dest = ipv4Dest->GetAddress (ipv4Dest->GetInterfaceForDevice (links[3].Get (1)), 0).GetLocal ();
+  Ptr<Ipv4DSRRouting> routing = nodes.Get (0)->GetObject<DSRRouter> ()->GetRoutingProtocol ();
+
+  Ptr<DSRRouteController> controller = CreateObject<DSRRouteController> ();
+  controller->Start ();
+  BooleanValue enabled;
+  GlobalValue::GetValueByName ("DsrIncrementalRouting", enabled);
+  NS_TEST_ASSERT_MSG_EQ (enabled.Get (), true, "The controller would recompute every route at each update");
+
+  // 10 packets wait in the fast lane, and the one dequeued spent 5 ms in it.
+  Simulator::Schedule (Seconds (1), &DsrRoutingControllerTestCase::RecordRoute, this, routing, dest);
+  Simulator::Schedule (Seconds (1), &DsrRoutingControllerTestCase::Load, this, queue, 11);
+  Simulator::Schedule (Seconds (1.005), &DsrRoutingControllerTestCase::Drain, this, queue);
+  Simulator::Schedule (Seconds (1.15), &DsrRoutingControllerTestCase::RecordRoute, this, routing, dest);
+  Simulator::Stop (Seconds (1.15));
+  Simulator::Run ();
+
+  NS_TEST_ASSERT_MSG_EQ (m_interfaces.size (), 2, "Routes not recorded");
+  NS_TEST_ASSERT_MSG_EQ (m_interfaces[0], viaNode2, "Node 0 should first reach node 3 through node 2");
+  NS_TEST_ASSERT_MSG_EQ (m_interfaces[1], viaNode1, "The loaded queue did not move the route through node 1");
+  NS_TEST_ASSERT_MSG_EQ (controller->GetUpdates (), 1, "One update expected, after the queue was loaded");
+  NS_TEST_ASSERT_MSG_EQ (controller->GetChangedLinks (), 1, "Only the loaded interface changed");
+  NS_TEST_ASSERT_MSG_GT (controller->GetImprovedDecisions (), 0, "The global view improved no route choice");
+  NS_TEST_ASSERT_MSG_GT (controller->GetMeanGain (), Time (0), "No gain from the global view");
+  controller->Stop ();
+  Simulator::Destroy ();
+}
+
 // The TestSuite class names the TestSuite, identifies what type of TestSuite,
 // and enables the TestCases to be run.  Typically, only the constructor for
 // this class must be defined
@@ -61,6 +1736,23 @@ DsrRoutingTestSuite::DsrRoutingTestSuite ()
 {
   // TestDuration for TestCase can be QUICK, EXTENSIVE or TAKES_FOREVER
   AddTestCase (new DsrRoutingTestCase1, TestCase::QUICK);
+  AddTestCase (new DsrRoutingScalingTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingDistanceMatrixTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingFastRerouteTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingThreadsTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingKShortestPathsTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingIncrementalTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingBestEffortTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingLinkMetricTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingImageTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingLSAExchangeTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingLinkStateTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingTelemetryTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingControllerTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingCoalescingTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingApplyRoutesTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingNodeRoutesTestCase, TestCase::QUICK);
+  AddTestCase (new DsrRoutingLazyTestCase, TestCase::QUICK);
 }
 
 // Do not forget to allocate an instance of this TestSuite